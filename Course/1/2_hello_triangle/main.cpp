@@ -8,6 +8,12 @@
     or additional includes. It's also the fastest way to draw a triangle on the screen 
     at this point. Since we just want to make sure our OpenGL is up and running, we 
     are going to use legacy OpenGL. It's perfectly fine to use it for debugging.
+
+    A core profile context (which the later lessons ask for) doesn't have glBegin
+    at all, and every glVertex is a separate call into the driver. The engine in
+    Course/4 keeps this style of drawing for its debug lines, but on top of a
+    vertex buffer: see ImmediateMode.h, where imm.Begin/imm.Vertex2d/imm.End
+    collect the vertices and the whole frame's worth is drawn at once.
 */
 
 
@@ -82,7 +82,12 @@ int main()
         /* Render here */
         glClear(GL_COLOR_BUFFER_BIT);
 
-        /* Drawing a trianle */
+        /*
+            Drawing a trianle, still the legacy way. With a core profile this
+            has to go through buffers, which is where the next lessons go (and
+            Course/4/1_engine/src/ImmediateMode.h, which keeps the
+            Begin/Vertex/End style on top of them).
+        */
         glBegin(GL_TRIANGLES);
         glVertex2d(-0.5f, -0.5f);
         glVertex2d(0.0f, 0.5f);
@@ -114,16 +114,19 @@ int main() {
     // calling this function only once.
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
     
-    // Enables the buffer.
-    glEnableVertexAttribArray(1);
+    // Enables the attribute. The index has to be the one we just described
+    // (0); enabling any other one leaves the position disabled, and nothing
+    // is drawn.
+    glEnableVertexAttribArray(0);
 
     while(!glfwWindowShouldClose(window)) {
         glClear(GL_COLOR_BUFFER_BIT);
 
-        // We still need a shader, so this won't work. However, some GPU drivers
-        // will provide you with a default shader, so on some systems, this might
-        // work already.
-        // glDrawArrays(GL_TRIANGLES, 0, 3);
+        // We still need a shader, so strictly speaking this shouldn't work.
+        // However, most drivers give you a default shader in the default
+        // (compatibility) context: attribute 0 is taken as the position, and
+        // the triangle comes out white.
+        glDrawArrays(GL_TRIANGLES, 0, 3);
 
         /* Swap front and back buffers */
         glfwSwapBuffers(window);
@@ -1,5 +1,6 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -178,8 +179,20 @@ int main() {
     // "Selecting" that context.
     glfwMakeContextCurrent(window);
 
-    // Adjusts framerate (????)
-    glfwSwapInterval(1);
+    // How many screen refreshes to wait before a swap: 1 is vsync (no tearing,
+    // at most the screen's rate), 0 swaps right away (as fast as possible, with
+    // tearing), -1 is adaptive vsync (late frames tear instead of waiting a
+    // whole refresh) where the driver has *_EXT_swap_control_tear.
+    // SWAP_INTERVAL=0 (or -1) tries the others.
+    int swapInterval = 1;
+    if (const char* interval = std::getenv("SWAP_INTERVAL")) {
+        swapInterval = std::atoi(interval);
+    }
+    if (swapInterval < 0 && !glfwExtensionSupported("WGL_EXT_swap_control_tear") &&
+        !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+        swapInterval = 1;
+    }
+    glfwSwapInterval(swapInterval);
 
     // Initializing glew.
     GLenum err = glewInit();
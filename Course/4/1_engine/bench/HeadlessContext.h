@@ -0,0 +1,117 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <iostream>
+
+/*
+    An OpenGL 4.5 core context for the GPU benchmarks, without a window.
+    EGL's surfaceless platform (Mesa) gives us a context with no default
+    framebuffer, so we draw into our own one: a color and a depth
+    renderbuffer of the requested size.
+
+    Without a GPU (or with LIBGL_ALWAYS_SOFTWARE=1) Mesa runs it on
+    llvmpipe, so the numbers are CPU numbers, but the same calls go through
+    the same driver paths as on real hardware.
+
+    CreateSharedContext gives another context sharing this one's objects,
+    for a second thread to make current (BackgroundLoader.h).
+*/
+
+class HeadlessContext {
+public:
+    HeadlessContext(int width, int height) : m_Width(width), m_Height(height) {
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (!getPlatformDisplay) {
+            std::cerr << "EGL has no eglGetPlatformDisplayEXT" << std::endl;
+            return;
+        }
+        m_Display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (m_Display == EGL_NO_DISPLAY || !eglInitialize(m_Display, nullptr, nullptr) ||
+            !eglBindAPI(EGL_OPENGL_API)) {
+            std::cerr << "Can't initialize EGL" << std::endl;
+            return;
+        }
+
+        m_Context = CreateContext(EGL_NO_CONTEXT);
+        if (m_Context == EGL_NO_CONTEXT || !eglMakeCurrent(m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_Context)) {
+            std::cerr << "Can't create an OpenGL 4.5 context" << std::endl;
+            return;
+        }
+
+        // GLEW looks for a GLX display as well, which we don't have and don't need.
+        glewExperimental = GL_TRUE;
+        GLenum err = glewInit();
+        if (err != GLEW_OK && err != GLEW_ERROR_NO_GLX_DISPLAY) {
+            std::cerr << glewGetErrorString(err) << std::endl;
+            return;
+        }
+        while (glGetError() != GL_NO_ERROR);
+
+        glCreateRenderbuffers(2, m_Renderbuffers);
+        glNamedRenderbufferStorage(m_Renderbuffers[0], GL_RGBA8, width, height);
+        glNamedRenderbufferStorage(m_Renderbuffers[1], GL_DEPTH_COMPONENT24, width, height);
+        glCreateFramebuffers(1, &m_Framebuffer);
+        glNamedFramebufferRenderbuffer(m_Framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_Renderbuffers[0]);
+        glNamedFramebufferRenderbuffer(m_Framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_Renderbuffers[1]);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+        glViewport(0, 0, width, height);
+        m_Valid = glCheckNamedFramebufferStatus(m_Framebuffer, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    }
+
+    ~HeadlessContext() {
+        if (m_Framebuffer) {
+            glDeleteFramebuffers(1, &m_Framebuffer);
+            glDeleteRenderbuffers(2, m_Renderbuffers);
+        }
+        if (m_Context != EGL_NO_CONTEXT) {
+            eglMakeCurrent(m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(m_Display, m_Context);
+        }
+        if (m_Display != EGL_NO_DISPLAY) {
+            eglTerminate(m_Display);
+        }
+    }
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    bool IsValid() const { return m_Valid; }
+    int GetWidth() const { return m_Width; }
+    int GetHeight() const { return m_Height; }
+    // Where everything is drawn in the end, our stand-in for framebuffer 0.
+    GLuint GetFramebuffer() const { return m_Framebuffer; }
+
+    // "llvmpipe (LLVM 15.0.6, 256 bits)" and the like.
+    const char* GetRenderer() const { return (const char*)glGetString(GL_RENDERER); }
+
+    // EGL_NO_CONTEXT if it can't be made.
+    EGLContext CreateSharedContext() { return CreateContext(m_Context); }
+    // On the thread that uses the context; EGL_NO_CONTEXT releases it.
+    bool MakeCurrent(EGLContext context) {
+        return eglMakeCurrent(m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+    }
+    // Must not be current on any thread.
+    void DestroySharedContext(EGLContext context) { eglDestroyContext(m_Display, context); }
+
+private:
+    EGLContext CreateContext(EGLContext share) {
+        const EGLint attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 5,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        return eglCreateContext(m_Display, EGL_NO_CONFIG_KHR, share, attributes);
+    }
+
+    int m_Width;
+    int m_Height;
+    bool m_Valid = false;
+    EGLDisplay m_Display = EGL_NO_DISPLAY;
+    EGLContext m_Context = EGL_NO_CONTEXT;
+    GLuint m_Framebuffer = 0;
+    GLuint m_Renderbuffers[2] = {};
+};
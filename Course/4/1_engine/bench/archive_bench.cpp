@@ -0,0 +1,87 @@
+/*
+    Reading many small files one by one versus reading them from one packed
+    archive (headless).
+
+    We write a few thousand shader-sized text files into bin/bench_res, pack
+    them into bin/bench_res.pak, and then read every file both ways. The page
+    cache is warm for both, so this measures the system call overhead; on a
+    cold start (or a slow disk) the difference is much bigger.
+
+    Usage: archive_bench [file count]
+*/
+
+#include "../src/Archive.h"
+#include "../src/Timing.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char* argv[]) {
+    const int count = argc > 1 ? std::atoi(argv[1]) : 4000;
+    const std::string directory = "bin/bench_res";
+
+    fs::remove_all(directory);
+    fs::create_directories(directory + "/shaders");
+
+    std::vector<ArchiveInput> files;
+    std::vector<std::string> paths;
+    for (int i = 0; i < count; i++) {
+        std::string text = "#shader vertex\n#version 330 core\n";
+        for (int line = 0; line < 20 + i % 200; line++) {
+            text += "uniform vec4 u_Value" + std::to_string(line) + "; // " + std::to_string(i * 31 + line) + "\n";
+        }
+
+        std::string path = directory + "/shaders/shader" + std::to_string(i) + ".shader";
+        std::ofstream(path, std::ios::binary) << text;
+        paths.push_back(path);
+        files.push_back({path, std::vector<unsigned char>(text.begin(), text.end()), true});
+    }
+
+    if (!WriteArchive(directory + ".pak", files)) {
+        std::cerr << "Can't write " << directory << ".pak (run from the engine directory)" << std::endl;
+        return 1;
+    }
+
+    size_t looseBytes = 0;
+    auto start = Clock::now();
+    for (const std::string& path : paths) {
+        std::ifstream input(path, std::ios::binary);
+        std::vector<unsigned char> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        looseBytes += data.size();
+    }
+    double looseTime = Milliseconds(start);
+
+    size_t archiveBytes = 0;
+    bool identical = true;
+    start = Clock::now();
+    Archive archive;
+    archive.Open(directory + ".pak");
+    std::vector<unsigned char> data;
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (!archive.Read(paths[i], data)) {
+            identical = false;
+        }
+        archiveBytes += data.size();
+    }
+    double archiveTime = Milliseconds(start);
+
+    // Make sure we got the same bytes back (outside of the timing).
+    for (const ArchiveInput& file : files) {
+        identical = identical && archive.Read(file.Path, data) && data == file.Data;
+    }
+
+    std::cout << "files:          " << count << "\n"
+              << "loose files:    " << looseTime << " ms (" << looseBytes / 1024 << " KB)\n"
+              << "archive:        " << archiveTime << " ms (" << archiveBytes / 1024 << " KB, "
+              << fs::file_size(directory + ".pak") / 1024 << " KB on disk)\n"
+              << "speedup:        " << looseTime / archiveTime << "x\n"
+              << "contents match: " << (identical ? "yes" : "NO") << std::endl;
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,280 @@
+/*
+    Many small meshes: one set of buffers each (CreateMesh) against one
+    MeshArena for all of them.
+
+    Every mesh is a small bumpy grid of its own size (4 to 100 vertices),
+    drawn side by side on a 100 x 100 raster.
+    - separate: CreateMesh per mesh, then a glBindVertexArray and a
+                glDrawElements per draw.
+    - arena:    MeshArena::Add per mesh, one Bind() per frame and a
+                glDrawElementsBaseVertex per draw. Must give the same image.
+    - churn:    half of the meshes are removed at random and as many new
+                ones of other sizes added, into an arena with little room to
+                spare. That leaves holes too small for a few big meshes. Then Defragment(): the image must not change, there
+                must be no fragmentation left, and big meshes that found no
+                hole before must fit now.
+    - allocator: RangeAllocator alone, random frees and allocations in a
+                half full space.
+
+    Usage: arena_bench [meshes] [frames]
+*/
+
+#include "HeadlessContext.h"
+
+#include "../src/Math.h"
+#include "../src/Mesh.h"
+#include "../src/MeshArena.h"
+#include "../src/RangeAllocator.h"
+#include "../src/Renderer.h"
+#include "../src/ResourcePool.h"
+#include "../src/Shader.h"
+#include "../src/Timing.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+struct Patch {
+    std::vector<float> Vertices;
+    std::vector<uint16_t> Indices;
+};
+
+// size x size vertices in the unit square, with a random height.
+static Patch MakePatch(int size, std::mt19937& random) {
+    Patch patch;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            float height = (random() % 1000) / 4000.0f;
+            patch.Vertices.insert(patch.Vertices.end(), {x / (size - 1.0f), y / (size - 1.0f), height});
+        }
+    }
+    for (int y = 0; y + 1 < size; y++) {
+        for (int x = 0; x + 1 < size; x++) {
+            uint16_t a = (uint16_t)(y * size + x), b = a + 1, c = a + size + 1, d = a + size;
+            patch.Indices.insert(patch.Indices.end(), {a, b, c, a, c, d});
+        }
+    }
+    return patch;
+}
+
+static MeshLayout PatchLayout() {
+    MeshLayout layout = {};
+    layout.Stride = 3 * sizeof(float);
+    layout.AttributeCount = 1;
+    layout.Attributes[0] = {0, 3, AttributeType::Float, 0, 0};
+    return layout;
+}
+
+// What LoadMeshFile would give for the patch.
+static void MakeFile(const Patch& patch, MeshFile& file) {
+    file.Layout = PatchLayout();
+    file.VertexCount = (uint32_t)patch.Vertices.size() / 3;
+    file.IndexCount = (uint32_t)patch.Indices.size();
+    file.IndexSize = 2;
+    file.BoundsMin = {0.0f, 0.0f, 0.0f};
+    file.BoundsMax = {1.0f, 1.0f, 0.25f};
+    file.LodCount = 1;
+    file.Lods[0] = {0, file.IndexCount, 0.0f, 0};
+    file.Vertices = (const unsigned char*)patch.Vertices.data();
+    file.VertexBytes = patch.Vertices.size() * sizeof(float);
+    file.Indices = (const unsigned char*)patch.Indices.data();
+    file.IndexBytes = patch.Indices.size() * sizeof(uint16_t);
+}
+
+// Where mesh i goes on the screen (straight into clip space).
+static Mat4 PlaceMesh(int i) {
+    const int columns = 100;
+    float size = 2.0f / columns;
+    return Translate({-1.0f + (i % columns) * size, -1.0f + (i / columns % columns) * size, 0.0f}) *
+           Scale({size * 0.9f, size * 0.9f, 1.0f});
+}
+
+static std::vector<unsigned char> ReadImage(int width, int height) {
+    std::vector<unsigned char> image(width * height * 4);
+    GLCall(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, image.data()));
+    return image;
+}
+
+int main(int argc, char* argv[]) {
+    const int count = argc > 1 ? std::atoi(argv[1]) : 10000;
+    const int frames = argc > 2 ? std::atoi(argv[2]) : 3;
+
+    HeadlessContext context(800, 800);
+    if (!context.IsValid()) {
+        return 1;
+    }
+    std::cout << "renderer:  " << context.GetRenderer() << "\n";
+
+    ProgramReflection reflection;
+    SetProgramCacheDirectory("");
+    GLuint basic = LoadProgram("res/shaders/Basic.shader", reflection);
+    GLint mvpLocation, colorLocation;
+    if (!basic || !ValidateUniform(reflection, "u_MVP", GL_FLOAT_MAT4, &mvpLocation) ||
+        !ValidateUniform(reflection, "u_Color", GL_FLOAT_VEC4, &colorLocation)) {
+        return 1;
+    }
+    GLCall(glUseProgram(basic));
+    GLCall(glUniform4f(colorLocation, 0.8f, 0.5f, 0.2f, 1.0f));
+    GLCall(glEnable(GL_DEPTH_TEST));
+
+    std::mt19937 random(7);
+    std::vector<Patch> patches;
+    for (int i = 0; i < count; i++) {
+        patches.push_back(MakePatch(2 + random() % 9, random));
+    }
+
+    // Draws mesh i of ids at place i; NoMesh leaves the place empty.
+    auto render = [&](auto&& draw, size_t meshes) {
+        GLCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+        for (size_t i = 0; i < meshes; i++) {
+            Mat4 mvp = PlaceMesh((int)i);
+            GLCall(glUniformMatrix4fv(mvpLocation, 1, GL_FALSE, mvp.Data));
+            draw(i);
+        }
+        GLCall(glFinish());
+    };
+    auto time = [&](auto&& draw, size_t meshes) {
+        render(draw, meshes);
+        auto start = Clock::now();
+        for (int frame = 0; frame < frames; frame++) {
+            render(draw, meshes);
+        }
+        return Milliseconds(start) / frames;
+    };
+
+    bool valid = true;
+    std::vector<unsigned char> separateImage;
+    {
+        std::vector<Mesh> meshes(count);
+        auto start = Clock::now();
+        for (int i = 0; i < count; i++) {
+            MeshFile file;
+            MakeFile(patches[i], file);
+            valid = valid && CreateMesh(file, meshes[i]);
+        }
+        GLCall(glFinish());
+        double createTime = Milliseconds(start);
+        double frameTime = time([&](size_t i) { DrawMesh(meshes[i]); }, meshes.size());
+        separateImage = ReadImage(800, 800);
+        std::cout << "separate:  " << count * 3 << " buffers, " << count << " vertex arrays, created in "
+                  << createTime << " ms, " << frameTime << " ms per frame\n";
+        for (Mesh& mesh : meshes) {
+            DeleteMesh(mesh);
+        }
+    }
+
+    ResourcePool resources;
+    {
+        // About 5% more than the meshes need.
+        size_t vertexBytes = 0, indexBytes = 0;
+        for (const Patch& patch : patches) {
+            vertexBytes += patch.Vertices.size() * sizeof(float);
+            indexBytes += (patch.Indices.size() * sizeof(uint16_t) + 3) / 4 * 4;
+        }
+        MeshArena arena(resources, "patches", PatchLayout(), (uint32_t)(vertexBytes * 1.05),
+                        (uint32_t)(indexBytes * 1.05));
+        std::vector<uint32_t> ids(count);
+        auto start = Clock::now();
+        for (int i = 0; i < count; i++) {
+            MeshFile file;
+            MakeFile(patches[i], file);
+            ids[i] = arena.Add(file);
+            valid = valid && ids[i] != MeshArena::NoMesh;
+        }
+        GLCall(glFinish());
+        double createTime = Milliseconds(start);
+        auto drawArena = [&](size_t i) {
+            if (ids[i] != MeshArena::NoMesh) {
+                arena.Draw(ids[i]);
+            }
+        };
+        arena.Bind();
+        double frameTime = time(drawArena, ids.size());
+        bool same = ReadImage(800, 800) == separateImage;
+        valid = valid && same;
+        std::cout << "arena:     2 buffers, 1 vertex array, created in " << createTime << " ms, " << frameTime
+                  << " ms per frame, " << (same ? "same image" : "DIFFERENT IMAGE") << "\n";
+
+        // Half of them go, and new ones of other sizes take their place.
+        size_t homeless = 0;
+        for (int i = 0; i < count; i++) {
+            if (random() % 2) {
+                arena.Remove(ids[i]);
+                patches[i] = MakePatch(2 + random() % 9, random);
+                MeshFile file;
+                MakeFile(patches[i], file);
+                ids[i] = arena.Add(file);
+                homeless += ids[i] == MeshArena::NoMesh;
+            }
+        }
+
+        // Then a few big ones (not drawn). There is room for all of them,
+        // but not in one piece.
+        const int bigCount = 16;
+        Patch big = MakePatch(24, random);
+        MeshFile bigFile;
+        MakeFile(big, bigFile);
+        int bigPlaced = 0;
+        for (int i = 0; i < bigCount; i++) {
+            bigPlaced += arena.Add(bigFile) != MeshArena::NoMesh;
+        }
+        std::cout << "churn:     " << homeless << " new meshes and " << bigCount - bigPlaced << " of " << bigCount
+                  << " big ones found no hole\n";
+        arena.PrintStats(std::cout);
+        render(drawArena, ids.size());
+        std::vector<unsigned char> before = ReadImage(800, 800);
+
+        start = Clock::now();
+        arena.Defragment();
+        GLCall(glFinish());
+        double defragmentTime = Milliseconds(start);
+        resources.EndFrame();
+
+        arena.Bind();
+        render(drawArena, ids.size());
+        same = ReadImage(800, 800) == before;
+        MeshArenaStats stats = arena.GetStats();
+        valid = valid && same && stats.VertexLargestFree == stats.VertexBytes - stats.VertexBytesUsed &&
+                stats.IndexLargestFree == stats.IndexBytes - stats.IndexBytesUsed;
+        std::cout << "defragment: " << defragmentTime << " ms, " << (same ? "same image" : "DIFFERENT IMAGE") << "\n";
+        arena.PrintStats(std::cout);
+
+        int placed = 0;
+        for (int i = bigPlaced; i < bigCount; i++) {
+            placed += arena.Add(bigFile) != MeshArena::NoMesh;
+        }
+        valid = valid && homeless == 0 && placed == bigCount - bigPlaced;
+        std::cout << "refill:    " << placed << " of the " << bigCount - bigPlaced << " big meshes fit now\n";
+    }
+
+    {
+        RangeAllocator allocator(1 << 24);
+        std::vector<RangeAllocator::Allocation> live;
+        std::vector<uint32_t> sizes(1 << 16);
+        for (uint32_t& size : sizes) {
+            size = 1 + random() % 512;
+        }
+        // 32768 allocations of 256 on average: half of the space.
+        for (int i = 0; i < 32768; i++) {
+            live.push_back(allocator.Allocate(sizes[i]));
+        }
+        const int rounds = 1 << 21;
+        size_t failed = 0;
+        auto start = Clock::now();
+        for (int i = 0; i < rounds; i++) {
+            size_t k = (i * 40503u) % live.size();
+            allocator.Free(live[k]);
+            live[k] = allocator.Allocate(sizes[i & 0xffff]);
+            failed += live[k].Node == RangeAllocator::NoSpace;
+        }
+        std::cout << "allocator: " << Milliseconds(start) * 1e6 / (2.0 * rounds) << " ns per allocation or free, "
+                  << (1.0 - (double)allocator.GetLargestFreeBlock() / allocator.GetFreeSize())
+                  << " fragmentation, " << failed << " failed\n";
+    }
+
+    GLCall(glDeleteProgram(basic));
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << "\n";
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,226 @@
+/*
+    Recording frames without waiting for them (FrameCapture.h).
+
+    Every frame is cleared to a color of its own and a few full screen
+    quads are blended over it, so the GPU has something to do. Then:
+    - none:     no capture, what a frame costs on its own.
+    - sync:     glReadPixels into memory before every "swap", the obvious
+                way; the CPU waits for the GPU each frame.
+    - async:    FrameCapture into a Y4M file: the PBO ring, the fences and
+                the writer thread.
+    The time on the render thread is what counts, over "none". On a real
+    GPU async costs little more than none. On llvmpipe the "GPU" is the CPU:
+    glReadPixels into the PBO draws the frame then and there, and with one
+    core the writer thread takes its time from the render thread too, so
+    only the correctness is checked. The Y4M file is read back: every frame
+    in it must be one solid color, one of the frames drawn, in the order
+    they were drawn. The names of a PNG sequence are checked too, with
+    targets that would be bad printf formats.
+
+    Usage: capture_bench [frames] [width] [height]
+*/
+
+#include "HeadlessContext.h"
+
+#include "../src/FrameCapture.h"
+#include "../src/Renderer.h"
+#include "../src/Shader.h"
+#include "../src/Timing.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Full screen quads blended over the clear color, per frame.
+static const int OVERDRAW = 4;
+
+static const char* VERTEX_SHADER = R"(#version 450 core
+void main() {
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 4.0 - 1.0;
+    gl_Position = vec4(corner, 0.0, 1.0);
+}
+)";
+
+// Transparent, so the frames stay the clear color.
+static const char* FRAGMENT_SHADER = R"(#version 450 core
+out vec4 color;
+void main() {
+    color = vec4(sin(gl_FragCoord.x), cos(gl_FragCoord.y), 0.5, 0.0);
+}
+)";
+
+static void FrameColor(int frame, unsigned char rgb[3]) {
+    rgb[0] = (unsigned char)(frame * 7);
+    rgb[1] = (unsigned char)(255 - frame * 3);
+    rgb[2] = (unsigned char)(frame * 13 + 64);
+}
+
+// The Y of FrameCapture's conversion.
+static int Luma(const unsigned char rgb[3]) {
+    return (77 * rgb[0] + 150 * rgb[1] + 29 * rgb[2] + 128) >> 8;
+}
+
+static void DrawFrame(int frame, GLuint program) {
+    unsigned char rgb[3];
+    FrameColor(frame, rgb);
+    GLCall(glClearColor(rgb[0] / 255.0f, rgb[1] / 255.0f, rgb[2] / 255.0f, 1.0f));
+    GLCall(glClear(GL_COLOR_BUFFER_BIT));
+    GLCall(glUseProgram(program));
+    for (int i = 0; i < OVERDRAW; i++) {
+        GLCall(glDrawArrays(GL_TRIANGLES, 0, 3));
+    }
+}
+
+// GetCaptureFileName against the names it must give; "" for a bad target.
+static bool CheckFileNames() {
+    static const char* cases[][2] = {
+        {"frames/frame_%05d.png", "frames/frame_00042.png"},
+        {"shot%d.png", "shot42.png"},
+        {"capture.png", "capture_00042.png"},
+        {"%s%n.png", ""},
+        {"frame_%05d_%d.png", ""},
+        {"frame_%5d.png", ""},
+        {"frame_%x.png", ""},
+        {"100%.png", ""},
+    };
+    bool valid = true;
+    for (const auto& test : cases) {
+        std::string name = GetCaptureFileName(test[0], 42);
+        if (name != test[1]) {
+            std::cout << "file name: \"" << test[0] << "\" gave \"" << name << "\", not \"" << test[1] << "\"\n";
+            valid = false;
+        }
+    }
+    return valid;
+}
+
+// Reads the Y4M file back; false if it isn't what was drawn.
+static bool CheckStream(const std::string& path, int width, int height, int frames, size_t expected) {
+    std::ifstream file(path, std::ios::binary);
+    std::string header;
+    std::getline(file, header);
+    char expectedHeader[128];
+    std::snprintf(expectedHeader, sizeof(expectedHeader), "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C420jpeg", width,
+                  height);
+    if (header != expectedHeader) {
+        std::cout << "header:    \"" << header << "\"\n";
+        return false;
+    }
+    size_t planes = (size_t)width * height + 2 * (size_t)((width + 1) / 2) * ((height + 1) / 2);
+    std::vector<unsigned char> frame(planes);
+    std::string marker;
+    size_t count = 0;
+    int next = 0;
+    while (std::getline(file, marker)) {
+        if (marker != "FRAME" || !file.read((char*)frame.data(), planes)) {
+            std::cout << "stream:    frame " << count << " is broken\n";
+            return false;
+        }
+        for (size_t i = 0; i < (size_t)width * height; i++) {
+            if (frame[i] != frame[0]) {
+                std::cout << "stream:    frame " << count << " isn't one color\n";
+                return false;
+            }
+        }
+        // The frames drawn since the last one written were dropped.
+        unsigned char rgb[3];
+        while (next < frames && (FrameColor(next, rgb), Luma(rgb)) != frame[0]) {
+            next++;
+        }
+        if (next == frames) {
+            std::cout << "stream:    frame " << count << " (Y " << (int)frame[0] << ") wasn't drawn, or not then\n";
+            return false;
+        }
+        next++;
+        count++;
+    }
+    if (count != expected) {
+        std::cout << "stream:    " << count << " frames, " << expected << " written\n";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 300;
+    const int width = argc > 2 ? std::atoi(argv[2]) : 640;
+    const int height = argc > 3 ? std::atoi(argv[3]) : 360;
+
+    HeadlessContext context(width, height);
+    if (!context.IsValid()) {
+        return 1;
+    }
+    std::cout << "renderer:  " << context.GetRenderer() << "\n";
+    std::cout << "frames:    " << frames << " at " << width << "x" << height << "\n";
+
+    GLuint program = CreateShader(VERTEX_SHADER, FRAGMENT_SHADER);
+    GLuint vertexArray;
+    GLCall(glCreateVertexArrays(1, &vertexArray));
+    GLCall(glBindVertexArray(vertexArray));
+    GLCall(glEnable(GL_BLEND));
+    GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, context.GetFramebuffer()));
+    GLCall(glViewport(0, 0, width, height));
+
+    // The "swap" of a window without one: the driver may start the frame.
+    auto swap = [] { GLCall(glFlush()); };
+
+    Clock::time_point start = Clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        DrawFrame(frame, program);
+        swap();
+    }
+    GLCall(glFinish());
+    double none = Milliseconds(start) / frames;
+
+    std::vector<unsigned char> pixels((size_t)width * height * 4);
+    start = Clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        DrawFrame(frame, program);
+        GLCall(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data()));
+        swap();
+    }
+    GLCall(glFinish());
+    double sync = Milliseconds(start) / frames;
+
+    const std::string path = "capture_bench.y4m";
+    FrameCaptureStats stats;
+    start = Clock::now();
+    {
+        FrameCapture capture(GetCaptureSettings(path));
+        for (int frame = 0; frame < frames; frame++) {
+            DrawFrame(frame, program);
+            capture.Capture(context.GetFramebuffer(), width, height);
+            swap();
+        }
+        GLCall(glFinish());
+        double async = Milliseconds(start) / frames;
+        capture.Finish();
+        stats = capture.GetStats();
+
+        std::cout << "none:      " << none << " ms per frame\n";
+        std::cout << "sync:      " << sync << " ms per frame, " << sync - none << " over none\n";
+        std::cout << "async:     " << async << " ms per frame, " << async - none << " over none, "
+                  << stats.RenderThreadMs / frames << " in Capture\n";
+        std::cout << "writer:    " << stats.WriterMs / std::max<size_t>(stats.Written, 1) << " ms per frame, "
+                  << stats.BytesWritten / 1e6 << " MB\n";
+        std::cout << "frames:    " << stats.Captured << " captured, " << stats.Written << " written, "
+                  << stats.Dropped << " dropped, " << stats.Stalls << " stalls (" << stats.StallMs << " ms)\n";
+        capture.PrintReport(std::cout);
+    }
+
+    bool valid = stats.Written == stats.Captured && stats.WriteErrors == 0 &&
+                 stats.Captured + stats.Dropped == (size_t)frames && stats.Written > 0;
+    valid = CheckStream(path, width, height, frames, stats.Written) && valid;
+    valid = CheckFileNames() && valid;
+    std::remove(path.c_str());
+
+    GLCall(glDeleteVertexArrays(1, &vertexArray));
+    GLCall(glDeleteProgram(program));
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << "\n";
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+/*
+    Compares getting a texture ready for upload from a plain image versus
+    from a memory mapped block compressed container (headless, no GPU).
+
+    - uncompressed: read the TGA and decode it to RGBA, like TextureUploader does.
+      The GPU then needs the RGBA image plus a generated mip chain (+1/3).
+    - compressed:   mmap the DDS and parse the header. We also touch every cache line
+      once, since the driver has to read the blocks when we upload them.
+    - fallback:     compressed, but decoded back to RGBA on the CPU for drivers
+      that don't know the format.
+
+    The input is a procedural image written into bin/ on first run.
+
+    EncodeBC1 always writes c0 > c1, the 4 color mode, so a hand made block
+    with c0 <= c1 checks the 3 color mode of the decoder too: BC1 black is
+    opaque, BC1_RGBA black is transparent, and BC3 ignores the order.
+
+    Usage: compressed_texture_bench [size] [iterations]
+*/
+
+#include "../src/BlockCompression.h"
+#include "../src/Image.h"
+#include "../src/TextureContainer.h"
+#include "../src/Timing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+// Writes an uncompressed 32 bit TGA, bottom row first.
+static void SaveTGA(const char* filepath, int width, int height, const std::vector<unsigned char>& rgba) {
+    unsigned char header[18] = {0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                (unsigned char)width, (unsigned char)(width >> 8),
+                                (unsigned char)height, (unsigned char)(height >> 8), 32, 8};
+    std::vector<unsigned char> bgra(rgba.size());
+    for (size_t i = 0; i < rgba.size(); i += 4) {
+        bgra[i] = rgba[i + 2];
+        bgra[i + 1] = rgba[i + 1];
+        bgra[i + 2] = rgba[i];
+        bgra[i + 3] = rgba[i + 3];
+    }
+    std::ofstream output(filepath, std::ios::binary);
+    output.write((const char*)header, sizeof(header));
+    output.write((const char*)bgra.data(), bgra.size());
+}
+
+// c0 is blue and c1 red (c0 < c1); the first four pixels use indices 0 to 3.
+static bool CheckThreeColorBlocks() {
+    const unsigned char color[8] = {0x1F, 0x00, 0x00, 0xF8, 0xE4, 0, 0, 0};
+    unsigned char bc3[16] = {255, 255};
+    std::copy(color, color + 8, bc3 + 8);
+
+    struct Case {
+        BlockFormat Format;
+        const unsigned char* Block;
+        unsigned char Expected[4][4];
+    };
+    const Case cases[] = {
+        {BlockFormat::BC1, color, {{0, 0, 255, 255}, {255, 0, 0, 255}, {127, 0, 127, 255}, {0, 0, 0, 255}}},
+        {BlockFormat::BC1_RGBA, color, {{0, 0, 255, 255}, {255, 0, 0, 255}, {127, 0, 127, 255}, {0, 0, 0, 0}}},
+        {BlockFormat::BC3, bc3, {{0, 0, 255, 255}, {255, 0, 0, 255}, {85, 0, 170, 255}, {170, 0, 85, 255}}},
+    };
+    bool valid = true;
+    for (const Case& c : cases) {
+        unsigned char rgba[4 * 4 * 4];
+        DecodeBlocks(c.Format, 4, 4, c.Block, rgba);
+        valid = valid && std::equal(rgba, rgba + 16, &c.Expected[0][0]);
+    }
+    return valid;
+}
+
+int main(int argc, char* argv[]) {
+    const int size = argc > 1 ? std::atoi(argv[1]) : 2048;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 10;
+    const char* tgaPath = "bin/bench_texture.tga";
+    const char* ddsPath = "bin/bench_texture.dds";
+
+    // Smooth gradients with some noise, roughly like a real photo texture.
+    std::vector<unsigned char> source((size_t)size * size * 4);
+    unsigned int seed = 12345;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            seed = seed * 1664525u + 1013904223u;
+            int noise = (int)(seed >> 28) - 8;
+            unsigned char* p = &source[((size_t)y * size + x) * 4];
+            p[0] = (unsigned char)std::min(255, std::max(0, 128 + (int)(100 * std::sin(x * 0.01)) + noise));
+            p[1] = (unsigned char)std::min(255, std::max(0, 128 + (int)(100 * std::cos(y * 0.013)) + noise));
+            p[2] = (unsigned char)std::min(255, std::max(0, (x ^ y) & 255));
+            p[3] = 255;
+        }
+    }
+    SaveTGA(tgaPath, size, size, source);
+
+    std::vector<std::vector<unsigned char>> levels;
+    {
+        std::vector<unsigned char> level = source;
+        int width = size, height = size;
+        for (;;) {
+            levels.emplace_back(GetCompressedSize(BlockFormat::BC1, width, height));
+            EncodeBC1(width, height, level.data(), levels.back().data());
+            if (width == 1 && height == 1) {
+                break;
+            }
+            std::vector<unsigned char> smaller((size_t)std::max(1, width / 2) * std::max(1, height / 2) * 4);
+            DownsampleImage(width, height, level.data(), smaller.data());
+            level.swap(smaller);
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+    }
+    if (!SaveDDS(ddsPath, BlockFormat::BC1, size, size, levels)) {
+        std::cerr << "Can't write " << ddsPath << " (run from the engine directory)" << std::endl;
+        return 1;
+    }
+
+    double uncompressedTime = 0.0, compressedTime = 0.0, fallbackTime = 0.0;
+    size_t uncompressedBytes = 0, compressedBytes = 0;
+    // Written so the compiler can't skip reading the mapped pages.
+    volatile unsigned char touched = 0;
+    std::vector<unsigned char> decoded;
+
+    for (int i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        {
+            std::ifstream input(tgaPath, std::ios::binary);
+            std::vector<unsigned char> file((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+            ImageInfo info;
+            ReadImageInfo(file.data(), file.size(), info);
+            decoded.resize((size_t)info.Width * info.Height * 4);
+            DecodeImage(file.data(), file.size(), decoded.data());
+            uncompressedBytes = decoded.size() * 4 / 3;
+        }
+        uncompressedTime += Milliseconds(start);
+
+        start = Clock::now();
+        {
+            TextureContainer container;
+            LoadTextureContainer(ddsPath, container);
+            compressedBytes = 0;
+            for (const TextureLevel& level : container.Levels) {
+                compressedBytes += level.Size;
+                for (size_t b = 0; b < level.Size; b += 64) {
+                    touched = touched + level.Data[b];
+                }
+            }
+        }
+        compressedTime += Milliseconds(start);
+
+        start = Clock::now();
+        {
+            TextureContainer container;
+            LoadTextureContainer(ddsPath, container);
+            for (const TextureLevel& level : container.Levels) {
+                decoded.resize((size_t)level.Width * level.Height * 4);
+                DecodeBlocks(container.Format, level.Width, level.Height, level.Data, decoded.data());
+            }
+        }
+        fallbackTime += Milliseconds(start);
+    }
+
+    // Quality of the compressed level 0 against the source.
+    TextureContainer container;
+    LoadTextureContainer(ddsPath, container);
+    decoded.resize(source.size());
+    DecodeBlocks(container.Format, size, size, container.Levels[0].Data, decoded.data());
+    double squaredError = 0.0;
+    for (size_t i = 0; i < source.size(); i++) {
+        double d = (double)source[i] - decoded[i];
+        squaredError += d * d;
+    }
+    double psnr = 10.0 * std::log10(255.0 * 255.0 / (squaredError / source.size() + 1e-12));
+
+    std::cout << "texture:            " << size << "x" << size << ", " << container.Levels.size() << " levels\n"
+              << "uncompressed load:  " << uncompressedTime / iterations << " ms, "
+              << uncompressedBytes / 1024 << " KB of video memory\n"
+              << "compressed load:    " << compressedTime / iterations << " ms, "
+              << compressedBytes / 1024 << " KB of video memory\n"
+              << "software fallback:  " << fallbackTime / iterations << " ms\n"
+              << "memory saved:       " << (1.0 - (double)compressedBytes / uncompressedBytes) * 100.0 << " %\n"
+              << "BC1 quality:        " << psnr << " dB PSNR\n";
+
+    bool valid = CheckThreeColorBlocks();
+    std::cout << "3 color blocks:     " << (valid ? "decoded right" : "WRONG") << std::endl;
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+/*
+    Uploads block compressed textures and samples them (CompressedTexture.h).
+
+    - BC1:  a procedural image through EncodeBC1 into a DDS file, the way
+            tools/texcompress makes them, with the whole mip chain. The
+            file goes on with more 1x1 levels than a chain can have; they
+            must be ignored, or glTextureStorage2D fails.
+    - ETC2: random blocks in a KTX file. Any 8 bytes are an ETC2 block, so
+            random ones go through every mode (individual, differential, T,
+            H and planar).
+    Both are loaded with LoadCompressedTexture: the blocks go to the driver
+    if it knows the format, or are decoded on the CPU if it doesn't. Then
+    every level is drawn with texelFetch, read back and compared with
+    DecodeBlocks. ETC2 decoding is exact by the spec; BC1 leaves the rounding
+    of the in-between colors to the driver, so those may be off by a few.
+
+    Usage: compressed_upload_bench [size]
+*/
+
+#include "HeadlessContext.h"
+
+#include "../src/BlockCompression.h"
+#include "../src/CompressedTexture.h"
+#include "../src/Image.h"
+#include "../src/Renderer.h"
+#include "../src/Shader.h"
+#include "../src/TextureContainer.h"
+#include "../src/Timing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// How far a channel may be from DecodeBlocks.
+static const int BC1_TOLERANCE = 8;
+static const int ETC2_TOLERANCE = 0;
+
+// Levels in the DDS file, more than any chain of the bench has.
+static const size_t DDS_LEVELS = 32;
+
+static const unsigned int GL_COMPRESSED_RGB8_ETC2_FORMAT = 0x9274;
+static const unsigned int GL_RGB_FORMAT = 0x1907;
+
+static const char* VERTEX_SHADER = R"(#version 450 core
+void main() {
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 4.0 - 1.0;
+    gl_Position = vec4(corner, 0.0, 1.0);
+}
+)";
+
+// One texel per pixel, from the level asked for.
+static const char* FRAGMENT_SHADER = R"(#version 450 core
+layout(binding = 0) uniform sampler2D u_Texture;
+uniform int u_Level;
+out vec4 color;
+void main() {
+    color = texelFetch(u_Texture, ivec2(gl_FragCoord.xy), u_Level);
+}
+)";
+
+static void WriteU32(std::ofstream& output, unsigned int value) {
+    unsigned char bytes[4] = {(unsigned char)value, (unsigned char)(value >> 8),
+                              (unsigned char)(value >> 16), (unsigned char)(value >> 24)};
+    output.write((const char*)bytes, 4);
+}
+
+// A KTX 1.1 file with ETC2 RGB8 levels (TextureContainer only writes DDS).
+static bool SaveKTX(const char* filepath, int width, int height,
+                    const std::vector<std::vector<unsigned char>>& levels) {
+    static const unsigned char identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+    std::ofstream output(filepath, std::ios::binary);
+    output.write((const char*)identifier, sizeof(identifier));
+    WriteU32(output, 0x04030201);
+    WriteU32(output, 0);                                // type: compressed
+    WriteU32(output, 1);                                // type size
+    WriteU32(output, 0);                                // format: compressed
+    WriteU32(output, GL_COMPRESSED_RGB8_ETC2_FORMAT);
+    WriteU32(output, GL_RGB_FORMAT);
+    WriteU32(output, (unsigned int)width);
+    WriteU32(output, (unsigned int)height);
+    WriteU32(output, 0);                                // depth
+    WriteU32(output, 0);                                // array elements
+    WriteU32(output, 1);                                // faces
+    WriteU32(output, (unsigned int)levels.size());
+    WriteU32(output, 0);                                // key/value bytes
+    // Blocks are 8 bytes, so every level is already padded to 4.
+    for (const std::vector<unsigned char>& level : levels) {
+        WriteU32(output, (unsigned int)level.size());
+        output.write((const char*)level.data(), level.size());
+    }
+    return (bool)output;
+}
+
+static bool WriteBC1File(const char* filepath, int size) {
+    std::vector<unsigned char> level((size_t)size * size * 4);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            unsigned char* p = &level[((size_t)y * size + x) * 4];
+            p[0] = (unsigned char)(128 + 100 * std::sin(x * 0.05));
+            p[1] = (unsigned char)(128 + 100 * std::cos(y * 0.07));
+            p[2] = (unsigned char)((x ^ y) & 255);
+            p[3] = 255;
+        }
+    }
+    std::vector<std::vector<unsigned char>> levels;
+    for (int width = size, height = size;;) {
+        levels.emplace_back(GetCompressedSize(BlockFormat::BC1, width, height));
+        EncodeBC1(width, height, level.data(), levels.back().data());
+        if (width == 1 && height == 1) {
+            break;
+        }
+        std::vector<unsigned char> smaller((size_t)std::max(1, width / 2) * std::max(1, height / 2) * 4);
+        DownsampleImage(width, height, level.data(), smaller.data());
+        level.swap(smaller);
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    while (levels.size() < DDS_LEVELS) {
+        levels.push_back(levels.back());
+    }
+    return SaveDDS(filepath, BlockFormat::BC1, size, size, levels);
+}
+
+static bool WriteETC2File(const char* filepath, int size) {
+    std::mt19937 random(7);
+    std::vector<std::vector<unsigned char>> levels;
+    for (int width = size, height = size;;) {
+        levels.emplace_back(GetCompressedSize(BlockFormat::ETC2_RGB8, width, height));
+        for (unsigned char& byte : levels.back()) {
+            byte = (unsigned char)random();
+        }
+        if (width == 1 && height == 1) {
+            break;
+        }
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return SaveKTX(filepath, size, size, levels);
+}
+
+// Loads the file, draws every level and compares it with DecodeBlocks.
+static bool Check(const char* name, const char* filepath, int tolerance, GLuint program) {
+    Clock::time_point start = Clock::now();
+    GLuint texture = LoadCompressedTexture(filepath);
+    double uploadMs = Milliseconds(start);
+
+    TextureContainer container;
+    if (!texture || !LoadTextureContainer(filepath, container)) {
+        std::cout << name << "can't load " << filepath << "\n";
+        return false;
+    }
+    GLint levels = 0;
+    GLCall(glGetTextureParameteriv(texture, GL_TEXTURE_IMMUTABLE_LEVELS, &levels));
+
+    GLCall(glUseProgram(program));
+    GLCall(glBindTextureUnit(0, texture));
+    int worst = 0;
+    std::vector<unsigned char> expected, drawn;
+    for (GLint i = 0; i < levels && i < (GLint)container.Levels.size(); i++) {
+        const TextureLevel& level = container.Levels[i];
+        expected.resize((size_t)level.Width * level.Height * 4);
+        drawn.resize(expected.size());
+        DecodeBlocks(container.Format, level.Width, level.Height, level.Data, expected.data());
+
+        GLCall(glUniform1i(glGetUniformLocation(program, "u_Level"), i));
+        GLCall(glViewport(0, 0, level.Width, level.Height));
+        GLCall(glDrawArrays(GL_TRIANGLES, 0, 3));
+        GLCall(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+        GLCall(glReadPixels(0, 0, level.Width, level.Height, GL_RGBA, GL_UNSIGNED_BYTE, drawn.data()));
+        for (size_t p = 0; p < expected.size(); p++) {
+            worst = std::max(worst, std::abs((int)expected[p] - (int)drawn[p]));
+        }
+    }
+    GLCall(glDeleteTextures(1, &texture));
+
+    bool valid = levels == (GLint)container.Levels.size() && worst <= tolerance;
+    std::cout << name << container.Width << "x" << container.Height << ", " << levels << " levels, "
+              << (IsBlockFormatSupported(container.Format) ? "by the driver" : "decoded on the CPU") << ", "
+              << uploadMs << " ms, off by at most " << worst << (valid ? "" : " (WRONG)") << "\n";
+    return valid;
+}
+
+int main(int argc, char* argv[]) {
+    const int size = argc > 1 ? std::atoi(argv[1]) : 256;
+    const char* bc1Path = "bin/bench_upload.dds";
+    const char* etc2Path = "bin/bench_upload.ktx";
+
+    if (!WriteBC1File(bc1Path, size) || !WriteETC2File(etc2Path, size)) {
+        std::cerr << "Can't write the textures (run from the engine directory)" << std::endl;
+        return 1;
+    }
+
+    HeadlessContext context(size, size);
+    if (!context.IsValid()) {
+        return 1;
+    }
+    std::cout << "renderer:  " << context.GetRenderer() << "\n";
+
+    GLuint program = CreateShader(VERTEX_SHADER, FRAGMENT_SHADER);
+    GLuint vertexArray;
+    GLCall(glCreateVertexArrays(1, &vertexArray));
+    GLCall(glBindVertexArray(vertexArray));
+
+    bool valid = Check("bc1:       ", bc1Path, BC1_TOLERANCE, program);
+    valid = Check("etc2:      ", etc2Path, ETC2_TOLERANCE, program) && valid;
+
+    GLCall(glDeleteVertexArrays(1, &vertexArray));
+    GLCall(glDeleteProgram(program));
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << "\n";
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+/*
+    Dynamic resolution (DynamicResolution.h) holding a GPU budget.
+
+    - model:  the controller alone, against frame times made up as
+              fixed + perPixel * scale^2 with a few percent of noise: a
+              load that fits somewhere in between must settle there and
+              stay under budget without flipping back and forth, a heavy
+              one must end at the smallest scale, and a light one that
+              follows a heavy one must climb back to the largest.
+    - gpu:    a scene whose fragment shader is expensive on purpose, drawn
+              through the render graph and stretched onto the backbuffer by
+              res/shaders/Present.shader, timed with GpuTimer.h. The budget
+              is half of what a frame at full size takes; the controller
+              must bring the GPU time down to it, and the stretched picture
+              must still have the scene's color.
+
+    Usage: dynamic_resolution_bench [frames]
+*/
+
+#include "HeadlessContext.h"
+
+#include "../src/DynamicResolution.h"
+#include "../src/GpuTimer.h"
+#include "../src/Renderer.h"
+#include "../src/RenderGraph.h"
+#include "../src/ResourcePool.h"
+#include "../src/Shader.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+static const char* HEAVY_VERTEX = R"(#version 450 core
+void main() {
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+// A fixed color, after a loop the compiler can't throw away.
+static const char* HEAVY_FRAGMENT = R"(#version 450 core
+layout (location = 0) out vec4 color;
+layout (location = 0) uniform int u_Iterations;
+void main() {
+    float value = gl_FragCoord.x * 0.001;
+    for (int i = 0; i < u_Iterations; i++) {
+        value = fract(sin(value * 12.9898 + float(i)) * 43758.5453);
+    }
+    color = vec4(0.25, 0.5, 0.75, 1.0) + vec4(value * 0.001);
+}
+)";
+
+struct ModelResult {
+    float Scale;
+    double WorstMs;
+    int Changes;
+};
+
+// frames frames of fixedMs + pixelMs * scale^2 (firstPixelMs for the first
+// quarter); the worst time and the changes are those of the second half.
+static ModelResult RunModel(double fixedMs, double pixelMs, int frames, double firstPixelMs) {
+    DynamicResolution resolution;
+    uint32_t random = 12345;
+    ModelResult result = {0.0f, 0.0, 0};
+    for (int frame = 0; frame < frames; frame++) {
+        random = random * 1664525u + 1013904223u;
+        double noise = 1.0 + ((random >> 8) / 16777216.0 - 0.5) * 0.06;
+        double scale = resolution.GetScale();
+        double time = (fixedMs + (frame < frames / 4 ? firstPixelMs : pixelMs) * scale * scale) * noise;
+        bool changed = resolution.Update(time);
+        if (frame >= frames / 2) {
+            result.WorstMs = std::max(result.WorstMs, time);
+            result.Changes += changed ? 1 : 0;
+        }
+    }
+    result.Scale = resolution.GetScale();
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 60;
+
+    bool valid = true;
+    {
+        const DynamicResolutionSettings settings;
+        ModelResult fits = RunModel(2.0, 20.0, 1000, 20.0);
+        ModelResult heavy = RunModel(2.0, 100.0, 1000, 100.0);
+        ModelResult light = RunModel(2.0, 5.0, 1000, 100.0);
+        std::cout << "model:     budget " << settings.BudgetMs << " ms; fits at scale " << fits.Scale << " (worst "
+                  << fits.WorstMs << " ms, " << fits.Changes << " changes), heavy at " << heavy.Scale << ", light at "
+                  << light.Scale << "\n";
+        valid = valid && fits.Scale > settings.MinScale && fits.Scale < settings.MaxScale;
+        valid = valid && fits.WorstMs <= settings.BudgetMs * 1.05 && fits.Changes == 0;
+        valid = valid && heavy.Scale == settings.MinScale && light.Scale == settings.MaxScale;
+    }
+
+    const int width = 640, height = 480;
+    HeadlessContext context(width, height);
+    if (!context.IsValid()) {
+        return 1;
+    }
+    std::cout << "renderer:  " << context.GetRenderer() << "\n";
+
+    {
+        ResourcePool resources;
+        RenderGraph graph(resources);
+        GpuTimer timer;
+        ProgramReflection reflection;
+        GLuint heavy = CreateShader(HEAVY_VERTEX, HEAVY_FRAGMENT);
+        GLuint present = LoadProgram("res/shaders/Present.shader", reflection);
+        VertexArrayHandle vertexArray = resources.CreateVertexArray("fullscreen triangle");
+        if (!heavy || !present) {
+            return 1;
+        }
+
+        auto renderFrame = [&](int sceneWidth, int sceneHeight) {
+            graph.Begin();
+            RenderTarget backbuffer = graph.ImportBackbuffer(context.GetFramebuffer(), width, height);
+            RenderTarget scene = graph.Create("scene color", {sceneWidth, sceneHeight, GL_RGBA8});
+            graph.AddPass(
+                "scene", [&](RenderPassBuilder& pass) { pass.Write(scene, LoadOp::DontCare); },
+                [&](const RenderPassContext&) {
+                    GLCall(glUseProgram(heavy));
+                    GLCall(glUniform1i(0, 60));
+                    GLCall(glBindVertexArray(resources.Get(vertexArray)));
+                    GLCall(glDrawArrays(GL_TRIANGLES, 0, 3));
+                });
+            graph.AddPass(
+                "present",
+                [&](RenderPassBuilder& pass) {
+                    pass.Read(scene);
+                    pass.Write(backbuffer, LoadOp::DontCare);
+                },
+                [&](const RenderPassContext& context) {
+                    GLCall(glUseProgram(present));
+                    GLCall(glBindTextureUnit(0, context.GetTexture(scene)));
+                    GLCall(glBindVertexArray(resources.Get(vertexArray)));
+                    GLCall(glDrawArrays(GL_TRIANGLES, 0, 3));
+                });
+            timer.Begin();
+            graph.Execute();
+            timer.End();
+            resources.EndFrame();
+        };
+
+        // Full size, waiting for every result, to get the budget.
+        double native = 0.0;
+        int measured = 0;
+        for (int frame = 0; frame < 8; frame++) {
+            renderFrame(width, height);
+            glFinish();
+            double milliseconds;
+            if (timer.Poll(milliseconds) && frame >= 2) {
+                native += milliseconds;
+                measured++;
+            }
+        }
+        native /= std::max(measured, 1);
+
+        DynamicResolutionSettings settings;
+        settings.BudgetMs = (float)(native * 0.5);
+        settings.Frames = 4;
+        DynamicResolution resolution(settings);
+        double lastMs = native, recent = 0.0;
+        int recentCount = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            double milliseconds;
+            if (timer.Poll(milliseconds)) {
+                lastMs = milliseconds;
+                if (resolution.Update(milliseconds)) {
+                    std::cout << "           frame " << frame << ": scale " << resolution.GetScale() << " after "
+                              << resolution.GetAverageMs() << " ms\n";
+                    recent = 0.0;
+                    recentCount = 0;
+                }
+                else {
+                    recent += milliseconds;
+                    recentCount++;
+                }
+            }
+            int sceneWidth, sceneHeight;
+            resolution.GetRenderSize(width, height, sceneWidth, sceneHeight);
+            renderFrame(sceneWidth, sceneHeight);
+        }
+        glFinish();
+        double settled = recentCount > 0 ? recent / recentCount : lastMs;
+
+        unsigned char pixel[4];
+        GLCall(glReadPixels(width / 2, height / 2, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel));
+        bool colorValid =
+            std::abs(pixel[0] - 64) <= 2 && std::abs(pixel[1] - 128) <= 2 && std::abs(pixel[2] - 191) <= 2;
+
+        int sceneWidth, sceneHeight;
+        resolution.GetRenderSize(width, height, sceneWidth, sceneHeight);
+        std::cout << "gpu:       " << native << " ms at full size, budget " << settings.BudgetMs
+                  << " ms, settled at scale " << resolution.GetScale() << " (" << sceneWidth << "x" << sceneHeight << ") with " << settled
+                  << " ms, " << timer.GetSkipped() << " frames not timed\n";
+        std::cout << "upscale:   center pixel " << (int)pixel[0] << " " << (int)pixel[1] << " " << (int)pixel[2]
+                  << (colorValid ? "" : ", expected 64 128 191") << "\n";
+        valid = valid && resolution.GetScale() < 1.0f && colorValid;
+        valid = valid && (settled <= settings.BudgetMs * 1.15 || resolution.GetScale() == settings.MinScale);
+
+        resources.Destroy(vertexArray);
+        glDeleteProgram(heavy);
+        glDeleteProgram(present);
+    }
+
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << "\n";
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+/*
+    The frame limiter (FramePacing.h) on its own, with a few milliseconds of
+    made-up work per frame in place of the draws and a no-op for the swap.
+
+    - limited:  60, 120 and 240 frames per second, once sleeping all the way
+                to the deadline and once sleeping most of the way and
+                spinning the rest. The spinning limiter must hit the rate
+                (median within 2%) and, over the three rates, be at least
+                as even: as many frames within 100 us of the one before as
+                sleeping, give or take 2%. On Linux, where sleeping is
+                already close, the two are often near; the spin pays off
+                where the sleep is coarse (Windows' default 15.6 ms tick).
+                Means and p99s are printed, not judged: a busy machine takes
+                the core away now and then, from either limiter.
+    - uncapped: must not wait at all.
+    - restart:  frames, a pause of PAUSE_MS with no frames (what drawing on
+                demand does when nothing changes) and Restart(), frames
+                again. The pause must not show up as an interval.
+
+    The jitter histograms show where the frames that miss went.
+
+    Usage: frame_pacing_bench [frames]
+*/
+
+#include "../src/FramePacing.h"
+#include "../src/Timing.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+// The time nothing is drawn in the restart test.
+static const int PAUSE_MS = 100;
+
+// Busy for 1 to 4 ms, different every frame.
+static void FakeWork(uint32_t& random) {
+    random = random * 1664525u + 1013904223u;
+    auto until = Clock::now() + std::chrono::microseconds(1000 + (random >> 8) % 3000);
+    while (Clock::now() < until) {
+    }
+}
+
+static FramePacingStats Run(FramePacer& pacer, int frames) {
+    uint32_t random = 12345;
+    for (int frame = 0; frame < frames; frame++) {
+        FakeWork(random);
+        pacer.BeforeSwap();
+        pacer.AfterSwap();
+    }
+    return pacer.GetStats();
+}
+
+// Frames that took within 100 us of the frame before.
+static size_t EvenFrames(const FramePacer& pacer) {
+    const std::vector<double>& buckets = FramePacer::GetJitterBuckets();
+    const std::vector<size_t>& histogram = pacer.GetJitterHistogram();
+    size_t even = 0;
+    for (size_t i = 0; i < buckets.size() && buckets[i] <= 100.0; i++) {
+        even += histogram[i];
+    }
+    return even;
+}
+
+static void PrintJitter(const FramePacer& pacer) {
+    const std::vector<double>& buckets = FramePacer::GetJitterBuckets();
+    const std::vector<size_t>& histogram = pacer.GetJitterHistogram();
+    std::cout << "           jitter:";
+    for (size_t i = 0; i < histogram.size(); i++) {
+        if (i < buckets.size()) {
+            std::cout << " <=" << buckets[i] << "us " << histogram[i];
+        }
+        else {
+            std::cout << " more " << histogram[i];
+        }
+    }
+    std::cout << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 120;
+
+    bool valid = true;
+    size_t sleepEven = 0, spinEven = 0;
+    for (double fps : {60.0, 120.0, 240.0}) {
+        FramePacingSettings sleeping;
+        sleeping.Mode = PacingMode::Limited;
+        sleeping.TargetFps = fps;
+        sleeping.SpinMicroseconds = 0.0;
+        FramePacingSettings spinning = sleeping;
+        spinning.SpinMicroseconds = 2000.0;
+
+        FramePacer sleepPacer(sleeping), spinPacer(spinning);
+        FramePacingStats sleep = Run(sleepPacer, frames);
+        FramePacingStats spin = Run(spinPacer, frames);
+        double target = 1000.0 / fps;
+
+        std::cout << "limited:   " << fps << " fps (" << target << " ms)\n";
+        std::cout << "  sleep:   mean " << sleep.MeanMs << " ms, p50 " << sleep.P50Ms << ", stddev " << sleep.StdDevMs
+                  << ", p99 " << sleep.P99Ms << ", max " << sleep.MaxMs << ", " << EvenFrames(sleepPacer) << " even\n";
+        PrintJitter(sleepPacer);
+        std::cout << "  spin:    mean " << spin.MeanMs << " ms, p50 " << spin.P50Ms << ", stddev " << spin.StdDevMs
+                  << ", p99 " << spin.P99Ms << ", max " << spin.MaxMs << ", " << EvenFrames(spinPacer)
+                  << " even, waited " << spin.WaitMs << " ms per frame\n";
+        PrintJitter(spinPacer);
+
+        valid = valid && std::abs(spin.P50Ms - target) <= target * 0.02;
+        sleepEven += EvenFrames(sleepPacer);
+        spinEven += EvenFrames(spinPacer);
+    }
+    valid = valid && spinEven + sleepEven / 50 >= sleepEven;
+
+    {
+        FramePacingSettings settings;
+        settings.Mode = PacingMode::Uncapped;
+        FramePacer pacer(settings);
+        FramePacingStats stats = Run(pacer, frames);
+        std::cout << "uncapped:  mean " << stats.MeanMs << " ms, waited " << stats.WaitMs << " ms per frame\n";
+        valid = valid && stats.WaitMs == 0.0 && stats.MeanMs < 5.0;
+    }
+
+    {
+        FramePacingSettings settings;
+        settings.Mode = PacingMode::Limited;
+        settings.TargetFps = 60.0;
+        FramePacer pacer(settings);
+        Run(pacer, frames / 2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(PAUSE_MS));
+        pacer.Restart();
+        FramePacingStats stats = Run(pacer, frames / 2);
+        std::cout << "restart:   " << stats.Frames << " intervals, max " << stats.MaxMs << " ms around a " << PAUSE_MS
+                  << " ms pause\n";
+        valid = valid && stats.Frames == (size_t)(frames / 2 - 1) * 2 && stats.MaxMs < PAUSE_MS * 0.5;
+    }
+
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << "\n";
+    return valid ? 0 : 1;
+}
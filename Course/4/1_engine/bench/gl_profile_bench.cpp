@@ -0,0 +1,124 @@
+/*
+    The GL call profiler (GLProfiler.h); built with GL_PROFILE, like the
+    engine after "make GL_PROFILE=1".
+
+    - frames:   a few frames of a cheap call made often, a query made now
+                and then and one expensive call (a clear and a glFinish).
+                The report must count each site's calls per frame exactly
+                and put the expensive one first.
+    - threads:  threads that time the same site at the same time, each into
+                counters of its own, while the main thread keeps reading
+                them. No call may get lost.
+    - overhead: what timing a call costs, against the same loop without the
+                profiler.
+
+    Usage: gl_profile_bench [frames] [calls per thread]
+*/
+
+#include "HeadlessContext.h"
+
+#include "../src/GLProfiler.h"
+#include "../src/Renderer.h"
+#include "../src/Timing.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 10;
+    const int callsPerThread = argc > 2 ? std::atoi(argv[2]) : 200000;
+
+    HeadlessContext context(256, 256);
+    if (!context.IsValid()) {
+        return 1;
+    }
+    std::cout << "renderer:  " << context.GetRenderer() << "\n";
+    if (!IsGLProfilerEnabled()) {
+        std::cout << "built without GL_PROFILE\n";
+        return 1;
+    }
+
+    bool valid = true;
+    {
+        const int cheapPerFrame = 100, queriesPerFrame = 10;
+        GLint viewport[4];
+        for (int frame = 0; frame < frames; frame++) {
+            for (int i = 0; i < cheapPerFrame; i++) {
+                GLCall(glBlendColor(i / 100.0f, 0.0f, 0.0f, 1.0f));
+            }
+            for (int i = 0; i < queriesPerFrame; i++) {
+                GLCall(glGetIntegerv(GL_VIEWPORT, viewport));
+            }
+            GLCall(glClear(GL_COLOR_BUFFER_BIT));
+            GLCall(glFinish());
+            GLProfilerEndFrame();
+        }
+
+        std::stringstream report;
+        PrintGLProfile(report, 10, true);
+        std::cout << report.str();
+        std::string text = report.str();
+        // The report is sorted by time, so the glFinish site comes first.
+        size_t first = text.find("gl_profile_call rank 1 ");
+        bool finishFirst = first != std::string::npos && text.find("glFinish", first) < text.find('\n', first);
+        bool cheapCounted = text.find("calls_per_frame " + std::to_string(cheapPerFrame) + " ") != std::string::npos;
+        bool queriesCounted =
+            text.find("calls_per_frame " + std::to_string(queriesPerFrame) + " ") != std::string::npos;
+        std::cout << "frames:    glFinish " << (finishFirst ? "first" : "NOT first") << ", per frame counts "
+                  << (cheapCounted && queriesCounted ? "exact" : "WRONG") << "\n";
+        valid = valid && finishFirst && cheapCounted && queriesCounted;
+    }
+
+    {
+        static const uint32_t site = RegisterGLCallSite("threads", __FILE__, __LINE__);
+        const unsigned threadCount = 4;
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < threadCount; t++) {
+            threads.emplace_back([&]() {
+                for (int i = 0; i < callsPerThread; i++) {
+                    GLCallTimer timer(site);
+                }
+            });
+        }
+        // Reading while they count, as the report every second does.
+        std::stringstream ignored;
+        for (int i = 0; i < 20; i++) {
+            PrintGLProfile(ignored, 10, true);
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        uint64_t calls, nanoseconds;
+        GetGLCallSiteTotals(site, calls, nanoseconds);
+        uint64_t expected = (uint64_t)threadCount * callsPerThread;
+        std::cout << "threads:   " << calls << " of " << expected << " calls counted over " << threadCount
+                  << " threads\n";
+        valid = valid && calls == expected;
+    }
+
+    {
+        const int calls = 1000000;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < calls; i++) {
+            glBlendColor(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+        double bare = Nanoseconds(start) / calls;
+        static const uint32_t site = RegisterGLCallSite("overhead", __FILE__, __LINE__);
+        start = Clock::now();
+        for (int i = 0; i < calls; i++) {
+            GLCallTimer timer(site);
+            glBlendColor(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+        double timed = Nanoseconds(start) / calls;
+        std::cout << "overhead:  glBlendColor " << bare << " ns, timed " << timed << " ns, "
+                  << timed - bare << " ns per call for the profiler\n";
+    }
+
+    PrintGLProfile(std::cout, 5, false);
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << "\n";
+    return valid ? 0 : 1;
+}
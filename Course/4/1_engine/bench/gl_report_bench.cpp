@@ -0,0 +1,170 @@
+/*
+    The deduplicating, rate-limited GL message reporting (GLReport.h).
+
+    - flood:    the same GL error from the same call, over and over, as a
+                GLCall inside the render loop would make it. Against the old
+                LogCall (a line and a std::endl per error, to /dev/null so
+                the terminal doesn't count), and it must come out as one
+                message and a line or two of repeats.
+    - sites:    many different debug messages in a burst; only
+                MAX_NEW_PER_SECOND are written at once, the rest later with
+                the repeats, text and all.
+    - fatal:    a new GL error right after that burst. The ASSERT of its
+                GLCall would trap, so it must be written before LogCall
+                returns, limit or not.
+    - threads:  threads reporting at the same time; no report may get lost.
+    - debug:    messages through the KHR_debug callback, if the driver has
+                it.
+
+    Usage: gl_report_bench [errors] [reports per thread]
+*/
+
+#include "HeadlessContext.h"
+
+#include "../src/GLReport.h"
+#include "../src/Renderer.h"
+#include "../src/Timing.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// What LogCall did before.
+static bool LogCallDirect(std::ostream& out, const char* func, const char* file, int line) {
+    while (GLenum error = glGetError()) {
+        out << "OpenGL error (" << error << "): In function " << func << " in file " << file << " on line " << line
+            << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    const int errors = argc > 1 ? std::atoi(argv[1]) : 100000;
+    const int reportsPerThread = argc > 2 ? std::atoi(argv[2]) : 100000;
+
+    HeadlessContext context(64, 64);
+    if (!context.IsValid()) {
+        return 1;
+    }
+    std::cout << "renderer:  " << context.GetRenderer() << "\n";
+
+    std::stringstream sink;
+    SetGLReportSink(sink);
+    bool valid = true;
+
+    {
+        // An enum glEnable doesn't know: GL_INVALID_ENUM every time.
+        const GLenum badCap = 0x1234;
+        std::ofstream devNull("/dev/null");
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < errors; i++) {
+            ClearError();
+            glEnable(badCap);
+            LogCallDirect(devNull, "glEnable(badCap)", __FILE__, __LINE__);
+        }
+        double direct = Nanoseconds(start) / errors;
+
+        start = Clock::now();
+        for (int i = 0; i < errors; i++) {
+            // The GLCall, without the ASSERT that would stop us.
+            ClearError();
+            glEnable(badCap);
+            LogCall("glEnable(badCap)", __FILE__, __LINE__);
+        }
+        double reported = Nanoseconds(start) / errors;
+        FlushGLReports();
+
+        GLReportStats stats = GetGLReportStats();
+        std::string text = sink.str();
+        size_t lines = std::count(text.begin(), text.end(), '\n');
+        bool first = text.find("GL_INVALID_ENUM") != std::string::npos;
+        std::cout << "flood:     " << errors << " errors, " << direct << " ns each written, " << reported
+                  << " ns each reported, " << lines << " lines\n";
+        valid = valid && first && stats.Reported == (size_t)errors && stats.Messages == 1 && lines <= 3;
+    }
+
+    {
+        const int messages = 200;
+        GLReportStats before = GetGLReportStats();
+        for (int i = 0; i < messages; i++) {
+            ReportGLMessage(GLMessageSource::Debug, GL_INVALID_VALUE, "sites", i, "a message of its own");
+        }
+        FlushGLReports();
+        GLReportStats stats = GetGLReportStats();
+        size_t written = stats.Written - before.Written;
+        size_t suppressed = stats.Suppressed - before.Suppressed;
+        std::cout << "sites:     " << messages << " new messages, " << written << " written, " << suppressed
+                  << " only counted\n";
+        valid = valid && written + suppressed == (size_t)messages && suppressed > 0;
+
+        // Still in the second of the burst, so over the limit.
+        ClearError();
+        glEnable(0x1235);
+        LogCall("glEnable(0x1235)", "fatal", 1);
+        bool fatal = sink.str().find("In function glEnable(0x1235) (error at fatal:1)") != std::string::npos;
+        std::cout << "fatal:     " << (fatal ? "written" : "NOT written") << " before the ASSERT\n";
+        valid = valid && fatal;
+    }
+
+    {
+        const unsigned threadCount = 4;
+        GLReportStats before = GetGLReportStats();
+        std::vector<std::thread> threads;
+        Clock::time_point start = Clock::now();
+        for (unsigned t = 0; t < threadCount; t++) {
+            threads.emplace_back([&, t]() {
+                for (int i = 0; i < reportsPerThread; i++) {
+                    // Half of it the same message for all of them.
+                    ReportGLMessage(GLMessageSource::Error, GL_INVALID_OPERATION, "threads", (i & 1) ? (int)t : -1,
+                                    "from a thread");
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        double perReport = Nanoseconds(start) / ((double)threadCount * reportsPerThread);
+        GLReportStats stats = GetGLReportStats();
+        size_t expected = (size_t)threadCount * reportsPerThread;
+        std::cout << "threads:   " << stats.Reported - before.Reported << " of " << expected << " reports counted, "
+                  << stats.Messages - before.Messages << " messages, " << perReport << " ns each\n";
+        valid = valid && stats.Reported - before.Reported == expected &&
+                stats.Messages - before.Messages == threadCount + 1;
+    }
+
+    {
+        EnableGLDebugOutput();
+        if (GLEW_KHR_debug || GLEW_VERSION_4_3) {
+            const int messages = 1000;
+            GLReportStats before = GetGLReportStats();
+            for (int i = 0; i < messages; i++) {
+                glDebugMessageInsert(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_ERROR, 42, GL_DEBUG_SEVERITY_HIGH, -1,
+                                     "inserted by the bench");
+            }
+            glFinish();
+            GLReportStats stats = GetGLReportStats();
+            std::cout << "debug:     " << stats.Reported - before.Reported << " of " << messages
+                      << " callbacks reported, " << stats.Messages - before.Messages << " message\n";
+            valid = valid && stats.Reported - before.Reported == (size_t)messages &&
+                    stats.Messages - before.Messages == 1;
+        }
+        else {
+            std::cout << "debug:     no KHR_debug\n";
+        }
+    }
+
+    StopGLReporting();
+    std::string text = sink.str();
+    // The last of the burst was held back, but must be written in full.
+    bool heldBack = text.find("a message of its own (debug at sites:199)") != std::string::npos;
+    std::cout << "held back: " << (heldBack ? "written" : "NOT written") << " in the end\n";
+    valid = valid && heldBack;
+    std::cout << text.substr(text.find("gl_report "));
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << "\n";
+    return valid ? 0 : 1;
+}
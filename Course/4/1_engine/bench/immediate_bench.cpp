@@ -0,0 +1,178 @@
+/*
+    Immediate mode drawing (ImmediateMode.h) on top of a streaming buffer.
+
+    - shapes:   one of every glBegin mode, each into its own corner of the
+                target, then read back: a quad, a fan and a strip must fill
+                their corners, a line loop and points must hit the pixels
+                they were drawn on.
+    - lines:    a debug overlay of [lines] short lines per frame, Begin/End
+                for each, the old way of writing it. Must cost a few draw
+                calls per frame, not one per line.
+    - naive:    the same lines with a Flush() after every one, which is what
+                glBegin/glEnd amounts to in a driver that draws at glEnd,
+                for a tenth of the lines.
+
+    Usage: immediate_bench [lines] [frames]
+*/
+
+#include "HeadlessContext.h"
+
+#include "../src/ImmediateMode.h"
+#include "../src/Renderer.h"
+#include "../src/Timing.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+// The pixel at x, y of the bound framebuffer, as 0xRRGGBB.
+static uint32_t ReadPixel(int x, int y) {
+    unsigned char pixel[4];
+    GLCall(glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel));
+    return (uint32_t)pixel[0] << 16 | (uint32_t)pixel[1] << 8 | pixel[2];
+}
+
+// Short lines (a few pixels, like the edges of far away boxes) all over the
+// target, Begin/End each.
+static void DrawLines(ImmediateRenderer& imm, int count, uint32_t& random, bool flushEach) {
+    auto next = [&]() {
+        random = random * 1664525u + 1013904223u;
+        return (random >> 8) / 8388608.0f - 1.0f;
+    };
+    for (int i = 0; i < count; i++) {
+        imm.Begin(GL_LINES);
+        imm.Color3f(0.5f + next() * 0.5f, 0.5f, 0.5f);
+        float x = next(), y = next();
+        imm.Vertex2f(x, y);
+        imm.Vertex2f(x + next() * 0.02f, y + next() * 0.02f);
+        imm.End();
+        if (flushEach) {
+            imm.Flush(Mat4::Identity());
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const int lines = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    const int frames = argc > 2 ? std::atoi(argv[2]) : 3;
+
+    const int width = 256, height = 256;
+    HeadlessContext context(width, height);
+    if (!context.IsValid()) {
+        return 1;
+    }
+    std::cout << "renderer:  " << context.GetRenderer() << "\n";
+
+    bool valid = true;
+    {
+        ImmediateRenderer imm;
+        if (!imm.IsValid()) {
+            return 1;
+        }
+        imm.SetDepthTest(false);
+
+        // Shapes, one corner each (the lower left one is split in two).
+        GLCall(glClearColor(0.0f, 0.0f, 0.0f, 1.0f));
+        GLCall(glClear(GL_COLOR_BUFFER_BIT));
+        imm.Begin(GL_QUADS);
+        imm.Color3f(1.0f, 0.0f, 0.0f);
+        imm.Vertex2f(-1.0f, 0.0f);
+        imm.Vertex2f(0.0f, 0.0f);
+        imm.Vertex2f(0.0f, 1.0f);
+        imm.Vertex2f(-1.0f, 1.0f);
+        imm.End();
+        imm.Begin(GL_TRIANGLE_FAN);
+        imm.Color3f(0.0f, 1.0f, 0.0f);
+        imm.Vertex2f(0.5f, 0.5f);
+        imm.Vertex2f(0.0f, 0.0f);
+        imm.Vertex2f(1.0f, 0.0f);
+        imm.Vertex2f(1.0f, 1.0f);
+        imm.Vertex2f(0.0f, 1.0f);
+        imm.Vertex2f(0.0f, 0.0f);
+        imm.End();
+        imm.Begin(GL_TRIANGLE_STRIP);
+        imm.Color3f(0.0f, 0.0f, 1.0f);
+        imm.Vertex2f(0.0f, -1.0f);
+        imm.Vertex2f(1.0f, -1.0f);
+        imm.Vertex2f(0.0f, 0.0f);
+        imm.Vertex2f(1.0f, 0.0f);
+        imm.End();
+        // Through the middle of a row and a column of pixels.
+        const float row = (64 + 0.5f) / height * 2.0f - 1.0f, column = (64 + 0.5f) / width * 2.0f - 1.0f;
+        imm.Begin(GL_LINE_LOOP);
+        imm.Color3f(1.0f, 1.0f, 0.0f);
+        imm.Vertex2f(-0.9f, row);
+        imm.Vertex2f(column, row);
+        imm.Vertex2f(column, -0.9f);
+        imm.End();
+        imm.SetPointSize(3.0f);
+        imm.Begin(GL_POINTS);
+        imm.Color3f(1.0f, 0.0f, 1.0f);
+        imm.Vertex2f((32 + 0.5f) / width * 2.0f - 1.0f, (32 + 0.5f) / height * 2.0f - 1.0f);
+        imm.End();
+        imm.Flush(Mat4::Identity());
+
+        struct Probe {
+            const char* Name;
+            int X, Y;
+            uint32_t Expected;
+        } probes[] = {{"quads", 64, 192, 0xff0000},      {"triangle fan", 192, 192, 0x00ff00},
+                      {"triangle strip", 192, 64, 0x0000ff}, {"line loop", 40, 64, 0xffff00},
+                      {"line loop (back)", 64, 40, 0xffff00}, {"points", 33, 31, 0xff00ff},
+                      {"nothing", 100, 100, 0x000000}};
+        int wrong = 0;
+        for (const Probe& probe : probes) {
+            uint32_t pixel = ReadPixel(probe.X, probe.Y);
+            if (pixel != probe.Expected) {
+                std::cout << "           " << probe.Name << ": " << std::hex << pixel << ", expected "
+                          << probe.Expected << std::dec << "\n";
+                wrong++;
+            }
+        }
+        std::cout << "shapes:    " << sizeof(probes) / sizeof(probes[0]) - wrong << " of "
+                  << sizeof(probes) / sizeof(probes[0]) << " right, " << imm.GetStats().DrawCalls
+                  << " draw calls for " << imm.GetStats().Primitives << " primitives\n";
+        valid = valid && wrong == 0 && imm.GetStats().DrawCalls <= 3;
+    }
+
+    {
+        ImmediateRenderer imm;
+        imm.SetDepthTest(false);
+        uint32_t random = 1;
+        double recordMs = 0.0, flushMs = 0.0, frameMs = 0.0;
+        size_t draws = imm.GetStats().DrawCalls;
+        for (int frame = 0; frame < frames; frame++) {
+            Clock::time_point start = Clock::now();
+            GLCall(glClear(GL_COLOR_BUFFER_BIT));
+            DrawLines(imm, lines, random, false);
+            recordMs += Milliseconds(start);
+            Clock::time_point flush = Clock::now();
+            imm.Flush(Mat4::Identity());
+            flushMs += Milliseconds(flush);
+            glFinish();
+            frameMs += Milliseconds(start);
+        }
+        const ImmediateStats& stats = imm.GetStats();
+        double drawsPerFrame = (double)(stats.DrawCalls - draws) / frames;
+        std::cout << "lines:     " << lines << " per frame in " << drawsPerFrame << " draw calls, "
+                  << stats.BytesStreamed / frames / (1024 * 1024) << " MB streamed; recording " << recordMs / frames
+                  << " ms, flush " << flushMs / frames << " ms, frame " << frameMs / frames << " ms ("
+                  << frameMs / frames * 1000.0 / lines << " us per line), " << stats.Stalls << " stalls\n";
+        valid = valid && drawsPerFrame <= 8;
+
+        int naiveLines = std::max(lines / 10, 1);
+        ImmediateRenderer naive;
+        naive.SetDepthTest(false);
+        Clock::time_point start = Clock::now();
+        GLCall(glClear(GL_COLOR_BUFFER_BIT));
+        DrawLines(naive, naiveLines, random, true);
+        glFinish();
+        double naiveMs = Milliseconds(start);
+        std::cout << "naive:     " << naiveLines << " lines in " << naive.GetStats().DrawCalls << " draw calls, "
+                  << naiveMs << " ms (" << naiveMs * 1000.0 / naiveLines << " us per line)\n";
+    }
+
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << "\n";
+    return valid ? 0 : 1;
+}
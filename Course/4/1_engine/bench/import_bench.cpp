@@ -0,0 +1,115 @@
+/*
+    Import throughput of MeshImporter against the number of threads, for the
+    same mesh as OBJ, ascii PLY and binary PLY (written into bin/ first, so
+    these are warm numbers: the files are in the page cache).
+
+    Every result is also compared with the single threaded one; the importer
+    merges in file order, so they must be identical.
+
+    Usage: import_bench [grid size] [max threads]
+*/
+
+#include "../src/MeshImporter.h"
+#include "../src/Timing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+static bool SameMesh(const ImportedMesh& a, const ImportedMesh& b) {
+    return a.VertexCount == b.VertexCount && a.Layout.Stride == b.Layout.Stride &&
+           a.Vertices == b.Vertices && a.Indices == b.Indices;
+}
+
+// A wavy grid with positions, texcoords and normals, in all three formats.
+static void WriteFiles(int size, const char* objPath, const char* asciiPath, const char* binaryPath) {
+    std::ofstream obj(objPath);
+    std::ofstream ascii(asciiPath);
+    std::ofstream binary(binaryPath, std::ios::binary);
+
+    size_t vertexCount = (size_t)size * size, faceCount = (size_t)(size - 1) * (size - 1) * 2;
+    const char* properties =
+        "property float x\nproperty float y\nproperty float z\n"
+        "property float nx\nproperty float ny\nproperty float nz\n"
+        "property float u\nproperty float v\n";
+    for (std::ofstream* ply : {&ascii, &binary}) {
+        *ply << "ply\nformat " << (ply == &ascii ? "ascii" : "binary_little_endian") << " 1.0\n"
+             << "comment import_bench\nelement vertex " << vertexCount << "\n" << properties
+             << "element face " << faceCount << "\nproperty list uchar int vertex_indices\nend_header\n";
+    }
+
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            float u = (float)x / (size - 1), v = (float)y / (size - 1);
+            float height = 0.05f * std::sin(u * 20.0f) * std::cos(v * 20.0f);
+            obj << "v " << u << ' ' << height << ' ' << v << "\nvt " << u << ' ' << v << "\nvn 0 1 0\n";
+            ascii << u << ' ' << height << ' ' << v << " 0 1 0 " << u << ' ' << v << '\n';
+            float vertex[8] = {u, height, v, 0.0f, 1.0f, 0.0f, u, v};
+            binary.write((const char*)vertex, sizeof(vertex));
+        }
+    }
+
+    for (int y = 0; y + 1 < size; y++) {
+        for (int x = 0; x + 1 < size; x++) {
+            int i = y * size + x;
+            int triangles[2][3] = {{i, i + size, i + 1}, {i + 1, i + size, i + size + 1}};
+            for (const int* triangle : triangles) {
+                obj << "f";
+                ascii << "3";
+                unsigned char count = 3;
+                binary.write((const char*)&count, 1);
+                for (int c = 0; c < 3; c++) {
+                    obj << ' ' << triangle[c] + 1 << '/' << triangle[c] + 1 << '/' << triangle[c] + 1;
+                    ascii << ' ' << triangle[c];
+                }
+                binary.write((const char*)triangle, 3 * sizeof(int));
+                obj << '\n';
+                ascii << '\n';
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const int size = argc > 1 ? std::atoi(argv[1]) : 600;
+    const unsigned int maxThreads = argc > 2 ? (unsigned int)std::atoi(argv[2])
+                                             : std::max(4u, std::thread::hardware_concurrency());
+    const char* paths[3] = {"bin/bench_import.obj", "bin/bench_import_ascii.ply", "bin/bench_import_binary.ply"};
+
+    WriteFiles(size, paths[0], paths[1], paths[2]);
+    std::cout << "grid:      " << size << "x" << size << " vertices, " << (size - 1) * (size - 1) * 2
+              << " triangles (" << std::thread::hardware_concurrency() << " cores)\n";
+
+    bool allMatch = true;
+    for (const char* path : paths) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        double megabytes = file.tellg() / 1e6;
+        std::cout << "== " << path << " (" << megabytes << " MB)\n";
+
+        ImportedMesh reference;
+        double referenceTime = 0.0;
+        for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+            ImportedMesh mesh;
+            auto start = Clock::now();
+            bool ok = ImportMesh(path, mesh, threads);
+            double time = Seconds(start);
+
+            if (threads == 1) {
+                reference = mesh;
+                referenceTime = time;
+            }
+            bool matches = ok && SameMesh(mesh, reference) && mesh.VertexCount == (uint32_t)size * size;
+            allMatch = allMatch && matches;
+
+            std::cout << threads << " thread(s): " << time * 1000.0 << " ms, " << megabytes / time << " MB/s, "
+                      << referenceTime / time << "x" << (matches ? "" : "  MISMATCH") << "\n";
+        }
+    }
+
+    std::cout << "results identical: " << (allMatch ? "yes" : "NO") << std::endl;
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+/*
+    How the job system (JobSystem.h) scales, from the main thread alone up
+    to one worker per core (and at least 3 workers, so the stealing is
+    exercised even on a small machine).
+
+    - jobs:     many empty jobs on one counter, the cost of a job.
+    - culling:  the engine's per-frame work on a bigger field: occlusion test
+                and level of detail of every object, with ParallelFor. Must
+                give exactly the serial answer.
+    - meshes:   a LOD chain (Simplify.h) for each of a batch of spheres, and
+                after each one a job that depends on it (its counter) and
+                sums up its triangles. Must match the serial sum.
+    - main:     jobs that hand work to RunOnMainThread, which must run on
+                the main thread, inside Wait().
+
+    Usage: job_bench [objects] [meshes]
+*/
+
+#include "../src/JobSystem.h"
+#include "../src/Math.h"
+#include "../src/MeshFile.h"
+#include "../src/OcclusionCulling.h"
+#include "../src/Simplify.h"
+#include "../src/Timing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// A sphere of radius 0.5 in the unit cube, positions only.
+static void BuildSphere(int segments, std::vector<float>& vertices, std::vector<uint32_t>& indices) {
+    int rings = segments / 2;
+    auto addVertex = [&](float x, float y, float z) {
+        vertices.insert(vertices.end(), {0.5f + x * 0.5f, 0.5f + y * 0.5f, 0.5f + z * 0.5f});
+    };
+    addVertex(0.0f, 1.0f, 0.0f);
+    for (int r = 1; r < rings; r++) {
+        float theta = 3.14159265f * r / rings;
+        for (int s = 0; s < segments; s++) {
+            float phi = 2.0f * 3.14159265f * s / segments;
+            addVertex(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+        }
+    }
+    addVertex(0.0f, -1.0f, 0.0f);
+
+    uint32_t bottom = 1 + (rings - 1) * segments;
+    auto ring = [&](int r, int s) { return (uint32_t)(1 + (r - 1) * segments + s % segments); };
+    for (int s = 0; s < segments; s++) {
+        indices.insert(indices.end(), {0u, ring(1, s + 1), ring(1, s)});
+        indices.insert(indices.end(), {bottom, ring(rings - 1, s), ring(rings - 1, s + 1)});
+    }
+    for (int r = 1; r + 1 < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            uint32_t a = ring(r, s), b = ring(r, s + 1), c = ring(r + 1, s + 1), d = ring(r + 1, s);
+            indices.insert(indices.end(), {a, b, c, a, c, d});
+        }
+    }
+}
+
+struct Scene {
+    OcclusionBuffer Occlusion{256, 128};
+    Mat4 ViewProjection;
+    Vec3 Eye;
+    std::vector<Mat4> Models;
+    std::vector<MeshLod> Lods;
+};
+
+// Bit 7: visible, the rest: level of detail.
+static uint8_t CullObject(const Scene& scene, size_t i) {
+    const float pixelsPerUnit = 480.0f / (2.0f * std::tan(30.0f * 3.14159265f / 180.0f));
+    const Mat4& model = scene.Models[i];
+    if (scene.Occlusion.Test(scene.ViewProjection * model, {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}) !=
+        OcclusionResult::Visible) {
+        return 0;
+    }
+    Vec4 center = Transform(model, {0.5f, 0.5f, 0.5f});
+    Vec3 toCamera = Vec3{center.x, center.y, center.z} - scene.Eye;
+    uint32_t lod = SelectLod(scene.Lods.data(), (uint32_t)scene.Lods.size(), MaxScale(model),
+                             std::sqrt(Dot(toCamera, toCamera)), pixelsPerUnit, 1.0f);
+    return (uint8_t)(0x80 | lod);
+}
+
+int main(int argc, char* argv[]) {
+    const int objects = argc > 1 ? std::atoi(argv[1]) : 200000;
+    const int meshCount = argc > 2 ? std::atoi(argv[2]) : 32;
+    const int tinyJobs = 200000;
+
+    // The engine's scene: a wall in front of a field of spheres, only much
+    // bigger.
+    Scene scene;
+    std::vector<float> cube = {0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 0, 0, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1};
+    std::vector<unsigned int> cubeIndices = {0, 1, 2, 0, 2, 3, 4, 6, 5, 4, 7, 6, 0, 4, 5, 0, 5, 1,
+                                             3, 2, 6, 3, 6, 7, 0, 3, 7, 0, 7, 4, 1, 5, 6, 1, 6, 2};
+    scene.Eye = {3.0f, 1.7f, 16.0f};
+    Mat4 projection = Perspective(60.0f * 3.14159265f / 180.0f, 640.0f / 480.0f, 0.1f, 400.0f);
+    scene.ViewProjection = projection * LookAt(scene.Eye, {0.0f, 1.5f, 0.0f}, {0.0f, 1.0f, 0.0f});
+    scene.Occlusion.Clear();
+    Mat4 wall = Translate({-8.0f, 0.0f, 0.0f}) * Scale({16.0f, 6.0f, 0.5f});
+    scene.Occlusion.RasterizeOccluder(scene.ViewProjection * wall, cube.data(), 8, cubeIndices.data(),
+                                      cubeIndices.size());
+    scene.Occlusion.BuildHierarchy();
+    int side = (int)std::sqrt((double)objects);
+    for (int i = 0; i < objects; i++) {
+        int x = i % side, z = i / side;
+        scene.Models.push_back(Translate({-100.0f + x * 200.0f / side, 0.0f, 8.0f - z * 200.0f / side}) *
+                               Scale({0.8f, 0.8f, 0.8f}));
+    }
+
+    std::vector<float> sphereVertices;
+    std::vector<uint32_t> sphereIndices;
+    BuildSphere(48, sphereVertices, sphereIndices);
+    MeshLayout layout = {};
+    layout.Stride = 3 * sizeof(float);
+    layout.AttributeCount = 1;
+    layout.Attributes[0] = {0, 3, AttributeType::Float, 0, 0};
+    uint32_t sphereVertexCount = (uint32_t)(sphereVertices.size() / 3);
+    // BuildLodChain appends to the indices, so every chain gets a copy.
+    std::vector<uint32_t> chainIndices = sphereIndices;
+    scene.Lods = BuildLodChain((const unsigned char*)sphereVertices.data(), sphereVertexCount, layout, chainIndices);
+
+    // The answers everything must match.
+    std::vector<uint8_t> serialCulling(objects);
+    for (int i = 0; i < objects; i++) {
+        serialCulling[i] = CullObject(scene, i);
+    }
+    size_t visible = std::count_if(serialCulling.begin(), serialCulling.end(), [](uint8_t r) { return r != 0; });
+    size_t serialTriangles = 0;
+    for (const MeshLod& lod : scene.Lods) {
+        serialTriangles += lod.IndexCount / 3;
+    }
+    serialTriangles *= meshCount;
+
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> workerCounts = {0};
+    for (int workers = 1; workers <= (int)std::max(3u, cores - 1); workers *= 2) {
+        workerCounts.push_back(workers);
+    }
+    if (workerCounts.back() != (int)std::max(3u, cores - 1)) {
+        workerCounts.push_back((int)std::max(3u, cores - 1));
+    }
+
+    std::cout << "cores:     " << cores << "\n";
+    std::cout << "culling:   " << objects << " objects, " << visible << " visible\n";
+    std::cout << "meshes:    " << meshCount << " spheres of " << sphereIndices.size() / 3 << " triangles\n";
+
+    bool valid = true;
+    double baseCulling = 0.0, baseMeshes = 0.0;
+    for (int workers : workerCounts) {
+        JobSystem jobs(workers);
+
+        auto start = Clock::now();
+        {
+            std::atomic<int> done(0);
+            JobCounter counter;
+            for (int i = 0; i < tinyJobs; i++) {
+                jobs.Run([&done] { done.fetch_add(1, std::memory_order_relaxed); }, &counter);
+            }
+            jobs.Wait(counter);
+            valid = valid && done.load() == tinyJobs;
+        }
+        double jobTime = Milliseconds(start);
+
+        // The best of a few frames, like a frame time.
+        double cullingTime = 1e30;
+        std::vector<uint8_t> culling(objects);
+        for (int frame = 0; frame < 5; frame++) {
+            std::fill(culling.begin(), culling.end(), 0xFF);
+            start = Clock::now();
+            jobs.ParallelFor(objects, 256, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    culling[i] = CullObject(scene, i);
+                }
+            });
+            cullingTime = std::min(cullingTime, Milliseconds(start));
+            valid = valid && culling == serialCulling;
+        }
+
+        start = Clock::now();
+        {
+            std::vector<std::vector<MeshLod>> chains(meshCount);
+            std::vector<JobCounter> simplified(meshCount);
+            std::atomic<size_t> triangles(0);
+            JobCounter summed;
+            for (int m = 0; m < meshCount; m++) {
+                jobs.Run(
+                    [&, m] {
+                        std::vector<uint32_t> indices = sphereIndices;
+                        chains[m] = BuildLodChain((const unsigned char*)sphereVertices.data(), sphereVertexCount,
+                                                  layout, indices);
+                    },
+                    &simplified[m]);
+                jobs.Run(
+                    [&, m] {
+                        for (const MeshLod& lod : chains[m]) {
+                            triangles.fetch_add(lod.IndexCount / 3, std::memory_order_relaxed);
+                        }
+                    },
+                    &summed, &simplified[m]);
+            }
+            jobs.Wait(summed);
+            valid = valid && triangles.load() == serialTriangles;
+        }
+        double meshTime = Milliseconds(start);
+
+        {
+            std::atomic<int> onMainThread(0);
+            std::thread::id mainThread = std::this_thread::get_id();
+            JobCounter counter;
+            for (int i = 0; i < 64; i++) {
+                jobs.Run([&] {
+                    jobs.RunOnMainThread([&] {
+                        if (std::this_thread::get_id() == mainThread) {
+                            onMainThread++;
+                        }
+                    }, &counter);
+                }, &counter);
+            }
+            jobs.Wait(counter);
+            valid = valid && onMainThread.load() == 64;
+        }
+
+        if (workers == 0) {
+            baseCulling = cullingTime;
+            baseMeshes = meshTime;
+        }
+        JobStats stats = jobs.GetStats();
+        size_t stolen = 0;
+        for (size_t s : stats.Stolen) {
+            stolen += s;
+        }
+        std::cout << "workers " << workers << ": jobs " << jobTime * 1e6 / tinyJobs << " ns each, culling "
+                  << cullingTime << " ms (" << baseCulling / cullingTime << "x), meshes " << meshTime << " ms ("
+                  << baseMeshes / meshTime << "x), " << stolen << " stolen\n";
+    }
+
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << "\n";
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+/*
+    Loading in a shared context on a thread of its own (BackgroundLoader.h).
+
+    The same loads, buffers, textures and the programs of res/shaders,
+    while "frames" go on (a clear and a flush each, then Update()):
+    - render:   no shared context, so Update() loads on the render thread,
+                which is what the engine did before.
+    - loader:   a shared EGL context on the loader thread; the render thread
+                only takes what is done.
+    What counts is the render thread: the time it spent loading, and its
+    worst frame. The program cache is off, so every program is compiled.
+    Every buffer is read back on the render thread and compared.
+
+    With the .spv files of "make spirv" and GL_ARB_gl_spirv the programs
+    that have them come from SPIR-V, so the loader's SPIR-V path (no
+    GL_PROGRAM_BINARY_LENGTH query, see IsSpirvProgram) is taken as well;
+    the report says how many did.
+
+    Usage: loader_bench [buffers] [buffer KB]
+*/
+
+#include "HeadlessContext.h"
+
+#include "../src/BackgroundLoader.h"
+#include "../src/Renderer.h"
+#include "../src/Shader.h"
+#include "../src/Timing.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// ParticleUpdate.shader is left out, it needs constants (Particles.cpp).
+static const char* SHADERS[] = {"Basic", "Textured", "Pulled", "Present", "Immediate", "Particles"};
+
+// Textures loaded, all of the same file.
+static const int TEXTURES = 4;
+
+static std::vector<unsigned char> BufferData(int buffer, size_t bytes) {
+    std::vector<unsigned char> data(bytes);
+    for (size_t i = 0; i < bytes; i++) {
+        data[i] = (unsigned char)(i * 31 + buffer * 7);
+    }
+    return data;
+}
+
+struct RunResult {
+    BackgroundLoadStats Stats;
+    int Frames = 0;
+    int SpirvPrograms = 0;
+    double WorstFrameMs = 0.0;
+    bool Valid = true;
+};
+
+static RunResult Run(const SharedContext& context, int buffers, size_t bufferBytes) {
+    RunResult run;
+    BackgroundLoader loader(context);
+    std::vector<uint32_t> bufferIds, programIds, textureIds;
+    for (int i = 0; i < buffers; i++) {
+        bufferIds.push_back(loader.LoadBuffer("buffer " + std::to_string(i), BufferData(i, bufferBytes)));
+    }
+    for (const char* shader : SHADERS) {
+        programIds.push_back(loader.LoadProgram(std::string("res/shaders/") + shader + ".shader"));
+    }
+    for (int i = 0; i < TEXTURES; i++) {
+        textureIds.push_back(loader.LoadTexture("res/textures/bricks.tga"));
+    }
+
+    while (!loader.IsIdle()) {
+        Clock::time_point start = Clock::now();
+        GLCall(glClearColor(0.1f, 0.2f, 0.3f, 1.0f));
+        GLCall(glClear(GL_COLOR_BUFFER_BIT));
+        GLCall(glFlush());
+        loader.Update();
+        run.WorstFrameMs = std::max(run.WorstFrameMs, Milliseconds(start));
+        run.Frames++;
+    }
+    run.Stats = loader.GetStats();
+    run.Valid = run.Stats.Failed == 0;
+
+    std::vector<unsigned char> readBack(bufferBytes);
+    for (int i = 0; i < buffers; i++) {
+        GLuint buffer = loader.Get(bufferIds[i]);
+        if (!buffer) {
+            run.Valid = false;
+            continue;
+        }
+        GLCall(glGetNamedBufferSubData(buffer, 0, bufferBytes, readBack.data()));
+        if (readBack != BufferData(i, bufferBytes)) {
+            std::cout << "buffer " << i << " isn't what was uploaded\n";
+            run.Valid = false;
+        }
+    }
+    for (uint32_t id : programIds) {
+        GLint linked = 0;
+        if (GLuint program = loader.Get(id)) {
+            GLCall(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+            run.SpirvPrograms += IsSpirvProgram(program);
+        }
+        run.Valid = run.Valid && linked;
+    }
+    for (uint32_t id : textureIds) {
+        GLint width = 0;
+        if (GLuint texture = loader.Get(id)) {
+            GLCall(glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &width));
+        }
+        run.Valid = run.Valid && width > 0;
+    }
+    loader.PrintReport(std::cout);
+    return run;
+}
+
+static void Print(const char* label, const RunResult& run) {
+    const BackgroundLoadStats& stats = run.Stats;
+    std::cout << label << stats.UpdateMs + stats.WaitMs << " ms loading on the render thread, worst frame "
+              << run.WorstFrameMs << " ms of " << run.Frames << ", " << stats.LoaderMs + stats.ReadMs
+              << " ms of loading in all\n";
+}
+
+int main(int argc, char* argv[]) {
+    const int buffers = argc > 1 ? std::atoi(argv[1]) : 64;
+    const size_t bufferBytes = (size_t)(argc > 2 ? std::atoi(argv[2]) : 1024) * 1024;
+
+    HeadlessContext context(64, 64);
+    if (!context.IsValid()) {
+        return 1;
+    }
+    std::cout << "renderer:  " << context.GetRenderer() << "\n";
+    SetProgramCacheDirectory("");
+
+    RunResult render = Run(SharedContext(), buffers, bufferBytes);
+
+    EGLContext shared = context.CreateSharedContext();
+    if (shared == EGL_NO_CONTEXT) {
+        std::cerr << "Can't create a shared context" << std::endl;
+        return 1;
+    }
+    SharedContext loaderContext;
+    loaderContext.MakeCurrent = [&]() { return context.MakeCurrent(shared); };
+    loaderContext.Release = [&]() { context.MakeCurrent(EGL_NO_CONTEXT); };
+    RunResult loader = Run(loaderContext, buffers, bufferBytes);
+    context.DestroySharedContext(shared);
+
+    std::cout << "loads:     " << buffers << " buffers of " << bufferBytes / 1024 << " KB, "
+              << sizeof(SHADERS) / sizeof(SHADERS[0]) << " programs, " << TEXTURES << " textures\n";
+    Print("render:    ", render);
+    Print("loader:    ", loader);
+    const BackgroundLoadStats& stats = loader.Stats;
+    // Every program with .spv files must have come from them.
+    int spirvExpected = 0;
+    for (const char* shader : SHADERS) {
+        std::vector<SpirvModule> modules;
+        std::string path = std::string("res/shaders/") + shader + ".shader";
+        spirvExpected += GLEW_ARB_gl_spirv && LoadSpirvModules(path, modules);
+    }
+    if (spirvExpected > 0) {
+        std::cout << "spirv:     " << loader.SpirvPrograms << " of " << spirvExpected << " programs from .spv files\n";
+    }
+    else if (!GLEW_ARB_gl_spirv) {
+        std::cout << "spirv:     no GL_ARB_gl_spirv, GLSL only\n";
+    }
+    else {
+        std::cout << "spirv:     no .spv files (make spirv), GLSL only\n";
+    }
+    std::cout << "moved:     " << stats.LoaderMs + stats.ReadMs - stats.UpdateMs - stats.WaitMs
+              << " ms off the render thread\n";
+
+    // The loader's GL work mustn't show up on the render thread.
+    bool valid = render.Valid && loader.Valid;
+    valid = valid && render.SpirvPrograms == spirvExpected && loader.SpirvPrograms == spirvExpected;
+    valid = valid && stats.UpdateMs + stats.WaitMs < render.Stats.UpdateMs / 2;
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << "\n";
+    return valid ? 0 : 1;
+}
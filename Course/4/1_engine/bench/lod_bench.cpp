@@ -0,0 +1,141 @@
+/*
+    Levels of detail, headless. A detailed sphere (positions and normals) is
+    simplified into a LOD chain, then the 32x32 field of spheres from the
+    engine is drawn from a few camera positions, once always at full detail
+    and once with SelectLod. "Drawing" is the occlusion buffer's software
+    rasterizer at 640x480, which stands in for the GPU: its cost grows with
+    the number of triangles, just like vertex work does.
+
+    Usage: lod_bench [segments] [frames]
+*/
+
+#include "../src/Math.h"
+#include "../src/MeshFile.h"
+#include "../src/OcclusionCulling.h"
+#include "../src/Simplify.h"
+#include "../src/Timing.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// A sphere of radius 0.5 in the unit cube, with normals. The poles and the
+// seam are shared, so the mesh is closed.
+static void BuildSphere(int segments, std::vector<float>& vertices, std::vector<uint32_t>& indices) {
+    int rings = segments / 2;
+    auto addVertex = [&](float x, float y, float z) {
+        float vertex[6] = {0.5f + x * 0.5f, 0.5f + y * 0.5f, 0.5f + z * 0.5f, x, y, z};
+        vertices.insert(vertices.end(), vertex, vertex + 6);
+    };
+    addVertex(0.0f, 1.0f, 0.0f);
+    for (int r = 1; r < rings; r++) {
+        float theta = 3.14159265f * r / rings;
+        for (int s = 0; s < segments; s++) {
+            float phi = 2.0f * 3.14159265f * s / segments;
+            addVertex(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+        }
+    }
+    addVertex(0.0f, -1.0f, 0.0f);
+
+    uint32_t bottom = 1 + (rings - 1) * segments;
+    auto ring = [&](int r, int s) { return (uint32_t)(1 + (r - 1) * segments + s % segments); };
+    for (int s = 0; s < segments; s++) {
+        indices.insert(indices.end(), {0u, ring(1, s + 1), ring(1, s)});
+        indices.insert(indices.end(), {bottom, ring(rings - 1, s), ring(rings - 1, s + 1)});
+    }
+    for (int r = 1; r + 1 < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            uint32_t a = ring(r, s), b = ring(r, s + 1), c = ring(r + 1, s + 1), d = ring(r + 1, s);
+            indices.insert(indices.end(), {a, b, c, a, c, d});
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const int segments = argc > 1 ? std::atoi(argv[1]) : 64;
+    const int frames = argc > 2 ? std::atoi(argv[2]) : 4;
+
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    BuildSphere(segments, vertices, indices);
+    uint32_t vertexCount = (uint32_t)(vertices.size() / 6);
+
+    MeshLayout layout = {};
+    layout.Stride = 6 * sizeof(float);
+    layout.AttributeCount = 2;
+    layout.Attributes[0] = {0, 3, AttributeType::Float, 0, 0};
+    layout.Attributes[1] = {2, 3, AttributeType::Float, 0, 3 * sizeof(float)};
+
+    auto start = Clock::now();
+    std::vector<MeshLod> lods = BuildLodChain((const unsigned char*)vertices.data(), vertexCount, layout, indices);
+    double simplifyTime = Milliseconds(start);
+
+    std::cout << "sphere:           " << vertexCount << " vertices, LOD chain built in " << simplifyTime << " ms\n";
+    bool monotonic = true;
+    for (size_t i = 0; i < lods.size(); i++) {
+        std::cout << "  lod " << i << ": " << lods[i].IndexCount / 3 << " triangles, error " << lods[i].Error << "\n";
+        if (i > 0) {
+            monotonic = monotonic && lods[i].IndexCount < lods[i - 1].IndexCount && lods[i].Error >= lods[i - 1].Error;
+        }
+    }
+
+    // The rasterizer wants tightly packed positions.
+    std::vector<float> positions(vertexCount * 3);
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        for (int c = 0; c < 3; c++) {
+            positions[v * 3 + c] = vertices[v * 6 + c];
+        }
+    }
+
+    // The same field and camera as the engine.
+    std::vector<Mat4> models;
+    for (int z = 0; z < 32; z++) {
+        for (int x = 0; x < 32; x++) {
+            models.push_back(Translate({-20.0f + x * 1.25f, 0.0f, 8.0f - z * 1.5f}) * Scale({0.8f, 0.8f, 0.8f}));
+        }
+    }
+    const float fovY = 60.0f * 3.14159265f / 180.0f;
+    Mat4 projection = Perspective(fovY, 640.0f / 480.0f, 0.1f, 200.0f);
+    const float pixelsPerUnit = 480.0f / (2.0f * std::tan(fovY / 2.0f));
+
+    OcclusionBuffer target(640, 480);
+    double time[2] = {};
+    size_t triangles[2] = {};
+    size_t lodUse[MeshFile::MaxLods] = {};
+    for (int frame = 0; frame < frames; frame++) {
+        float t = frame * 0.5f;
+        Vec3 eye = {std::sin(t * 0.3f) * 12.0f, 1.7f, 16.0f};
+        Mat4 viewProjection = projection * LookAt(eye, {0.0f, 1.5f, 0.0f}, {0.0f, 1.0f, 0.0f});
+
+        for (int useLods = 0; useLods < 2; useLods++) {
+            target.Clear();
+            start = Clock::now();
+            for (const Mat4& model : models) {
+                uint32_t lod = 0;
+                if (useLods) {
+                    Vec4 center = Transform(model, {0.5f, 0.5f, 0.5f});
+                    Vec3 toCamera = Vec3{center.x, center.y, center.z} - eye;
+                    lod = SelectLod(lods.data(), (uint32_t)lods.size(), MaxScale(model),
+                                    std::sqrt(Dot(toCamera, toCamera)), pixelsPerUnit, 1.0f);
+                    lodUse[lod]++;
+                }
+                target.RasterizeOccluder(viewProjection * model, positions.data(), vertexCount,
+                                         indices.data() + lods[lod].IndexOffset, lods[lod].IndexCount);
+                triangles[useLods] += lods[lod].IndexCount / 3;
+            }
+            time[useLods] += Milliseconds(start);
+        }
+    }
+
+    std::cout << "full detail:      " << triangles[0] / frames << " triangles, " << time[0] / frames << " ms per frame\n"
+              << "with LODs:        " << triangles[1] / frames << " triangles, " << time[1] / frames << " ms per frame\n"
+              << "LOD use:         ";
+    for (size_t i = 0; i < lods.size(); i++) {
+        std::cout << " " << lodUse[i] / frames;
+    }
+    std::cout << " spheres per level\n"
+              << "triangles saved:  " << (1.0 - (double)triangles[1] / triangles[0]) * 100.0 << " %\n"
+              << "levels valid:     " << (monotonic ? "yes" : "NO") << std::endl;
+    return monotonic ? 0 : 1;
+}
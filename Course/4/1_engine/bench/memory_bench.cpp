@@ -0,0 +1,175 @@
+/*
+    Checks and times the GPU memory accounting (GpuMemory.h).
+
+    - track:   TrackGpuMemory + ReleaseGpuMemory alone, in ns per pair.
+    - totals:  buffers of every category out of a ResourcePool and a mesh
+               without one; the books must match what was created, and after
+               destroying half of it the bytes must drop and the peaks stay.
+    - budget:  a budget on shader data whose callback destroys the oldest
+               buffers (least recently created) until the category fits
+               again. Many more buffers are created than the budget holds;
+               afterwards the category must be within budget.
+    - report:  the report must have a line per category and the labels of
+               what is still alive.
+    - driver:  what GL_NVX_gpu_memory_info or GL_ATI_meminfo say, if the
+               driver has either.
+
+    Usage: memory_bench [buffers]
+*/
+
+#include "HeadlessContext.h"
+
+#include "../src/GpuMemory.h"
+#include "../src/Mesh.h"
+#include "../src/Renderer.h"
+#include "../src/ResourcePool.h"
+#include "../src/Timing.h"
+#include "../src/VertexPulling.h"
+
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// A small triangle, enough for CreateMesh.
+static void MakeTriangle(MeshFile& file, std::vector<float>& vertices, std::vector<uint16_t>& indices) {
+    vertices = {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f};
+    indices = {0, 1, 2};
+    file.Layout = {};
+    file.Layout.Stride = 3 * sizeof(float);
+    file.Layout.AttributeCount = 1;
+    file.Layout.Attributes[0] = {0, 3, AttributeType::Float, 0, 0};
+    file.VertexCount = 3;
+    file.IndexCount = 3;
+    file.IndexSize = 2;
+    file.LodCount = 1;
+    file.Lods[0] = {0, 3, 0.0f, 0};
+    file.Vertices = (const unsigned char*)vertices.data();
+    file.VertexBytes = vertices.size() * sizeof(float);
+    file.Indices = (const unsigned char*)indices.data();
+    file.IndexBytes = indices.size() * sizeof(uint16_t);
+}
+
+int main(int argc, char* argv[]) {
+    const int count = argc > 1 ? std::atoi(argv[1]) : 1000;
+    const int rounds = 1000000;
+
+    HeadlessContext context(64, 64);
+    if (!context.IsValid()) {
+        return 1;
+    }
+    std::cout << "renderer:  " << context.GetRenderer() << "\n";
+
+    bool valid = true;
+    {
+        auto start = Clock::now();
+        for (int i = 0; i < rounds; i++) {
+            ReleaseGpuMemory(TrackGpuMemory(MemoryCategory::Other, "scratch", 64));
+        }
+        std::cout << "track:     " << Milliseconds(start) * 1e6 / rounds << " ns per track and release\n";
+        valid = valid && GetGpuMemoryUsage(MemoryCategory::Other).Bytes == 0;
+    }
+
+    ResourcePool resources;
+    {
+        const GLsizeiptr size = 4096;
+        std::vector<BufferHandle> buffers;
+        for (int i = 0; i < count; i++) {
+            MemoryCategory category = i % 2 ? MemoryCategory::Geometry : MemoryCategory::Staging;
+            buffers.push_back(resources.CreateBuffer("buffer " + std::to_string(i % 10), size, nullptr, 0, category));
+        }
+        TextureHandle texture = resources.CreateTexture("texture", GL_TEXTURE_2D, 256 * 256 * 4);
+
+        MeshFile file;
+        std::vector<float> vertices;
+        std::vector<uint16_t> indices;
+        MakeTriangle(file, vertices, indices);
+        Mesh mesh;
+        valid = valid && CreateMesh(file, mesh, nullptr, "triangle");
+        // The vertices (already a multiple of 4 bytes), the indices and the
+        // pull format.
+        size_t meshBytes = file.VertexBytes + file.IndexBytes + sizeof(PullFormat);
+
+        size_t geometry = (size_t)(count / 2) * size;
+        size_t staging = (size_t)(count - count / 2) * size;
+        MemoryUsage geometryUsage = GetGpuMemoryUsage(MemoryCategory::Geometry);
+        MemoryUsage stagingUsage = GetGpuMemoryUsage(MemoryCategory::Staging);
+        valid = valid && geometryUsage.Bytes == geometry + meshBytes;
+        valid = valid && geometryUsage.Allocations == (size_t)count / 2 + 1;
+        valid = valid && stagingUsage.Bytes == staging;
+        valid = valid && GetGpuMemoryUsage(MemoryCategory::Textures).Bytes == 256 * 256 * 4;
+        size_t peak = GetTotalGpuMemoryUsage().Bytes;
+
+        for (size_t i = 0; i < buffers.size(); i += 2) {
+            resources.Destroy(buffers[i]);
+        }
+        resources.Destroy(texture);
+        DeleteMesh(mesh);
+        MemoryUsage total = GetTotalGpuMemoryUsage();
+        valid = valid && GetGpuMemoryUsage(MemoryCategory::Staging).Bytes == 0 &&
+                GetGpuMemoryUsage(MemoryCategory::Staging).PeakBytes == staging &&
+                GetGpuMemoryUsage(MemoryCategory::Geometry).Bytes == geometry && total.PeakBytes == peak;
+        std::cout << "totals:    " << peak / 1024 << " KB at the peak, " << total.Bytes / 1024
+                  << " KB after destroying half\n";
+
+        for (BufferHandle& buffer : buffers) {
+            resources.Destroy(buffer);
+        }
+        resources.EndFrame();
+    }
+
+    {
+        const GLsizeiptr size = 64 * 1024;
+        const size_t budget = 1024 * 1024;
+        std::deque<BufferHandle> live;
+        SetGpuMemoryBudget(MemoryCategory::ShaderData, budget, [&](size_t excess) {
+            // The newest one isn't in live yet, so it is never the victim.
+            size_t freed = 0;
+            while (freed < excess && !live.empty()) {
+                freed += resources.GetInfo(live.front())->Size;
+                resources.Destroy(live.front());
+                live.pop_front();
+            }
+        });
+
+        for (int i = 0; i < count; i++) {
+            live.push_back(resources.CreateBuffer("uniforms " + std::to_string(i), size, nullptr, 0));
+            resources.EndFrame();
+        }
+        MemoryUsage usage = GetGpuMemoryUsage(MemoryCategory::ShaderData);
+        valid = valid && usage.Bytes <= budget && usage.PeakBytes <= budget + size && usage.Evictions > 0 &&
+                usage.Bytes == live.size() * size;
+        std::cout << "budget:    " << count << " buffers of " << size / 1024 << " KB, " << live.size()
+                  << " alive, " << usage.Evictions << " evictions, " << usage.Bytes / 1024 << " of "
+                  << budget / 1024 << " KB used, peak " << usage.PeakBytes / 1024 << " KB\n";
+
+        std::ostringstream report;
+        PrintGpuMemoryReport(report, 5);
+        std::string text = report.str();
+        valid = valid && text.find("gpu_memory shader_data bytes " + std::to_string(usage.Bytes)) != std::string::npos;
+        valid = valid && text.find("gpu_memory_label shader_data \"uniforms ") != std::string::npos;
+        valid = valid && text.find("gpu_memory_label ... " + std::to_string(live.size() - 5) + " more") !=
+                             std::string::npos;
+        valid = valid && text.find("gpu_memory textures bytes 0 peak 262144") != std::string::npos;
+        std::cout << "report:\n" << text;
+
+        SetGpuMemoryBudget(MemoryCategory::ShaderData, 0);
+        for (BufferHandle& buffer : live) {
+            resources.Destroy(buffer);
+        }
+    }
+
+    DriverMemoryInfo driver = QueryDriverMemory();
+    if (driver.Known) {
+        std::cout << "driver:    " << driver.Source << ", " << driver.AvailableKB / 1024 << " of "
+                  << driver.TotalKB / 1024 << " MB available\n";
+    }
+    else {
+        std::cout << "driver:    no memory info extension\n";
+    }
+
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << "\n";
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+/*
+    How fast can a mesh get from disk into (a stand-in for) a mapped GPU
+    buffer? Headless, so the destination is plain memory; with a driver it
+    would be the pointer from glMapNamedBufferRange, or the driver's own copy
+    when glNamedBufferStorage reads from the mapping.
+
+    - mesh file, mmap:  LoadMeshFile, then copy both blobs to the destination.
+    - mesh file, read:  the same file read into a vector first (one extra copy).
+    - obj:              parse the same mesh from text, like we would without
+                        the converter.
+
+    The files are written into bin/ first, so they are in the page cache;
+    these are warm numbers.
+
+    Usage: mesh_bench [grid size] [iterations]
+*/
+
+#include "../src/MeshFile.h"
+#include "../src/MeshImporter.h"
+#include "../src/Timing.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    const int size = argc > 1 ? std::atoi(argv[1]) : 512;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 20;
+    const char* meshPath = "bin/bench_mesh.mesh";
+    const char* objPath = "bin/bench_mesh.obj";
+
+    // A wavy grid with positions, texcoords and normals (32 bytes per vertex).
+    MeshLayout layout = {};
+    layout.Stride = 8 * sizeof(float);
+    layout.AttributeCount = 3;
+    layout.Attributes[0] = {0, 3, AttributeType::Float, 0, 0};
+    layout.Attributes[1] = {1, 2, AttributeType::Float, 0, 3 * sizeof(float)};
+    layout.Attributes[2] = {2, 3, AttributeType::Float, 0, 5 * sizeof(float)};
+
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    std::ofstream obj(objPath);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            float u = (float)x / (size - 1), v = (float)y / (size - 1);
+            float height = 0.05f * std::sin(u * 20.0f) * std::cos(v * 20.0f);
+            float vertex[8] = {u, height, v, u, v, 0.0f, 1.0f, 0.0f};
+            vertices.insert(vertices.end(), vertex, vertex + 8);
+            obj << "v " << u << ' ' << height << ' ' << v << "\nvt " << u << ' ' << v << "\nvn 0 1 0\n";
+        }
+    }
+    for (int y = 0; y + 1 < size; y++) {
+        for (int x = 0; x + 1 < size; x++) {
+            uint32_t i = y * size + x;
+            uint32_t quad[6] = {i, i + size, i + 1, i + 1, i + size, i + size + 1};
+            indices.insert(indices.end(), quad, quad + 6);
+            obj << "f";
+            for (int c = 0; c < 3; c++) {
+                obj << ' ' << quad[c] + 1 << '/' << quad[c] + 1 << '/' << quad[c] + 1;
+            }
+            obj << "\nf";
+            for (int c = 3; c < 6; c++) {
+                obj << ' ' << quad[c] + 1 << '/' << quad[c] + 1 << '/' << quad[c] + 1;
+            }
+            obj << '\n';
+        }
+    }
+    obj.close();
+
+    if (!SaveMeshFile(meshPath, layout, vertices.data(), (uint32_t)(vertices.size() / 8),
+                      indices.data(), (uint32_t)indices.size())) {
+        std::cerr << "Can't write " << meshPath << " (run from the engine directory)" << std::endl;
+        return 1;
+    }
+
+    // Stands in for the mapped vertex and index buffers.
+    std::vector<unsigned char> gpuVertices, gpuIndices;
+    double mappedTime = 0.0, readTime = 0.0;
+    size_t bytes = 0;
+
+    for (int i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        {
+            MeshFile mesh;
+            if (!LoadMeshFile(meshPath, mesh)) {
+                std::cerr << "Can't load " << meshPath << std::endl;
+                return 1;
+            }
+            gpuVertices.resize(mesh.VertexBytes);
+            gpuIndices.resize(mesh.IndexBytes);
+            std::memcpy(gpuVertices.data(), mesh.Vertices, mesh.VertexBytes);
+            std::memcpy(gpuIndices.data(), mesh.Indices, mesh.IndexBytes);
+            bytes = mesh.VertexBytes + mesh.IndexBytes;
+        }
+        mappedTime += Seconds(start);
+
+        start = Clock::now();
+        {
+            std::ifstream input(meshPath, std::ios::binary | std::ios::ate);
+            std::vector<unsigned char> file((size_t)input.tellg());
+            input.seekg(0);
+            input.read((char*)file.data(), file.size());
+            MeshFile mesh;
+            ParseMeshFile(file.data(), file.size(), mesh);
+            std::memcpy(gpuVertices.data(), mesh.Vertices, mesh.VertexBytes);
+            std::memcpy(gpuIndices.data(), mesh.Indices, mesh.IndexBytes);
+        }
+        readTime += Seconds(start);
+    }
+
+    // Text parsing is orders of magnitude slower, once is enough. One thread,
+    // see import_bench for more.
+    auto start = Clock::now();
+    ImportedMesh imported;
+    ImportObj(objPath, imported, 1);
+    double objTime = Seconds(start);
+
+    std::ifstream objFile(objPath, std::ios::binary | std::ios::ate);
+    double objBytes = (double)objFile.tellg();
+
+    // The copies must be identical to what we started with. The importer
+    // numbers vertices in the order it meets them, so only compare its counts.
+    bool matches = gpuVertices.size() == vertices.size() * sizeof(float) &&
+                   std::memcmp(gpuVertices.data(), vertices.data(), gpuVertices.size()) == 0 &&
+                   imported.VertexCount == vertices.size() / 8 && imported.Indices.size() == indices.size();
+
+    double gigabytes = bytes / 1e9;
+    std::cout << "mesh:               " << vertices.size() / 8 << " vertices, " << indices.size() / 3
+              << " triangles, " << bytes / (1024 * 1024) << " MB of buffers\n"
+              << "mesh file, mmap:    " << mappedTime / iterations * 1000.0 << " ms, "
+              << gigabytes * iterations / mappedTime << " GB/s\n"
+              << "mesh file, read:    " << readTime / iterations * 1000.0 << " ms, "
+              << gigabytes * iterations / readTime << " GB/s\n"
+              << "obj:                " << objTime * 1000.0 << " ms, " << gigabytes / objTime << " GB/s ("
+              << objBytes / 1e6 / objTime << " MB/s of text)\n"
+              << "contents match:     " << (matches ? "yes" : "NO") << std::endl;
+    return matches ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+/*
+    Headless benchmark for the software occlusion culling (no window, no GPU).
+
+    The scene is a grid of small boxes on the ground with a couple of big walls
+    standing in front of the camera. Every iteration clears the occlusion buffer,
+    rasterizes the walls, builds the hierarchy and tests every box.
+
+    At the end we print the timings, how many boxes were culled, and a checksum
+    of the depth buffer and of the results. Running it twice must print the same
+    checksum. We also compare every "Occluded" answer against a brute force
+    per-pixel test, since claiming that a visible box is hidden would be a bug.
+
+    Usage: occlusion_bench [iterations]
+*/
+
+#include "../src/OcclusionCulling.h"
+#include "../src/Timing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+struct Box {
+    Vec3 Min;
+    Vec3 Max;
+};
+
+static void AddQuad(std::vector<float>& positions, std::vector<unsigned int>& indices,
+                    Vec3 a, Vec3 b, Vec3 c, Vec3 d) {
+    unsigned int base = (unsigned int)(positions.size() / 3);
+    for (const Vec3& v : {a, b, c, d}) {
+        positions.insert(positions.end(), {v.x, v.y, v.z});
+    }
+    indices.insert(indices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+}
+
+static uint64_t Hash(uint64_t hash, const void* data, size_t size) {
+    // FNV-1a, good enough to notice if two runs differ.
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Projects the box the same way OcclusionBuffer::Test does, but compares
+// against every single pixel of the full resolution buffer.
+static bool BruteForceOccluded(const OcclusionBuffer& buffer, const Mat4& mvp, const Box& box) {
+    float minX = 1e30f, minY = 1e30f, minZ = 1e30f, maxX = -1e30f, maxY = -1e30f;
+    for (int corner = 0; corner < 8; corner++) {
+        Vec3 p = {(corner & 1) ? box.Max.x : box.Min.x,
+                  (corner & 2) ? box.Max.y : box.Min.y,
+                  (corner & 4) ? box.Max.z : box.Min.z};
+        Vec4 c = Transform(mvp, p);
+        if (c.z < -c.w) {
+            return false;
+        }
+        float invW = 1.0f / c.w;
+        minX = std::min(minX, (c.x * invW * 0.5f + 0.5f) * buffer.GetWidth());
+        maxX = std::max(maxX, (c.x * invW * 0.5f + 0.5f) * buffer.GetWidth());
+        minY = std::min(minY, (c.y * invW * 0.5f + 0.5f) * buffer.GetHeight());
+        maxY = std::max(maxY, (c.y * invW * 0.5f + 0.5f) * buffer.GetHeight());
+        minZ = std::min(minZ, c.z * invW * 0.5f + 0.5f);
+    }
+
+    int x0 = std::max(0, (int)std::floor(minX)), x1 = std::min(buffer.GetWidth() - 1, (int)std::floor(maxX));
+    int y0 = std::max(0, (int)std::floor(minY)), y1 = std::min(buffer.GetHeight() - 1, (int)std::floor(maxY));
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            if (minZ <= buffer.GetDepth(x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+
+    // Two walls and a low fence, all in world space.
+    std::vector<float> occluderPositions;
+    std::vector<unsigned int> occluderIndices;
+    AddQuad(occluderPositions, occluderIndices, {-8, 0, 0}, {8, 0, 0}, {8, 6, 0}, {-8, 6, 0});
+    AddQuad(occluderPositions, occluderIndices, {6, 0, -20}, {30, 0, -20}, {30, 12, -20}, {6, 12, -20});
+    AddQuad(occluderPositions, occluderIndices, {-40, 0, -30}, {-10, 0, -30}, {-10, 1.5f, -30}, {-40, 1.5f, -30});
+
+    std::vector<Box> boxes;
+    for (int z = 0; z < 64; z++) {
+        for (int x = 0; x < 64; x++) {
+            float wx = -40.0f + x * 1.25f;
+            float wz = 8.0f - z * 1.5f;
+            boxes.push_back({{wx, 0.0f, wz}, {wx + 0.8f, 0.8f + (x * 7 + z * 3) % 5 * 0.4f, wz + 0.8f}});
+        }
+    }
+
+    Mat4 projection = Perspective(60.0f * 3.14159265f / 180.0f, 640.0f / 480.0f, 0.1f, 200.0f);
+    Mat4 view = LookAt({0.0f, 1.7f, 14.0f}, {0.0f, 1.5f, 0.0f}, {0.0f, 1.0f, 0.0f});
+    Mat4 viewProjection = projection * view;
+
+    OcclusionBuffer buffer(256, 128);
+    std::vector<OcclusionResult> results(boxes.size());
+
+    double rasterizeTime = 0.0, hierarchyTime = 0.0, testTime = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        auto t0 = Clock::now();
+        buffer.Clear();
+        buffer.RasterizeOccluder(viewProjection, occluderPositions.data(), occluderPositions.size() / 3,
+                                 occluderIndices.data(), occluderIndices.size());
+        auto t1 = Clock::now();
+        buffer.BuildHierarchy();
+        auto t2 = Clock::now();
+        for (size_t b = 0; b < boxes.size(); b++) {
+            results[b] = buffer.Test(viewProjection, boxes[b].Min, boxes[b].Max);
+        }
+        auto t3 = Clock::now();
+
+        rasterizeTime += Microseconds(t0, t1);
+        hierarchyTime += Microseconds(t1, t2);
+        testTime += Microseconds(t2, t3);
+    }
+
+    size_t visible = 0, occluded = 0, outside = 0, wrong = 0;
+    for (size_t b = 0; b < boxes.size(); b++) {
+        switch (results[b]) {
+            case OcclusionResult::Visible: visible++; break;
+            case OcclusionResult::Occluded: occluded++; break;
+            case OcclusionResult::OutsideFrustum: outside++; break;
+        }
+        if (results[b] == OcclusionResult::Occluded && !BruteForceOccluded(buffer, viewProjection, boxes[b])) {
+            wrong++;
+        }
+    }
+
+    uint64_t checksum = 14695981039346656037ull;
+    for (int y = 0; y < buffer.GetHeight(); y++) {
+        for (int x = 0; x < buffer.GetWidth(); x++) {
+            float depth = buffer.GetDepth(x, y);
+            checksum = Hash(checksum, &depth, sizeof(depth));
+        }
+    }
+    checksum = Hash(checksum, results.data(), results.size() * sizeof(OcclusionResult));
+
+    std::cout << "buffer:          " << buffer.GetWidth() << "x" << buffer.GetHeight()
+              << " (" << buffer.GetLevelCount() << " hierarchy levels)\n"
+              << "iterations:      " << iterations << "\n"
+              << "rasterize:       " << rasterizeTime / iterations << " us\n"
+              << "build hierarchy: " << hierarchyTime / iterations << " us\n"
+              << "test " << boxes.size() << " boxes: " << testTime / iterations << " us ("
+              << testTime * 1000.0 / iterations / boxes.size() << " ns per box)\n"
+              << "visible:         " << visible << "\n"
+              << "occluded:        " << occluded << "\n"
+              << "outside frustum: " << outside << "\n"
+              << "wrongly culled:  " << wrong << "\n"
+              << "checksum:        " << std::hex << checksum << std::dec << std::endl;
+
+    return wrong == 0 ? 0 : 1;
+}
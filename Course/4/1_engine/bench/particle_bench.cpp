@@ -0,0 +1,102 @@
+/*
+    How many particles the compute passes of ParticleSystem move per
+    millisecond (llvmpipe when there is no GPU, see HeadlessContext.h).
+
+    - steady:   the buffer is filled once with particles that never die, then
+                every frame simulates all of them and compacts nothing away.
+    - churn:    particles live 0.5 to 1.5 seconds and new ones are emitted
+                every frame, so SIMULATE, COMPACT and EMIT all have work. After
+                a while there should be about emit rate * average lifetime of
+                them.
+
+    Nothing is read back while the frames run; the count is read once at the
+    end to check it. Finally one frame is drawn with the indirect draw, to
+    see that the count made it from the compute passes to the draw.
+
+    Usage: particle_bench [capacity] [frames]
+*/
+
+#include "HeadlessContext.h"
+
+#include "../src/Particles.h"
+#include "../src/Renderer.h"
+#include "../src/Timing.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    const uint32_t capacity = argc > 1 ? (uint32_t)std::atoi(argv[1]) : 1 << 20;
+    const int frames = argc > 2 ? std::atoi(argv[2]) : 60;
+    const float deltaTime = 1.0f / 60.0f;
+
+    HeadlessContext context(640, 480);
+    if (!context.IsValid()) {
+        return 1;
+    }
+    std::cout << "renderer:  " << context.GetRenderer() << "\n";
+
+    ParticleEmitter emitter = {{0.0f, 0.0f, 0.0f}, {0.0f, 5.0f, 0.0f}, 2.0f, 1e9f, 1e9f};
+    bool valid = true;
+
+    {
+        ParticleSystem particles(capacity);
+        if (!particles.IsValid()) {
+            return 1;
+        }
+        particles.Update(deltaTime, emitter, capacity);
+        uint32_t filled = particles.ReadCount();
+
+        auto start = Clock::now();
+        for (int frame = 0; frame < frames; frame++) {
+            particles.Update(deltaTime, emitter, 0);
+        }
+        GLCall(glFinish());
+        double time = Milliseconds(start);
+        uint32_t count = particles.ReadCount();
+
+        std::cout << "steady:    " << count << " particles, " << time / frames << " ms per frame, "
+                  << (double)count * frames / time << " particles per ms\n";
+        valid = valid && filled == capacity && count == capacity;
+    }
+
+    ParticleSystem particles(capacity);
+    emitter.MinLifetime = 0.5f;
+    emitter.MaxLifetime = 1.5f;
+    // Half of the capacity alive on average: rate * 1 second of lifetime.
+    const uint32_t emitPerFrame = (uint32_t)(capacity / 2 * deltaTime);
+    const int churnFrames = frames < 120 ? 120 : frames;
+
+    auto start = Clock::now();
+    for (int frame = 0; frame < churnFrames; frame++) {
+        particles.Update(deltaTime, emitter, emitPerFrame);
+    }
+    GLCall(glFinish());
+    double time = Milliseconds(start);
+    uint32_t count = particles.ReadCount();
+    double expected = capacity / 2.0;
+
+    std::cout << "churn:     " << count << " particles (expected about " << (uint32_t)expected << "), "
+              << time / churnFrames << " ms per frame, "
+              << (double)count * churnFrames / time << " particles per ms\n";
+    valid = valid && count > expected * 0.9 && count < expected * 1.1;
+
+    // One frame on screen, looking at the fountain from the side.
+    Mat4 viewProjection = Perspective(60.0f * 3.14159265f / 180.0f, 640.0f / 480.0f, 0.1f, 200.0f) *
+                          LookAt({0.0f, 2.0f, 12.0f}, {0.0f, 2.0f, 0.0f}, {0.0f, 1.0f, 0.0f});
+    GLCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    particles.Draw(viewProjection, 4.0f);
+
+    std::vector<unsigned char> pixels(640 * 480 * 4);
+    GLCall(glReadPixels(0, 0, 640, 480, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data()));
+    size_t lit = 0;
+    for (size_t i = 0; i < pixels.size(); i += 4) {
+        lit += pixels[i] != 0;
+    }
+    std::cout << "drawn:     " << lit << " pixels covered\n";
+    valid = valid && lit > 0;
+
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << std::endl;
+    return valid ? 0 : 1;
+}
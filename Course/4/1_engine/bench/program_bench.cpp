@@ -0,0 +1,109 @@
+/*
+    What the program cache (BuildProgram in Shader.h) saves on a start.
+
+    Every program in res/shaders is built twice:
+    - cold:  the cache directory is empty, so BuildProgram compiles, links,
+             asks for the reflection and writes the cache file.
+    - warm:  the file is there; glProgramBinary plus reading the reflection.
+
+    The warm build must come from the cache, and its reflection must be the
+    same as the cold one, byte for byte. Every round adds its number to the
+    sources as a comment, so the driver's own shader cache has never seen
+    them either and the cold numbers are really cold. (That cache can't just
+    be turned off: Mesa only hands out program binaries while it is on.)
+
+    Usage: program_bench [rounds]
+*/
+
+#include "HeadlessContext.h"
+
+#include "../src/Shader.h"
+#include "../src/Timing.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct Program {
+    std::string Name;
+    ShaderProgramSource Source;
+};
+
+int main(int argc, char* argv[]) {
+    const int rounds = argc > 1 ? std::atoi(argv[1]) : 5;
+    const std::string directory = "bin/program_cache";
+
+    HeadlessContext context(64, 64);
+    if (!context.IsValid()) {
+        return 1;
+    }
+    std::cout << "renderer:  " << context.GetRenderer() << "\n";
+
+    // The same variants ParticleSystem builds, plus every other file.
+    std::vector<Program> programs;
+    for (const char* name : {"Basic", "Textured", "Pulled", "Particles"}) {
+        std::string path = std::string("res/shaders/") + name + ".shader";
+        programs.push_back({path, ParseShaders(path)});
+    }
+    ShaderProgramSource update = ParseShaders("res/shaders/ParticleUpdate.shader");
+    for (int pass = 0; pass < 5; pass++) {
+        ShaderProgramSource variant;
+        variant.ComputeSource = AddDefine(update.ComputeSource, "PASS " + std::to_string(pass) + "u");
+        programs.push_back({"ParticleUpdate.shader (PASS " + std::to_string(pass) + ")", variant});
+    }
+
+    SetProgramCacheDirectory(directory);
+    bool valid = true;
+    double coldTime = 0.0, warmTime = 0.0;
+    for (int round = 0; round < rounds; round++) {
+        std::filesystem::remove_all(directory);
+
+        std::vector<ShaderProgramSource> sources;
+        std::string comment = "\n// round " + std::to_string(round) + " of program_bench\n";
+        for (const Program& program : programs) {
+            sources.push_back(program.Source);
+            for (std::string* part : {&sources.back().VertexSource, &sources.back().FragmentSource,
+                                      &sources.back().ComputeSource}) {
+                if (!part->empty()) {
+                    *part += comment;
+                }
+            }
+        }
+
+        std::vector<std::vector<unsigned char>> coldReflections;
+        auto start = Clock::now();
+        for (size_t i = 0; i < programs.size(); i++) {
+            ProgramReflection reflection;
+            bool fromCache;
+            GLuint id = BuildProgram(sources[i], programs[i].Name, reflection, &fromCache);
+            valid = valid && id != 0 && !fromCache;
+            coldReflections.emplace_back();
+            SerializeReflection(reflection, coldReflections.back());
+            glDeleteProgram(id);
+        }
+        glFinish();
+        coldTime += Milliseconds(start);
+
+        start = Clock::now();
+        for (size_t i = 0; i < programs.size(); i++) {
+            ProgramReflection reflection;
+            bool fromCache;
+            GLuint id = BuildProgram(sources[i], programs[i].Name, reflection, &fromCache);
+            std::vector<unsigned char> warm;
+            SerializeReflection(reflection, warm);
+            valid = valid && id != 0 && fromCache && warm == coldReflections[i];
+            glDeleteProgram(id);
+        }
+        glFinish();
+        warmTime += Milliseconds(start);
+    }
+    std::filesystem::remove_all(directory);
+
+    std::cout << "programs:  " << programs.size() << "\n";
+    std::cout << "cold:      " << coldTime / rounds << " ms\n";
+    std::cout << "warm:      " << warmTime / rounds << " ms (" << coldTime / warmTime << "x faster)\n";
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << "\n";
+    return valid ? 0 : 1;
+}
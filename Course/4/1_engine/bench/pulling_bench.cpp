@@ -0,0 +1,187 @@
+/*
+    Vertex attributes against vertex pulling, on a real OpenGL driver
+    (llvmpipe when there is no GPU, see HeadlessContext.h).
+
+    The 32x32 field of objects from the engine is drawn into a 640x480
+    framebuffer with every mesh, three ways:
+
+    - attributes:          Basic.shader, the vertex array from CreateMesh,
+                           glUniform + glDrawElements per object
+    - pulled:              Pulled.shader, the same vertex buffer as a storage
+                           buffer, glUniform + glDrawElementsInstanced per object
+    - pulled, instanced:   Pulled.shader, one draw for the whole field
+
+    Frames end with glFinish, so the times include the vertex and fragment
+    work, not just the time it took to queue the calls. The last frame of
+    every mode is read back and compared against the attribute one: the
+    same vertices go through the same math, so the images must be equal.
+
+    The meshes are the ones in res/meshes ("make meshes") plus a denser
+    sphere with normals, written into bin/ first.
+
+    Usage: pulling_bench [frames] [dense sphere segments]
+*/
+
+#include "HeadlessContext.h"
+
+#include "../src/Math.h"
+#include "../src/Mesh.h"
+#include "../src/MeshFile.h"
+#include "../src/Renderer.h"
+#include "../src/Shader.h"
+#include "../src/Timing.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Same as the Instance struct in main.cpp.
+struct Instance {
+    Mat4 MVP;
+    float Color[4];
+};
+
+// A sphere of radius 0.5 in the unit cube, positions and normals (24 bytes per vertex).
+static bool WriteDenseSphere(const std::string& filepath, int segments) {
+    int rings = segments / 2;
+    std::vector<float> vertices;
+    for (int r = 0; r <= rings; r++) {
+        float theta = 3.14159265f * r / rings;
+        for (int s = 0; s <= segments; s++) {
+            float phi = 2.0f * 3.14159265f * s / segments;
+            float n[3] = {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+            float vertex[6] = {0.5f + n[0] * 0.5f, 0.5f + n[1] * 0.5f, 0.5f + n[2] * 0.5f, n[0], n[1], n[2]};
+            vertices.insert(vertices.end(), vertex, vertex + 6);
+        }
+    }
+
+    std::vector<uint32_t> indices;
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            uint32_t a = r * (segments + 1) + s, b = a + 1, c = a + segments + 2, d = a + segments + 1;
+            indices.insert(indices.end(), {a, c, b, a, d, c});
+        }
+    }
+
+    MeshLayout layout = {};
+    layout.Stride = 6 * sizeof(float);
+    layout.AttributeCount = 2;
+    layout.Attributes[0] = {0, 3, AttributeType::Float, 0, 0};
+    layout.Attributes[1] = {2, 3, AttributeType::Float, 0, 3 * sizeof(float)};
+    return SaveMeshFile(filepath, layout, vertices.data(), (uint32_t)(vertices.size() / 6),
+                        indices.data(), (uint32_t)indices.size());
+}
+
+static GLuint LoadProgram(const std::string& filepath) {
+    ShaderProgramSource source = ParseShaders(filepath);
+    return CreateShader(source.VertexSource, source.FragmentSource);
+}
+
+int main(int argc, char* argv[]) {
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 3;
+    const int segments = argc > 2 ? std::atoi(argv[2]) : 64;
+
+    HeadlessContext context(640, 480);
+    if (!context.IsValid()) {
+        return 1;
+    }
+    std::cout << "renderer:  " << context.GetRenderer() << "\n";
+
+    const char* densePath = "bin/pulling_sphere.mesh";
+    if (!WriteDenseSphere(densePath, segments)) {
+        std::cerr << "Can't write " << densePath << std::endl;
+        return 1;
+    }
+
+    GLuint basic = LoadProgram("res/shaders/Basic.shader");
+    GLuint pulled = LoadProgram("res/shaders/Pulled.shader");
+    GLint mvpLocation = glGetUniformLocation(basic, "u_MVP");
+    GLint colorLocation = glGetUniformLocation(basic, "u_Color");
+    GLint firstInstanceLocation = glGetUniformLocation(pulled, "u_FirstInstance");
+    if (mvpLocation == -1 || colorLocation == -1 || firstInstanceLocation == -1) {
+        std::cerr << "Can't load the shaders" << std::endl;
+        return 1;
+    }
+
+    std::vector<Mat4> models;
+    std::vector<Instance> instances;
+    for (int z = 0; z < 32; z++) {
+        for (int x = 0; x < 32; x++) {
+            models.push_back(Translate({-20.0f + x * 1.25f, 0.0f, 8.0f - z * 1.5f}) * Scale({0.8f, 0.8f, 0.8f}));
+            instances.push_back({Mat4::Identity(), {x / 32.0f, 0.0f, z / 32.0f, 1.0f}});
+        }
+    }
+    Mat4 projection = Perspective(60.0f * 3.14159265f / 180.0f, 640.0f / 480.0f, 0.1f, 200.0f);
+
+    GLuint instanceBuffer;
+    GLCall(glCreateBuffers(1, &instanceBuffer));
+    GLCall(glNamedBufferStorage(instanceBuffer, instances.size() * sizeof(Instance), nullptr, GL_DYNAMIC_STORAGE_BIT));
+    GLCall(glEnable(GL_DEPTH_TEST));
+
+    const char* modeNames[] = {"attributes:       ", "pulled:           ", "pulled, instanced:"};
+    bool allMatch = true;
+    for (const char* path : {"res/meshes/cube.mesh", "res/meshes/sphere.mesh", densePath}) {
+        Mesh mesh;
+        if (!LoadMesh(path, mesh)) {
+            return 1;
+        }
+        std::cout << path << ": " << mesh.Lods[0].IndexCount / 3 << " triangles x " << models.size() << "\n";
+
+        std::vector<unsigned char> images[3];
+        for (int mode = 0; mode < 3; mode++) {
+            GLCall(glUseProgram(mode == 0 ? basic : pulled));
+            GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, instanceBuffer));
+
+            auto start = Clock::now();
+            for (int frame = 0; frame < frames; frame++) {
+                float t = frame * 0.5f;
+                Vec3 eye = {std::sin(t * 0.3f) * 12.0f, 1.7f, 16.0f};
+                Mat4 viewProjection = projection * LookAt(eye, {0.0f, 1.5f, 0.0f}, {0.0f, 1.0f, 0.0f});
+                for (size_t i = 0; i < models.size(); i++) {
+                    instances[i].MVP = viewProjection * models[i];
+                }
+
+                GLCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+                if (mode == 0) {
+                    for (const Instance& instance : instances) {
+                        GLCall(glUniformMatrix4fv(mvpLocation, 1, GL_FALSE, instance.MVP.Data));
+                        GLCall(glUniform4fv(colorLocation, 1, instance.Color));
+                        DrawMesh(mesh);
+                    }
+                }
+                else {
+                    GLCall(glNamedBufferSubData(instanceBuffer, 0, instances.size() * sizeof(Instance), instances.data()));
+                    if (mode == 1) {
+                        for (uint32_t i = 0; i < instances.size(); i++) {
+                            GLCall(glUniform1ui(firstInstanceLocation, i));
+                            DrawPulledMesh(mesh);
+                        }
+                    }
+                    else {
+                        GLCall(glUniform1ui(firstInstanceLocation, 0));
+                        DrawPulledMesh(mesh, 0, (uint32_t)instances.size());
+                    }
+                }
+                GLCall(glFinish());
+            }
+            double time = Milliseconds(start) / frames;
+
+            images[mode].resize(640 * 480 * 4);
+            GLCall(glReadPixels(0, 0, 640, 480, GL_RGBA, GL_UNSIGNED_BYTE, images[mode].data()));
+            bool match = images[mode] == images[0];
+            allMatch = allMatch && match;
+            std::cout << "  " << modeNames[mode] << " " << time << " ms per frame"
+                      << (mode > 0 ? (match ? ", same image" : ", IMAGE DIFFERS") : "") << "\n";
+        }
+        DeleteMesh(mesh);
+    }
+
+    GLCall(glDeleteBuffers(1, &instanceBuffer));
+    GLCall(glDeleteProgram(pulled));
+    GLCall(glDeleteProgram(basic));
+
+    std::cout << "images match: " << (allMatch ? "yes" : "NO") << std::endl;
+    return allMatch ? 0 : 1;
+}
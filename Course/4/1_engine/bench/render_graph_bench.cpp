@@ -0,0 +1,329 @@
+/*
+    A deferred-style frame through the render graph (RenderGraph.h): shadow
+    map, G-buffer, ambient occlusion, lighting, a debug view nobody reads, a
+    bloom chain, tone mapping and the final pass onto the backbuffer.
+
+    Every pass that reads draws a full-screen triangle mixing its inputs with
+    fixed weights, so the colors are constant and the CPU can work out what
+    must end up on screen. If two textures alive at the same time got the
+    same memory, the pixel would be wrong.
+
+    - culling:   the debug view must be culled, and never run.
+    - memory:    the transient bytes with and without aliasing, which must be
+                 less, and what the GPU memory accounting says about render
+                 targets (must be the aliased number).
+    - frames:    the time of a frame, and the CPU time the graph itself
+                 takes outside the passes (declaring, culling, assigning
+                 textures, clears and invalidations). After the first frame
+                 no texture and no framebuffer may be created.
+    - resize:    the same frame at another size; after a few frames the old
+                 textures must be gone again.
+
+    Usage: render_graph_bench [frames]
+*/
+
+#include "HeadlessContext.h"
+
+#include "../src/GpuMemory.h"
+#include "../src/Renderer.h"
+#include "../src/RenderGraph.h"
+#include "../src/ResourcePool.h"
+#include "../src/Shader.h"
+#include "../src/Timing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+static const char* MIX_VERTEX = R"(#version 450 core
+layout (location = 0) out vec2 v_TexCoord;
+void main() {
+    v_TexCoord = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(v_TexCoord * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+// color = a * weights.x + b * weights.y + c * weights.z + add
+static const char* MIX_FRAGMENT = R"(#version 450 core
+layout (location = 0) in vec2 v_TexCoord;
+layout (location = 0) out vec4 color;
+layout (location = 0) uniform vec3 u_Weights;
+layout (location = 1) uniform vec4 u_Add;
+layout (binding = 0) uniform sampler2D u_A;
+layout (binding = 1) uniform sampler2D u_B;
+layout (binding = 2) uniform sampler2D u_C;
+void main() {
+    color = texture(u_A, v_TexCoord) * u_Weights.x + texture(u_B, v_TexCoord) * u_Weights.y +
+            texture(u_C, v_TexCoord) * u_Weights.z + u_Add;
+}
+)";
+
+struct Color {
+    float r, g, b, a;
+};
+
+static Color Mix(const Color* inputs[3], const float weights[3], Color add) {
+    Color result = add;
+    for (int i = 0; i < 3; i++) {
+        if (inputs[i]) {
+            result.r += inputs[i]->r * weights[i];
+            result.g += inputs[i]->g * weights[i];
+            result.b += inputs[i]->b * weights[i];
+            result.a += inputs[i]->a * weights[i];
+        }
+    }
+    return result;
+}
+
+// What sampling a texture of that format gives back: 8 bit channels are
+// clamped and rounded, missing channels are 0 (alpha 1).
+static Color Store(Color color, GLenum format) {
+    auto unorm = [](float v) { return std::round(std::min(std::max(v, 0.0f), 1.0f) * 255.0f) / 255.0f; };
+    switch (format) {
+        case GL_RGBA8: return {unorm(color.r), unorm(color.g), unorm(color.b), unorm(color.a)};
+        case GL_R8: return {unorm(color.r), 0.0f, 0.0f, 1.0f};
+        default: return color;
+    }
+}
+
+struct Frame {
+    GLuint Program;
+    GLuint VertexArray;
+    // The colors the CPU expects in every target, by target index.
+    std::vector<Color> Expected;
+    bool DebugRan = false;
+    // Time spent inside the passes' functions.
+    double PassTime = 0.0;
+};
+
+// The pass function for a mix of up to 3 inputs, which also works out the
+// expected color of its output.
+static std::function<void(const RenderPassContext&)> MixPass(Frame& frame, std::vector<RenderTarget> inputs,
+                                                             std::vector<float> weights, Color add,
+                                                             RenderTarget output, GLenum format) {
+    const Color* colors[3] = {};
+    float w[3] = {};
+    for (size_t i = 0; i < inputs.size(); i++) {
+        colors[i] = &frame.Expected[inputs[i].Index];
+        w[i] = weights[i];
+    }
+    frame.Expected[output.Index] = Store(Mix(colors, w, add), format);
+
+    return [&frame, inputs, w0 = w[0], w1 = w[1], w2 = w[2], add](const RenderPassContext& context) {
+        auto start = Clock::now();
+        GLCall(glUseProgram(frame.Program));
+        GLCall(glUniform3f(0, w0, w1, w2));
+        GLCall(glUniform4f(1, add.r, add.g, add.b, add.a));
+        for (GLuint unit = 0; unit < 3; unit++) {
+            GLCall(glBindTextureUnit(unit, unit < inputs.size() ? context.GetTexture(inputs[unit]) : 0));
+        }
+        GLCall(glBindVertexArray(frame.VertexArray));
+        GLCall(glDrawArrays(GL_TRIANGLES, 0, 3));
+        frame.PassTime += Milliseconds(start);
+    };
+}
+
+// Declares and runs one frame, width by height, into the backbuffer.
+static void RenderFrame(RenderGraph& graph, Frame& frame, GLuint backbufferFramebuffer, GLsizei width,
+                        GLsizei height) {
+    GLsizei halfWidth = width / 2, halfHeight = height / 2;
+    graph.Begin();
+    RenderTarget backbuffer = graph.ImportBackbuffer(backbufferFramebuffer, width, height);
+    RenderTarget shadow = graph.Create("shadow map", {1024, 1024, GL_DEPTH_COMPONENT32F});
+    RenderTarget albedo = graph.Create("albedo", {width, height, GL_RGBA8});
+    RenderTarget normal = graph.Create("normal", {width, height, GL_RGBA16F});
+    RenderTarget depth = graph.Create("depth", {width, height, GL_DEPTH_COMPONENT24});
+    RenderTarget ao = graph.Create("ambient occlusion", {halfWidth, halfHeight, GL_R8});
+    RenderTarget hdr = graph.Create("hdr", {width, height, GL_RGBA16F});
+    RenderTarget debug = graph.Create("debug view", {width, height, GL_RGBA8});
+    RenderTarget bright = graph.Create("bloom bright", {halfWidth, halfHeight, GL_RGBA16F});
+    RenderTarget blurX = graph.Create("bloom blur x", {halfWidth, halfHeight, GL_RGBA16F});
+    RenderTarget blurY = graph.Create("bloom blur y", {halfWidth, halfHeight, GL_RGBA16F});
+    RenderTarget ldr = graph.Create("ldr", {width, height, GL_RGBA8});
+    frame.Expected.assign(ldr.Index + 1, {0.0f, 0.0f, 0.0f, 0.0f});
+    frame.DebugRan = false;
+
+    // Only cleared: depth 1, sampled as (1, 0, 0, 1).
+    frame.Expected[shadow.Index] = {1.0f, 0.0f, 0.0f, 1.0f};
+    graph.AddPass("shadows", [&](RenderPassBuilder& pass) { pass.Write(shadow, LoadOp::Clear); },
+                  [](const RenderPassContext&) {});
+
+    const float albedoColor[4] = {0.5f, 0.25f, 0.75f, 1.0f};
+    const float normalColor[4] = {0.1f, 0.2f, 0.3f, 0.4f};
+    frame.Expected[albedo.Index] = Store({albedoColor[0], albedoColor[1], albedoColor[2], albedoColor[3]}, GL_RGBA8);
+    frame.Expected[normal.Index] = {normalColor[0], normalColor[1], normalColor[2], normalColor[3]};
+    frame.Expected[depth.Index] = {1.0f, 0.0f, 0.0f, 1.0f};
+    graph.AddPass(
+        "g-buffer",
+        [&](RenderPassBuilder& pass) {
+            pass.Write(albedo, LoadOp::Clear, albedoColor);
+            pass.Write(normal, LoadOp::DontCare);
+            pass.Write(depth, LoadOp::Clear);
+        },
+        [normalColor](const RenderPassContext& context) {
+            // The "geometry" covers every pixel of the normals.
+            GLCall(glClearNamedFramebufferfv(context.GetFramebuffer(), GL_COLOR, 1, normalColor));
+        });
+
+    graph.AddPass(
+        "ambient occlusion",
+        [&](RenderPassBuilder& pass) {
+            pass.Read(normal);
+            pass.Read(depth);
+            pass.Write(ao, LoadOp::DontCare);
+        },
+        MixPass(frame, {normal, depth}, {1.0f, 0.5f}, {0.0f, 0.0f, 0.0f, 0.0f}, ao, GL_R8));
+
+    graph.AddPass(
+        "lighting",
+        [&](RenderPassBuilder& pass) {
+            pass.Read(albedo);
+            pass.Read(ao);
+            pass.Read(shadow);
+            pass.Write(hdr, LoadOp::DontCare);
+        },
+        MixPass(frame, {albedo, ao, shadow}, {1.0f, 0.5f, 0.25f}, {0.0f, 0.0f, 0.0f, 0.0f}, hdr, GL_RGBA16F));
+
+    graph.AddPass(
+        "debug view",
+        [&](RenderPassBuilder& pass) {
+            pass.Read(normal);
+            pass.Write(debug, LoadOp::DontCare);
+        },
+        [&frame](const RenderPassContext&) { frame.DebugRan = true; });
+
+    graph.AddPass(
+        "bloom bright",
+        [&](RenderPassBuilder& pass) {
+            pass.Read(hdr);
+            pass.Write(bright, LoadOp::DontCare);
+        },
+        MixPass(frame, {hdr}, {0.5f}, {-0.1f, -0.1f, -0.1f, 0.0f}, bright, GL_RGBA16F));
+    graph.AddPass(
+        "bloom blur x",
+        [&](RenderPassBuilder& pass) {
+            pass.Read(bright);
+            pass.Write(blurX, LoadOp::DontCare);
+        },
+        MixPass(frame, {bright}, {1.0f}, {0.05f, 0.0f, 0.0f, 0.0f}, blurX, GL_RGBA16F));
+    graph.AddPass(
+        "bloom blur y",
+        [&](RenderPassBuilder& pass) {
+            pass.Read(blurX);
+            pass.Write(blurY, LoadOp::DontCare);
+        },
+        MixPass(frame, {blurX}, {1.0f}, {0.0f, 0.05f, 0.0f, 0.0f}, blurY, GL_RGBA16F));
+
+    graph.AddPass(
+        "tone mapping",
+        [&](RenderPassBuilder& pass) {
+            pass.Read(hdr);
+            pass.Read(blurY);
+            pass.Write(ldr, LoadOp::DontCare);
+        },
+        MixPass(frame, {hdr, blurY}, {0.4f, 0.5f}, {0.0f, 0.0f, 0.0f, 0.0f}, ldr, GL_RGBA8));
+
+    graph.AddPass(
+        "present",
+        [&](RenderPassBuilder& pass) {
+            pass.Read(ldr);
+            pass.Write(backbuffer, LoadOp::DontCare);
+        },
+        MixPass(frame, {ldr}, {1.0f}, {0.0f, 0.0f, 0.0f, 0.0f}, backbuffer, GL_RGBA8));
+
+    graph.Execute();
+}
+
+// The center pixel of the backbuffer against what the CPU worked out.
+static bool CheckPixel(const Frame& frame, GLsizei width, GLsizei height) {
+    unsigned char pixel[4];
+    GLCall(glReadPixels(width / 2, height / 2, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel));
+    const Color& expected = frame.Expected[0];
+    float channels[4] = {expected.r, expected.g, expected.b, expected.a};
+    for (int i = 0; i < 4; i++) {
+        if (std::abs(pixel[i] - channels[i] * 255.0f) > 2.0f) {
+            std::cerr << "pixel " << (int)pixel[0] << " " << (int)pixel[1] << " " << (int)pixel[2] << " "
+                      << (int)pixel[3] << ", expected " << channels[0] * 255.0f << " " << channels[1] * 255.0f << " "
+                      << channels[2] * 255.0f << " " << channels[3] * 255.0f << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 100;
+    const GLsizei width = 640, height = 480;
+
+    HeadlessContext context(width, height);
+    if (!context.IsValid()) {
+        return 1;
+    }
+    std::cout << "renderer:  " << context.GetRenderer() << "\n";
+
+    bool valid = true;
+    {
+        ResourcePool resources;
+        RenderGraph graph(resources);
+        Frame frame;
+        frame.Program = CreateShader(MIX_VERTEX, MIX_FRAGMENT);
+        VertexArrayHandle vertexArray = resources.CreateVertexArray("fullscreen triangle");
+        frame.VertexArray = resources.Get(vertexArray);
+        if (!frame.Program) {
+            return 1;
+        }
+
+        RenderFrame(graph, frame, context.GetFramebuffer(), width, height);
+        valid = valid && CheckPixel(frame, width, height);
+        RenderGraphStats stats = graph.GetStats();
+        graph.Print(std::cout);
+        std::cout << "culling:   " << stats.CulledPasses << " of " << stats.Passes << " passes culled, debug view "
+                  << (frame.DebugRan ? "ran" : "didn't run") << "\n";
+        valid = valid && stats.CulledPasses == 1 && !frame.DebugRan;
+
+        size_t booked = GetGpuMemoryUsage(MemoryCategory::RenderTargets).Bytes;
+        std::cout << "memory:    " << stats.Transients << " transients, " << stats.TransientBytes / 1024
+                  << " KB without aliasing, " << stats.AliasedBytes / 1024 << " KB with ("
+                  << 100.0 * stats.AliasedBytes / stats.TransientBytes << "%), " << booked / 1024
+                  << " KB booked as render targets\n";
+        valid = valid && stats.AliasedBytes < stats.TransientBytes && booked == stats.AliasedBytes;
+
+        size_t texturesCreated = stats.TexturesCreated, framebuffersCreated = stats.FramebuffersCreated;
+        double frameTime = 0.0, graphTime = 0.0;
+        for (int i = 0; i < frames; i++) {
+            frame.PassTime = 0.0;
+            auto start = Clock::now();
+            RenderFrame(graph, frame, context.GetFramebuffer(), width, height);
+            graphTime += Milliseconds(start) - frame.PassTime;
+            glFinish();
+            frameTime += Milliseconds(start);
+            resources.EndFrame();
+        }
+        valid = valid && CheckPixel(frame, width, height);
+        stats = graph.GetStats();
+        std::cout << "frames:    " << frameTime / frames << " ms per frame, the graph " << graphTime / frames * 1000.0
+                  << " us of CPU outside the passes, " << stats.Clears << " clears and " << stats.Invalidations
+                  << " invalidations per frame\n";
+        valid = valid && stats.TexturesCreated == texturesCreated && stats.FramebuffersCreated == framebuffersCreated;
+
+        // Half the size: new textures, and after a few frames the old ones go.
+        for (int i = 0; i < 16; i++) {
+            RenderFrame(graph, frame, context.GetFramebuffer(), width / 2, height / 2);
+            resources.EndFrame();
+        }
+        valid = valid && CheckPixel(frame, width / 2, height / 2);
+        stats = graph.GetStats();
+        booked = GetGpuMemoryUsage(MemoryCategory::RenderTargets).Bytes;
+        std::cout << "resize:    " << stats.AliasedBytes / 1024 << " KB at " << width / 2 << "x" << height / 2 << ", "
+                  << booked / 1024 << " KB booked, peak " << stats.PeakAliasedBytes / 1024 << " KB\n";
+        valid = valid && booked == stats.AliasedBytes;
+
+        resources.Destroy(vertexArray);
+        glDeleteProgram(frame.Program);
+    }
+
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << "\n";
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+/*
+    Checks and times ResourcePool.
+
+    - lookup:   Get() on random handles out of a full pool, in ns per call.
+    - stale:    half of the buffers are destroyed and their slots reused by
+                new ones; every old handle must now give 0, every new one
+                its own buffer.
+    - deferred: the destroyed buffers are deleted only after their frame's
+                fence, in one glDeleteBuffers call per frame.
+    - leaks:    a second pool is dropped with a buffer and a texture alive and
+                must list both of them.
+
+    Usage: resource_bench [buffers]
+*/
+
+#include "HeadlessContext.h"
+
+#include "../src/Renderer.h"
+#include "../src/ResourcePool.h"
+#include "../src/Timing.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    const int count = argc > 1 ? std::atoi(argv[1]) : 10000;
+    const int lookups = 10000000;
+
+    HeadlessContext context(64, 64);
+    if (!context.IsValid()) {
+        return 1;
+    }
+    std::cout << "renderer:  " << context.GetRenderer() << "\n";
+
+    bool valid = true;
+    {
+        ResourcePool resources;
+        std::vector<BufferHandle> buffers;
+        auto start = Clock::now();
+        for (int i = 0; i < count; i++) {
+            buffers.push_back(resources.CreateBuffer("buffer " + std::to_string(i), 256, nullptr, 0));
+        }
+        std::cout << "create:    " << Milliseconds(start) * 1e6 / count << " ns per buffer\n";
+
+        std::mt19937 random(1);
+        std::vector<BufferHandle> order(lookups / 100);
+        for (BufferHandle& handle : order) {
+            handle = buffers[random() % buffers.size()];
+        }
+        GLuint sum = 0;
+        start = Clock::now();
+        for (int round = 0; round < 100; round++) {
+            for (BufferHandle handle : order) {
+                sum += resources.Get(handle);
+            }
+        }
+        std::cout << "lookup:    " << Milliseconds(start) * 1e6 / lookups << " ns (checksum " << sum << ")\n";
+
+        // Every other buffer goes, then as many new ones take their slots.
+        std::vector<BufferHandle> destroyed;
+        for (int i = 0; i < count; i += 2) {
+            destroyed.push_back(buffers[i]);
+            resources.Destroy(buffers[i]);
+        }
+        std::vector<BufferHandle> reused;
+        for (size_t i = 0; i < destroyed.size(); i++) {
+            reused.push_back(resources.CreateBuffer("reused " + std::to_string(i), 64, nullptr, 0));
+        }
+        size_t staleHits = 0;
+        for (BufferHandle handle : destroyed) {
+            staleHits += resources.Get(handle) != 0;
+        }
+        for (size_t i = 0; i < reused.size(); i++) {
+            valid = valid && resources.GetInfo(reused[i])->Size == 64;
+        }
+        std::cout << "stale:     " << staleHits << " of " << destroyed.size() << " old handles still resolve, "
+                  << resources.GetStats().Live[(int)ResourceKind::Buffer] << " buffers alive\n";
+        valid = valid && staleHits == 0 && resources.GetStats().Live[(int)ResourceKind::Buffer] == (size_t)count;
+
+        // The first EndFrame only fences; after the GPU is done, the next
+        // one deletes the lot.
+        resources.EndFrame();
+        size_t pending = resources.GetStats().Pending;
+        GLCall(glFinish());
+        resources.EndFrame();
+        const ResourceStats& stats = resources.GetStats();
+        std::cout << "deferred:  " << pending << " pending after the frame, " << stats.Deleted << " deleted in "
+                  << stats.DeleteCalls << " call(s) after its fence\n";
+        valid = valid && pending == destroyed.size() && stats.Pending == 0 && stats.Deleted == destroyed.size() &&
+                stats.DeleteCalls == 1;
+
+        for (BufferHandle& handle : buffers) {
+            resources.Destroy(handle);
+        }
+        for (BufferHandle& handle : reused) {
+            resources.Destroy(handle);
+        }
+        valid = valid && resources.GetStats().Live[(int)ResourceKind::Buffer] == 0;
+    }
+
+    {
+        ResourcePool leaky;
+        leaky.CreateBuffer("forgotten vertices", 1024, nullptr, 0);
+        leaky.CreateTexture("forgotten texture", GL_TEXTURE_2D);
+        std::ostringstream report;
+        leaky.PrintLive(report);
+        std::string text = report.str();
+        valid = valid && text.find("forgotten vertices") != std::string::npos &&
+                text.find("forgotten texture") != std::string::npos;
+        std::cout << "leaks (two expected):" << std::endl;
+    }
+
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << "\n";
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+/*
+    Cold start from GLSL against cold start from SPIR-V (LoadProgram in
+    Shader.h).
+
+    Every program in res/shaders, with the particle passes as separate
+    programs, is built both ways with the program cache off:
+    - glsl:   ParseShaders, the PASS #define, compile and link, reflection
+              queries.
+    - spirv:  the .spv files from "make spirv", glShaderBinary,
+              glSpecializeShader with PASS, link, reflection from the module.
+
+    Every round changes the inputs a little (a comment in the GLSL, an
+    OpSourceExtension in the SPIR-V), so the driver's own shader cache
+    hasn't seen them and both numbers are really cold. The SPIR-V programs
+    must have the same interface as their GLSL twins: inputs, uniforms and
+    their locations, blocks and their bindings.
+
+    Without the .spv files or GL_ARB_gl_spirv only the GLSL is timed.
+
+    Usage: spirv_bench [rounds]
+*/
+
+#include "HeadlessContext.h"
+
+#include "../src/Shader.h"
+#include "../src/Timing.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct Program {
+    std::string Name;
+    ShaderProgramSource Source;
+    std::vector<ShaderConstant> Constants;
+    // Empty if there are no .spv files for it.
+    std::vector<SpirvModule> Modules;
+};
+
+// The opcodes that come before the debug section of a module, where an
+// OpSourceExtension may go.
+static bool IsPreamble(uint32_t opcode) {
+    // OpExtension, OpExtInstImport, OpMemoryModel, OpEntryPoint,
+    // OpExecutionMode, OpCapability, OpExecutionModeId
+    return opcode == 10 || opcode == 11 || opcode == 14 || opcode == 15 || opcode == 16 || opcode == 17 ||
+           opcode == 331;
+}
+
+// Same module, different words: an OpSourceExtension naming the round.
+static SpirvModule MarkModule(const SpirvModule& module, int round) {
+    std::string text = "spirv_bench round " + std::to_string(round);
+    std::vector<uint32_t> literal((text.size() + 4) / 4, 0);
+    for (size_t i = 0; i < text.size(); i++) {
+        literal[i / 4] |= (uint32_t)(unsigned char)text[i] << (i % 4 * 8);
+    }
+
+    SpirvModule marked = module;
+    size_t position = 5;
+    while (position < marked.Words.size() && IsPreamble(marked.Words[position] & 0xFFFF)) {
+        position += marked.Words[position] >> 16;
+    }
+    std::vector<uint32_t> instruction = {(uint32_t)(literal.size() + 1) << 16 | 4};
+    instruction.insert(instruction.end(), literal.begin(), literal.end());
+    marked.Words.insert(marked.Words.begin() + position, instruction.begin(), instruction.end());
+    return marked;
+}
+
+static bool SameVariables(const std::vector<ShaderVariable>& glsl, const std::vector<ShaderVariable>& spirv) {
+    for (const ShaderVariable& variable : glsl) {
+        if (variable.BlockIndex != -1) {
+            continue;
+        }
+        bool found = false;
+        for (const ShaderVariable& other : spirv) {
+            found = found || (other.Name == variable.Name && other.Type == variable.Type &&
+                              other.Location == variable.Location);
+        }
+        if (!found) {
+            std::cerr << variable.Name << " differs" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool SameBlocks(const std::vector<ShaderBlock>& glsl, const std::vector<ShaderBlock>& spirv) {
+    for (const ShaderBlock& block : glsl) {
+        bool found = false;
+        for (const ShaderBlock& other : spirv) {
+            found = found || (other.Name == block.Name && other.Binding == block.Binding);
+        }
+        if (!found) {
+            std::cerr << block.Name << " differs" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool SameInterface(const ProgramReflection& glsl, const ProgramReflection& spirv) {
+    return SameVariables(glsl.Inputs, spirv.Inputs) && SameVariables(glsl.Uniforms, spirv.Uniforms) &&
+           SameBlocks(glsl.UniformBlocks, spirv.UniformBlocks) && SameBlocks(glsl.StorageBlocks, spirv.StorageBlocks);
+}
+
+int main(int argc, char* argv[]) {
+    const int rounds = argc > 1 ? std::atoi(argv[1]) : 5;
+
+    HeadlessContext context(64, 64);
+    if (!context.IsValid()) {
+        return 1;
+    }
+    std::cout << "renderer:  " << context.GetRenderer() << "\n";
+
+    std::vector<Program> programs;
+    for (const char* name : {"Basic", "Textured", "Pulled", "Particles", "Present", "Immediate"}) {
+        std::string path = std::string("res/shaders/") + name + ".shader";
+        programs.push_back({path, ParseShaders(path), {}, {}});
+    }
+    for (GLuint pass = 0; pass < 5; pass++) {
+        std::string path = "res/shaders/ParticleUpdate.shader";
+        Program program = {path + " (PASS " + std::to_string(pass) + ")", ParseShaders(path), {{"PASS", 0, pass}}, {}};
+        program.Source.ComputeSource = AddDefine(program.Source.ComputeSource, "PASS " + std::to_string(pass) + "u");
+        programs.push_back(program);
+    }
+
+    size_t withModules = 0;
+    for (Program& program : programs) {
+        std::string path = program.Name.substr(0, program.Name.find(" ("));
+        if (GLEW_ARB_gl_spirv && LoadSpirvModules(path, program.Modules)) {
+            withModules++;
+        }
+    }
+
+    SetProgramCacheDirectory("");
+    bool valid = true;
+    double glslTime = 0.0, glslSubset = 0.0, spirvTime = 0.0;
+    for (int round = 0; round < rounds; round++) {
+        std::string comment = "\n// round " + std::to_string(round) + " of spirv_bench\n";
+        std::vector<ProgramReflection> glslReflections(programs.size());
+        for (size_t i = 0; i < programs.size(); i++) {
+            ShaderProgramSource source = programs[i].Source;
+            for (std::string* part : {&source.VertexSource, &source.FragmentSource, &source.ComputeSource}) {
+                if (!part->empty()) {
+                    *part += comment;
+                }
+            }
+
+            auto start = Clock::now();
+            GLuint id = BuildProgram(source, programs[i].Name, glslReflections[i]);
+            glFinish();
+            double time = Milliseconds(start);
+            glslTime += time;
+            if (!programs[i].Modules.empty()) {
+                glslSubset += time;
+            }
+            valid = valid && id != 0;
+            glDeleteProgram(id);
+        }
+
+        for (size_t i = 0; i < programs.size(); i++) {
+            if (programs[i].Modules.empty()) {
+                continue;
+            }
+            std::vector<SpirvModule> modules;
+            for (const SpirvModule& module : programs[i].Modules) {
+                modules.push_back(MarkModule(module, round));
+            }
+
+            auto start = Clock::now();
+            ProgramReflection reflection;
+            GLuint id = BuildSpirvProgram(modules, programs[i].Constants, programs[i].Name, reflection);
+            glFinish();
+            spirvTime += Milliseconds(start);
+            valid = valid && id != 0 && SameInterface(glslReflections[i], reflection);
+            glDeleteProgram(id);
+        }
+    }
+
+    std::cout << "programs:  " << programs.size() << ", " << withModules << " with SPIR-V\n";
+    std::cout << "glsl:      " << glslTime / rounds << " ms\n";
+    if (withModules > 0) {
+        std::cout << "spirv:     " << spirvTime / rounds << " ms, against " << glslSubset / rounds
+                  << " ms for the same programs from GLSL (" << glslSubset / spirvTime << "x)\n";
+    }
+    else if (!GLEW_ARB_gl_spirv) {
+        std::cout << "spirv:     no GL_ARB_gl_spirv, GLSL only\n";
+    }
+    else {
+        std::cout << "spirv:     no .spv files (make spirv), GLSL only\n";
+    }
+    std::cout << "valid:     " << (valid ? "yes" : "NO") << "\n";
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+#shader vertex
+#version 450 core
+
+layout (location = 0) in vec4 position;
+
+layout (location = 0) uniform mat4 u_MVP;
+
+void main() {
+    gl_Position = u_MVP * position;
+}
+
+#shader fragment
+#version 450 core
+
+layout (location = 0) out vec4 color;
+
+layout (location = 1) uniform vec4 u_Color;
+
+void main() {
+    color = u_Color;
+}
@@ -0,0 +1,29 @@
+#shader vertex
+#version 450 core
+
+// ImmediateVertex in ImmediateMode.h: 3 floats, then 4 normalized bytes.
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec4 vertexColor;
+
+layout (location = 0) uniform mat4 u_ViewProjection;
+// In pixels; only points use it.
+layout (location = 1) uniform float u_PointSize;
+
+layout (location = 0) out vec4 v_Color;
+
+void main() {
+    gl_Position = u_ViewProjection * vec4(position, 1.0);
+    gl_PointSize = u_PointSize;
+    v_Color = vertexColor;
+}
+
+#shader fragment
+#version 450 core
+
+layout (location = 0) in vec4 v_Color;
+
+layout (location = 0) out vec4 color;
+
+void main() {
+    color = v_Color;
+}
@@ -0,0 +1,164 @@
+#shader compute
+#version 450 core
+
+// Every pass of the particle system (see Particles.h) is in this file.
+// ParticleSystem builds it once per pass, with PASS set to one of the
+// numbers below (the same as ParticleSystem::Pass). From SPIR-V it is a
+// specialization constant, from GLSL a #define; either way the switch at
+// the end is decided when the program is built, not per thread.
+#ifdef GL_SPIRV
+layout (constant_id = 0) const uint PASS = 0u;
+#endif
+
+const uint EMIT = 0u;
+const uint PREPARE = 1u;
+const uint SIMULATE = 2u;
+const uint COMPACT = 3u;
+const uint FINISH = 4u;
+
+layout (local_size_x = 64) in;
+
+struct Particle {
+    // xyz, seconds left to live
+    vec4 PositionLife;
+    // xyz, seconds it lived in total
+    vec4 VelocityLifetime;
+};
+
+layout (std430, binding = 0) buffer Source {
+    Particle source[];
+};
+
+layout (std430, binding = 1) buffer Destination {
+    Particle destination[];
+};
+
+// Count[u_Source] belongs to the source buffer, the other one to the destination.
+layout (std430, binding = 2) buffer State {
+    uint Count[2];
+    uint DispatchX, DispatchY, DispatchZ;
+    uint Padding;
+    uint DrawCount, DrawInstanceCount, DrawFirst, DrawBaseInstance;
+};
+
+layout (std140, binding = 1) uniform Parameters {
+    vec3 u_EmitterPosition;
+    float u_Spread;
+    vec3 u_EmitterVelocity;
+    float u_DeltaTime;
+    vec3 u_Gravity;
+    uint u_Source;
+    vec2 u_Lifetime;
+    uint u_EmitCount;
+    uint u_Seed;
+    uint u_Capacity;
+};
+
+// PCG hash: a cheap random number for every particle and frame.
+uint Hash(uint x) {
+    uint state = x * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float Random(inout uint seed) {
+    seed = Hash(seed);
+    return float(seed) / 4294967295.0;
+}
+
+void Emit() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= u_EmitCount) {
+        return;
+    }
+
+    // When the buffer is full the particle is dropped; PREPARE fixes the count.
+    uint slot = atomicAdd(Count[u_Source], 1u);
+    if (slot >= u_Capacity) {
+        return;
+    }
+
+    uint seed = Hash(i ^ Hash(u_Seed));
+    vec3 direction = vec3(Random(seed), Random(seed), Random(seed)) * 2.0 - 1.0;
+    float lifetime = mix(u_Lifetime.x, u_Lifetime.y, Random(seed));
+    source[slot].PositionLife = vec4(u_EmitterPosition, lifetime);
+    source[slot].VelocityLifetime = vec4(u_EmitterVelocity + direction * u_Spread, lifetime);
+}
+
+// A single thread. SIMULATE and COMPACT get one group per 64 particles.
+void Prepare() {
+    uint count = min(Count[u_Source], u_Capacity);
+    Count[u_Source] = count;
+    Count[1u - u_Source] = 0u;
+    DispatchX = (count + 63u) / 64u;
+    DispatchY = 1u;
+    DispatchZ = 1u;
+}
+
+void Simulate() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= Count[u_Source]) {
+        return;
+    }
+
+    Particle particle = source[i];
+    vec3 velocity = particle.VelocityLifetime.xyz + u_Gravity * u_DeltaTime;
+    vec3 position = particle.PositionLife.xyz + velocity * u_DeltaTime;
+
+    // Bounce off the ground, losing half of the speed.
+    if (position.y < 0.0) {
+        position.y = -position.y;
+        velocity.y = -velocity.y * 0.5;
+    }
+
+    source[i].PositionLife = vec4(position, particle.PositionLife.w - u_DeltaTime);
+    source[i].VelocityLifetime.xyz = velocity;
+}
+
+// The living particles are appended to the destination, in no particular
+// order. The group counts its survivors in shared memory first, so there is
+// one atomicAdd on the buffer per group instead of one per particle.
+shared uint groupCount;
+shared uint groupStart;
+
+void Compact() {
+    if (gl_LocalInvocationIndex == 0u) {
+        groupCount = 0u;
+    }
+    barrier();
+
+    uint i = gl_GlobalInvocationID.x;
+    bool alive = i < Count[u_Source] && source[i].PositionLife.w > 0.0;
+    uint slot = 0u;
+    if (alive) {
+        slot = atomicAdd(groupCount, 1u);
+    }
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0u) {
+        groupStart = atomicAdd(Count[1u - u_Source], groupCount);
+    }
+    barrier();
+
+    if (alive) {
+        destination[groupStart + slot] = source[i];
+    }
+}
+
+// A single thread. One point per survivor.
+void Finish() {
+    DrawCount = Count[1u - u_Source];
+    DrawInstanceCount = 1u;
+    DrawFirst = 0u;
+    DrawBaseInstance = 0u;
+}
+
+void main() {
+    switch (PASS) {
+        case EMIT: Emit(); break;
+        case PREPARE: Prepare(); break;
+        case SIMULATE: Simulate(); break;
+        case COMPACT: Compact(); break;
+        case FINISH: Finish(); break;
+    }
+}
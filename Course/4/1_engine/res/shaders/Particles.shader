@@ -0,0 +1,39 @@
+#shader vertex
+#version 450 core
+
+// Same as in ParticleUpdate.shader.
+struct Particle {
+    vec4 PositionLife;
+    vec4 VelocityLifetime;
+};
+
+layout (std430, binding = 0) readonly buffer Particles {
+    Particle particles[];
+};
+
+layout (location = 0) uniform mat4 u_ViewProjection;
+// Size in pixels at a distance of 1.
+layout (location = 1) uniform float u_PointSize;
+
+layout (location = 0) out vec4 v_Color;
+
+void main() {
+    Particle particle = particles[gl_VertexID];
+    gl_Position = u_ViewProjection * vec4(particle.PositionLife.xyz, 1.0);
+    gl_PointSize = max(u_PointSize / gl_Position.w, 1.0);
+
+    // Yellow when new, red when about to die.
+    float age = 1.0 - particle.PositionLife.w / particle.VelocityLifetime.w;
+    v_Color = mix(vec4(1.0, 0.9, 0.4, 1.0), vec4(0.9, 0.2, 0.1, 1.0), age);
+}
+
+#shader fragment
+#version 450 core
+
+layout (location = 0) in vec4 v_Color;
+
+layout (location = 0) out vec4 color;
+
+void main() {
+    color = v_Color;
+}
@@ -0,0 +1,23 @@
+#shader vertex
+#version 450 core
+
+// One triangle that covers the whole screen, made from gl_VertexID alone:
+// no vertex buffer needed, only an empty vertex array.
+layout (location = 0) out vec2 v_TexCoord;
+
+void main() {
+    v_TexCoord = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(v_TexCoord * 2.0 - 1.0, 0.0, 1.0);
+}
+
+#shader fragment
+#version 450 core
+
+layout (location = 0) in vec2 v_TexCoord;
+layout (location = 0) out vec4 color;
+
+layout (location = 0, binding = 0) uniform sampler2D u_Scene;
+
+void main() {
+    color = texture(u_Scene, v_TexCoord);
+}
@@ -0,0 +1,39 @@
+#shader vertex
+#version 450 core
+
+// Read from the mesh's buffers by PullVertex(), see VertexPulling.h.
+#pull (location = 0) vec3 position
+
+// Every object is one instance, so a single draw covers all the spheres
+// that use the same level of detail.
+struct Instance {
+    mat4 MVP;
+    vec4 Color;
+};
+
+layout (std430, binding = 2) readonly buffer Instances {
+    Instance instances[];
+};
+
+// Where the instances of this draw start in the buffer.
+layout (location = 0) uniform uint u_FirstInstance;
+
+layout (location = 0) flat out vec4 v_Color;
+
+void main() {
+    PullVertex();
+    Instance instance = instances[u_FirstInstance + uint(gl_InstanceID)];
+    gl_Position = instance.MVP * vec4(position, 1.0);
+    v_Color = instance.Color;
+}
+
+#shader fragment
+#version 450 core
+
+layout (location = 0) flat in vec4 v_Color;
+
+layout (location = 0) out vec4 color;
+
+void main() {
+    color = v_Color;
+}
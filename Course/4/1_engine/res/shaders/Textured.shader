@@ -0,0 +1,29 @@
+#shader vertex
+#version 450 core
+
+layout (location = 0) in vec4 position;
+
+layout (location = 0) uniform mat4 u_MVP;
+
+// Our cube goes from 0 to 1 on every axis, so its x and y double as
+// texture coordinates for the front face.
+layout (location = 0) out vec2 v_TexCoord;
+
+void main() {
+    gl_Position = u_MVP * position;
+    v_TexCoord = position.xy;
+}
+
+#shader fragment
+#version 450 core
+
+layout (location = 0) in vec2 v_TexCoord;
+
+layout (location = 0) out vec4 color;
+
+layout (location = 1) uniform vec4 u_Color;
+layout (location = 2, binding = 0) uniform sampler2D u_Texture;
+
+void main() {
+    color = texture(u_Texture, v_TexCoord) * u_Color;
+}
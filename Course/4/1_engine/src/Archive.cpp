@@ -0,0 +1,199 @@
+#include "Archive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "LZ4.h"
+
+static const uint32_t ARCHIVE_VERSION = 1;
+static const uint32_t ENTRY_COMPRESSED = 1;
+static const uint64_t DATA_ALIGNMENT = 4096;
+
+struct ArchiveHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t EntryCount;
+    uint32_t NamesSize;
+    uint64_t NamesOffset;
+    uint64_t Reserved;
+};
+
+// The header and the entries are used straight from the mapping, so their
+// layout must be exactly the one in the file.
+static_assert(sizeof(ArchiveHeader) == 32, "ArchiveHeader must match the file layout");
+static_assert(sizeof(ArchiveEntry) == 48, "ArchiveEntry must match the file layout");
+
+std::string NormalizeAssetPath(const std::string& path) {
+    std::string result = path;
+    std::replace(result.begin(), result.end(), '\\', '/');
+    while (result.compare(0, 2, "./") == 0) {
+        result.erase(0, 2);
+    }
+    return result;
+}
+
+uint64_t HashAssetPath(const std::string& path) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : path) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool Archive::Open(const std::string& filepath) {
+    Close();
+    if (!m_File.Open(filepath)) {
+        return false;
+    }
+
+    const unsigned char* data = m_File.GetData();
+    size_t size = m_File.GetSize();
+    const ArchiveHeader* header = (const ArchiveHeader*)data;
+    if (size < sizeof(ArchiveHeader) || std::memcmp(header->Magic, "GLPK", 4) != 0 ||
+        header->Version != ARCHIVE_VERSION ||
+        sizeof(ArchiveHeader) + (size_t)header->EntryCount * sizeof(ArchiveEntry) > size ||
+        header->NamesOffset + header->NamesSize > size) {
+        Close();
+        return false;
+    }
+
+    // Find and Read trust the entries from here on: every name must be in
+    // the names block, every stored entry as large as the data it gives.
+    const ArchiveEntry* entries = (const ArchiveEntry*)(data + sizeof(ArchiveHeader));
+    for (uint32_t i = 0; i < header->EntryCount; i++) {
+        const ArchiveEntry& entry = entries[i];
+        if ((uint64_t)entry.NameOffset + entry.NameLength > header->NamesSize ||
+            (!(entry.Flags & ENTRY_COMPRESSED) && entry.Size != entry.StoredSize)) {
+            Close();
+            return false;
+        }
+    }
+
+    m_Entries = entries;
+    m_EntryCount = header->EntryCount;
+    m_Names = (const char*)(data + header->NamesOffset);
+    return true;
+}
+
+void Archive::Close() {
+    m_File.Close();
+    m_Entries = nullptr;
+    m_EntryCount = 0;
+    m_Names = nullptr;
+}
+
+const ArchiveEntry* Archive::Find(const std::string& path) const {
+    if (!m_Entries) {
+        return nullptr;
+    }
+
+    std::string name = NormalizeAssetPath(path);
+    uint64_t hash = HashAssetPath(name);
+
+    const ArchiveEntry* end = m_Entries + m_EntryCount;
+    const ArchiveEntry* entry = std::lower_bound(m_Entries, end, hash,
+        [](const ArchiveEntry& e, uint64_t h) { return e.Hash < h; });
+
+    // Different paths may (very rarely) have the same hash, so check the names too.
+    for (; entry != end && entry->Hash == hash; entry++) {
+        if (entry->NameLength == name.size() && std::memcmp(m_Names + entry->NameOffset, name.data(), name.size()) == 0) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+bool Archive::Read(const std::string& path, std::vector<unsigned char>& data) const {
+    const ArchiveEntry* entry = Find(path);
+    if (!entry || entry->DataOffset + entry->StoredSize > m_File.GetSize()) {
+        return false;
+    }
+
+    const unsigned char* stored = m_File.GetData() + entry->DataOffset;
+    data.resize(entry->Size);
+    if (entry->Flags & ENTRY_COMPRESSED) {
+        return LZ4Decompress(stored, entry->StoredSize, data.data(), data.size());
+    }
+    std::memcpy(data.data(), stored, entry->Size);
+    return true;
+}
+
+bool Archive::Map(const std::string& path, const unsigned char*& data, size_t& size) const {
+    const ArchiveEntry* entry = Find(path);
+    if (!entry || (entry->Flags & ENTRY_COMPRESSED) || entry->DataOffset + entry->Size > m_File.GetSize()) {
+        return false;
+    }
+
+    data = m_File.GetData() + entry->DataOffset;
+    size = entry->Size;
+    return true;
+}
+
+bool WriteArchive(const std::string& filepath, std::vector<ArchiveInput>& files) {
+    for (ArchiveInput& file : files) {
+        file.Path = NormalizeAssetPath(file.Path);
+    }
+    std::sort(files.begin(), files.end(), [](const ArchiveInput& a, const ArchiveInput& b) {
+        return HashAssetPath(a.Path) < HashAssetPath(b.Path);
+    });
+
+    std::vector<ArchiveEntry> entries(files.size());
+    std::string names;
+    for (size_t i = 0; i < files.size(); i++) {
+        entries[i].Hash = HashAssetPath(files[i].Path);
+        entries[i].NameOffset = (uint32_t)names.size();
+        entries[i].NameLength = (uint32_t)files[i].Path.size();
+        entries[i].Size = files[i].Data.size();
+        entries[i].Flags = 0;
+        entries[i].Reserved = 0;
+        names += files[i].Path;
+    }
+
+    ArchiveHeader header;
+    std::memcpy(header.Magic, "GLPK", 4);
+    header.Version = ARCHIVE_VERSION;
+    header.EntryCount = (uint32_t)entries.size();
+    header.NamesSize = (uint32_t)names.size();
+    header.NamesOffset = sizeof(ArchiveHeader) + entries.size() * sizeof(ArchiveEntry);
+    header.Reserved = 0;
+
+    // Compress what is worth compressing (at least 1/8 smaller), store the rest.
+    std::vector<std::vector<unsigned char>> stored(files.size());
+    uint64_t offset = header.NamesOffset + names.size();
+    for (size_t i = 0; i < files.size(); i++) {
+        const std::vector<unsigned char>& data = files[i].Data;
+        if (files[i].Compress && !data.empty()) {
+            stored[i].resize(LZ4CompressBound(data.size()));
+            stored[i].resize(LZ4Compress(data.data(), data.size(), stored[i].data()));
+            if (stored[i].size() > data.size() - data.size() / 8) {
+                stored[i].clear();
+            }
+            else {
+                entries[i].Flags |= ENTRY_COMPRESSED;
+            }
+        }
+        entries[i].StoredSize = (entries[i].Flags & ENTRY_COMPRESSED) ? stored[i].size() : data.size();
+
+        offset = (offset + DATA_ALIGNMENT - 1) & ~(DATA_ALIGNMENT - 1);
+        entries[i].DataOffset = offset;
+        offset += entries[i].StoredSize;
+    }
+
+    std::ofstream output(filepath, std::ios::binary);
+    output.write((const char*)&header, sizeof(header));
+    output.write((const char*)entries.data(), entries.size() * sizeof(ArchiveEntry));
+    output.write(names.data(), names.size());
+
+    static const char padding[DATA_ALIGNMENT] = {};
+    uint64_t position = header.NamesOffset + names.size();
+    for (size_t i = 0; i < files.size(); i++) {
+        output.write(padding, entries[i].DataOffset - position);
+        const std::vector<unsigned char>& data = (entries[i].Flags & ENTRY_COMPRESSED) ? stored[i] : files[i].Data;
+        output.write((const char*)data.data(), data.size());
+        position = entries[i].DataOffset + data.size();
+    }
+
+    return (bool)output;
+}
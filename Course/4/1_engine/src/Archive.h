@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+/*
+        PACKED ASSET ARCHIVE
+    Opening a file costs a few system calls (open, fstat, read, close) and, on
+    a cold start, a disk seek. With thousands of small assets that adds up to
+    most of the startup time. Instead, we pack all of res/ into one file and
+    map it once.
+
+    Layout (all numbers little endian):
+        header      "GLPK", version, entry count, offset and size of the names
+        entries     sorted by the 64 bit hash of the path, so lookup is a binary search
+        names       every path, to make sure a hash match is really our file
+        data        every file starts on a 4 KiB boundary (a page), so stored files
+                    can be used straight from the mapping without any copying
+
+    Files can be stored as they are or LZ4 compressed, whichever the packer
+    decides is worth it.
+*/
+
+struct ArchiveEntry {
+    uint64_t Hash;
+    uint32_t NameOffset;
+    uint32_t NameLength;
+    uint64_t DataOffset;
+    uint64_t StoredSize;
+    uint64_t Size;
+    uint32_t Flags;
+    uint32_t Reserved;
+};
+
+// What the packer gets for every file.
+struct ArchiveInput {
+    std::string Path;
+    std::vector<unsigned char> Data;
+    bool Compress;
+};
+
+class Archive {
+public:
+    bool Open(const std::string& filepath);
+    void Close();
+    bool IsOpen() const { return m_File.IsOpen(); }
+
+    // Copies (and decompresses, if needed) the file into data.
+    bool Read(const std::string& path, std::vector<unsigned char>& data) const;
+
+    // Points straight into the mapping. Only works for files that are stored
+    // uncompressed; the pointer lives as long as the archive stays open.
+    bool Map(const std::string& path, const unsigned char*& data, size_t& size) const;
+
+    bool Contains(const std::string& path) const { return Find(path) != nullptr; }
+    size_t GetEntryCount() const { return m_EntryCount; }
+
+private:
+    const ArchiveEntry* Find(const std::string& path) const;
+
+    MappedFile m_File;
+    const ArchiveEntry* m_Entries = nullptr;
+    size_t m_EntryCount = 0;
+    const char* m_Names = nullptr;
+};
+
+// Paths are stored with forward slashes and without a leading "./".
+std::string NormalizeAssetPath(const std::string& path);
+
+uint64_t HashAssetPath(const std::string& path);
+
+// Builds an archive from the given files. Returns false if it can't be written.
+bool WriteArchive(const std::string& filepath, std::vector<ArchiveInput>& files);
@@ -0,0 +1,55 @@
+#include "Assets.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+#include "Archive.h"
+
+static Archive archive;
+static bool looseFileOverride = std::getenv("ENGINE_LOOSE_FILES") != nullptr;
+
+bool MountArchive(const std::string& filepath) {
+    return archive.Open(filepath);
+}
+
+void SetLooseFileOverride(bool enabled) {
+    looseFileOverride = enabled;
+}
+
+static bool LooseFileExists(const std::string& path) {
+    return (bool)std::ifstream(path);
+}
+
+bool IsLooseAsset(const std::string& path) {
+    if (!archive.IsOpen() || !archive.Contains(path)) {
+        return true;
+    }
+    return looseFileOverride && LooseFileExists(path);
+}
+
+bool ReadAsset(const std::string& path, std::vector<unsigned char>& data) {
+    if (!IsLooseAsset(path)) {
+        return archive.Read(path, data);
+    }
+
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    return true;
+}
+
+bool ReadAsset(const std::string& path, std::string& text) {
+    std::vector<unsigned char> data;
+    if (!ReadAsset(path, data)) {
+        return false;
+    }
+    text.assign(data.begin(), data.end());
+    return true;
+}
+
+bool MapAsset(const std::string& path, const unsigned char*& data, size_t& size) {
+    return !IsLooseAsset(path) && archive.Map(path, data, size);
+}
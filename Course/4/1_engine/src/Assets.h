@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+    One place to load asset files from, so loaders don't care where the bytes
+    come from. Paths are the same relative paths as before ("res/shaders/Basic.shader").
+
+    - With an archive mounted (MountArchive("res.pak")), files come from it.
+    - Files that aren't in the archive, or every file when nothing is mounted,
+      are read from disk as before.
+    - With the loose file override on, a file that exists on disk wins over the
+      archive. That's for development: edit a shader and rerun, no repacking.
+      The ENGINE_LOOSE_FILES environment variable turns it on too.
+
+    Mount once at startup, before any worker thread loads assets; after that,
+    reading is thread safe.
+*/
+
+bool MountArchive(const std::string& filepath);
+
+void SetLooseFileOverride(bool enabled);
+
+bool ReadAsset(const std::string& path, std::vector<unsigned char>& data);
+
+bool ReadAsset(const std::string& path, std::string& text);
+
+// Zero copy access for assets stored uncompressed in the mounted archive.
+// Returns false for loose files and compressed entries; use ReadAsset then.
+bool MapAsset(const std::string& path, const unsigned char*& data, size_t& size);
+
+// True if the asset would be read from disk rather than from the archive.
+bool IsLooseAsset(const std::string& path);
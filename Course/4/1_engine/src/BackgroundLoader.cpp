@@ -0,0 +1,308 @@
+#include "BackgroundLoader.h"
+#include "Assets.h"
+#include "Image.h"
+#include "Renderer.h"
+#include "Shader.h"
+#include "Timing.h"
+
+#include <algorithm>
+#include <chrono>
+
+BackgroundLoader::BackgroundLoader(const SharedContext& context) : m_Synchronous(!context.MakeCurrent) {
+    if (!m_Synchronous) {
+        m_Loader = std::thread(&BackgroundLoader::LoaderThread, this, context);
+    }
+}
+
+BackgroundLoader::~BackgroundLoader() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+        m_Requests.clear();
+    }
+    m_Abandon = true;
+    m_Wake.notify_one();
+    if (m_Loader.joinable()) {
+        m_Loader.join();
+    }
+
+    // What is still on its way was never handed out.
+    for (size_t head = m_Head; head != m_Tail; head++) {
+        m_Waiting.push_back(std::move(m_Ring[head % QueueSize]));
+    }
+    for (Result& result : m_Waiting) {
+        if (result.Fence) {
+            GLCall(glDeleteSync(result.Fence));
+        }
+        DeleteObject(result.Kind, result.Object);
+    }
+    for (Entry& entry : m_Objects) {
+        DeleteObject(entry.Kind, entry.Object);
+        ReleaseGpuMemory(entry.MemoryId);
+    }
+}
+
+void BackgroundLoader::DeleteObject(LoadKind kind, GLuint object) {
+    if (!object) {
+        return;
+    }
+    switch (kind) {
+    case LoadKind::Buffer:
+        GLCall(glDeleteBuffers(1, &object));
+        break;
+    case LoadKind::Texture:
+        GLCall(glDeleteTextures(1, &object));
+        break;
+    case LoadKind::Program:
+        GLCall(glDeleteProgram(object));
+        break;
+    }
+}
+
+uint32_t BackgroundLoader::Enqueue(Request request) {
+    request.Id = (uint32_t)m_Objects.size();
+    m_Objects.emplace_back();
+    m_Objects.back().Kind = request.Kind;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Requests.push_back(std::move(request));
+    }
+    m_Wake.notify_one();
+    return (uint32_t)m_Objects.size() - 1;
+}
+
+uint32_t BackgroundLoader::LoadBuffer(const std::string& name, std::vector<unsigned char> data, GLbitfield flags,
+                                      MemoryCategory category) {
+    return Enqueue({0, LoadKind::Buffer, name, std::move(data), flags, category});
+}
+
+uint32_t BackgroundLoader::LoadTexture(const std::string& filepath) {
+    return Enqueue({0, LoadKind::Texture, filepath, {}, 0, MemoryCategory::Textures});
+}
+
+uint32_t BackgroundLoader::LoadProgram(const std::string& filepath) {
+    return Enqueue({0, LoadKind::Program, filepath, {}, 0, MemoryCategory::Programs});
+}
+
+void BackgroundLoader::LoaderThread(SharedContext context) {
+    bool current = context.MakeCurrent();
+    for (;;) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Wake.wait(lock, [&] { return m_Stopping || !m_Requests.empty(); });
+            if (m_Stopping) {
+                break;
+            }
+            request = std::move(m_Requests.front());
+            m_Requests.pop_front();
+        }
+
+        // Without a context every request fails, but still comes back.
+        Result result;
+        result.Id = request.Id;
+        result.Kind = request.Kind;
+        result.Name = request.Name;
+        result.Category = request.Category;
+        if (current) {
+            Load(request, result);
+        }
+        Push(std::move(result));
+    }
+    if (current && context.Release) {
+        context.Release();
+    }
+}
+
+void BackgroundLoader::Load(Request& request, Result& result) {
+    Clock::time_point start = Clock::now();
+    switch (request.Kind) {
+    case LoadKind::Buffer: {
+        GLCall(glCreateBuffers(1, &result.Object));
+        GLCall(glNamedBufferStorage(result.Object, request.Data.size(), request.Data.data(), request.Flags));
+        result.Bytes = result.Uploaded = request.Data.size();
+        break;
+    }
+    case LoadKind::Texture: {
+        std::vector<unsigned char> file, pixels;
+        ImageInfo info;
+        if (!ReadAsset(request.Name, file) || !ReadImageInfo(file.data(), file.size(), info)) {
+            break;
+        }
+        pixels.resize((size_t)info.Width * info.Height * 4);
+        if (!DecodeImage(file.data(), file.size(), pixels.data())) {
+            break;
+        }
+        result.ReadMs = Milliseconds(start);
+        start = Clock::now();
+
+        int levels = 1;
+        while ((std::max(info.Width, info.Height) >> levels) > 0) {
+            levels++;
+        }
+        GLCall(glCreateTextures(GL_TEXTURE_2D, 1, &result.Object));
+        GLCall(glTextureStorage2D(result.Object, levels, GL_RGBA8, info.Width, info.Height));
+        GLCall(glTextureParameteri(result.Object, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+        GLCall(glTextureParameteri(result.Object, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+        GLCall(glTextureSubImage2D(result.Object, 0, 0, 0, info.Width, info.Height, GL_RGBA, GL_UNSIGNED_BYTE,
+                                   pixels.data()));
+        GLCall(glGenerateTextureMipmap(result.Object));
+        // The whole mip chain adds a third.
+        result.Uploaded = pixels.size();
+        result.Bytes = pixels.size() * 4 / 3;
+        break;
+    }
+    case LoadKind::Program: {
+        result.Object = ::LoadProgram(request.Name, result.Reflection);
+        // Not for SPIR-V programs, see IsSpirvProgram.
+        if (result.Object && !IsSpirvProgram(result.Object)) {
+            GLint binaryLength = 0;
+            GLCall(glGetProgramiv(result.Object, GL_PROGRAM_BINARY_LENGTH, &binaryLength));
+            result.Bytes = (size_t)binaryLength;
+        }
+        break;
+    }
+    }
+
+    if (result.Object) {
+        // Without the flush the fence may sit in this context's command
+        // queue, and the render thread would wait for it forever.
+        result.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        GLCall(glFlush());
+    }
+    result.LoaderMs = Milliseconds(start);
+}
+
+void BackgroundLoader::Push(Result&& result) {
+    size_t tail = m_Tail.load(std::memory_order_relaxed);
+    while (tail - m_Head.load(std::memory_order_acquire) == QueueSize) {
+        // Full: the render thread hasn't called Update() in a while.
+        if (m_Abandon) {
+            if (result.Fence) {
+                GLCall(glDeleteSync(result.Fence));
+            }
+            DeleteObject(result.Kind, result.Object);
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    m_Ring[tail % QueueSize] = std::move(result);
+    m_Tail.store(tail + 1, std::memory_order_release);
+}
+
+void BackgroundLoader::LoadQueued() {
+    std::deque<Request> requests;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        requests.swap(m_Requests);
+    }
+    for (Request& request : requests) {
+        Result result;
+        result.Id = request.Id;
+        result.Kind = request.Kind;
+        result.Name = request.Name;
+        result.Category = request.Category;
+        Load(request, result);
+        m_Waiting.push_back(std::move(result));
+    }
+}
+
+void BackgroundLoader::Publish() {
+    if (m_Synchronous) {
+        LoadQueued();
+    }
+    size_t head = m_Head.load(std::memory_order_relaxed);
+    size_t tail = m_Tail.load(std::memory_order_acquire);
+    for (; head != tail; head++) {
+        m_Waiting.push_back(std::move(m_Ring[head % QueueSize]));
+    }
+    m_Head.store(head, std::memory_order_release);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < m_Waiting.size(); i++) {
+        Result& result = m_Waiting[i];
+        if (result.Fence) {
+            GLenum status = glClientWaitSync(result.Fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED) {
+                if (kept != i) {
+                    m_Waiting[kept] = std::move(result);
+                }
+                kept++;
+                continue;
+            }
+            GLCall(glDeleteSync(result.Fence));
+        }
+
+        Entry& entry = m_Objects[result.Id];
+        entry.Object = result.Object;
+        entry.Finished = true;
+        m_Finished++;
+        m_Stats.LoaderMs += result.LoaderMs;
+        m_Stats.ReadMs += result.ReadMs;
+        if (!result.Object) {
+            m_Stats.Failed++;
+            continue;
+        }
+        switch (result.Kind) {
+        case LoadKind::Buffer:
+            m_Stats.Buffers++;
+            break;
+        case LoadKind::Texture:
+            m_Stats.Textures++;
+            break;
+        case LoadKind::Program:
+            m_Stats.Programs++;
+            entry.Reflection = std::move(result.Reflection);
+            break;
+        }
+        m_Stats.BytesUploaded += result.Uploaded;
+        if (result.Bytes > 0) {
+            entry.MemoryId = TrackGpuMemory(result.Category, result.Name, result.Bytes);
+        }
+    }
+    m_Waiting.resize(kept);
+}
+
+void BackgroundLoader::Update() {
+    Clock::time_point start = Clock::now();
+    Publish();
+    m_Stats.UpdateMs += Milliseconds(start);
+}
+
+void BackgroundLoader::WaitFor(uint32_t id) {
+    if (id >= m_Objects.size()) {
+        return;
+    }
+    Clock::time_point start = Clock::now();
+    Publish();
+    while (!m_Objects[id].Finished) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        Publish();
+    }
+    m_Stats.WaitMs += Milliseconds(start);
+}
+
+GLuint BackgroundLoader::Take(uint32_t id) {
+    if (id >= m_Objects.size()) {
+        return 0;
+    }
+    Entry& entry = m_Objects[id];
+    GLuint object = entry.Object;
+    entry.Object = 0;
+    ReleaseGpuMemory(entry.MemoryId);
+    entry.MemoryId = 0;
+    return object;
+}
+
+void BackgroundLoader::PrintReport(std::ostream& out) const {
+    if (m_Objects.empty()) {
+        return;
+    }
+    // The loader's time minus what the render thread spent on it anyway.
+    double moved = m_Stats.LoaderMs + m_Stats.ReadMs - m_Stats.UpdateMs - m_Stats.WaitMs;
+    out << "background_loader buffers " << m_Stats.Buffers << " textures " << m_Stats.Textures << " programs "
+        << m_Stats.Programs << " failed " << m_Stats.Failed << " megabytes " << m_Stats.BytesUploaded / 1e6
+        << " loader_ms " << m_Stats.LoaderMs << " read_ms " << m_Stats.ReadMs << " render_thread_ms "
+        << m_Stats.UpdateMs << " wait_ms " << m_Stats.WaitMs << " moved_off_render_thread_ms " << moved << "\n";
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GpuMemory.h"
+#include "ProgramReflection.h"
+
+/*
+        BACKGROUND LOADING WITH A SHARED CONTEXT
+    A context belongs to one thread at a time, which is why ThreadPool's
+    tasks must not touch OpenGL, and why TextureUploader decodes on the pool
+    but still calls glTextureSubImage2D on the render thread. Everything
+    that really has to be a GL call (glNamedBufferStorage copying a buffer's
+    data, compiling and linking a program) stays on the render thread and
+    freezes it while it runs.
+
+    Unless there is a SECOND context. Contexts created "shared" with the
+    window's (GLFW: the last argument of glfwCreateWindow, here a hidden
+    1x1 window; EGL: the share_context of eglCreateContext) see the same
+    buffers, textures, programs and sync objects. Containers of other
+    objects (vertex arrays, framebuffers) are NOT shared; the render thread
+    still makes those.
+
+    So the loader thread makes the shared context current and creates and
+    fills whatever is asked for. Then:
+    - A FENCE after the object, and a glFlush so the fence actually reaches
+      the GPU; without the flush another context may wait for it forever.
+    - The object, its fence and what it cost go into a LOCK-FREE queue (one
+      producer, one consumer: a ring with an atomic head and tail).
+    - Update() on the render thread takes them out and hands an object out
+      (Get) only once its fence has signaled, so the render thread never
+      sees half an upload.
+
+    The GPU memory is booked on the render thread, in Update(), like
+    everything else that can run a budget callback (GpuMemory.h).
+
+    Without a shared context (no MakeCurrent) there is no loader thread;
+    Update() and WaitFor() load everything on the render thread, as before.
+*/
+
+// How the loader thread gets its context; both run on the loader thread.
+struct SharedContext {
+    // Makes the shared context current. False: nothing is loaded.
+    std::function<bool()> MakeCurrent;
+    // Makes no context current, before the thread ends.
+    std::function<void()> Release;
+};
+
+struct BackgroundLoadStats {
+    size_t Buffers = 0;
+    size_t Textures = 0;
+    size_t Programs = 0;
+    size_t Failed = 0;
+    size_t BytesUploaded = 0;
+    // GL time on the loader thread: what the render thread would have paid.
+    double LoaderMs = 0.0;
+    // Reading and decoding files on the loader thread, no GL.
+    double ReadMs = 0.0;
+    // What the render thread did pay: Update(), and waiting in WaitFor().
+    double UpdateMs = 0.0;
+    double WaitMs = 0.0;
+};
+
+class BackgroundLoader {
+public:
+    static const size_t QueueSize = 256;
+
+    // Starts the loader thread, if there is a context for it.
+    explicit BackgroundLoader(const SharedContext& context);
+    // Stops the loader (what is queued and not started is dropped) and
+    // deletes every object that wasn't taken. Render thread, context current.
+    ~BackgroundLoader();
+
+    BackgroundLoader(const BackgroundLoader&) = delete;
+    BackgroundLoader& operator=(const BackgroundLoader&) = delete;
+
+    // All of these are for the render thread and return an id at once.
+
+    // An immutable buffer with the data (glNamedBufferStorage).
+    uint32_t LoadBuffer(const std::string& name, std::vector<unsigned char> data, GLbitfield flags = 0,
+                        MemoryCategory category = MemoryCategory::Geometry);
+    // An RGBA8 texture with mipmaps, from an image file (Image.h).
+    uint32_t LoadTexture(const std::string& filepath);
+    // LoadProgram (Shader.h); GetReflection gives the reflection.
+    uint32_t LoadProgram(const std::string& filepath);
+
+    // Render thread, once per frame: makes what has finished available.
+    void Update();
+
+    // Update() until the id has finished (or failed).
+    void WaitFor(uint32_t id);
+
+    // 0 while it is loading, if it failed, or once it was taken.
+    GLuint Get(uint32_t id) const { return id < m_Objects.size() ? m_Objects[id].Object : 0; }
+    // Valid once Get() isn't 0, for programs.
+    const ProgramReflection& GetReflection(uint32_t id) const { return m_Objects[id].Reflection; }
+
+    // Hands the object over: the loader neither deletes it nor books its
+    // memory any more (ResourcePool::AddProgram books programs again).
+    GLuint Take(uint32_t id);
+
+    bool IsIdle() const { return m_Finished == m_Objects.size(); }
+
+    const BackgroundLoadStats& GetStats() const { return m_Stats; }
+    // "background_loader ..." with the stats and the time moved off the
+    // render thread.
+    void PrintReport(std::ostream& out) const;
+
+private:
+    enum class LoadKind : uint8_t { Buffer, Texture, Program };
+
+    struct Request {
+        uint32_t Id;
+        LoadKind Kind;
+        std::string Name;
+        std::vector<unsigned char> Data;
+        GLbitfield Flags;
+        MemoryCategory Category;
+    };
+
+    // From the loader thread to the render thread.
+    struct Result {
+        uint32_t Id = 0;
+        LoadKind Kind = LoadKind::Buffer;
+        GLuint Object = 0;
+        GLsync Fence = nullptr;
+        std::string Name;
+        MemoryCategory Category = MemoryCategory::Other;
+        // Booked, and copied to the GPU.
+        size_t Bytes = 0;
+        size_t Uploaded = 0;
+        double LoaderMs = 0.0;
+        double ReadMs = 0.0;
+        ProgramReflection Reflection;
+    };
+
+    // What the render thread knows about an id.
+    struct Entry {
+        LoadKind Kind = LoadKind::Buffer;
+        GLuint Object = 0;
+        uint32_t MemoryId = 0;
+        bool Finished = false;
+        ProgramReflection Reflection;
+    };
+
+    uint32_t Enqueue(Request request);
+    void LoaderThread(SharedContext context);
+    void Load(Request& request, Result& result);
+    // Without a loader thread: every request, here.
+    void LoadQueued();
+    // Loader thread; waits while the ring is full.
+    void Push(Result&& result);
+    // Render thread: the results whose fences have signaled become entries.
+    void Publish();
+    static void DeleteObject(LoadKind kind, GLuint object);
+
+    bool m_Synchronous = false;
+
+    // Render thread only.
+    std::vector<Entry> m_Objects;
+    size_t m_Finished = 0;
+    std::vector<Result> m_Waiting;
+    BackgroundLoadStats m_Stats;
+
+    // Requests, render thread to loader; the loader sleeps on them.
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::deque<Request> m_Requests;
+    bool m_Stopping = false;
+
+    // Results, loader to render thread. The loader only writes m_Tail, the
+    // render thread only m_Head.
+    Result m_Ring[QueueSize];
+    std::atomic<size_t> m_Head{0};
+    std::atomic<size_t> m_Tail{0};
+    std::atomic<bool> m_Abandon{false};
+
+    std::thread m_Loader;
+};
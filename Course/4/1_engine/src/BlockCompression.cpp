@@ -0,0 +1,364 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+
+size_t GetBlockBytes(BlockFormat format) {
+    return format == BlockFormat::BC3 ? 16 : 8;
+}
+
+size_t GetCompressedSize(BlockFormat format, int width, int height) {
+    size_t blocksX = (size_t)(width + 3) / 4;
+    size_t blocksY = (size_t)(height + 3) / 4;
+    return blocksX * blocksY * GetBlockBytes(format);
+}
+
+static int Clamp255(int value) {
+    return std::min(255, std::max(0, value));
+}
+
+// Expands a 5:6:5 color to 8 bits per channel by repeating the top bits.
+static void Unpack565(unsigned int color, int* rgb) {
+    int r = (color >> 11) & 31;
+    int g = (color >> 5) & 63;
+    int b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Decodes the 8 byte color part of a BC1/BC3 block into 16 RGBA pixels.
+// forceFourColor: BC3, whose color blocks always use 4 colors.
+// alphaForIndex3: BC1_RGBA, where the black of the 3 color mode is transparent.
+static void DecodeBC1Block(const unsigned char* block, unsigned char pixels[16][4], bool forceFourColor,
+                           bool alphaForIndex3) {
+    unsigned int c0 = block[0] | (block[1] << 8);
+    unsigned int c1 = block[2] | (block[3] << 8);
+
+    int palette[4][4];
+    Unpack565(c0, palette[0]);
+    Unpack565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = 255;
+
+    // c0 > c1 means 4 colors, otherwise 3 colors plus black.
+    if (c0 > c1 || forceFourColor) {
+        for (int i = 0; i < 3; i++) {
+            palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+            palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+        }
+        palette[2][3] = palette[3][3] = 255;
+    }
+    else {
+        for (int i = 0; i < 3; i++) {
+            palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+            palette[3][i] = 0;
+        }
+        palette[2][3] = 255;
+        palette[3][3] = alphaForIndex3 ? 0 : 255;
+    }
+
+    // 2 bits per pixel, row by row, starting at the lowest bits.
+    unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+    for (int i = 0; i < 16; i++) {
+        const int* color = palette[(indices >> (i * 2)) & 3];
+        for (int c = 0; c < 4; c++) {
+            pixels[i][c] = (unsigned char)color[c];
+        }
+    }
+}
+
+// BC3 alpha: two 8 bit endpoints and 3 bit indices into an 8 entry ramp.
+static void DecodeBC3AlphaBlock(const unsigned char* block, unsigned char pixels[16][4]) {
+    int a0 = block[0];
+    int a1 = block[1];
+
+    int alpha[8] = {a0, a1};
+    if (a0 > a1) {
+        for (int i = 1; i < 7; i++) {
+            alpha[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+        }
+    }
+    else {
+        for (int i = 1; i < 5; i++) {
+            alpha[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        }
+        alpha[6] = 0;
+        alpha[7] = 255;
+    }
+
+    unsigned long long indices = 0;
+    for (int i = 0; i < 6; i++) {
+        indices |= (unsigned long long)block[2 + i] << (8 * i);
+    }
+    for (int i = 0; i < 16; i++) {
+        pixels[i][3] = (unsigned char)alpha[(indices >> (i * 3)) & 7];
+    }
+}
+
+/*
+    ETC2 RGB8. The block is read as a big endian 64 bit number. It starts out as
+    an ETC1 block (two sub-blocks, each with a base color and an intensity
+    table), and ETC2 hides three more modes in bit patterns that were invalid
+    in ETC1: when the "differential" base color would overflow in red (T mode),
+    green (H mode) or blue (planar mode).
+*/
+static const int etcModifiers[8][4] = {
+    {2, 8, -2, -8},
+    {5, 17, -5, -17},
+    {9, 29, -9, -29},
+    {13, 42, -13, -42},
+    {18, 60, -18, -60},
+    {24, 80, -24, -80},
+    {33, 106, -33, -106},
+    {47, 183, -47, -183}
+};
+
+static const int etcDistances[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+
+static int Extend4(int value) { return (value << 4) | value; }
+static int Extend5(int value) { return (value << 3) | (value >> 2); }
+static int Extend6(int value) { return (value << 2) | (value >> 4); }
+static int Extend7(int value) { return (value << 1) | (value >> 6); }
+
+static void DecodeETC2Block(const unsigned char* block, unsigned char pixels[16][4]) {
+    // Pixel indices are stored column by column: pixel (x, y) is bit x * 4 + y,
+    // with the most significant bit of every index in the upper 16 bits.
+    unsigned int indexBits = ((unsigned int)block[4] << 24) | (block[5] << 16) | (block[6] << 8) | block[7];
+    auto pixelIndex = [&](int x, int y) {
+        int bit = x * 4 + y;
+        return (int)((((indexBits >> (bit + 16)) & 1) << 1) | ((indexBits >> bit) & 1));
+    };
+    auto setPixel = [&](int x, int y, int r, int g, int b) {
+        unsigned char* p = pixels[y * 4 + x];
+        p[0] = (unsigned char)Clamp255(r);
+        p[1] = (unsigned char)Clamp255(g);
+        p[2] = (unsigned char)Clamp255(b);
+        p[3] = 255;
+    };
+
+    bool differential = (block[3] & 2) != 0;
+    bool flip = (block[3] & 1) != 0;
+    int base[2][3];
+
+    if (differential) {
+        int r = block[0] >> 3, g = block[1] >> 3, b = block[2] >> 3;
+        // 3 bit two's complement deltas.
+        int dr = ((block[0] & 7) ^ 4) - 4;
+        int dg = ((block[1] & 7) ^ 4) - 4;
+        int db = ((block[2] & 7) ^ 4) - 4;
+
+        if (r + dr < 0 || r + dr > 31) {
+            // T mode: one color on its own, the other one spread by a distance.
+            int c1[3] = {Extend4(((block[0] >> 1) & 0xC) | (block[0] & 3)), Extend4(block[1] >> 4), Extend4(block[1] & 0xF)};
+            int c2[3] = {Extend4(block[2] >> 4), Extend4(block[2] & 0xF), Extend4(block[3] >> 4)};
+            int d = etcDistances[((block[3] >> 1) & 6) | (block[3] & 1)];
+            int paint[4][3] = {
+                {c1[0], c1[1], c1[2]},
+                {c2[0] + d, c2[1] + d, c2[2] + d},
+                {c2[0], c2[1], c2[2]},
+                {c2[0] - d, c2[1] - d, c2[2] - d}
+            };
+            for (int y = 0; y < 4; y++) {
+                for (int x = 0; x < 4; x++) {
+                    const int* c = paint[pixelIndex(x, y)];
+                    setPixel(x, y, c[0], c[1], c[2]);
+                }
+            }
+            return;
+        }
+
+        if (g + dg < 0 || g + dg > 31) {
+            // H mode: both colors spread by the same distance.
+            int r1 = (block[0] >> 3) & 0xF;
+            int g1 = ((block[0] & 7) << 1) | ((block[1] >> 4) & 1);
+            int b1 = (block[1] & 8) | ((block[1] & 3) << 1) | (block[2] >> 7);
+            int r2 = (block[2] >> 3) & 0xF;
+            int g2 = ((block[2] & 7) << 1) | (block[3] >> 7);
+            int b2 = (block[3] >> 3) & 0xF;
+            // The last bit of the distance index is hidden in the order of the colors.
+            int order = ((r1 << 8) | (g1 << 4) | b1) >= ((r2 << 8) | (g2 << 4) | b2) ? 1 : 0;
+            int d = etcDistances[(block[3] & 4) | ((block[3] & 1) << 1) | order];
+            int c1[3] = {Extend4(r1), Extend4(g1), Extend4(b1)};
+            int c2[3] = {Extend4(r2), Extend4(g2), Extend4(b2)};
+            int paint[4][3] = {
+                {c1[0] + d, c1[1] + d, c1[2] + d},
+                {c1[0] - d, c1[1] - d, c1[2] - d},
+                {c2[0] + d, c2[1] + d, c2[2] + d},
+                {c2[0] - d, c2[1] - d, c2[2] - d}
+            };
+            for (int y = 0; y < 4; y++) {
+                for (int x = 0; x < 4; x++) {
+                    const int* c = paint[pixelIndex(x, y)];
+                    setPixel(x, y, c[0], c[1], c[2]);
+                }
+            }
+            return;
+        }
+
+        if (b + db < 0 || b + db > 31) {
+            // Planar mode: a smooth gradient from three colors (origin, horizontal, vertical).
+            int ro = Extend6((block[0] >> 1) & 0x3F);
+            int go = Extend7(((block[0] & 1) << 6) | ((block[1] >> 1) & 0x3F));
+            int bo = Extend6(((block[1] & 1) << 5) | (block[2] & 0x18) | ((block[2] & 3) << 1) | (block[3] >> 7));
+            int rh = Extend6((((block[3] >> 2) & 0x1F) << 1) | (block[3] & 1));
+            int gh = Extend7(block[4] >> 1);
+            int bh = Extend6(((block[4] & 1) << 5) | (block[5] >> 3));
+            int rv = Extend6(((block[5] & 7) << 3) | (block[6] >> 5));
+            int gv = Extend7(((block[6] & 0x1F) << 2) | (block[7] >> 6));
+            int bv = Extend6(block[7] & 0x3F);
+            for (int y = 0; y < 4; y++) {
+                for (int x = 0; x < 4; x++) {
+                    setPixel(x, y,
+                             (x * (rh - ro) + y * (rv - ro) + 4 * ro + 2) >> 2,
+                             (x * (gh - go) + y * (gv - go) + 4 * go + 2) >> 2,
+                             (x * (bh - bo) + y * (bv - bo) + 4 * bo + 2) >> 2);
+                }
+            }
+            return;
+        }
+
+        base[0][0] = Extend5(r);
+        base[0][1] = Extend5(g);
+        base[0][2] = Extend5(b);
+        base[1][0] = Extend5(r + dr);
+        base[1][1] = Extend5(g + dg);
+        base[1][2] = Extend5(b + db);
+    }
+    else {
+        // "Individual" mode: two independent 4 bit colors.
+        for (int c = 0; c < 3; c++) {
+            base[0][c] = Extend4(block[c] >> 4);
+            base[1][c] = Extend4(block[c] & 0xF);
+        }
+    }
+
+    int tables[2] = {(block[3] >> 5) & 7, (block[3] >> 2) & 7};
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            // Without flip the sub-blocks are the left and right 2x4 halves, with flip top and bottom.
+            int subBlock = flip ? (y >= 2) : (x >= 2);
+            int modifier = etcModifiers[tables[subBlock]][pixelIndex(x, y)];
+            setPixel(x, y, base[subBlock][0] + modifier, base[subBlock][1] + modifier, base[subBlock][2] + modifier);
+        }
+    }
+}
+
+void DecodeBlocks(BlockFormat format, int width, int height, const unsigned char* blocks, unsigned char* rgba) {
+    const size_t blockBytes = GetBlockBytes(format);
+    const int blocksX = (width + 3) / 4;
+    const int blocksY = (height + 3) / 4;
+
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            const unsigned char* block = blocks + ((size_t)by * blocksX + bx) * blockBytes;
+            unsigned char pixels[16][4];
+
+            switch (format) {
+                case BlockFormat::BC1:
+                    DecodeBC1Block(block, pixels, false, false);
+                    break;
+                case BlockFormat::BC1_RGBA:
+                    DecodeBC1Block(block, pixels, false, true);
+                    break;
+                case BlockFormat::BC3:
+                    // BC3 color blocks always use the 4 color mode.
+                    DecodeBC1Block(block + 8, pixels, true, false);
+                    DecodeBC3AlphaBlock(block, pixels);
+                    break;
+                case BlockFormat::ETC2_RGB8:
+                    DecodeETC2Block(block, pixels);
+                    break;
+            }
+
+            // Blocks on the right and top edges may stick out of the image.
+            for (int y = 0; y < 4 && by * 4 + y < height; y++) {
+                for (int x = 0; x < 4 && bx * 4 + x < width; x++) {
+                    unsigned char* dst = rgba + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4;
+                    std::copy(pixels[y * 4 + x], pixels[y * 4 + x] + 4, dst);
+                }
+            }
+        }
+    }
+}
+
+static unsigned int Pack565(int r, int g, int b) {
+    return ((unsigned int)(r * 31 + 127) / 255 << 11) | ((unsigned int)(g * 63 + 127) / 255 << 5) |
+           ((unsigned int)(b * 31 + 127) / 255);
+}
+
+void EncodeBC1(int width, int height, const unsigned char* rgba, unsigned char* blocks) {
+    const int blocksX = (width + 3) / 4;
+    const int blocksY = (height + 3) / 4;
+
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            // Gather the block, repeating the edge pixels where it sticks out.
+            int pixels[16][3];
+            for (int y = 0; y < 4; y++) {
+                for (int x = 0; x < 4; x++) {
+                    int sx = std::min(bx * 4 + x, width - 1);
+                    int sy = std::min(by * 4 + y, height - 1);
+                    const unsigned char* p = rgba + ((size_t)sy * width + sx) * 4;
+                    for (int c = 0; c < 3; c++) {
+                        pixels[y * 4 + x][c] = p[c];
+                    }
+                }
+            }
+
+            // Use the corners of the color bounding box as the two endpoints.
+            int low[3] = {255, 255, 255};
+            int high[3] = {0, 0, 0};
+            for (const int* p : pixels) {
+                for (int c = 0; c < 3; c++) {
+                    low[c] = std::min(low[c], p[c]);
+                    high[c] = std::max(high[c], p[c]);
+                }
+            }
+
+            unsigned int c0 = Pack565(high[0], high[1], high[2]);
+            unsigned int c1 = Pack565(low[0], low[1], low[2]);
+            unsigned char* block = blocks + ((size_t)by * blocksX + bx) * 8;
+
+            // A flat block (c0 == c1) keeps every index at 0.
+            unsigned int indices = 0;
+            if (c0 != c1) {
+                // The 4 color mode needs c0 > c1.
+                if (c0 < c1) {
+                    std::swap(c0, c1);
+                }
+                int palette[4][3];
+                Unpack565(c0, palette[0]);
+                Unpack565(c1, palette[1]);
+                for (int c = 0; c < 3; c++) {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+
+                for (int i = 0; i < 16; i++) {
+                    int best = 0;
+                    int bestError = 1 << 30;
+                    for (int k = 0; k < 4; k++) {
+                        int error = 0;
+                        for (int c = 0; c < 3; c++) {
+                            int d = pixels[i][c] - palette[k][c];
+                            error += d * d;
+                        }
+                        if (error < bestError) {
+                            bestError = error;
+                            best = k;
+                        }
+                    }
+                    indices |= (unsigned int)best << (i * 2);
+                }
+            }
+
+            block[0] = c0 & 0xFF;
+            block[1] = c0 >> 8;
+            block[2] = c1 & 0xFF;
+            block[3] = c1 >> 8;
+            block[4] = indices & 0xFF;
+            block[5] = (indices >> 8) & 0xFF;
+            block[6] = (indices >> 16) & 0xFF;
+            block[7] = indices >> 24;
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+        BLOCK COMPRESSED TEXTURES
+    GPUs can sample textures that stay compressed in video memory. The image
+    is cut into 4x4 pixel blocks and every block is stored in a fixed number
+    of bytes, so the GPU can find any pixel without decompressing the rest:
+
+    - BC1 (a.k.a. DXT1)   8 bytes per block, RGB (+ 1 bit alpha)   -> 4 bits per pixel
+    - BC3 (a.k.a. DXT5)  16 bytes per block, RGBA                  -> 8 bits per pixel
+    - ETC2 RGB8           8 bytes per block, RGB (mobile / GL ES)  -> 4 bits per pixel
+
+    Compare that to 32 bits per pixel for plain RGBA. Desktop drivers usually
+    have BC, mobile ones ETC2. For a driver that doesn't understand a format we
+    can still decode the blocks on the CPU and upload plain RGBA.
+
+    Decoded pixels are RGBA, 8 bits per channel, rows in the same order as the
+    blocks (we don't flip anything here).
+*/
+
+enum class BlockFormat {
+    BC1,
+    BC1_RGBA,
+    BC3,
+    ETC2_RGB8
+};
+
+size_t GetBlockBytes(BlockFormat format);
+
+// Size of one mip level in bytes; partial blocks at the edges count as full ones.
+size_t GetCompressedSize(BlockFormat format, int width, int height);
+
+// Decodes a whole mip level. rgba must have room for width * height * 4 bytes.
+void DecodeBlocks(BlockFormat format, int width, int height, const unsigned char* blocks, unsigned char* rgba);
+
+// A quick (not pretty) BC1 encoder, good enough for tools and tests.
+// blocks must have room for GetCompressedSize(BlockFormat::BC1, width, height) bytes.
+void EncodeBC1(int width, int height, const unsigned char* rgba, unsigned char* blocks);
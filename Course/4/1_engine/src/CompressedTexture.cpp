@@ -0,0 +1,83 @@
+#include "CompressedTexture.h"
+
+#include <vector>
+
+#include "Assets.h"
+#include "Renderer.h"
+
+static GLenum GetInternalFormat(BlockFormat format) {
+    switch (format) {
+        case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BlockFormat::BC1_RGBA: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BlockFormat::ETC2_RGB8: return GL_COMPRESSED_RGB8_ETC2;
+    }
+    return 0;
+}
+
+bool IsBlockFormatSupported(BlockFormat format) {
+    switch (format) {
+        case BlockFormat::BC1:
+        case BlockFormat::BC1_RGBA:
+        case BlockFormat::BC3:
+            return GLEW_EXT_texture_compression_s3tc;
+        case BlockFormat::ETC2_RGB8:
+            // ETC2 is core in GL ES 3.0 and came to desktop GL with this extension (core in 4.3).
+            return GLEW_ARB_ES3_compatibility;
+    }
+    return false;
+}
+
+GLuint CreateCompressedTexture(const TextureContainer& container, bool* decodedOnCpu) {
+    if (container.Levels.empty()) {
+        return 0;
+    }
+
+    const bool native = IsBlockFormatSupported(container.Format);
+    const GLsizei levelCount = (GLsizei)container.Levels.size();
+
+    GLuint texture;
+    GLCall(glCreateTextures(GL_TEXTURE_2D, 1, &texture));
+    GLCall(glTextureStorage2D(texture, levelCount, native ? GetInternalFormat(container.Format) : GL_RGBA8,
+                              container.Width, container.Height));
+    // The chain may stop before 1x1, so tell GL which levels exist.
+    GLCall(glTextureParameteri(texture, GL_TEXTURE_MAX_LEVEL, levelCount - 1));
+    GLCall(glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+    GLCall(glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+
+    std::vector<unsigned char> rgba;
+    for (GLsizei i = 0; i < levelCount; i++) {
+        const TextureLevel& level = container.Levels[i];
+        if (native) {
+            GLCall(glCompressedTextureSubImage2D(texture, i, 0, 0, level.Width, level.Height,
+                                                 GetInternalFormat(container.Format), (GLsizei)level.Size,
+                                                 level.Data));
+        }
+        else {
+            rgba.resize((size_t)level.Width * level.Height * 4);
+            DecodeBlocks(container.Format, level.Width, level.Height, level.Data, rgba.data());
+            GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+            GLCall(glTextureSubImage2D(texture, i, 0, 0, level.Width, level.Height, GL_RGBA, GL_UNSIGNED_BYTE,
+                                       rgba.data()));
+        }
+    }
+
+    if (decodedOnCpu) {
+        *decodedOnCpu = !native;
+    }
+    return texture;
+}
+
+GLuint LoadCompressedTexture(const std::string& filepath) {
+    // Stored entries of the packed archive are already mapped, and page aligned,
+    // so the blocks go to the driver straight from the archive.
+    TextureContainer container;
+    const unsigned char* data;
+    size_t size;
+    bool loaded = MapAsset(filepath, data, size) ? ParseTextureContainer(data, size, container)
+                                                 : LoadTextureContainer(filepath, container);
+    if (!loaded) {
+        return 0;
+    }
+    return CreateCompressedTexture(container);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+
+#include "TextureContainer.h"
+
+// Does the driver understand this block format natively?
+bool IsBlockFormatSupported(BlockFormat format);
+
+/*
+    Creates an immutable texture with every level of the container. If the
+    driver knows the format, the mapped blocks go straight to
+    glCompressedTextureSubImage2D. Otherwise every level is decoded on the CPU
+    and uploaded as plain RGBA (slower, and 4-8x the video memory, but it works).
+    Returns 0 on failure.
+*/
+GLuint CreateCompressedTexture(const TextureContainer& container, bool* decodedOnCpu = nullptr);
+
+// Loads the container (from the archive or from disk, see Assets.h) and calls
+// CreateCompressedTexture. The driver keeps its own copy of the blocks.
+GLuint LoadCompressedTexture(const std::string& filepath);
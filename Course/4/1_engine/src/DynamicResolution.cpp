@@ -0,0 +1,69 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Measurements left out after a change: as many frames as GpuTimer can
+// have in flight.
+static const int IGNORED_AFTER_CHANGE = 3;
+
+DynamicResolution::DynamicResolution(const DynamicResolutionSettings& settings) : m_Settings(settings) {
+    m_Settings.MinScale = std::max(m_Settings.MinScale, 0.01f);
+    m_Settings.MaxScale = std::max(m_Settings.MaxScale, m_Settings.MinScale);
+    m_Settings.Frames = std::max(m_Settings.Frames, 1);
+    m_Scale = m_Settings.MaxScale;
+}
+
+float DynamicResolution::Quantize(float scale) const {
+    if (m_Settings.Step > 0.0f) {
+        // Down, so a scale that was picked to fit still fits. The small
+        // epsilon keeps 0.7 / 0.05 from coming out as 13.999.
+        scale = std::floor(scale / m_Settings.Step + 1e-4f) * m_Settings.Step;
+    }
+    return std::min(std::max(scale, m_Settings.MinScale), m_Settings.MaxScale);
+}
+
+bool DynamicResolution::Update(double gpuMilliseconds) {
+    if (m_Ignore > 0) {
+        m_Ignore--;
+        return false;
+    }
+    m_Sum += gpuMilliseconds;
+    if (++m_Count < m_Settings.Frames) {
+        return false;
+    }
+    double average = m_Sum / m_Count;
+    m_LastAverage = average;
+    m_Sum = 0.0;
+    m_Count = 0;
+    if (average <= 0.0) {
+        return false;
+    }
+
+    float scale = m_Scale;
+    if (average > m_Settings.BudgetMs) {
+        scale = Quantize(m_Scale * (float)std::sqrt(m_Settings.BudgetMs / average));
+    }
+    else {
+        // One step up, if even at that scale there'd be room to spare.
+        float wanted = m_Scale * (float)std::sqrt(m_Settings.BudgetMs / average);
+        float step = m_Settings.Step > 0.0f ? m_Settings.Step : wanted - m_Scale;
+        float larger = Quantize(std::min(wanted, m_Scale + step + 1e-4f));
+        double predicted = average * (larger * larger) / (m_Scale * m_Scale);
+        if (predicted < m_Settings.BudgetMs * m_Settings.Headroom) {
+            scale = larger;
+        }
+    }
+
+    if (scale == m_Scale) {
+        return false;
+    }
+    m_Scale = scale;
+    m_Ignore = IGNORED_AFTER_CHANGE;
+    return true;
+}
+
+void DynamicResolution::GetRenderSize(int outputWidth, int outputHeight, int& width, int& height) const {
+    width = std::max(1, (int)std::lround(outputWidth * m_Scale));
+    height = std::max(1, (int)std::lround(outputHeight * m_Scale));
+}
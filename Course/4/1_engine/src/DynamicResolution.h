@@ -0,0 +1,65 @@
+#pragma once
+
+/*
+        DYNAMIC RESOLUTION
+    The window stays 640x480 (or whatever it is), but the scene doesn't have
+    to be drawn at that size. The render graph draws it into a texture of
+    its own, and the present pass stretches that over the window with
+    bilinear filtering. When the GPU can't keep up, the scene texture gets
+    smaller; when there's time to spare, it grows back.
+
+    Most of a frame's GPU time goes into pixels, so the time goes roughly
+    with the square of the scale. The controller averages the GPU frame
+    time (GpuTimer.h) over a few frames and then picks the scale that would
+    have fit the budget:
+
+        scale = scale * sqrt(budget / time)
+
+    It goes down right away, but up only one step at a time, and only when
+    the frames would still be comfortably under budget at the bigger scale,
+    so it doesn't flip back and forth around the limit. The scale is rounded to steps, so the render
+    graph gets a handful of sizes and not a new texture every frame.
+*/
+
+struct DynamicResolutionSettings {
+    // GPU milliseconds a frame may take. Under 16.7 for 60 Hz, with room
+    // for the present pass and the swap.
+    float BudgetMs = 14.0f;
+    // Of the output size, per side.
+    float MinScale = 0.5f;
+    float MaxScale = 1.0f;
+    float Step = 0.05f;
+    // Frames averaged before each decision.
+    int Frames = 8;
+    // Scaling up only when the time at the bigger scale is expected to be
+    // below this part of the budget.
+    float Headroom = 0.85f;
+};
+
+class DynamicResolution {
+public:
+    explicit DynamicResolution(const DynamicResolutionSettings& settings = DynamicResolutionSettings());
+
+    // One GPU frame time. True if the scale changed.
+    bool Update(double gpuMilliseconds);
+
+    float GetScale() const { return m_Scale; }
+    // The average the last decision was based on.
+    double GetAverageMs() const { return m_LastAverage; }
+    const DynamicResolutionSettings& GetSettings() const { return m_Settings; }
+
+    // The scaled size of an output, at least 1 by 1.
+    void GetRenderSize(int outputWidth, int outputHeight, int& width, int& height) const;
+
+private:
+    float Quantize(float scale) const;
+
+    DynamicResolutionSettings m_Settings;
+    float m_Scale;
+    double m_Sum = 0.0;
+    int m_Count = 0;
+    // Frames to leave out after a change: the GPU may still be drawing
+    // frames at the old scale.
+    int m_Ignore = 0;
+    double m_LastAverage = 0.0;
+};
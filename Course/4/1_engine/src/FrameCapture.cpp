@@ -0,0 +1,331 @@
+#include "FrameCapture.h"
+#include "GpuMemory.h"
+#include "Image.h"
+#include "Renderer.h"
+#include "Timing.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+FrameCaptureSettings GetCaptureSettings(const std::string& target) {
+    FrameCaptureSettings settings;
+    settings.Target = target;
+    bool png = target.find(".png") != std::string::npos && target[0] != '|';
+    settings.Format = png ? CaptureFormat::PNGSequence : CaptureFormat::Y4M;
+    return settings;
+}
+
+std::string GetCaptureFileName(const std::string& target, size_t frame) {
+    std::string prefix, suffix;
+    int digits = 0;
+    size_t percent = target.find('%');
+    if (percent == std::string::npos) {
+        // "capture.png" -> "capture_00000.png"
+        size_t extension = target.find(".png");
+        prefix = target.substr(0, extension) + "_";
+        suffix = target.substr(extension);
+        digits = 5;
+    }
+    else {
+        size_t end = percent + 1;
+        if (end < target.size() && target[end] == '0') {
+            for (end++; end < target.size() && std::isdigit((unsigned char)target[end]) && digits < 100; end++) {
+                digits = digits * 10 + (target[end] - '0');
+            }
+        }
+        if (end >= target.size() || target[end] != 'd' || digits >= 100 ||
+            target.find('%', end) != std::string::npos) {
+            return std::string();
+        }
+        prefix = target.substr(0, percent);
+        suffix = target.substr(end + 1);
+    }
+    std::string number = std::to_string(frame);
+    if ((int)number.size() < digits) {
+        number.insert(0, digits - number.size(), '0');
+    }
+    return prefix + number + suffix;
+}
+
+FrameCapture::FrameCapture(const FrameCaptureSettings& settings)
+    : m_Settings(settings), m_Slots(std::max(settings.RingSize, 1)) {
+    if (m_Settings.Target.empty()) {
+        return;
+    }
+    if (m_Settings.Format == CaptureFormat::PNGSequence && GetCaptureFileName(m_Settings.Target, 0).empty()) {
+        std::cerr << "\"" << m_Settings.Target << "\" can have one %d or %0Nd for the frame number and no other '%'"
+                  << std::endl;
+        return;
+    }
+    if (m_Settings.Format == CaptureFormat::Y4M) {
+        if (m_Settings.Target[0] == '|') {
+            m_Output = popen(m_Settings.Target.c_str() + 1, "w");
+            m_Pipe = true;
+        }
+        else {
+            m_Output = std::fopen(m_Settings.Target.c_str(), "wb");
+        }
+        if (!m_Output) {
+            std::cerr << "Can't open \"" << m_Settings.Target << "\" for the frame capture" << std::endl;
+            return;
+        }
+    }
+    m_Enabled = true;
+    m_Writer = std::thread(&FrameCapture::WriterThread, this);
+}
+
+FrameCapture::~FrameCapture() {
+    Finish();
+}
+
+void FrameCapture::Resize(Slot& slot, size_t bytes) {
+    if (slot.Bytes == bytes) {
+        return;
+    }
+    if (slot.Buffer) {
+        GLCall(glUnmapNamedBuffer(slot.Buffer));
+        GLCall(glDeleteBuffers(1, &slot.Buffer));
+        ReleaseGpuMemory(slot.MemoryId);
+    }
+    // Read by the CPU, so in memory the CPU reads fast.
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT | GL_CLIENT_STORAGE_BIT;
+    GLCall(glCreateBuffers(1, &slot.Buffer));
+    GLCall(glNamedBufferStorage(slot.Buffer, bytes, nullptr, flags));
+    slot.Memory = (unsigned char*)glMapNamedBufferRange(slot.Buffer, 0, bytes, flags & ~GL_CLIENT_STORAGE_BIT);
+    slot.Bytes = bytes;
+    slot.MemoryId = TrackGpuMemory(MemoryCategory::Staging, "frame capture", bytes);
+}
+
+bool FrameCapture::Harvest(Slot& slot, bool wait) {
+    GLenum result = glClientWaitSync(slot.Fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? UINT64_MAX : 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    GLCall(glDeleteSync(slot.Fence));
+    slot.Fence = nullptr;
+    slot.State.store(SlotState::Writing, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Queue.push_back(&slot);
+    }
+    m_Wake.notify_one();
+    return true;
+}
+
+void FrameCapture::Capture(GLuint framebuffer, int width, int height) {
+    if (!m_Enabled || width <= 0 || height <= 0) {
+        return;
+    }
+    Clock::time_point start = Clock::now();
+
+    // Whatever the GPU has finished goes to the writer, oldest first.
+    while (!m_InFlight.empty() && Harvest(*m_InFlight.front(), false)) {
+        m_InFlight.pop_front();
+    }
+
+    if (m_Settings.Format == CaptureFormat::Y4M) {
+        if (m_StreamWidth == 0) {
+            m_StreamWidth = width;
+            m_StreamHeight = height;
+        }
+        if (width != m_StreamWidth || height != m_StreamHeight) {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stats.Skipped++;
+            m_Stats.RenderThreadMs += Milliseconds(start);
+            return;
+        }
+    }
+
+    Slot& slot = m_Slots[m_Next];
+    if (slot.State.load(std::memory_order_relaxed) == SlotState::Reading) {
+        // The oldest readback in flight, RingSize frames ago, still isn't
+        // done. It goes to the writer, so this frame doesn't get the slot.
+        Clock::time_point stallStart = Clock::now();
+        Harvest(slot, true);
+        m_InFlight.pop_front();
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stats.Stalls++;
+        m_Stats.StallMs += Milliseconds(stallStart);
+        m_Stats.Dropped++;
+        m_Stats.RenderThreadMs += Milliseconds(start);
+        return;
+    }
+    if (slot.State.load(std::memory_order_acquire) == SlotState::Writing) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stats.Dropped++;
+        m_Stats.RenderThreadMs += Milliseconds(start);
+        return;
+    }
+
+    Resize(slot, (size_t)width * height * 4);
+    slot.Width = width;
+    slot.Height = height;
+    slot.State.store(SlotState::Reading, std::memory_order_relaxed);
+    GLCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer));
+    GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.Buffer));
+    GLCall(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+    GLCall(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_InFlight.push_back(&slot);
+    m_Next = (m_Next + 1) % m_Slots.size();
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    slot.Frame = m_Stats.Captured++;
+    m_Stats.RenderThreadMs += Milliseconds(start);
+}
+
+// Full range BT.601, what the "C420jpeg" of the header says. Each chroma
+// sample is the average of a 2x2 block; odd edges are clamped.
+static void ConvertToYUV420(int width, int height, const unsigned char* rgba, std::vector<unsigned char>& yuv) {
+    int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    yuv.resize((size_t)width * height + 2 * (size_t)chromaWidth * chromaHeight);
+    unsigned char* yPlane = yuv.data();
+    unsigned char* uPlane = yPlane + (size_t)width * height;
+    unsigned char* vPlane = uPlane + (size_t)chromaWidth * chromaHeight;
+    // The image is bottom row first, the stream top row first.
+    auto pixel = [&](int x, int y) { return rgba + ((size_t)(height - 1 - y) * width + x) * 4; };
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const unsigned char* p = pixel(x, y);
+            yPlane[(size_t)y * width + x] = (unsigned char)((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+        }
+    }
+    for (int y = 0; y < chromaHeight; y++) {
+        int y0 = y * 2, y1 = std::min(y * 2 + 1, height - 1);
+        for (int x = 0; x < chromaWidth; x++) {
+            int x0 = x * 2, x1 = std::min(x * 2 + 1, width - 1);
+            int r = 0, g = 0, b = 0;
+            for (const unsigned char* p : {pixel(x0, y0), pixel(x1, y0), pixel(x0, y1), pixel(x1, y1)}) {
+                r += p[0];
+                g += p[1];
+                b += p[2];
+            }
+            int u = 128 + ((-43 * r - 85 * g + 128 * b + 512) >> 10);
+            int v = 128 + ((128 * r - 107 * g - 21 * b + 512) >> 10);
+            uPlane[(size_t)y * chromaWidth + x] = (unsigned char)std::min(std::max(u, 0), 255);
+            vPlane[(size_t)y * chromaWidth + x] = (unsigned char)std::min(std::max(v, 0), 255);
+        }
+    }
+}
+
+size_t FrameCapture::WriteFrame(Slot& slot, std::vector<unsigned char>& scratch, std::vector<unsigned char>& encoded) {
+    int width = slot.Width, height = slot.Height;
+    size_t frame = slot.Frame;
+    if (m_Settings.Format == CaptureFormat::Y4M) {
+        ConvertToYUV420(width, height, slot.Memory, scratch);
+        slot.State.store(SlotState::Free, std::memory_order_release);
+
+        static const char frameHeader[] = "FRAME\n";
+        bool ok = std::fwrite(frameHeader, 1, sizeof(frameHeader) - 1, m_Output) == sizeof(frameHeader) - 1 &&
+                  std::fwrite(scratch.data(), 1, scratch.size(), m_Output) == scratch.size();
+        return ok ? sizeof(frameHeader) - 1 + scratch.size() : 0;
+    }
+
+    // The slot is given back as soon as the pixels are copied; the encoding
+    // takes much longer.
+    scratch.assign(slot.Memory, slot.Memory + (size_t)width * height * 4);
+    slot.State.store(SlotState::Free, std::memory_order_release);
+    EncodePNG(width, height, scratch.data(), encoded);
+
+    std::string name = GetCaptureFileName(m_Settings.Target, frame);
+    FILE* file = std::fopen(name.c_str(), "wb");
+    if (!file) {
+        return 0;
+    }
+    bool ok = std::fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+    ok = std::fclose(file) == 0 && ok;
+    return ok ? encoded.size() : 0;
+}
+
+void FrameCapture::WriterThread() {
+    std::vector<unsigned char> scratch, encoded;
+    bool headerWritten = false;
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    for (;;) {
+        m_Wake.wait(lock, [&] { return m_Stopping || !m_Queue.empty(); });
+        if (m_Queue.empty()) {
+            return;
+        }
+        Slot* slot = m_Queue.front();
+        m_Queue.pop_front();
+        lock.unlock();
+
+        Clock::time_point start = Clock::now();
+        size_t bytes = 0;
+        if (m_Settings.Format == CaptureFormat::Y4M && !headerWritten) {
+            char header[128];
+            int length = std::snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+                                       slot->Width, slot->Height, m_Settings.FramesPerSecond);
+            bytes += std::fwrite(header, 1, length, m_Output);
+            headerWritten = true;
+        }
+        size_t frameBytes = WriteFrame(*slot, scratch, encoded);
+        bytes += frameBytes;
+        double ms = Milliseconds(start);
+
+        lock.lock();
+        m_Stats.Written += frameBytes > 0;
+        m_Stats.WriteErrors += frameBytes == 0;
+        m_Stats.BytesWritten += bytes;
+        m_Stats.WriterMs += ms;
+    }
+}
+
+void FrameCapture::Finish() {
+    if (!m_Enabled) {
+        return;
+    }
+    // Everything read back so far still gets written.
+    while (!m_InFlight.empty()) {
+        Harvest(*m_InFlight.front(), true);
+        m_InFlight.pop_front();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_Wake.notify_one();
+    m_Writer.join();
+
+    for (Slot& slot : m_Slots) {
+        if (slot.Buffer) {
+            GLCall(glUnmapNamedBuffer(slot.Buffer));
+            GLCall(glDeleteBuffers(1, &slot.Buffer));
+            ReleaseGpuMemory(slot.MemoryId);
+            slot.Buffer = 0;
+            slot.Bytes = 0;
+            slot.Memory = nullptr;
+        }
+    }
+    if (m_Output) {
+        if (m_Pipe) {
+            pclose(m_Output);
+        }
+        else {
+            std::fclose(m_Output);
+        }
+        m_Output = nullptr;
+    }
+    m_Enabled = false;
+}
+
+FrameCaptureStats FrameCapture::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
+
+void FrameCapture::PrintReport(std::ostream& out) const {
+    FrameCaptureStats stats = GetStats();
+    if (stats.Captured == 0 && stats.Dropped == 0 && stats.Skipped == 0) {
+        return;
+    }
+    double frames = std::max<size_t>(stats.Captured + stats.Dropped + stats.Skipped, 1);
+    out << "frame_capture target \"" << m_Settings.Target << "\" captured " << stats.Captured << " written "
+        << stats.Written << " dropped " << stats.Dropped << " skipped " << stats.Skipped << " write_errors "
+        << stats.WriteErrors << " stalls " << stats.Stalls << " stall_ms " << stats.StallMs
+        << " render_thread_ms_per_frame " << stats.RenderThreadMs / frames << " writer_ms_per_frame "
+        << stats.WriterMs / std::max<size_t>(stats.Written, 1) << " megabytes " << stats.BytesWritten / 1e6 << "\n";
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+        FRAME CAPTURE
+    The obvious way to record what we draw is a glReadPixels into memory
+    right before the swap. But the pixels only exist once the GPU has drawn
+    them, so glReadPixels waits for the whole frame to finish, and the CPU
+    and the GPU, which normally work a frame or two apart, run in lock
+    step from then on. A recording made like that measures something else
+    than the program without it.
+
+    So the readback is asynchronous, the same way the uploads in
+    TextureUploader.h are, only in the other direction:
+    - glReadPixels goes into a PIXEL PACK BUFFER (a PBO) instead of our
+      memory. That only queues a copy on the GPU and returns at once.
+    - A fence after it tells us when the copy is done. There is a RING of
+      these buffers, one per frame, so the frame from a few swaps ago is
+      usually done by the time we look at it.
+    - The buffers are persistently mapped for reading; when the fence has
+      signaled, the pixels are simply there.
+    - Converting and writing happens on a WRITER THREAD. It takes the
+      buffer, converts the frame (and gives the buffer back as soon as
+      that's done), then encodes and writes it.
+
+    If the writer can't keep up and the next buffer of the ring is still
+    being converted, the frame is DROPPED, not waited for; the report says
+    how many. The render thread only waits when the GPU hasn't finished a
+    copy from RingSize frames ago (a "stall").
+
+    Outputs:
+    - A PNG sequence, when the target has ".png" in it: one file per frame,
+      the frame number in place of a %d or %0Nd in the name
+      (frame_%05d.png), or added in front of ".png". Slow to encode, for
+      looking at single frames.
+    - A Y4M stream (raw YUV 4:2:0 with a small header), to a .y4m file or,
+      when the target starts with '|', into a command's stdin:
+          "|ffmpeg -y -i - capture.mp4"
+      Cheap enough for long recordings at full frame rate.
+*/
+
+enum class CaptureFormat : uint8_t { PNGSequence, Y4M };
+
+struct FrameCaptureSettings {
+    // A file, a file name pattern, or "|command". Empty: no capture.
+    std::string Target;
+    CaptureFormat Format = CaptureFormat::Y4M;
+    // Written into the Y4M header; the frames are whatever was drawn.
+    int FramesPerSecond = 60;
+    // PBOs in the ring, so how many frames a readback has to finish.
+    int RingSize = 4;
+};
+
+// Settings for a target, the format from its name.
+FrameCaptureSettings GetCaptureSettings(const std::string& target);
+
+// The file of one frame of a PNG sequence. The target comes from the user,
+// so it is never used as a printf format: a single %d or %0Nd is replaced
+// by hand, and any other '%' gives an empty string.
+std::string GetCaptureFileName(const std::string& target, size_t frame);
+
+struct FrameCaptureStats {
+    // Frames read back, and written by the writer.
+    size_t Captured = 0;
+    size_t Written = 0;
+    // The writer was still busy with the next buffer of the ring.
+    size_t Dropped = 0;
+    // A Y4M stream has one size; frames of another size are skipped.
+    size_t Skipped = 0;
+    // The GPU hadn't finished a readback from RingSize frames ago.
+    size_t Stalls = 0;
+    double StallMs = 0.0;
+    // Time of Capture() on the render thread, stalls included.
+    double RenderThreadMs = 0.0;
+    double WriterMs = 0.0;
+    size_t BytesWritten = 0;
+    size_t WriteErrors = 0;
+};
+
+class FrameCapture {
+public:
+    // Opens the target; without one (or if it can't be opened) Capture()
+    // does nothing.
+    explicit FrameCapture(const FrameCaptureSettings& settings);
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    bool IsEnabled() const { return m_Enabled; }
+
+    // After the last draw of a frame, before the swap: reads width x height
+    // pixels from (0, 0) of a framebuffer (0, the window's back buffer).
+    // Leaves it bound as the read framebuffer.
+    void Capture(GLuint framebuffer, int width, int height);
+
+    // Waits for the readbacks in flight and the writer, and closes the
+    // target. Needs the context; the destructor calls it as well.
+    void Finish();
+
+    FrameCaptureStats GetStats() const;
+
+    // "frame_capture ..." with the stats.
+    void PrintReport(std::ostream& out) const;
+
+private:
+    enum class SlotState : uint8_t { Free, Reading, Writing };
+
+    struct Slot {
+        GLuint Buffer = 0;
+        size_t Bytes = 0;
+        unsigned char* Memory = nullptr;
+        GLsync Fence = nullptr;
+        uint32_t MemoryId = 0;
+        int Width = 0, Height = 0;
+        size_t Frame = 0;
+        // Free and Reading belong to the render thread, Writing to the writer.
+        std::atomic<SlotState> State{SlotState::Free};
+    };
+
+    // Gives a slot whose readback is done to the writer; with wait, waits
+    // for it. False if it isn't done.
+    bool Harvest(Slot& slot, bool wait);
+    void Resize(Slot& slot, size_t bytes);
+    void WriterThread();
+    // Converts the slot's frame, gives the slot back, then encodes and
+    // writes. Returns the bytes written, 0 on an error.
+    size_t WriteFrame(Slot& slot, std::vector<unsigned char>& scratch, std::vector<unsigned char>& encoded);
+
+    FrameCaptureSettings m_Settings;
+    bool m_Enabled = false;
+    FILE* m_Output = nullptr;
+    bool m_Pipe = false;
+    int m_StreamWidth = 0, m_StreamHeight = 0;
+
+    std::vector<Slot> m_Slots;
+    // The next slot to read into, and the readbacks in flight, oldest first.
+    size_t m_Next = 0;
+    std::deque<Slot*> m_InFlight;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::deque<Slot*> m_Queue;
+    bool m_Stopping = false;
+    FrameCaptureStats m_Stats;
+    std::thread m_Writer;
+};
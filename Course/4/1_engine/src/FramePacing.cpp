@@ -0,0 +1,174 @@
+#include "FramePacing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+
+// Bins of the interval histogram, in milliseconds; longer frames go into
+// the last bin.
+static const double INTERVAL_BIN_MS = 0.05;
+static const size_t INTERVAL_BINS = 4000;
+
+const char* GetPacingModeName(PacingMode mode) {
+    switch (mode) {
+        case PacingMode::Uncapped: return "uncapped";
+        case PacingMode::Vsync: return "vsync";
+        case PacingMode::Adaptive: return "adaptive";
+        case PacingMode::Limited: return "limited";
+    }
+    return "?";
+}
+
+bool ParsePacingMode(const std::string& text, FramePacingSettings& settings) {
+    for (PacingMode mode : {PacingMode::Uncapped, PacingMode::Vsync, PacingMode::Adaptive}) {
+        if (text == GetPacingModeName(mode)) {
+            settings.Mode = mode;
+            return true;
+        }
+    }
+    char* end = nullptr;
+    double fps = std::strtod(text.c_str(), &end);
+    if (text.empty() || *end != '\0' || !(fps > 0.0)) {
+        return false;
+    }
+    settings.Mode = PacingMode::Limited;
+    settings.TargetFps = fps;
+    return true;
+}
+
+int GetSwapInterval(PacingMode mode, bool tearControl) {
+    switch (mode) {
+        case PacingMode::Vsync: return 1;
+        case PacingMode::Adaptive: return tearControl ? -1 : 1;
+        default: return 0;
+    }
+}
+
+const std::vector<double>& FramePacer::GetJitterBuckets() {
+    static const std::vector<double> buckets = {50, 100, 250, 500, 1000, 2000, 4000, 8000, 16000};
+    return buckets;
+}
+
+FramePacer::FramePacer(const FramePacingSettings& settings)
+    : m_Settings(settings), m_Intervals(INTERVAL_BINS, 0), m_Jitter(GetJitterBuckets().size() + 1, 0) {}
+
+void FramePacer::BeforeSwap() {
+    Clock::time_point now = Clock::now();
+    if (m_Settings.Mode == PacingMode::Limited && m_Settings.TargetFps > 0.0) {
+        auto period =
+            std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_Settings.TargetFps));
+        if (m_Deadline == Clock::time_point()) {
+            m_Deadline = now;
+        }
+        m_Deadline += period;
+        // More than a frame behind (a hitch, a breakpoint): start over from
+        // now instead of rushing frames out to catch up.
+        if (now > m_Deadline + period) {
+            m_Deadline = now;
+        }
+
+        auto spin = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double, std::micro>(m_Settings.SpinMicroseconds));
+        if (now < m_Deadline - spin) {
+            std::this_thread::sleep_until(m_Deadline - spin);
+        }
+        while (Clock::now() < m_Deadline) {
+            std::this_thread::yield();
+        }
+        Clock::time_point waited = Clock::now();
+        m_WaitSum += Milliseconds(now, waited);
+        now = waited;
+    }
+    m_SwapStart = now;
+}
+
+void FramePacer::AfterSwap() {
+    Clock::time_point now = Clock::now();
+    double swap = Milliseconds(m_SwapStart, now);
+    if (!m_Started) {
+        m_Started = true;
+        m_LastSwap = now;
+        return;
+    }
+
+    double interval = Milliseconds(m_LastSwap, now);
+    m_LastSwap = now;
+    m_Intervals[std::min((size_t)(interval / INTERVAL_BIN_MS), INTERVAL_BINS - 1)]++;
+    m_Min = m_Frames == 0 ? interval : std::min(m_Min, interval);
+    m_Max = m_Frames == 0 ? interval : std::max(m_Max, interval);
+    m_Sum += interval;
+    m_SumSquares += interval * interval;
+    m_SwapSum += swap;
+    m_WorstSwap = std::max(m_WorstSwap, swap);
+    m_Frames++;
+
+    if (m_LastInterval >= 0.0) {
+        double jitter = std::abs(interval - m_LastInterval) * 1000.0;
+        const std::vector<double>& buckets = GetJitterBuckets();
+        size_t bucket = std::lower_bound(buckets.begin(), buckets.end(), jitter) - buckets.begin();
+        m_Jitter[bucket]++;
+    }
+    m_LastInterval = interval;
+}
+
+void FramePacer::Restart() {
+    m_Started = false;
+    m_LastInterval = -1.0;
+    m_Deadline = Clock::time_point();
+}
+
+FramePacingStats FramePacer::GetStats() const {
+    FramePacingStats stats;
+    stats.Frames = m_Frames;
+    if (m_Frames == 0) {
+        return stats;
+    }
+    stats.MeanMs = m_Sum / m_Frames;
+    stats.StdDevMs = std::sqrt(std::max(0.0, m_SumSquares / m_Frames - stats.MeanMs * stats.MeanMs));
+    stats.MinMs = m_Min;
+    stats.MaxMs = m_Max;
+    stats.SwapMs = m_SwapSum / m_Frames;
+    stats.WorstSwapMs = m_WorstSwap;
+    stats.WaitMs = m_WaitSum / m_Frames;
+
+    // The middle of the bin the percentile falls into.
+    auto percentile = [&](double fraction) {
+        size_t wanted = (size_t)std::ceil(fraction * m_Frames), seen = 0;
+        for (size_t bin = 0; bin < INTERVAL_BINS; bin++) {
+            seen += m_Intervals[bin];
+            if (seen >= wanted) {
+                return (bin + 0.5) * INTERVAL_BIN_MS;
+            }
+        }
+        return m_Max;
+    };
+    stats.P50Ms = percentile(0.5);
+    stats.P99Ms = percentile(0.99);
+    return stats;
+}
+
+void FramePacer::PrintReport(std::ostream& out) const {
+    FramePacingStats stats = GetStats();
+    out << "frame_pacing mode " << GetPacingModeName(m_Settings.Mode);
+    if (m_Settings.Mode == PacingMode::Limited) {
+        out << " target_fps " << m_Settings.TargetFps;
+    }
+    out << " frames " << stats.Frames << " mean_ms " << stats.MeanMs << " stddev_ms " << stats.StdDevMs << " min_ms "
+        << stats.MinMs << " p50_ms " << stats.P50Ms << " p99_ms " << stats.P99Ms << " max_ms " << stats.MaxMs
+        << " swap_ms " << stats.SwapMs << " worst_swap_ms " << stats.WorstSwapMs << " wait_ms " << stats.WaitMs
+        << "\n";
+
+    const std::vector<double>& buckets = GetJitterBuckets();
+    for (size_t i = 0; i < m_Jitter.size(); i++) {
+        out << "frame_pacing_jitter ";
+        if (i < buckets.size()) {
+            out << "up_to_us " << buckets[i];
+        }
+        else {
+            out << "over_us " << buckets.back();
+        }
+        out << " frames " << m_Jitter[i] << "\n";
+    }
+}
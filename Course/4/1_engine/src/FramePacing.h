@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Timing.h"
+
+/*
+        FRAME PACING
+    How often frames reach the screen, and how evenly, is decided by the
+    swap interval (glfwSwapInterval) and by whatever the loop does before
+    the swap. The modes:
+
+    - UNCAPPED (interval 0): as fast as the GPU goes. The most throughput
+      and the least input latency, but frames tear and the GPU never rests.
+    - VSYNC (interval 1): the swap waits for the screen's refresh. No
+      tearing and a steady rate, but the driver may queue frames up, and a
+      frame that misses a refresh waits for the next one (60 drops to 30).
+    - ADAPTIVE (interval -1, with WGL/GLX_EXT_swap_control_tear): like
+      vsync, but a late frame is shown right away, with a tear, instead of
+      waiting a whole refresh. Drivers without it get plain vsync.
+    - LIMITED: interval 0, and the loop itself waits until the frame's
+      deadline before it swaps. For a rate the screen doesn't have, or to
+      save power.
+
+    The limiter can't simply sleep: sleep_for wakes up late, by up to a
+    scheduler tick, and by how much changes from frame to frame. So it
+    sleeps until shortly before the deadline and SPINS for the rest, on the
+    clock, which is exact but keeps a core busy for that short while.
+
+    Whatever the mode, the pacer records the time between one swap and the
+    next, and the JITTER, how much that differs from the frame before. Two
+    modes with the same average can feel very different; the histograms
+    tell them apart.
+*/
+
+enum class PacingMode : uint8_t { Uncapped, Vsync, Adaptive, Limited };
+
+struct FramePacingSettings {
+    PacingMode Mode = PacingMode::Vsync;
+    // Limited only.
+    double TargetFps = 60.0;
+    // Limited only: how long before the deadline the limiter stops sleeping
+    // and spins. 0 sleeps all the way.
+    double SpinMicroseconds = 2000.0;
+};
+
+const char* GetPacingModeName(PacingMode mode);
+
+// "uncapped", "vsync", "adaptive", or a number of frames per second for the
+// limiter. False (and settings untouched) for anything else.
+bool ParsePacingMode(const std::string& text, FramePacingSettings& settings);
+
+// What glfwSwapInterval should get. tearControl: whether the driver has
+// WGL_EXT_swap_control_tear or GLX_EXT_swap_control_tear.
+int GetSwapInterval(PacingMode mode, bool tearControl);
+
+struct FramePacingStats {
+    size_t Frames = 0;
+    // Between the ends of two swaps.
+    double MeanMs = 0.0;
+    double StdDevMs = 0.0;
+    double MinMs = 0.0;
+    double MaxMs = 0.0;
+    double P50Ms = 0.0;
+    double P99Ms = 0.0;
+    // Time spent inside the swap, on average and at worst: how long the
+    // driver held the loop back.
+    double SwapMs = 0.0;
+    double WorstSwapMs = 0.0;
+    // Limited only: time spent waiting for the deadline, on average.
+    double WaitMs = 0.0;
+};
+
+class FramePacer {
+public:
+    explicit FramePacer(const FramePacingSettings& settings);
+
+    // Right before the swap. In Limited mode this waits for the deadline.
+    void BeforeSwap();
+    // Right after the swap.
+    void AfterSwap();
+    // After frames that weren't drawn at all (RedrawTracker.h): the next
+    // swap starts over, so the pause isn't counted as an interval, and the
+    // limiter's next deadline is taken from then.
+    void Restart();
+
+    const FramePacingSettings& GetSettings() const { return m_Settings; }
+    FramePacingStats GetStats() const;
+
+    // Upper bounds of the jitter histogram's buckets in microseconds; the
+    // last bucket has no bound.
+    static const std::vector<double>& GetJitterBuckets();
+    const std::vector<size_t>& GetJitterHistogram() const { return m_Jitter; }
+
+    // "frame_pacing ..." and one "frame_pacing_jitter ..." line per bucket,
+    // like the GPU memory report.
+    void PrintReport(std::ostream& out) const;
+
+private:
+    FramePacingSettings m_Settings;
+    Clock::time_point m_Deadline;
+    Clock::time_point m_SwapStart;
+    Clock::time_point m_LastSwap;
+    bool m_Started = false;
+    double m_LastInterval = -1.0;
+
+    // Intervals in 0.05 ms bins (the percentiles), plus exact sums.
+    std::vector<uint32_t> m_Intervals;
+    size_t m_Frames = 0;
+    double m_Sum = 0.0;
+    double m_SumSquares = 0.0;
+    double m_Min = 0.0;
+    double m_Max = 0.0;
+    double m_SwapSum = 0.0;
+    double m_WorstSwap = 0.0;
+    double m_WaitSum = 0.0;
+    std::vector<size_t> m_Jitter;
+};
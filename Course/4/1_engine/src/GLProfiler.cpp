@@ -0,0 +1,148 @@
+#include "GLProfiler.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "Timing.h"
+
+struct GLCallSite {
+    const char* Call;
+    const char* File;
+    int Line;
+};
+
+struct GLProfile {
+    // Sites and threads come and go under the mutex; the counters don't.
+    std::mutex Mutex;
+    std::vector<GLCallSite> Sites;
+    std::vector<GLSiteCounters*> Threads;
+    std::atomic<uint64_t> Frames{0};
+
+    // Where the last report left off.
+    std::vector<uint64_t> LastCalls;
+    std::vector<uint64_t> LastNanoseconds;
+    uint64_t LastFrames = 0;
+    Clock::time_point Start = Clock::now();
+    Clock::time_point LastReport = Start;
+};
+
+static GLProfile& GetProfile() {
+    static GLProfile profile;
+    return profile;
+}
+
+uint32_t RegisterGLCallSite(const char* call, const char* file, int line) {
+    GLProfile& profile = GetProfile();
+    std::lock_guard<std::mutex> lock(profile.Mutex);
+    if (profile.Sites.size() + 1 < MaxGLCallSites) {
+        profile.Sites.push_back({call, file, line});
+        return (uint32_t)profile.Sites.size() - 1;
+    }
+    if (profile.Sites.size() + 1 == MaxGLCallSites) {
+        profile.Sites.push_back({"(all other call sites)", "", 0});
+    }
+    return MaxGLCallSites - 1;
+}
+
+GLSiteCounters* GetThreadGLCounters() {
+    GLProfile& profile = GetProfile();
+    GLSiteCounters* counters = new GLSiteCounters[MaxGLCallSites];
+    std::lock_guard<std::mutex> lock(profile.Mutex);
+    profile.Threads.push_back(counters);
+    return counters;
+}
+
+bool IsGLProfilerEnabled() {
+#ifdef GL_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+void GLProfilerEndFrame() {
+    GetProfile().Frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+// The sums over all threads. Called with the mutex held.
+static void SumCounters(const GLProfile& profile, std::vector<uint64_t>& calls, std::vector<uint64_t>& nanoseconds) {
+    calls.assign(profile.Sites.size(), 0);
+    nanoseconds.assign(profile.Sites.size(), 0);
+    for (const GLSiteCounters* counters : profile.Threads) {
+        for (size_t site = 0; site < profile.Sites.size(); site++) {
+            calls[site] += counters[site].Calls.load(std::memory_order_relaxed);
+            nanoseconds[site] += counters[site].Nanoseconds.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void GetGLCallSiteTotals(uint32_t site, uint64_t& calls, uint64_t& nanoseconds) {
+    GLProfile& profile = GetProfile();
+    std::lock_guard<std::mutex> lock(profile.Mutex);
+    calls = nanoseconds = 0;
+    for (const GLSiteCounters* counters : profile.Threads) {
+        calls += counters[site].Calls.load(std::memory_order_relaxed);
+        nanoseconds += counters[site].Nanoseconds.load(std::memory_order_relaxed);
+    }
+}
+
+void PrintGLProfile(std::ostream& out, size_t top, bool sinceLastReport) {
+    GLProfile& profile = GetProfile();
+    std::lock_guard<std::mutex> lock(profile.Mutex);
+    if (profile.Sites.empty()) {
+        return;
+    }
+
+    std::vector<uint64_t> calls, nanoseconds;
+    SumCounters(profile, calls, nanoseconds);
+    uint64_t frames = profile.Frames.load(std::memory_order_relaxed);
+    Clock::time_point now = Clock::now();
+    double seconds = Seconds(sinceLastReport ? profile.LastReport : profile.Start, now);
+
+    // Per site, what happened in the window this report covers.
+    std::vector<uint64_t> windowCalls = calls, windowNanoseconds = nanoseconds;
+    uint64_t windowFrames = frames;
+    if (sinceLastReport) {
+        for (size_t site = 0; site < profile.LastCalls.size(); site++) {
+            windowCalls[site] -= profile.LastCalls[site];
+            windowNanoseconds[site] -= profile.LastNanoseconds[site];
+        }
+        windowFrames -= profile.LastFrames;
+        profile.LastCalls = calls;
+        profile.LastNanoseconds = nanoseconds;
+        profile.LastFrames = frames;
+        profile.LastReport = now;
+    }
+
+    std::vector<uint32_t> order;
+    uint64_t totalCalls = 0, totalNanoseconds = 0;
+    for (size_t site = 0; site < windowCalls.size(); site++) {
+        totalCalls += windowCalls[site];
+        totalNanoseconds += windowNanoseconds[site];
+        if (windowCalls[site] > 0) {
+            order.push_back((uint32_t)site);
+        }
+    }
+    // Ties stay in the order the sites were first called, as in
+    // PrintGpuMemoryReport.
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t a, uint32_t b) { return windowNanoseconds[a] > windowNanoseconds[b]; });
+
+    double perFrame = 1.0 / std::max(windowFrames, (uint64_t)1);
+    out << "gl_profile seconds " << seconds << " frames " << windowFrames << " threads " << profile.Threads.size()
+        << " sites " << profile.Sites.size() << " calls_per_frame " << totalCalls * perFrame << " us_per_frame "
+        << totalNanoseconds * perFrame / 1000.0 << "\n";
+    for (size_t rank = 0; rank < order.size() && rank < top; rank++) {
+        uint32_t site = order[rank];
+        const GLCallSite& callSite = profile.Sites[site];
+        out << "gl_profile_call rank " << rank + 1 << " calls_per_frame " << windowCalls[site] * perFrame
+            << " us_per_frame " << windowNanoseconds[site] * perFrame / 1000.0 << " ns_per_call "
+            << windowNanoseconds[site] / windowCalls[site] << " share "
+            << (totalNanoseconds > 0 ? 100.0 * windowNanoseconds[site] / totalNanoseconds : 0.0) << " at "
+            << callSite.File << ":" << callSite.Line << " \"" << callSite.Call << "\"\n";
+    }
+    if (order.size() > top) {
+        out << "gl_profile_call ... " << order.size() - top << " more\n";
+    }
+}
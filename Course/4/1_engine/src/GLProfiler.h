@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "Timing.h"
+
+/*
+        GL CALL PROFILER
+    GLCall already knows which call it wraps (#x), and where (__FILE__,
+    __LINE__). Built with GL_PROFILE defined ("make GL_PROFILE=1"), it also
+    times the call: every GLCall in the source becomes a CALL SITE, and each
+    site counts how often it ran and how long the CPU spent inside the
+    driver for it. That is the submission cost of a frame, call by call, and
+    the few lines at the top of the table are where to start optimizing.
+
+    The counting must cost next to nothing and must not serialize the
+    threads that call GL. So every thread has counters of its own, one pair
+    per site, which only that thread ever writes: no locks, and no atomic
+    read-modify-write either, just a relaxed load and store. The report
+    reads all threads' counters (relaxed loads, so a number may be a call
+    behind) and adds them up. A thread's counters are made the first time it
+    makes a call and kept until the program ends, so a report never reads
+    freed memory.
+
+    Without GL_PROFILE, GLCall is what it always was, and the report has
+    nothing to say.
+*/
+
+// A site's place in every thread's counters. Thread safe; the first
+// MaxGLCallSites sites get a place of their own, the rest share the last.
+uint32_t RegisterGLCallSite(const char* call, const char* file, int line);
+
+static const uint32_t MaxGLCallSites = 2048;
+
+struct GLSiteCounters {
+    std::atomic<uint64_t> Calls{0};
+    std::atomic<uint64_t> Nanoseconds{0};
+};
+
+// This thread's counters, made on first use.
+GLSiteCounters* GetThreadGLCounters();
+
+// Times its scope and books it to a site of the calling thread.
+class GLCallTimer {
+public:
+    explicit GLCallTimer(uint32_t site) : m_Site(site), m_Start(Clock::now()) {}
+    ~GLCallTimer() {
+        uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_Start).count();
+        thread_local GLSiteCounters* counters = GetThreadGLCounters();
+        GLSiteCounters& site = counters[m_Site];
+        // Only this thread writes these, so this is not a race, only not a
+        // single instruction.
+        site.Calls.store(site.Calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        site.Nanoseconds.store(site.Nanoseconds.load(std::memory_order_relaxed) + nanoseconds,
+                               std::memory_order_relaxed);
+    }
+
+    GLCallTimer(const GLCallTimer&) = delete;
+    GLCallTimer& operator=(const GLCallTimer&) = delete;
+
+private:
+    uint32_t m_Site;
+    Clock::time_point m_Start;
+};
+
+// True when built with GL_PROFILE.
+bool IsGLProfilerEnabled();
+
+// Once per frame, from the render thread: the frames the per-frame numbers
+// are divided by.
+void GLProfilerEndFrame();
+
+// The top sites by time: since the last PrintGLProfile(out, top, true) (for
+// a report every second), or since the start. "gl_profile ..." and one
+// "gl_profile_call ..." line per site. Nothing without GL_PROFILE.
+void PrintGLProfile(std::ostream& out, size_t top, bool sinceLastReport);
+
+// Totals of one site over all threads, for tests.
+void GetGLCallSiteTotals(uint32_t site, uint64_t& calls, uint64_t& nanoseconds);
@@ -0,0 +1,313 @@
+#include "GLReport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "Timing.h"
+
+// New messages written per second; more are only counted.
+static const size_t MAX_NEW_PER_SECOND = 20;
+// Lines waiting for the writer; more are only counted.
+static const size_t MAX_QUEUED = 256;
+// How often the writer sums up the repeats.
+static const double REPEAT_INTERVAL = 1.0;
+// Messages in the summary, the most frequent first.
+static const size_t SUMMARY_TOP = 20;
+
+struct MessageKey {
+    GLMessageSource Source;
+    uint32_t Id;
+    std::string File;
+    int Line;
+
+    bool operator<(const MessageKey& other) const {
+        return std::tie(Source, Id, File, Line) < std::tie(other.Source, other.Id, other.File, other.Line);
+    }
+};
+
+struct MessageEntry {
+    std::string Text;
+    size_t Count = 0;
+    // Count when the writer last wrote about it.
+    size_t Written = 0;
+};
+
+struct Reporter {
+    std::mutex Mutex;
+    std::condition_variable Wake;
+    std::condition_variable Done;
+    std::map<MessageKey, MessageEntry> Messages;
+    std::vector<std::string> Queue;
+    std::ostream* Sink = &std::cerr;
+    std::thread Writer;
+    bool Running = false;
+    bool Stopping = false;
+    // Lines queued and lines written so far, for FlushGLReports.
+    uint64_t Queued = 0;
+    uint64_t Flushed = 0;
+    Clock::time_point WindowStart = Clock::now();
+    size_t NewInWindow = 0;
+    GLReportStats Stats;
+
+    ~Reporter() {
+        // Whoever forgot StopGLReporting, the thread must not outlive us.
+        std::unique_lock<std::mutex> lock(Mutex);
+        if (Running) {
+            Stopping = true;
+            Wake.notify_all();
+            lock.unlock();
+            Writer.join();
+        }
+    }
+};
+
+static Reporter& GetReporter() {
+    static Reporter reporter;
+    return reporter;
+}
+
+static const char* GetSourceName(GLMessageSource source) {
+    switch (source) {
+        case GLMessageSource::Error: return "error";
+        case GLMessageSource::Debug: return "debug";
+        case GLMessageSource::Shader: return "shader";
+    }
+    return "?";
+}
+
+// "text (source at file:line)", the line a message is first written with;
+// with a count when it came more than once before that.
+static std::string FormatFirstLine(const MessageKey& key, const std::string& text, size_t count) {
+    std::stringstream line;
+    line << text << " (" << GetSourceName(key.Source) << " at " << key.File << ":" << key.Line;
+    if (count > 1) {
+        line << ", " << count << " times";
+    }
+    line << ")\n";
+    return line.str();
+}
+
+// The "repeated" lines of everything that came again since it was last
+// written about. A message the limits kept back was never written; it gets
+// its first line now. Called with the mutex held.
+static void QueueRepeats(Reporter& reporter, std::vector<std::string>& lines) {
+    for (auto& message : reporter.Messages) {
+        MessageEntry& entry = message.second;
+        if (entry.Written == 0) {
+            lines.push_back(FormatFirstLine(message.first, entry.Text, entry.Count));
+            entry.Written = entry.Count;
+        }
+        else if (entry.Count > entry.Written) {
+            std::stringstream line;
+            line << "(" << GetSourceName(message.first.Source) << " at " << message.first.File << ":"
+                 << message.first.Line << " repeated " << entry.Count - entry.Written << " times, " << entry.Count
+                 << " in all)\n";
+            lines.push_back(line.str());
+            entry.Written = entry.Count;
+        }
+    }
+}
+
+static void WriterThread(Reporter& reporter) {
+    std::unique_lock<std::mutex> lock(reporter.Mutex);
+    Clock::time_point lastRepeats = Clock::now();
+    for (;;) {
+        reporter.Wake.wait_for(lock, std::chrono::duration<double>(REPEAT_INTERVAL),
+                               [&] { return reporter.Stopping || !reporter.Queue.empty(); });
+        std::vector<std::string> lines;
+        lines.swap(reporter.Queue);
+        uint64_t queued = reporter.Queued;
+        if (reporter.Stopping || Clock::now() - lastRepeats >= std::chrono::duration<double>(REPEAT_INTERVAL)) {
+            QueueRepeats(reporter, lines);
+            lastRepeats = Clock::now();
+        }
+        reporter.Stats.Written += lines.size();
+        std::ostream& out = *reporter.Sink;
+        bool stopping = reporter.Stopping;
+
+        // The writing itself without the lock, so nobody reporting waits
+        // for the stream.
+        lock.unlock();
+        for (const std::string& line : lines) {
+            out << line;
+        }
+        if (!lines.empty()) {
+            out.flush();
+        }
+        lock.lock();
+
+        reporter.Flushed = queued;
+        reporter.Done.notify_all();
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+bool ReportGLMessage(GLMessageSource source, uint32_t id, const char* file, int line, const std::string& text) {
+    Reporter& reporter = GetReporter();
+    std::lock_guard<std::mutex> lock(reporter.Mutex);
+    reporter.Stats.Reported++;
+    MessageKey key = {source, id, file, line};
+    MessageEntry& entry = reporter.Messages[key];
+    entry.Count++;
+    if (entry.Count > 1) {
+        return false;
+    }
+    entry.Text = text;
+    reporter.Stats.Messages++;
+
+    Clock::time_point now = Clock::now();
+    if (now - reporter.WindowStart >= std::chrono::seconds(1)) {
+        reporter.WindowStart = now;
+        reporter.NewInWindow = 0;
+    }
+    // A GLCall traps right after its error, so the error can't wait for the
+    // repeats; the limits are for the driver's debug messages.
+    bool limited = source != GLMessageSource::Error;
+    if (limited && (reporter.NewInWindow >= MAX_NEW_PER_SECOND || reporter.Queue.size() >= MAX_QUEUED)) {
+        // It still shows up in the repeats and the summary.
+        reporter.Stats.Suppressed++;
+        return false;
+    }
+    if (limited) {
+        reporter.NewInWindow++;
+    }
+    // Written as a first time, the later ones are the repeats.
+    entry.Written = 1;
+
+    reporter.Queue.push_back(FormatFirstLine(key, text, 1));
+    reporter.Queued++;
+    if (!reporter.Running) {
+        reporter.Running = true;
+        reporter.Stopping = false;
+        reporter.Writer = std::thread(WriterThread, std::ref(reporter));
+    }
+    reporter.Wake.notify_one();
+    return true;
+}
+
+void FlushGLReports() {
+    Reporter& reporter = GetReporter();
+    std::unique_lock<std::mutex> lock(reporter.Mutex);
+    uint64_t target = reporter.Queued;
+    reporter.Done.wait(lock, [&] { return !reporter.Running || reporter.Flushed >= target; });
+}
+
+void SetGLReportSink(std::ostream& out) {
+    Reporter& reporter = GetReporter();
+    std::lock_guard<std::mutex> lock(reporter.Mutex);
+    reporter.Sink = &out;
+}
+
+static const char* GetDebugSourceName(GLenum source) {
+    switch (source) {
+        case GL_DEBUG_SOURCE_API: return "api";
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+        case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+        case GL_DEBUG_SOURCE_APPLICATION: return "application";
+        default: return "other";
+    }
+}
+
+static void GLAPIENTRY OnDebugMessage(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                      const GLchar* message, const void*) {
+    if (severity == GL_DEBUG_SEVERITY_NOTIFICATION) {
+        return;
+    }
+    const char* typeName = type == GL_DEBUG_TYPE_ERROR                 ? "error"
+                           : type == GL_DEBUG_TYPE_PERFORMANCE         ? "performance"
+                           : type == GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR ? "deprecated"
+                           : type == GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR  ? "undefined behavior"
+                                                                       : "other";
+    const char* severityName = severity == GL_DEBUG_SEVERITY_HIGH     ? "high"
+                               : severity == GL_DEBUG_SEVERITY_MEDIUM ? "medium"
+                                                                      : "low";
+    std::string text = std::string("OpenGL ") + typeName + " (" + severityName + "): ";
+    text.append(message, length >= 0 ? (size_t)length : std::strlen(message));
+    // No call site in a callback; the debug source stands in for it.
+    ReportGLMessage(GLMessageSource::Debug, id, GetDebugSourceName(source), 0, text);
+}
+
+void EnableGLDebugOutput() {
+    if (!GLEW_KHR_debug && !GLEW_VERSION_4_3) {
+        return;
+    }
+    glEnable(GL_DEBUG_OUTPUT);
+    glDebugMessageCallback(OnDebugMessage, nullptr);
+}
+
+const char* GetGLErrorName(GLenum error) {
+    switch (error) {
+        case GL_INVALID_ENUM: return "GL_INVALID_ENUM";
+        case GL_INVALID_VALUE: return "GL_INVALID_VALUE";
+        case GL_INVALID_OPERATION: return "GL_INVALID_OPERATION";
+        case GL_STACK_OVERFLOW: return "GL_STACK_OVERFLOW";
+        case GL_STACK_UNDERFLOW: return "GL_STACK_UNDERFLOW";
+        case GL_OUT_OF_MEMORY: return "GL_OUT_OF_MEMORY";
+        case GL_INVALID_FRAMEBUFFER_OPERATION: return "GL_INVALID_FRAMEBUFFER_OPERATION";
+        default: return "unknown error";
+    }
+}
+
+GLReportStats GetGLReportStats() {
+    Reporter& reporter = GetReporter();
+    std::lock_guard<std::mutex> lock(reporter.Mutex);
+    return reporter.Stats;
+}
+
+void PrintGLReportSummary(std::ostream& out) {
+    Reporter& reporter = GetReporter();
+    std::lock_guard<std::mutex> lock(reporter.Mutex);
+    out << "gl_report reported " << reporter.Stats.Reported << " messages " << reporter.Stats.Messages << " written "
+        << reporter.Stats.Written << " suppressed " << reporter.Stats.Suppressed << "\n";
+    std::vector<const std::pair<const MessageKey, MessageEntry>*> order;
+    for (const auto& message : reporter.Messages) {
+        order.push_back(&message);
+    }
+    // Ties stay in key order, as in PrintGpuMemoryReport.
+    std::stable_sort(order.begin(), order.end(),
+                     [](const auto* a, const auto* b) { return a->second.Count > b->second.Count; });
+    for (size_t rank = 0; rank < order.size() && rank < SUMMARY_TOP; rank++) {
+        const MessageKey& key = order[rank]->first;
+        const MessageEntry& entry = order[rank]->second;
+        out << "gl_report_message " << GetSourceName(key.Source) << " id " << key.Id << " at " << key.File << ":"
+            << key.Line << " count " << entry.Count << " \"" << entry.Text << "\"\n";
+    }
+    if (order.size() > SUMMARY_TOP) {
+        out << "gl_report_message ... " << order.size() - SUMMARY_TOP << " more\n";
+    }
+}
+
+void StopGLReporting() {
+    Reporter& reporter = GetReporter();
+    {
+        std::unique_lock<std::mutex> lock(reporter.Mutex);
+        if (!reporter.Running) {
+            return;
+        }
+        reporter.Stopping = true;
+        reporter.Wake.notify_all();
+    }
+    reporter.Writer.join();
+
+    std::ostream* sink;
+    {
+        std::lock_guard<std::mutex> lock(reporter.Mutex);
+        reporter.Running = false;
+        reporter.Stopping = false;
+        sink = reporter.Sink;
+    }
+    PrintGLReportSummary(*sink);
+    sink->flush();
+}
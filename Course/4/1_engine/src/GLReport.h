@@ -0,0 +1,72 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/*
+        GL ERROR AND DEBUG MESSAGE REPORTING
+    LogCall used to write every error straight to std::cerr with std::endl.
+    An error inside the render loop then comes every frame, and every one
+    of them is a write and a flush of stderr, on the render thread: the
+    frame rate goes down exactly when we'd like to look at what is wrong.
+
+    Everything the GL tells us now goes through one place:
+    - DEDUPLICATED by (source, id, call site): the same error from the same
+      GLCall is one message, however often it happens. The first time it
+      is written out in full.
+    - RATE LIMITED: after that, at most one line per message and second,
+      "repeated N times", and at most MAX_NEW_PER_SECOND new messages a
+      second; whatever is over is only counted. Not for new glGetError
+      errors: the ASSERT of their GLCall traps right after, so a held back
+      one would never be written. There's one per call site at most anyway.
+    - ASYNCHRONOUS: the calling thread only updates the counts and queues
+      the text. A writer thread does the writing (and the flushing), to
+      std::cerr or any other stream.
+    - SUMMED UP at shutdown: every message with how often it came.
+
+    The sources are glGetError (from GLCall), the KHR_debug callback (what
+    the driver has to say, EnableGLDebugOutput) and the shader compiler.
+*/
+
+enum class GLMessageSource : uint8_t { Error, Debug, Shader };
+
+struct GLReportStats {
+    // Every call of ReportGLMessage, and how many different messages.
+    size_t Reported = 0;
+    size_t Messages = 0;
+    // Lines the writer wrote: first times and "repeated" lines.
+    size_t Written = 0;
+    // First times over the rate limit or the queue, only counted.
+    size_t Suppressed = 0;
+};
+
+// Thread safe, never writes itself. file and line are the call site (file
+// may be any name that tells sites apart, it's copied). True if the message
+// is new and queued; FlushGLReports then waits until it is written.
+bool ReportGLMessage(GLMessageSource source, uint32_t id, const char* file, int line, const std::string& text);
+
+// Waits until everything reported so far was written and flushed.
+void FlushGLReports();
+
+// Where the writer writes, std::cerr by default. The stream must live
+// until StopGLReporting().
+void SetGLReportSink(std::ostream& out);
+
+// Sends the driver's debug messages (KHR_debug, core in 4.3) here, all but
+// the notifications. Most drivers only say much in a debug context.
+void EnableGLDebugOutput();
+
+const char* GetGLErrorName(GLenum error);
+
+GLReportStats GetGLReportStats();
+
+// "gl_report ..." and a "gl_report_message ..." line for each of the most
+// frequent messages.
+void PrintGLReportSummary(std::ostream& out);
+
+// Writes what is left and the summary (if anything was reported) to the
+// sink and stops the writer. Reporting after that starts it again.
+void StopGLReporting();
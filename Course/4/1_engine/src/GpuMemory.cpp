@@ -0,0 +1,227 @@
+#include "GpuMemory.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+struct TrackedAllocation {
+    MemoryCategory Category;
+    std::string Label;
+    size_t Bytes;
+    bool Live;
+};
+
+struct Books {
+    std::mutex Mutex;
+    // Index + 1 is the id. Released entries are reused.
+    std::vector<TrackedAllocation> Allocations;
+    std::vector<uint32_t> FreeIds;
+    MemoryUsage Usage[(int)MemoryCategory::Count];
+    size_t TotalBytes = 0;
+    size_t TotalPeakBytes = 0;
+    std::function<void(size_t)> OnOverBudget[(int)MemoryCategory::Count];
+    DriverMemoryInfo LastDriverInfo;
+    std::string ReportPath;
+    bool ReportAtExit = false;
+};
+
+// Never destroyed, so allocations released by static destructors after
+// main() still find it.
+static Books& GetBooks() {
+    static Books* books = new Books();
+    return *books;
+}
+
+const char* GetCategoryName(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::Geometry: return "geometry";
+        case MemoryCategory::Textures: return "textures";
+        case MemoryCategory::ShaderData: return "shader_data";
+        case MemoryCategory::RenderTargets: return "render_targets";
+        case MemoryCategory::Staging: return "staging";
+        case MemoryCategory::Programs: return "programs";
+        case MemoryCategory::Other: return "other";
+        case MemoryCategory::Count: break;
+    }
+    return "?";
+}
+
+uint32_t TrackGpuMemory(MemoryCategory category, const std::string& label, size_t bytes) {
+    Books& books = GetBooks();
+    std::function<void(size_t)> onOverBudget;
+    size_t excess = 0;
+    uint32_t id;
+    {
+        std::lock_guard<std::mutex> lock(books.Mutex);
+        if (!books.FreeIds.empty()) {
+            id = books.FreeIds.back();
+            books.FreeIds.pop_back();
+            books.Allocations[id - 1] = {category, label, bytes, true};
+        }
+        else {
+            books.Allocations.push_back({category, label, bytes, true});
+            id = (uint32_t)books.Allocations.size();
+        }
+
+        MemoryUsage& usage = books.Usage[(int)category];
+        usage.Bytes += bytes;
+        usage.Allocations++;
+        usage.PeakBytes = std::max(usage.PeakBytes, usage.Bytes);
+        books.TotalBytes += bytes;
+        books.TotalPeakBytes = std::max(books.TotalPeakBytes, books.TotalBytes);
+
+        if (usage.BudgetBytes > 0 && usage.Bytes > usage.BudgetBytes && books.OnOverBudget[(int)category]) {
+            excess = usage.Bytes - usage.BudgetBytes;
+            onOverBudget = books.OnOverBudget[(int)category];
+            usage.Evictions++;
+        }
+    }
+
+    // Outside of the lock: the callback will release memory.
+    if (onOverBudget) {
+        onOverBudget(excess);
+    }
+    return id;
+}
+
+void ReleaseGpuMemory(uint32_t id) {
+    Books& books = GetBooks();
+    std::lock_guard<std::mutex> lock(books.Mutex);
+    if (id == 0 || id > books.Allocations.size() || !books.Allocations[id - 1].Live) {
+        return;
+    }
+
+    TrackedAllocation& allocation = books.Allocations[id - 1];
+    MemoryUsage& usage = books.Usage[(int)allocation.Category];
+    usage.Bytes -= allocation.Bytes;
+    usage.Allocations--;
+    books.TotalBytes -= allocation.Bytes;
+    allocation.Live = false;
+    allocation.Label.clear();
+    books.FreeIds.push_back(id);
+}
+
+void SetGpuMemoryBudget(MemoryCategory category, size_t bytes, std::function<void(size_t excessBytes)> onOverBudget) {
+    Books& books = GetBooks();
+    std::lock_guard<std::mutex> lock(books.Mutex);
+    books.Usage[(int)category].BudgetBytes = bytes;
+    books.OnOverBudget[(int)category] = std::move(onOverBudget);
+}
+
+MemoryUsage GetGpuMemoryUsage(MemoryCategory category) {
+    Books& books = GetBooks();
+    std::lock_guard<std::mutex> lock(books.Mutex);
+    return books.Usage[(int)category];
+}
+
+MemoryUsage GetTotalGpuMemoryUsage() {
+    Books& books = GetBooks();
+    std::lock_guard<std::mutex> lock(books.Mutex);
+    MemoryUsage total;
+    for (const MemoryUsage& usage : books.Usage) {
+        total.Allocations += usage.Allocations;
+        total.BudgetBytes += usage.BudgetBytes;
+        total.Evictions += usage.Evictions;
+    }
+    total.Bytes = books.TotalBytes;
+    total.PeakBytes = books.TotalPeakBytes;
+    return total;
+}
+
+DriverMemoryInfo QueryDriverMemory() {
+    DriverMemoryInfo info;
+    if (GLEW_NVX_gpu_memory_info) {
+        GLint total = 0, available = 0, evicted = 0;
+        glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &total);
+        glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &available);
+        glGetIntegerv(GL_GPU_MEMORY_INFO_EVICTED_MEMORY_NVX, &evicted);
+        info = {true, "GL_NVX_gpu_memory_info", (size_t)total, (size_t)available, (size_t)evicted};
+    }
+    else if (GLEW_ATI_meminfo) {
+        // Free memory in the texture pool, largest free block, then the same
+        // for auxiliary (system) memory. There is no total.
+        GLint free[4] = {};
+        glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, free);
+        info = {true, "GL_ATI_meminfo", 0, (size_t)free[0], 0};
+    }
+
+    Books& books = GetBooks();
+    std::lock_guard<std::mutex> lock(books.Mutex);
+    books.LastDriverInfo = info;
+    return info;
+}
+
+void PrintGpuMemoryReport(std::ostream& out, size_t maxLabels) {
+    Books& books = GetBooks();
+    std::lock_guard<std::mutex> lock(books.Mutex);
+
+    out << "gpu_memory total bytes " << books.TotalBytes << " peak " << books.TotalPeakBytes << "\n";
+    for (int category = 0; category < (int)MemoryCategory::Count; category++) {
+        const MemoryUsage& usage = books.Usage[category];
+        out << "gpu_memory " << GetCategoryName((MemoryCategory)category) << " bytes " << usage.Bytes << " peak "
+            << usage.PeakBytes << " allocations " << usage.Allocations;
+        if (usage.BudgetBytes > 0) {
+            out << " budget " << usage.BudgetBytes << " evictions " << usage.Evictions;
+        }
+        out << "\n";
+    }
+
+    std::map<std::pair<int, std::string>, size_t> labels;
+    for (const TrackedAllocation& allocation : books.Allocations) {
+        if (allocation.Live) {
+            labels[{(int)allocation.Category, allocation.Label}] += allocation.Bytes;
+        }
+    }
+    std::vector<std::pair<size_t, std::pair<int, std::string>>> largest;
+    for (const auto& label : labels) {
+        largest.push_back({label.second, label.first});
+    }
+    // Stable, so equal sizes stay in label order and two reports can be diffed.
+    std::stable_sort(largest.begin(), largest.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (size_t i = 0; i < largest.size() && i < maxLabels; i++) {
+        out << "gpu_memory_label " << GetCategoryName((MemoryCategory)largest[i].second.first) << " \""
+            << largest[i].second.second << "\" bytes " << largest[i].first << "\n";
+    }
+    if (largest.size() > maxLabels) {
+        out << "gpu_memory_label ... " << largest.size() - maxLabels << " more\n";
+    }
+
+    const DriverMemoryInfo& driver = books.LastDriverInfo;
+    if (driver.Known) {
+        out << "gpu_memory_driver " << driver.Source << " total_kb " << driver.TotalKB << " available_kb "
+            << driver.AvailableKB << " evicted_kb " << driver.EvictedKB << "\n";
+    }
+}
+
+static void ReportAtExit() {
+    Books& books = GetBooks();
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(books.Mutex);
+        path = books.ReportPath;
+    }
+    if (path.empty()) {
+        PrintGpuMemoryReport(std::cout);
+        return;
+    }
+    std::ofstream file(path);
+    PrintGpuMemoryReport(file);
+}
+
+void SetGpuMemoryReportAtExit(const std::string& filepath) {
+    Books& books = GetBooks();
+    bool registered;
+    {
+        std::lock_guard<std::mutex> lock(books.Mutex);
+        books.ReportPath = filepath;
+        registered = books.ReportAtExit;
+        books.ReportAtExit = true;
+    }
+    if (!registered) {
+        std::atexit(ReportAtExit);
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+
+/*
+        GPU MEMORY ACCOUNTING
+    glNamedBufferStorage and glTextureStorage2D don't tell anybody how much
+    memory they took, and OpenGL itself has no call that asks. So we keep
+    the books ourselves: every place that allocates GPU memory reports the
+    bytes, with a category and a label (the same debug name the object gets
+    in ResourcePool.h), and reports them again when the object goes.
+
+    From that we know, per category, the bytes alive right now, the high
+    water mark and the number of allocations, and per label where the bytes
+    went. The numbers are what we asked for; drivers add padding, alignment
+    and copies of their own on top.
+
+    What the driver itself says, if it says anything: NVIDIA has
+    GL_NVX_gpu_memory_info (total, available, evicted), AMD has
+    GL_ATI_meminfo (free memory per pool). Mesa's software renderer has
+    neither, so QueryDriverMemory() may well return nothing.
+
+    A category can get a BUDGET. When an allocation pushes the category over
+    it, the category's eviction callback is told by how much, and is
+    expected to free something (and report that). Tracking never refuses an
+    allocation; what to give up is the callback's call.
+
+    PrintGpuMemoryReport() writes everything in a fixed "key value" format,
+    on demand or at exit (SetGpuMemoryReportAtExit), so a CI run can compare
+    peaks against the last one.
+*/
+
+enum class MemoryCategory : uint8_t {
+    Geometry,
+    Textures,
+    // Uniform and storage buffers: parameters, instances, particles...
+    ShaderData,
+    // Textures drawn into, like the render graph's (RenderGraph.h).
+    RenderTargets,
+    // Buffers that carry data to other objects (PBOs...).
+    Staging,
+    // The size of the program binaries, as an estimate.
+    Programs,
+    Other,
+    Count
+};
+
+const char* GetCategoryName(MemoryCategory category);
+
+struct MemoryUsage {
+    size_t Bytes = 0;
+    size_t PeakBytes = 0;
+    size_t Allocations = 0;
+    // 0 means no budget.
+    size_t BudgetBytes = 0;
+    // How often the eviction callback ran.
+    size_t Evictions = 0;
+};
+
+// Records bytes of GPU memory. Returns an id for ReleaseGpuMemory. Thread safe.
+uint32_t TrackGpuMemory(MemoryCategory category, const std::string& label, size_t bytes);
+// The id from TrackGpuMemory; 0 is ignored.
+void ReleaseGpuMemory(uint32_t id);
+
+// 0 removes the budget. onOverBudget gets the bytes over budget and runs on
+// the thread that allocated, after the allocation was recorded.
+void SetGpuMemoryBudget(MemoryCategory category, size_t bytes,
+                        std::function<void(size_t excessBytes)> onOverBudget = nullptr);
+
+MemoryUsage GetGpuMemoryUsage(MemoryCategory category);
+// Summed over all categories (the peak is the peak of the sum).
+MemoryUsage GetTotalGpuMemoryUsage();
+
+struct DriverMemoryInfo {
+    // False if the driver has neither extension.
+    bool Known = false;
+    const char* Source = "";
+    size_t TotalKB = 0;
+    size_t AvailableKB = 0;
+    // NVX only: how much the driver had to move out of video memory.
+    size_t EvictedKB = 0;
+};
+
+// Needs a current context.
+DriverMemoryInfo QueryDriverMemory();
+
+// Totals per category, then the largest live labels (labels with the same
+// name are summed), then what the driver said the last time it was asked.
+void PrintGpuMemoryReport(std::ostream& out, size_t maxLabels = 20);
+
+// Also prints the report when the program exits: to the file if one is
+// given, to std::cout if the path is empty.
+void SetGpuMemoryReportAtExit(const std::string& filepath);
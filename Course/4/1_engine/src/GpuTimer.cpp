@@ -0,0 +1,48 @@
+#include "GpuTimer.h"
+
+#include "Renderer.h"
+
+GpuTimer::GpuTimer() {
+    GLCall(glCreateQueries(GL_TIME_ELAPSED, QUERY_COUNT, m_Queries));
+}
+
+GpuTimer::~GpuTimer() {
+    GLCall(glDeleteQueries(QUERY_COUNT, m_Queries));
+}
+
+void GpuTimer::Begin() {
+    if (m_Pending == QUERY_COUNT) {
+        m_Skipped++;
+        return;
+    }
+    GLCall(glBeginQuery(GL_TIME_ELAPSED, m_Queries[(m_Oldest + m_Pending) % QUERY_COUNT]));
+    m_Running = true;
+}
+
+void GpuTimer::End() {
+    if (!m_Running) {
+        return;
+    }
+    GLCall(glEndQuery(GL_TIME_ELAPSED));
+    m_Running = false;
+    m_Pending++;
+}
+
+bool GpuTimer::Poll(double& milliseconds) {
+    bool found = false;
+    while (m_Pending > 0) {
+        GLuint query = m_Queries[m_Oldest];
+        GLint available = 0;
+        GLCall(glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available));
+        if (!available) {
+            break;
+        }
+        GLuint64 nanoseconds = 0;
+        GLCall(glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds));
+        milliseconds = nanoseconds / 1e6;
+        found = true;
+        m_Oldest = (m_Oldest + 1) % QUERY_COUNT;
+        m_Pending--;
+    }
+    return found;
+}
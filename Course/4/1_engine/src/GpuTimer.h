@@ -0,0 +1,50 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+/*
+        GPU TIMERS
+    The CPU time of a frame says little about the GPU: glDrawArrays returns
+    long before anything is drawn. A TIMER QUERY (GL_TIME_ELAPSED) measures
+    what the GPU spent between glBeginQuery and glEndQuery.
+
+    The answer only exists once the GPU got there, a frame or two later.
+    Asking for it right away (GL_QUERY_RESULT) would wait for the GPU and
+    throw away all the overlap between CPU and GPU. So the timer has a RING
+    of queries: every frame uses the next one, and Poll() only reads those
+    whose GL_QUERY_RESULT_AVAILABLE says they are done. If the GPU is so far
+    behind that the ring is full, that frame simply isn't measured.
+*/
+
+class GpuTimer {
+public:
+    GpuTimer();
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    // Around the GPU work to measure. Timer queries can't be nested.
+    void Begin();
+    void End();
+
+    // The newest finished measurement (older finished ones are dropped).
+    // False if none finished since the last call.
+    bool Poll(double& milliseconds);
+
+    // Frames not measured because all queries were still in flight.
+    size_t GetSkipped() const { return m_Skipped; }
+
+private:
+    // Enough for the GPU to be 3 frames behind.
+    static const int QUERY_COUNT = 4;
+
+    GLuint m_Queries[QUERY_COUNT];
+    // Issued but not read yet, oldest first from m_Oldest.
+    int m_Oldest = 0;
+    int m_Pending = 0;
+    bool m_Running = false;
+    size_t m_Skipped = 0;
+};
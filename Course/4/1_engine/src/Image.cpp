@@ -0,0 +1,428 @@
+#include "Image.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+enum class ImageFormat {
+    Unknown,
+    TGA,
+    PPM
+};
+
+struct TGAHeader {
+    int ImageType;
+    int Width;
+    int Height;
+    int BitsPerPixel;
+    bool TopToBottom;
+    size_t PixelOffset;
+};
+
+static bool ParseTGA(const unsigned char* data, size_t size, TGAHeader& header) {
+    if (size < 18) {
+        return false;
+    }
+
+    header.ImageType = data[2];
+    header.Width = data[12] | (data[13] << 8);
+    header.Height = data[14] | (data[15] << 8);
+    header.BitsPerPixel = data[16];
+    // Bit 5 of the descriptor says the first row in the file is the top one.
+    header.TopToBottom = (data[17] & 0x20) != 0;
+    // Skip the optional image ID and color map.
+    header.PixelOffset = 18 + data[0] + (data[1] ? (data[5] | (data[6] << 8)) * ((data[7] + 7) / 8) : 0);
+
+    return (header.ImageType == 2 || header.ImageType == 10) &&
+           (header.BitsPerPixel == 24 || header.BitsPerPixel == 32) &&
+           header.Width > 0 && header.Height > 0 && header.PixelOffset <= size;
+}
+
+// Reads the next whitespace separated number of a PPM header (skipping comments).
+static bool ReadPPMNumber(const unsigned char* data, size_t size, size_t& position, int& value) {
+    while (position < size) {
+        if (data[position] == '#') {
+            while (position < size && data[position] != '\n') {
+                position++;
+            }
+        }
+        else if (data[position] == ' ' || data[position] == '\t' || data[position] == '\n' || data[position] == '\r') {
+            position++;
+        }
+        else {
+            break;
+        }
+    }
+
+    value = 0;
+    size_t start = position;
+    while (position < size && data[position] >= '0' && data[position] <= '9') {
+        value = value * 10 + (data[position] - '0');
+        position++;
+    }
+    return position > start;
+}
+
+static bool ParsePPM(const unsigned char* data, size_t size, ImageInfo& info, size_t& pixelOffset) {
+    size_t position = 2;
+    int maxValue;
+    if (!ReadPPMNumber(data, size, position, info.Width) ||
+        !ReadPPMNumber(data, size, position, info.Height) ||
+        !ReadPPMNumber(data, size, position, maxValue) ||
+        maxValue != 255 || position >= size) {
+        return false;
+    }
+
+    // Exactly one whitespace character separates the header from the pixels.
+    pixelOffset = position + 1;
+    return info.Width > 0 && info.Height > 0 && pixelOffset + (size_t)info.Width * info.Height * 3 <= size;
+}
+
+static ImageFormat DetectFormat(const unsigned char* data, size_t size) {
+    if (size >= 2 && data[0] == 'P' && data[1] == '6') {
+        return ImageFormat::PPM;
+    }
+    // TGA has no magic number, so it's whatever is left.
+    return ImageFormat::TGA;
+}
+
+bool ReadImageInfo(const unsigned char* data, size_t size, ImageInfo& info) {
+    switch (DetectFormat(data, size)) {
+        case ImageFormat::PPM: {
+            size_t pixelOffset;
+            return ParsePPM(data, size, info, pixelOffset);
+        }
+        case ImageFormat::TGA: {
+            TGAHeader header;
+            if (!ParseTGA(data, size, header)) {
+                return false;
+            }
+            info.Width = header.Width;
+            info.Height = header.Height;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static bool DecodeTGA(const unsigned char* data, size_t size, unsigned char* rgba) {
+    TGAHeader header;
+    if (!ParseTGA(data, size, header)) {
+        return false;
+    }
+
+    const int bytesPerPixel = header.BitsPerPixel / 8;
+    const size_t pixelCount = (size_t)header.Width * header.Height;
+    const unsigned char* src = data + header.PixelOffset;
+    const unsigned char* end = data + size;
+
+    // TGA stores BGR(A). We write pixels in file order and flip rows at the end if needed.
+    auto writePixel = [&](size_t index, const unsigned char* bgra) {
+        unsigned char* dst = rgba + index * 4;
+        dst[0] = bgra[2];
+        dst[1] = bgra[1];
+        dst[2] = bgra[0];
+        dst[3] = bytesPerPixel == 4 ? bgra[3] : 255;
+    };
+
+    if (header.ImageType == 2) {
+        if ((size_t)(end - src) < pixelCount * bytesPerPixel) {
+            return false;
+        }
+        for (size_t i = 0; i < pixelCount; i++) {
+            writePixel(i, src + i * bytesPerPixel);
+        }
+    }
+    else {
+        // RLE: every packet starts with a byte. If the top bit is set, the next
+        // pixel is repeated (count + 1) times, otherwise (count + 1) raw pixels follow.
+        size_t i = 0;
+        while (i < pixelCount) {
+            if (src >= end) {
+                return false;
+            }
+            unsigned char packet = *src++;
+            size_t count = (packet & 0x7F) + 1;
+            if (i + count > pixelCount) {
+                return false;
+            }
+
+            if (packet & 0x80) {
+                if (end - src < bytesPerPixel) {
+                    return false;
+                }
+                for (size_t k = 0; k < count; k++) {
+                    writePixel(i++, src);
+                }
+                src += bytesPerPixel;
+            }
+            else {
+                if ((size_t)(end - src) < count * bytesPerPixel) {
+                    return false;
+                }
+                for (size_t k = 0; k < count; k++) {
+                    writePixel(i++, src);
+                    src += bytesPerPixel;
+                }
+            }
+        }
+    }
+
+    if (header.TopToBottom) {
+        const size_t rowBytes = (size_t)header.Width * 4;
+        unsigned char* top = rgba;
+        unsigned char* bottom = rgba + (header.Height - 1) * rowBytes;
+        unsigned char* temp = new unsigned char[rowBytes];
+        while (top < bottom) {
+            std::memcpy(temp, top, rowBytes);
+            std::memcpy(top, bottom, rowBytes);
+            std::memcpy(bottom, temp, rowBytes);
+            top += rowBytes;
+            bottom -= rowBytes;
+        }
+        delete[] temp;
+    }
+
+    return true;
+}
+
+static bool DecodePPM(const unsigned char* data, size_t size, unsigned char* rgba) {
+    ImageInfo info;
+    size_t pixelOffset;
+    if (!ParsePPM(data, size, info, pixelOffset)) {
+        return false;
+    }
+
+    // PPM stores the top row first, OpenGL wants the bottom row first.
+    const unsigned char* src = data + pixelOffset;
+    for (int y = 0; y < info.Height; y++) {
+        const unsigned char* row = src + (size_t)(info.Height - 1 - y) * info.Width * 3;
+        unsigned char* dst = rgba + (size_t)y * info.Width * 4;
+        for (int x = 0; x < info.Width; x++) {
+            dst[x * 4 + 0] = row[x * 3 + 0];
+            dst[x * 4 + 1] = row[x * 3 + 1];
+            dst[x * 4 + 2] = row[x * 3 + 2];
+            dst[x * 4 + 3] = 255;
+        }
+    }
+
+    return true;
+}
+
+bool DecodeImage(const unsigned char* data, size_t size, unsigned char* rgba) {
+    switch (DetectFormat(data, size)) {
+        case ImageFormat::PPM:
+            return DecodePPM(data, size, rgba);
+        case ImageFormat::TGA:
+            return DecodeTGA(data, size, rgba);
+        default:
+            return false;
+    }
+}
+
+void DownsampleImage(int width, int height, const unsigned char* rgba, unsigned char* out) {
+    int outWidth = std::max(1, width / 2);
+    int outHeight = std::max(1, height / 2);
+
+    for (int y = 0; y < outHeight; y++) {
+        int y0 = std::min(y * 2, height - 1);
+        int y1 = std::min(y * 2 + 1, height - 1);
+        for (int x = 0; x < outWidth; x++) {
+            int x0 = std::min(x * 2, width - 1);
+            int x1 = std::min(x * 2 + 1, width - 1);
+            for (int c = 0; c < 4; c++) {
+                int sum = rgba[((size_t)y0 * width + x0) * 4 + c] + rgba[((size_t)y0 * width + x1) * 4 + c] +
+                          rgba[((size_t)y1 * width + x0) * 4 + c] + rgba[((size_t)y1 * width + x1) * 4 + c];
+                out[((size_t)y * outWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// Deflate writes its bits starting with the lowest one.
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<unsigned char>& out) : m_Out(out) {}
+
+    void Write(uint32_t bits, int count) {
+        m_Bits |= (uint64_t)bits << m_Count;
+        m_Count += count;
+        while (m_Count >= 8) {
+            m_Out.push_back((unsigned char)m_Bits);
+            m_Bits >>= 8;
+            m_Count -= 8;
+        }
+    }
+
+    // Huffman codes are the other way around, highest bit first.
+    void WriteCode(uint32_t code, int length) {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; i++) {
+            reversed |= ((code >> i) & 1) << (length - 1 - i);
+        }
+        Write(reversed, length);
+    }
+
+    void Finish() {
+        if (m_Count > 0) {
+            m_Out.push_back((unsigned char)m_Bits);
+        }
+        m_Bits = 0;
+        m_Count = 0;
+    }
+
+private:
+    std::vector<unsigned char>& m_Out;
+    uint64_t m_Bits = 0;
+    int m_Count = 0;
+};
+
+// The fixed Huffman code of deflate (RFC 1951, 3.2.6) for literals and lengths.
+static void WriteFixedSymbol(BitWriter& bits, int symbol) {
+    if (symbol < 144) {
+        bits.WriteCode(0x30 + symbol, 8);
+    }
+    else if (symbol < 256) {
+        bits.WriteCode(0x190 + symbol - 144, 9);
+    }
+    else if (symbol < 280) {
+        bits.WriteCode(symbol - 256, 7);
+    }
+    else {
+        bits.WriteCode(0xC0 + symbol - 280, 8);
+    }
+}
+
+static const int LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const int LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                     2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const int DISTANCE_BASE[30] = {1,    2,    3,    4,    5,    7,    9,    13,    17,    25,
+                                      33,   49,   65,   97,   129,  193,  257,  385,   513,   769,
+                                      1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const int DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                       6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static void WriteMatch(BitWriter& bits, int length, int distance) {
+    int code = 28;
+    while (LENGTH_BASE[code] > length) {
+        code--;
+    }
+    WriteFixedSymbol(bits, 257 + code);
+    bits.Write(length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+    code = 29;
+    while (DISTANCE_BASE[code] > distance) {
+        code--;
+    }
+    bits.WriteCode(code, 5);
+    bits.Write(distance - DISTANCE_BASE[code], DISTANCE_EXTRA[code]);
+}
+
+// Only two kinds of match, the pixel to the left and the one above, and only
+// the fixed code. Far from what zlib would get, but rendered frames are
+// mostly runs of the same color, those it catches, and it's one pass.
+static void Deflate(const std::vector<unsigned char>& data, size_t rowBytes, std::vector<unsigned char>& out) {
+    BitWriter bits(out);
+    // Final block, fixed Huffman codes.
+    bits.Write(1, 1);
+    bits.Write(1, 2);
+    const size_t distances[2] = {3, rowBytes};
+    size_t i = 0;
+    while (i < data.size()) {
+        size_t bestLength = 0, bestDistance = 0;
+        for (size_t distance : distances) {
+            if (distance > i || distance > 32768) {
+                continue;
+            }
+            size_t length = 0;
+            while (length < 258 && i + length < data.size() && data[i + length] == data[i + length - distance]) {
+                length++;
+            }
+            if (length > bestLength) {
+                bestLength = length;
+                bestDistance = distance;
+            }
+        }
+        if (bestLength >= 3) {
+            WriteMatch(bits, (int)bestLength, (int)bestDistance);
+            i += bestLength;
+        }
+        else {
+            WriteFixedSymbol(bits, data[i++]);
+        }
+    }
+    WriteFixedSymbol(bits, 256);
+    bits.Finish();
+}
+
+static uint32_t CRC32(const unsigned char* data, size_t size, uint32_t crc = 0) {
+    static uint32_t table[256];
+    static bool ready = false;
+    if (!ready) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        ready = true;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void WriteBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back((unsigned char)(value >> shift));
+    }
+}
+
+static void WriteChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+    WriteBigEndian(out, (uint32_t)data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    WriteBigEndian(out, CRC32(&out[start], out.size() - start));
+}
+
+void EncodePNG(int width, int height, const unsigned char* rgba, std::vector<unsigned char>& out) {
+    // Filter type 0 (none) in front of every row, top row first.
+    size_t rowBytes = (size_t)width * 3 + 1;
+    std::vector<unsigned char> rows(rowBytes * height);
+    for (int y = 0; y < height; y++) {
+        unsigned char* row = &rows[rowBytes * y];
+        const unsigned char* source = rgba + (size_t)(height - 1 - y) * width * 4;
+        row[0] = 0;
+        for (int x = 0; x < width; x++) {
+            row[1 + x * 3] = source[x * 4];
+            row[2 + x * 3] = source[x * 4 + 1];
+            row[3 + x * 3] = source[x * 4 + 2];
+        }
+    }
+
+    // zlib: header, deflate, Adler-32 of the uncompressed data.
+    std::vector<unsigned char> compressed = {0x78, 0x01};
+    Deflate(rows, rowBytes, compressed);
+    uint32_t a = 1, b = 0;
+    for (unsigned char byte : rows) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    WriteBigEndian(compressed, (b << 16) | a);
+
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    out.assign(signature, signature + 8);
+    std::vector<unsigned char> header;
+    WriteBigEndian(header, (uint32_t)width);
+    WriteBigEndian(header, (uint32_t)height);
+    // 8 bits, RGB, deflate, no filter method, not interlaced.
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+    WriteChunk(out, "IHDR", header);
+    WriteChunk(out, "IDAT", compressed);
+    WriteChunk(out, "IEND", {});
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/*
+    Minimal image decoding, so we don't need a library just to get pixels.
+    Supported formats:
+    - TGA, uncompressed or RLE compressed, 24 or 32 bits per pixel
+    - binary PPM (P6), 8 bits per channel
+
+    Decoding happens in two steps. First we read only the header, which tells
+    us how much memory the pixels need. Then the caller hands us that memory
+    and we decode straight into it. That's what lets the texture uploader
+    decode on a worker thread directly into a mapped GPU buffer.
+
+    The output is always RGBA, 8 bits per channel, with the BOTTOM row first,
+    since that's what glTexImage2D expects.
+
+    And one way back: EncodePNG, for frame captures (FrameCapture.h).
+*/
+
+struct ImageInfo {
+    int Width;
+    int Height;
+};
+
+// Returns false if the format is not recognised or the header is broken.
+bool ReadImageInfo(const unsigned char* data, size_t size, ImageInfo& info);
+
+// rgba must have room for Width * Height * 4 bytes.
+bool DecodeImage(const unsigned char* data, size_t size, unsigned char* rgba);
+
+// Halves an RGBA image with a 2x2 box filter (odd edges are clamped), for
+// building mip chains offline. out must hold max(1, w / 2) * max(1, h / 2) * 4 bytes.
+void DownsampleImage(int width, int height, const unsigned char* rgba, unsigned char* out);
+
+// An RGBA image, bottom row first (as glReadPixels gives it), as a PNG
+// file: RGB, alpha dropped. Compresses runs only, fast rather than small.
+void EncodePNG(int width, int height, const unsigned char* rgba, std::vector<unsigned char>& out);
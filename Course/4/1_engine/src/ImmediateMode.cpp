@@ -0,0 +1,251 @@
+#include "ImmediateMode.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+#include "GpuMemory.h"
+#include "Renderer.h"
+#include "Shader.h"
+
+static const size_t PART_COUNT = 3;
+// Pieces of a batch hold whole points, lines and triangles.
+static const size_t PIECE_VERTICES = 6;
+
+ImmediateRenderer::ImmediateRenderer(size_t partBytes) {
+    m_PartBytes = std::max(partBytes / (sizeof(ImmediateVertex) * PIECE_VERTICES), (size_t)1) *
+                  sizeof(ImmediateVertex) * PIECE_VERTICES;
+
+    ProgramReflection reflection;
+    m_Program = LoadProgram("res/shaders/Immediate.shader", reflection);
+    bool valid = m_Program != 0;
+    valid = valid && ValidateUniform(reflection, "u_ViewProjection", GL_FLOAT_MAT4, &m_ViewProjectionLocation);
+    valid = valid && ValidateUniform(reflection, "u_PointSize", GL_FLOAT, &m_PointSizeLocation);
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLCall(glCreateBuffers(1, &m_Buffer));
+    GLCall(glNamedBufferStorage(m_Buffer, m_PartBytes * PART_COUNT, nullptr, flags));
+    m_Memory = (unsigned char*)glMapNamedBufferRange(m_Buffer, 0, m_PartBytes * PART_COUNT, flags);
+    valid = valid && m_Memory != nullptr;
+    m_MemoryId = TrackGpuMemory(MemoryCategory::Staging, "immediate mode stream", m_PartBytes * PART_COUNT);
+
+    // One vertex array for the whole stream; a piece is picked by the first
+    // vertex of the draw.
+    GLCall(glCreateVertexArrays(1, &m_VertexArray));
+    GLCall(glVertexArrayVertexBuffer(m_VertexArray, 0, m_Buffer, 0, sizeof(ImmediateVertex)));
+    GLCall(glEnableVertexArrayAttrib(m_VertexArray, 0));
+    GLCall(glVertexArrayAttribFormat(m_VertexArray, 0, 3, GL_FLOAT, GL_FALSE, offsetof(ImmediateVertex, Position)));
+    GLCall(glVertexArrayAttribBinding(m_VertexArray, 0, 0));
+    GLCall(glEnableVertexArrayAttrib(m_VertexArray, 1));
+    GLCall(glVertexArrayAttribFormat(m_VertexArray, 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(ImmediateVertex, Color)));
+    GLCall(glVertexArrayAttribBinding(m_VertexArray, 1, 0));
+
+    m_Valid = valid;
+    if (!m_Valid) {
+        std::cerr << "Can't set up immediate mode drawing" << std::endl;
+    }
+}
+
+ImmediateRenderer::~ImmediateRenderer() {
+    for (GLsync fence : m_Fences) {
+        if (fence) {
+            GLCall(glDeleteSync(fence));
+        }
+    }
+    if (m_Memory) {
+        GLCall(glUnmapNamedBuffer(m_Buffer));
+    }
+    GLCall(glDeleteBuffers(1, &m_Buffer));
+    GLCall(glDeleteVertexArrays(1, &m_VertexArray));
+    if (m_Program) {
+        GLCall(glDeleteProgram(m_Program));
+    }
+    ReleaseGpuMemory(m_MemoryId);
+}
+
+void ImmediateRenderer::Color4f(float r, float g, float b, float a) {
+    auto toByte = [](float value) { return (uint8_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f); };
+    Color4ub(toByte(r), toByte(g), toByte(b), toByte(a));
+}
+
+void ImmediateRenderer::Color4ub(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    m_Color[0] = r;
+    m_Color[1] = g;
+    m_Color[2] = b;
+    m_Color[3] = a;
+}
+
+void ImmediateRenderer::Begin(GLenum mode) {
+    Kind type;
+    switch (mode) {
+        case GL_POINTS: type = Kind::Points; break;
+        case GL_LINES:
+        case GL_LINE_STRIP:
+        case GL_LINE_LOOP: type = Kind::Lines; break;
+        default: type = Kind::Triangles; break;
+    }
+    float pointSize = type == Kind::Points ? m_PointSize : 1.0f;
+
+    m_Current = nullptr;
+    for (Batch& batch : m_Batches) {
+        if (batch.Type == type && batch.DepthTest == m_DepthTest && batch.PointSize == pointSize) {
+            m_Current = &batch;
+            break;
+        }
+    }
+    if (!m_Current) {
+        m_Batches.push_back({type, m_DepthTest, pointSize, {}});
+        m_Current = &m_Batches.back();
+    }
+    m_Mode = mode;
+    m_First = m_Current->Vertices.size();
+    m_Outside.Vertices.clear();
+}
+
+void ImmediateRenderer::End() {
+    std::vector<ImmediateVertex>& vertices = m_Current->Vertices;
+    size_t count = vertices.size() - m_First;
+    if (m_Current == &m_Outside || count == 0) {
+        m_Outside.Vertices.clear();
+        m_Current = &m_Outside;
+        return;
+    }
+
+    // Lists go into the batch as they are, minus an incomplete primitive at
+    // the end. Everything else is taken out again and put back as a list.
+    if (m_Mode == GL_POINTS || m_Mode == GL_LINES || m_Mode == GL_TRIANGLES) {
+        size_t perPrimitive = m_Mode == GL_POINTS ? 1 : m_Mode == GL_LINES ? 2 : 3;
+        vertices.resize(m_First + count - count % perPrimitive);
+    }
+    else {
+        m_Scratch.assign(vertices.begin() + m_First, vertices.end());
+        vertices.resize(m_First);
+        const std::vector<ImmediateVertex>& in = m_Scratch;
+        auto line = [&](size_t a, size_t b) {
+            vertices.push_back(in[a]);
+            vertices.push_back(in[b]);
+        };
+        auto triangle = [&](size_t a, size_t b, size_t c) {
+            vertices.push_back(in[a]);
+            vertices.push_back(in[b]);
+            vertices.push_back(in[c]);
+        };
+        switch (m_Mode) {
+            case GL_LINE_STRIP:
+            case GL_LINE_LOOP:
+                for (size_t i = 1; i < count; i++) {
+                    line(i - 1, i);
+                }
+                if (m_Mode == GL_LINE_LOOP && count > 2) {
+                    line(count - 1, 0);
+                }
+                break;
+            case GL_TRIANGLE_STRIP:
+            case GL_QUAD_STRIP:
+                // Every other triangle flipped, so they all keep the winding
+                // of the first. A quad strip is the same triangles, over
+                // whole pairs of vertices.
+                if (m_Mode == GL_QUAD_STRIP) {
+                    count -= count % 2;
+                }
+                for (size_t i = 2; i < count; i++) {
+                    if (i % 2 == 0) {
+                        triangle(i - 2, i - 1, i);
+                    }
+                    else {
+                        triangle(i - 1, i - 2, i);
+                    }
+                }
+                break;
+            case GL_QUADS:
+                for (size_t i = 0; i + 3 < count; i += 4) {
+                    triangle(i, i + 1, i + 2);
+                    triangle(i, i + 2, i + 3);
+                }
+                break;
+            case GL_TRIANGLE_FAN:
+            case GL_POLYGON:
+                for (size_t i = 2; i < count; i++) {
+                    triangle(0, i - 1, i);
+                }
+                break;
+        }
+    }
+
+    if (vertices.size() > m_First) {
+        m_Stats.Primitives++;
+        m_Stats.Vertices += vertices.size() - m_First;
+    }
+    m_Current = &m_Outside;
+}
+
+size_t ImmediateRenderer::NextPart() {
+    size_t part = m_Part;
+    m_Part = (m_Part + 1) % PART_COUNT;
+    if (GLsync fence = m_Fences[part]) {
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            m_Stats.Stalls++;
+            // The first time around with GL_SYNC_FLUSH_COMMANDS_BIT, so the
+            // fence is on its way to the GPU at all.
+            GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+            do {
+                status = glClientWaitSync(fence, flags, 1000000);
+                flags = 0;
+            } while (status == GL_TIMEOUT_EXPIRED);
+        }
+        GLCall(glDeleteSync(fence));
+        m_Fences[part] = nullptr;
+    }
+    return part;
+}
+
+void ImmediateRenderer::Flush(const Mat4& viewProjection) {
+    m_Stats.Flushes++;
+    if (!m_Valid) {
+        for (Batch& batch : m_Batches) {
+            batch.Vertices.clear();
+        }
+        return;
+    }
+
+    bool depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLCall(glUseProgram(m_Program));
+    GLCall(glUniformMatrix4fv(m_ViewProjectionLocation, 1, GL_FALSE, viewProjection.Data));
+    GLCall(glBindVertexArray(m_VertexArray));
+    GLCall(glEnable(GL_PROGRAM_POINT_SIZE));
+
+    const size_t partVertices = m_PartBytes / sizeof(ImmediateVertex);
+    for (Batch& batch : m_Batches) {
+        if (batch.Vertices.empty()) {
+            continue;
+        }
+        if (batch.DepthTest) {
+            GLCall(glEnable(GL_DEPTH_TEST));
+        }
+        else {
+            GLCall(glDisable(GL_DEPTH_TEST));
+        }
+        GLCall(glUniform1f(m_PointSizeLocation, batch.PointSize));
+        GLenum mode = batch.Type == Kind::Points ? GL_POINTS : batch.Type == Kind::Lines ? GL_LINES : GL_TRIANGLES;
+
+        for (size_t first = 0; first < batch.Vertices.size(); first += partVertices) {
+            size_t count = std::min(partVertices, batch.Vertices.size() - first);
+            size_t part = NextPart();
+            std::memcpy(m_Memory + part * m_PartBytes, &batch.Vertices[first], count * sizeof(ImmediateVertex));
+            GLCall(glDrawArrays(mode, (GLint)(part * partVertices), (GLsizei)count));
+            GLCall(m_Fences[part] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+            m_Stats.DrawCalls++;
+            m_Stats.BytesStreamed += count * sizeof(ImmediateVertex);
+        }
+        batch.Vertices.clear();
+    }
+
+    if (depthTest) {
+        GLCall(glEnable(GL_DEPTH_TEST));
+    }
+    else {
+        GLCall(glDisable(GL_DEPTH_TEST));
+    }
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+
+/*
+        IMMEDIATE MODE, BATCHED
+    Lessons 1/2 and 1/3 drew their triangle with glBegin, glVertex2d and
+    glEnd. That is the easiest way to get something on the screen, and
+    still the easiest way to write debug drawing (a box here, a line
+    there), but a core profile doesn't have it, and where it exists every
+    glVertex is a call into the driver and every glEnd may be a draw.
+
+    ImmediateRenderer keeps the way of writing and changes what happens
+    underneath:
+
+        imm.Begin(GL_LINE_LOOP);
+        imm.Color3f(1.0f, 0.0f, 0.0f);
+        imm.Vertex2f(-0.5f, -0.5f);
+        ...
+        imm.End();
+        ...
+        imm.Flush(viewProjection);   // once per frame
+
+    Vertex() only appends 16 bytes to an array. End() turns strips, loops,
+    fans, quads and polygons into plain lists, so every primitive ends up
+    as points, lines or triangles. Flush() copies each of those into a
+    streaming buffer and draws it with ONE glDrawArrays, however many
+    Begin/End pairs went into it. A million lines are a few draw calls.
+
+    The streaming buffer is persistently mapped and split in three parts,
+    used in turn, each with a fence, so we never write over vertices the
+    GPU is still reading (the same idea as the texture staging buffer in
+    TextureUploader.h). A batch bigger than a part is drawn in pieces.
+
+    What it doesn't keep from the old API: the order between different
+    kinds. All lines are drawn in one go and all triangles in another, so a
+    line that was drawn before a triangle may end up under it. Depth
+    testing, which is part of the batch's state, takes care of that in 3D;
+    for overlays, draw in two flushes.
+*/
+
+struct ImmediateVertex {
+    float Position[3];
+    // RGBA, one byte each.
+    uint8_t Color[4];
+};
+
+struct ImmediateStats {
+    size_t Primitives = 0;
+    size_t Vertices = 0;
+    size_t Flushes = 0;
+    size_t DrawCalls = 0;
+    size_t BytesStreamed = 0;
+    // Times a part of the streaming buffer was still in use by the GPU.
+    size_t Stalls = 0;
+};
+
+class ImmediateRenderer {
+public:
+    // partBytes: the size of each of the three parts of the streaming
+    // buffer, at least 6 vertices.
+    explicit ImmediateRenderer(size_t partBytes = 8 * 1024 * 1024);
+    ~ImmediateRenderer();
+
+    ImmediateRenderer(const ImmediateRenderer&) = delete;
+    ImmediateRenderer& operator=(const ImmediateRenderer&) = delete;
+
+    // False if the shader failed to build or the buffer couldn't be mapped.
+    bool IsValid() const { return m_Valid; }
+
+    // State for the primitives that follow; different state, different
+    // batch (and draw call).
+    void SetDepthTest(bool enabled) { m_DepthTest = enabled; }
+    void SetPointSize(float pixels) { m_PointSize = pixels; }
+
+    // Any of the glBegin modes: GL_POINTS, GL_LINES, GL_LINE_STRIP,
+    // GL_LINE_LOOP, GL_TRIANGLES, GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN,
+    // GL_QUADS, GL_QUAD_STRIP and GL_POLYGON.
+    void Begin(GLenum mode);
+    // Like glEnd: a primitive that isn't complete is dropped.
+    void End();
+
+    // Applies to the vertices that follow, as glColor does.
+    void Color3f(float r, float g, float b) { Color4f(r, g, b, 1.0f); }
+    void Color4f(float r, float g, float b, float a);
+    void Color4ub(uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+
+    void Vertex2f(float x, float y) { Vertex3f(x, y, 0.0f); }
+    void Vertex2d(double x, double y) { Vertex3f((float)x, (float)y, 0.0f); }
+    void Vertex3d(double x, double y, double z) { Vertex3f((float)x, (float)y, (float)z); }
+    void Vertex3f(float x, float y, float z) {
+        ImmediateVertex& vertex = m_Current->Vertices.emplace_back();
+        vertex.Position[0] = x;
+        vertex.Position[1] = y;
+        vertex.Position[2] = z;
+        vertex.Color[0] = m_Color[0];
+        vertex.Color[1] = m_Color[1];
+        vertex.Color[2] = m_Color[2];
+        vertex.Color[3] = m_Color[3];
+    }
+
+    // Draws everything since the last Flush(), one draw call per batch (or
+    // per piece of it). Leaves its program and vertex array bound.
+    void Flush(const Mat4& viewProjection);
+
+    const ImmediateStats& GetStats() const { return m_Stats; }
+
+private:
+    enum class Kind : uint8_t { Points, Lines, Triangles };
+
+    struct Batch {
+        Kind Type;
+        bool DepthTest;
+        float PointSize;
+        std::vector<ImmediateVertex> Vertices;
+    };
+
+    // The part of the stream to write next, waiting for the GPU if needed.
+    size_t NextPart();
+
+    bool m_Valid = false;
+    GLuint m_Program = 0;
+    GLint m_ViewProjectionLocation = -1;
+    GLint m_PointSizeLocation = -1;
+    GLuint m_VertexArray = 0;
+    GLuint m_Buffer = 0;
+    unsigned char* m_Memory = nullptr;
+    size_t m_PartBytes;
+    GLsync m_Fences[3] = {};
+    size_t m_Part = 0;
+    uint32_t m_MemoryId = 0;
+
+    // In the order they were first used. A Flush() empties them but keeps
+    // them (and their memory) for the next frame.
+    std::vector<Batch> m_Batches;
+    // A batch Vertex() can always write to, also outside Begin/End (and
+    // thrown away then).
+    Batch m_Outside = {Kind::Points, false, 1.0f, {}};
+    Batch* m_Current = &m_Outside;
+    GLenum m_Mode = 0;
+    size_t m_First = 0;
+    std::vector<ImmediateVertex> m_Scratch;
+
+    bool m_DepthTest = true;
+    float m_PointSize = 1.0f;
+    uint8_t m_Color[4] = {255, 255, 255, 255};
+
+    ImmediateStats m_Stats;
+};
@@ -0,0 +1,360 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+struct Job {
+    std::function<void()> Work;
+    JobCounter* Counter;
+    bool MainThread;
+};
+
+// A power of two. A thread that has this many jobs queued puts the next
+// ones into the shared queue.
+static const int64_t DEQUE_CAPACITY = 4096;
+
+// How often an idle worker looks for work again before it goes to sleep.
+static const int IDLE_SPINS = 64;
+
+/*
+    The Chase-Lev deque, with the memory orders of "Correct and Efficient
+    Work-Stealing for Weak Memory Models" (Le, Pop, Cohen, Zappa Nardelli).
+    Bottom is only written by the owner, top only moves up, by a CAS. The
+    one job both sides may want at once (top == bottom - 1) is decided by
+    that same CAS.
+*/
+class JobSystem::Deque {
+public:
+    Deque() : m_Jobs(new std::atomic<Job*>[DEQUE_CAPACITY]) {}
+
+    // Owner only. False when full.
+    bool Push(Job* job) {
+        int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+        int64_t top = m_Top.load(std::memory_order_acquire);
+        if (bottom - top >= DEQUE_CAPACITY) {
+            return false;
+        }
+        m_Jobs[bottom & (DEQUE_CAPACITY - 1)].store(job, std::memory_order_relaxed);
+        // The paper has a release fence and a relaxed store here; a release
+        // store is the same on x86 and ARM, and thread sanitizers understand it.
+        m_Bottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Owner only. The newest job.
+    Job* Pop() {
+        int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+        m_Bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_Top.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Job* job = m_Jobs[bottom & (DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // The last one: a thief may be taking it right now.
+            if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                               std::memory_order_relaxed)) {
+                job = nullptr;
+            }
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    // Any thread. The oldest job, or nullptr if there is none or another
+    // thread got it first.
+    Job* Steal() {
+        int64_t top = m_Top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return nullptr;
+        }
+        Job* job = m_Jobs[top & (DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return job;
+    }
+
+private:
+    std::atomic<int64_t> m_Top{0};
+    std::atomic<int64_t> m_Bottom{0};
+    std::unique_ptr<std::atomic<Job*>[]> m_Jobs;
+};
+
+// One per thread, on its own cache lines so the counters don't bounce
+// between cores.
+struct alignas(64) JobSystem::ThreadState {
+    Deque Queue;
+    std::atomic<size_t> Executed{0};
+    std::atomic<size_t> Stolen{0};
+    // For picking whom to steal from. Only its own thread uses it.
+    uint32_t Random;
+};
+
+// Which JobSystem the current thread works for, and as which thread.
+static thread_local const JobSystem* t_System = nullptr;
+static thread_local int t_Thread = -1;
+
+static uint32_t NextRandom(uint32_t& state) {
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+JobSystem::JobSystem(int workerCount) : m_MainThread(std::this_thread::get_id()) {
+    if (workerCount < 0) {
+        unsigned int cores = std::thread::hardware_concurrency();
+        workerCount = cores > 1 ? (int)cores - 1 : 0;
+    }
+
+    for (int i = 0; i <= workerCount; i++) {
+        m_States.emplace_back(new ThreadState());
+        m_States.back()->Random = 0x9E3779B9u * (i + 1);
+    }
+    for (int i = 1; i <= workerCount; i++) {
+        m_Threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    m_Stopping.store(true);
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+    }
+    m_SleepCondition.notify_all();
+    for (std::thread& thread : m_Threads) {
+        thread.join();
+    }
+
+    // The workers only stop once they find nothing to do, so what is left
+    // was queued by the main thread (or for it) in the meantime.
+    for (;;) {
+        if (Job* job = FindJob(0)) {
+            Execute(job, 0);
+        }
+        else if (RunMainThreadJobs() == 0) {
+            break;
+        }
+    }
+}
+
+int JobSystem::CurrentThread() const {
+    if (t_System == this) {
+        return t_Thread;
+    }
+    return std::this_thread::get_id() == m_MainThread ? 0 : -1;
+}
+
+void JobSystem::Run(std::function<void()> work, JobCounter* counter, JobCounter* after) {
+    Enqueue(new Job{std::move(work), counter, false}, after);
+}
+
+void JobSystem::RunOnMainThread(std::function<void()> work, JobCounter* counter, JobCounter* after) {
+    Enqueue(new Job{std::move(work), counter, true}, after);
+}
+
+void JobSystem::Enqueue(Job* job, JobCounter* after) {
+    if (job->Counter) {
+        job->Counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (after && after->m_Pending.load(std::memory_order_acquire) != 0) {
+        std::lock_guard<std::mutex> lock(after->m_Mutex);
+        // Finish() takes the list under the same lock when the counter gets
+        // to 0, so either it sees this job or we see the 0.
+        if (after->m_Pending.load(std::memory_order_acquire) != 0) {
+            after->m_Waiting.push_back(job);
+            return;
+        }
+    }
+    Schedule(job);
+}
+
+void JobSystem::Schedule(Job* job) {
+    if (job->MainThread) {
+        std::lock_guard<std::mutex> lock(m_MainMutex);
+        m_MainJobs.push_back(job);
+        return;
+    }
+
+    int thread = CurrentThread();
+    if (thread < 0 || !m_States[thread]->Queue.Push(job)) {
+        std::lock_guard<std::mutex> lock(m_InjectedMutex);
+        m_Injected.push_back(job);
+        m_InjectedCount.fetch_add(1, std::memory_order_release);
+        m_InjectedTotal.fetch_add(1, std::memory_order_relaxed);
+    }
+    WakeWorkers();
+}
+
+void JobSystem::WakeWorkers() {
+    m_WorkVersion.fetch_add(1, std::memory_order_seq_cst);
+    if (m_Sleeping.load(std::memory_order_seq_cst) > 0) {
+        // Taking the lock makes sure the sleeper is either still checking
+        // the version or already waiting, not in between.
+        {
+            std::lock_guard<std::mutex> lock(m_SleepMutex);
+        }
+        m_SleepCondition.notify_one();
+    }
+}
+
+Job* JobSystem::FindJob(int thread) {
+    if (thread >= 0) {
+        if (Job* job = m_States[thread]->Queue.Pop()) {
+            return job;
+        }
+    }
+
+    if (m_InjectedCount.load(std::memory_order_acquire) > 0) {
+        std::lock_guard<std::mutex> lock(m_InjectedMutex);
+        if (!m_Injected.empty()) {
+            Job* job = m_Injected.front();
+            m_Injected.pop_front();
+            m_InjectedCount.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    // Starting somewhere random, so the thieves spread out.
+    uint32_t random = thread >= 0 ? NextRandom(m_States[thread]->Random) : 0;
+    size_t count = m_States.size();
+    for (size_t i = 0; i < count; i++) {
+        size_t victim = (random + i) % count;
+        if ((int)victim == thread) {
+            continue;
+        }
+        if (Job* job = m_States[victim]->Queue.Steal()) {
+            if (thread >= 0) {
+                m_States[thread]->Stolen.fetch_add(1, std::memory_order_relaxed);
+            }
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::Execute(Job* job, int thread) {
+    job->Work();
+    JobCounter* counter = job->Counter;
+    delete job;
+    if (thread >= 0) {
+        m_States[thread]->Executed.fetch_add(1, std::memory_order_relaxed);
+    }
+    Finish(counter);
+}
+
+void JobSystem::Finish(JobCounter* counter) {
+    if (!counter) {
+        return;
+    }
+    // Counting down without a lock, as long as this isn't the last job.
+    uint32_t pending = counter->m_Pending.load(std::memory_order_relaxed);
+    while (pending > 1) {
+        if (counter->m_Pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel,
+                                                     std::memory_order_relaxed)) {
+            return;
+        }
+    }
+
+    // The last one (unless a job was added meanwhile): 0 is reached under the
+    // lock, and the counter isn't touched after that, see IsDone().
+    std::vector<Job*> waiting;
+    {
+        std::lock_guard<std::mutex> lock(counter->m_Mutex);
+        if (counter->m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            waiting.swap(counter->m_Waiting);
+        }
+    }
+    for (Job* job : waiting) {
+        Schedule(job);
+    }
+}
+
+void JobSystem::WorkerLoop(int thread) {
+    t_System = this;
+    t_Thread = thread;
+
+    for (;;) {
+        Job* job = nullptr;
+        uint64_t version = 0;
+        for (int spin = 0; spin < IDLE_SPINS && !job; spin++) {
+            version = m_WorkVersion.load(std::memory_order_seq_cst);
+            job = FindJob(thread);
+            if (!job) {
+                std::this_thread::yield();
+            }
+        }
+        if (job) {
+            Execute(job, thread);
+            continue;
+        }
+
+        if (m_Stopping.load()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(m_SleepMutex);
+        m_Sleeping.fetch_add(1, std::memory_order_seq_cst);
+        m_SleepCondition.wait(lock, [&] {
+            return m_Stopping.load() || m_WorkVersion.load(std::memory_order_seq_cst) != version;
+        });
+        m_Sleeping.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+    int thread = CurrentThread();
+    while (!counter.IsDone()) {
+        if (Job* job = FindJob(thread)) {
+            Execute(job, thread);
+        }
+        else if (thread != 0 || RunMainThreadJobs() == 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+size_t JobSystem::RunMainThreadJobs() {
+    // Jobs queued by these jobs wait for the next call, so a job that keeps
+    // queueing itself can't hold up the frame.
+    std::deque<Job*> jobs;
+    {
+        std::lock_guard<std::mutex> lock(m_MainMutex);
+        jobs.swap(m_MainJobs);
+    }
+    for (Job* job : jobs) {
+        Execute(job, 0);
+    }
+    return jobs.size();
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body) {
+    if (count == 0) {
+        return;
+    }
+    if (grain == 0) {
+        grain = std::max<size_t>(1, count / (GetThreadCount() * 4));
+    }
+
+    JobCounter counter;
+    for (size_t begin = 0; begin < count; begin += grain) {
+        size_t end = std::min(count, begin + grain);
+        Run([&body, begin, end] { body(begin, end); }, &counter);
+    }
+    Wait(counter);
+}
+
+JobStats JobSystem::GetStats() const {
+    JobStats stats;
+    for (const std::unique_ptr<ThreadState>& state : m_States) {
+        stats.Executed.push_back(state->Executed.load(std::memory_order_relaxed));
+        stats.Stolen.push_back(state->Stolen.load(std::memory_order_relaxed));
+    }
+    stats.Injected = m_InjectedTotal.load(std::memory_order_relaxed);
+    return stats;
+}
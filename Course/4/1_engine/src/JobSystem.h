@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+        THE JOB SYSTEM
+    ThreadPool.h has one queue behind one mutex. That is fine for a handful
+    of long jobs (decoding a texture), but when a frame is cut into thousands
+    of small jobs every thread spends its time waiting for that mutex.
+
+    Here every thread has a queue of its own, a CHASE-LEV DEQUE: the owner
+    pushes and pops at the bottom without any lock (last in, first out, so
+    the data of the job it just made is still in its cache), and the other
+    threads STEAL from the top (the oldest, usually biggest, job) with a
+    single compare-and-swap. A thread only looks at the others when its own
+    queue is empty, so as long as there is work, nobody fights over anything.
+
+    The main thread (the one that made the JobSystem) has a deque too. It
+    doesn't sit in a loop like the workers, but whenever it waits for jobs it
+    runs jobs itself instead of sleeping.
+
+    COUNTERS tie jobs together. Every job can count up a JobCounter when it
+    is queued and counts it down when it is done; Wait() returns once the
+    counter is back at 0, and a job queued "after" a counter only starts
+    then. That is all the dependencies we need: a chain is a counter per
+    step, a fan-in is many jobs on one counter.
+
+    Jobs must NOT touch OpenGL, the context belongs to the main thread. Those
+    that have to go through RunOnMainThread and run from RunMainThreadJobs()
+    (once per frame) or from a Wait() on the main thread.
+*/
+
+class JobSystem;
+struct Job;
+
+// Must outlive every job that counts it. Starts (and ends up) at 0.
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool IsDone() const {
+        if (m_Pending.load(std::memory_order_acquire) != 0) {
+            return false;
+        }
+        // The job that brought it to 0 did that under the lock, and may still
+        // hold it. Once it lets go it is done with the counter, so after this
+        // the counter may be destroyed.
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return true;
+    }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> m_Pending{0};
+    // The jobs queued after this counter, started when it reaches 0.
+    mutable std::mutex m_Mutex;
+    std::vector<Job*> m_Waiting;
+};
+
+struct JobStats {
+    // Per thread; the main thread is [0].
+    std::vector<size_t> Executed;
+    std::vector<size_t> Stolen;
+    // Jobs that went through the shared queue: queued by other threads, or
+    // by a thread whose deque was full.
+    size_t Injected = 0;
+};
+
+class JobSystem {
+public:
+    // -1 means one worker per core, minus the main thread. With 0 workers,
+    // every job runs on the main thread inside Wait().
+    explicit JobSystem(int workerCount = -1);
+    // Runs what is still queued, then joins the workers. On the main thread.
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Queues a job. counter (optional) is counted up now and down when the
+    // job is done. after (optional): the job waits until that counter is 0.
+    void Run(std::function<void()> work, JobCounter* counter = nullptr, JobCounter* after = nullptr);
+    // Same, but the job runs on the main thread.
+    void RunOnMainThread(std::function<void()> work, JobCounter* counter = nullptr, JobCounter* after = nullptr);
+
+    // Runs jobs until the counter is 0. On the main thread that includes the
+    // main thread jobs.
+    void Wait(JobCounter& counter);
+
+    // Main thread only. Returns how many ran.
+    size_t RunMainThreadJobs();
+
+    // Calls body(begin, end) for ranges of at most grain indices that cover
+    // [0, count), spread over all threads, and waits for them. grain 0 picks
+    // about 4 ranges per thread.
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body);
+
+    unsigned int GetWorkerCount() const { return (unsigned int)m_Threads.size(); }
+    // Workers plus the main thread.
+    unsigned int GetThreadCount() const { return (unsigned int)m_Threads.size() + 1; }
+
+    JobStats GetStats() const;
+
+private:
+    class Deque;
+    struct ThreadState;
+
+    // Counts the job's counter up, then schedules it now or after that.
+    void Enqueue(Job* job, JobCounter* after);
+    void Schedule(Job* job);
+    void Execute(Job* job, int thread);
+    void Finish(JobCounter* counter);
+    Job* FindJob(int thread);
+    void WorkerLoop(int thread);
+    void WakeWorkers();
+    int CurrentThread() const;
+
+    std::vector<std::unique_ptr<ThreadState>> m_States;
+    std::vector<std::thread> m_Threads;
+
+    // Jobs from threads that have no deque here, and overflow.
+    std::mutex m_InjectedMutex;
+    std::deque<Job*> m_Injected;
+    std::atomic<size_t> m_InjectedCount{0};
+    std::atomic<size_t> m_InjectedTotal{0};
+
+    std::mutex m_MainMutex;
+    std::deque<Job*> m_MainJobs;
+    std::thread::id m_MainThread;
+
+    // Idle workers sleep here. m_WorkVersion changes with every queued job,
+    // so a worker that saw no work can tell whether some came in since.
+    std::mutex m_SleepMutex;
+    std::condition_variable m_SleepCondition;
+    std::atomic<uint64_t> m_WorkVersion{0};
+    std::atomic<int> m_Sleeping{0};
+    std::atomic<bool> m_Stopping{false};
+};
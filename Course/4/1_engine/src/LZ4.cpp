@@ -0,0 +1,161 @@
+#include "LZ4.h"
+
+#include <cstring>
+
+static const size_t MIN_MATCH = 4;
+// The spec wants the last 5 bytes to be literals, and the last match to start
+// at least 12 bytes before the end of the block.
+static const size_t LAST_LITERALS = 5;
+static const size_t MATCH_LIMIT = 12;
+static const int HASH_BITS = 12;
+
+size_t LZ4CompressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+static unsigned int Read32(const unsigned char* p) {
+    unsigned int value;
+    std::memcpy(&value, p, 4);
+    return value;
+}
+
+static unsigned int Hash(unsigned int sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static unsigned char* WriteLength(unsigned char* dst, size_t length) {
+    while (length >= 255) {
+        *dst++ = 255;
+        length -= 255;
+    }
+    *dst++ = (unsigned char)length;
+    return dst;
+}
+
+static unsigned char* WriteSequence(unsigned char* dst, const unsigned char* literals, size_t literalLength,
+                                    size_t offset, size_t matchLength) {
+    unsigned char* token = dst++;
+    *token = (unsigned char)((literalLength >= 15 ? 15 : literalLength) << 4);
+    if (literalLength >= 15) {
+        dst = WriteLength(dst, literalLength - 15);
+    }
+    std::memcpy(dst, literals, literalLength);
+    dst += literalLength;
+
+    // The last sequence of a block has literals only.
+    if (matchLength == 0) {
+        return dst;
+    }
+
+    *dst++ = (unsigned char)(offset & 0xFF);
+    *dst++ = (unsigned char)(offset >> 8);
+    size_t length = matchLength - MIN_MATCH;
+    *token |= (unsigned char)(length >= 15 ? 15 : length);
+    if (length >= 15) {
+        dst = WriteLength(dst, length - 15);
+    }
+    return dst;
+}
+
+size_t LZ4Compress(const unsigned char* src, size_t size, unsigned char* dst) {
+    unsigned char* out = dst;
+    const unsigned char* anchor = src;
+
+    if (size > MATCH_LIMIT) {
+        // Last position seen for every hashed 4 byte sequence (as an offset + 1, 0 means empty).
+        size_t table[1 << HASH_BITS] = {};
+        const unsigned char* matchEnd = src + size - LAST_LITERALS;
+        const unsigned char* p = src;
+
+        while (p + MATCH_LIMIT <= src + size) {
+            unsigned int sequence = Read32(p);
+            unsigned int h = Hash(sequence);
+            size_t candidate = table[h];
+            table[h] = (size_t)(p - src) + 1;
+
+            const unsigned char* match = src + candidate - 1;
+            if (candidate == 0 || p - match > 65535 || Read32(match) != sequence) {
+                p++;
+                continue;
+            }
+
+            // Extend the match as far as we are allowed to.
+            size_t length = MIN_MATCH;
+            while (p + length < matchEnd && p[length] == match[length]) {
+                length++;
+            }
+
+            out = WriteSequence(out, anchor, (size_t)(p - anchor), (size_t)(p - match), length);
+            p += length;
+            anchor = p;
+        }
+    }
+
+    return (size_t)(WriteSequence(out, anchor, (size_t)(src + size - anchor), 0, 0) - dst);
+}
+
+bool LZ4Decompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize) {
+    const unsigned char* in = src;
+    const unsigned char* inEnd = src + srcSize;
+    unsigned char* out = dst;
+    unsigned char* outEnd = dst + dstSize;
+
+    auto readLength = [&](size_t& length) {
+        unsigned char b;
+        do {
+            if (in >= inEnd) {
+                return false;
+            }
+            b = *in++;
+            length += b;
+        } while (b == 255);
+        return true;
+    };
+
+    while (in < inEnd) {
+        unsigned char token = *in++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(literalLength)) {
+            return false;
+        }
+        if ((size_t)(inEnd - in) < literalLength || (size_t)(outEnd - out) < literalLength) {
+            return false;
+        }
+        std::memcpy(out, in, literalLength);
+        in += literalLength;
+        out += literalLength;
+
+        // The last sequence ends right after its literals.
+        if (in == inEnd) {
+            break;
+        }
+
+        if (inEnd - in < 2) {
+            return false;
+        }
+        size_t offset = in[0] | (in[1] << 8);
+        in += 2;
+        if (offset == 0 || offset > (size_t)(out - dst)) {
+            return false;
+        }
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(matchLength)) {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        if ((size_t)(outEnd - out) < matchLength) {
+            return false;
+        }
+
+        // Matches may overlap what they are writing (offset < length), so copy byte by byte.
+        const unsigned char* match = out - offset;
+        for (size_t i = 0; i < matchLength; i++) {
+            out[i] = match[i];
+        }
+        out += matchLength;
+    }
+
+    return out == outEnd;
+}
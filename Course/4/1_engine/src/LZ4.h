@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+    The LZ4 block format, written from the spec so we don't need the library.
+    LZ4 doesn't compress as well as zlib, but it decompresses at several GB/s,
+    which is what matters when loading assets at startup.
+
+    A block is a list of sequences. Each one is: a token byte (4 bits literal
+    length, 4 bits match length), the literals, and a 2 byte offset back to
+    where the match should be copied from. Lengths of 15 or more continue in
+    extra bytes.
+*/
+
+// Worst case size of compressing `size` bytes (incompressible data grows a little).
+size_t LZ4CompressBound(size_t size);
+
+// Returns the compressed size, dst must hold LZ4CompressBound(size) bytes.
+size_t LZ4Compress(const unsigned char* src, size_t size, unsigned char* dst);
+
+// Returns false if the block is broken or doesn't decompress to exactly dstSize bytes.
+bool LZ4Decompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize);
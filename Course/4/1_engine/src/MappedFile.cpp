@@ -0,0 +1,61 @@
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_Data(other.m_Data), m_Size(other.m_Size) {
+    other.m_Data = nullptr;
+    other.m_Size = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        m_Data = other.m_Data;
+        m_Size = other.m_Size;
+        other.m_Data = nullptr;
+        other.m_Size = 0;
+    }
+    return *this;
+}
+
+bool MappedFile::Open(const std::string& filepath) {
+    Close();
+
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file, we don't need the descriptor anymore.
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    m_Data = (const unsigned char*)data;
+    m_Size = (size_t)info.st_size;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_Data) {
+        munmap((void*)m_Data, m_Size);
+        m_Data = nullptr;
+        m_Size = 0;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/*
+    A read-only memory mapped file (mmap). Instead of reading the file into a
+    buffer of our own, the OS maps its pages straight into our address space
+    and loads them the first time we touch them. Nothing gets copied, and the
+    pages can be shared with the OS file cache.
+*/
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Returns false if the file doesn't exist or can't be mapped.
+    bool Open(const std::string& filepath);
+    void Close();
+
+    bool IsOpen() const { return m_Data != nullptr; }
+    const unsigned char* GetData() const { return m_Data; }
+    size_t GetSize() const { return m_Size; }
+
+private:
+    const unsigned char* m_Data = nullptr;
+    size_t m_Size = 0;
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cmath>
+
+/*
+    A tiny bit of linear algebra, just enough for cameras and bounding boxes.
+
+    Matrices are stored COLUMN-MAJOR, exactly the way OpenGL expects them, so
+    a Mat4 can be handed straight to glUniformMatrix4fv(location, 1, GL_FALSE, m.Data).
+    Element (row, column) lives at Data[column * 4 + row].
+*/
+
+struct Vec3 {
+    float x, y, z;
+};
+
+struct Vec4 {
+    float x, y, z, w;
+};
+
+inline Vec3 operator+(const Vec3& a, const Vec3& b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+inline Vec3 operator-(const Vec3& a, const Vec3& b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline Vec3 operator*(const Vec3& a, float s) { return {a.x * s, a.y * s, a.z * s}; }
+
+inline float Dot(const Vec3& a, const Vec3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline Vec3 Cross(const Vec3& a, const Vec3& b) {
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+inline Vec3 Normalize(const Vec3& v) {
+    float length = std::sqrt(Dot(v, v));
+    return length > 0.0f ? v * (1.0f / length) : v;
+}
+
+struct Mat4 {
+    float Data[16];
+
+    static Mat4 Identity() {
+        Mat4 m = {};
+        m.Data[0] = m.Data[5] = m.Data[10] = m.Data[15] = 1.0f;
+        return m;
+    }
+
+    float& operator()(int row, int column) { return Data[column * 4 + row]; }
+    float operator()(int row, int column) const { return Data[column * 4 + row]; }
+};
+
+inline Mat4 operator*(const Mat4& a, const Mat4& b) {
+    Mat4 result;
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += a(row, k) * b(k, column);
+            }
+            result(row, column) = sum;
+        }
+    }
+    return result;
+}
+
+inline Vec4 Transform(const Mat4& m, const Vec3& p) {
+    return {
+        m.Data[0] * p.x + m.Data[4] * p.y + m.Data[8]  * p.z + m.Data[12],
+        m.Data[1] * p.x + m.Data[5] * p.y + m.Data[9]  * p.z + m.Data[13],
+        m.Data[2] * p.x + m.Data[6] * p.y + m.Data[10] * p.z + m.Data[14],
+        m.Data[3] * p.x + m.Data[7] * p.y + m.Data[11] * p.z + m.Data[15]
+    };
+}
+
+inline Mat4 Translate(const Vec3& t) {
+    Mat4 m = Mat4::Identity();
+    m(0, 3) = t.x;
+    m(1, 3) = t.y;
+    m(2, 3) = t.z;
+    return m;
+}
+
+inline Mat4 Scale(const Vec3& s) {
+    Mat4 m = Mat4::Identity();
+    m(0, 0) = s.x;
+    m(1, 1) = s.y;
+    m(2, 2) = s.z;
+    return m;
+}
+
+// Same as gluPerspective. fovY is in radians.
+inline Mat4 Perspective(float fovY, float aspect, float zNear, float zFar) {
+    float f = 1.0f / std::tan(fovY * 0.5f);
+    Mat4 m = {};
+    m(0, 0) = f / aspect;
+    m(1, 1) = f;
+    m(2, 2) = (zFar + zNear) / (zNear - zFar);
+    m(2, 3) = (2.0f * zFar * zNear) / (zNear - zFar);
+    m(3, 2) = -1.0f;
+    return m;
+}
+
+// The largest scale along any axis, for turning object space sizes into world space.
+inline float MaxScale(const Mat4& m) {
+    float x = m(0, 0) * m(0, 0) + m(1, 0) * m(1, 0) + m(2, 0) * m(2, 0);
+    float y = m(0, 1) * m(0, 1) + m(1, 1) * m(1, 1) + m(2, 1) * m(2, 1);
+    float z = m(0, 2) * m(0, 2) + m(1, 2) * m(1, 2) + m(2, 2) * m(2, 2);
+    return std::sqrt(std::fmax(x, std::fmax(y, z)));
+}
+
+// Same as gluLookAt.
+inline Mat4 LookAt(const Vec3& eye, const Vec3& center, const Vec3& up) {
+    Vec3 f = Normalize(center - eye);
+    Vec3 s = Normalize(Cross(f, up));
+    Vec3 u = Cross(s, f);
+
+    Mat4 m = Mat4::Identity();
+    m(0, 0) = s.x;  m(0, 1) = s.y;  m(0, 2) = s.z;
+    m(1, 0) = u.x;  m(1, 1) = u.y;  m(1, 2) = u.z;
+    m(2, 0) = -f.x; m(2, 1) = -f.y; m(2, 2) = -f.z;
+    m(0, 3) = -Dot(s, eye);
+    m(1, 3) = -Dot(u, eye);
+    m(2, 3) = Dot(f, eye);
+    return m;
+}
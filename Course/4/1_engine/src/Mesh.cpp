@@ -0,0 +1,157 @@
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "Renderer.h"
+#include "VertexPulling.h"
+
+static GLenum ToGLType(AttributeType type) {
+    switch (type) {
+        case AttributeType::Float: return GL_FLOAT;
+        case AttributeType::UnsignedByte: return GL_UNSIGNED_BYTE;
+        case AttributeType::Short: return GL_SHORT;
+        case AttributeType::HalfFloat: return GL_HALF_FLOAT;
+    }
+    return GL_FLOAT;
+}
+
+void SetVertexFormat(GLuint vertexArray, const MeshLayout& layout) {
+    // Same thing glVertexAttribPointer does, but with the format and the
+    // buffer set separately, so nothing has to be bound.
+    for (uint32_t i = 0; i < layout.AttributeCount; i++) {
+        const VertexAttribute& attribute = layout.Attributes[i];
+        GLCall(glEnableVertexArrayAttrib(vertexArray, attribute.Location));
+        GLCall(glVertexArrayAttribFormat(vertexArray, attribute.Location, attribute.Components,
+                                         ToGLType(attribute.Type), attribute.Normalized ? GL_TRUE : GL_FALSE,
+                                         attribute.Offset));
+        GLCall(glVertexArrayAttribBinding(vertexArray, attribute.Location, 0));
+    }
+}
+
+bool SameLayout(const MeshLayout& a, const MeshLayout& b) {
+    if (a.Stride != b.Stride || a.AttributeCount != b.AttributeCount) {
+        return false;
+    }
+    for (uint32_t i = 0; i < a.AttributeCount; i++) {
+        const VertexAttribute& x = a.Attributes[i];
+        const VertexAttribute& y = b.Attributes[i];
+        if (x.Location != y.Location || x.Components != y.Components || x.Type != y.Type ||
+            x.Normalized != y.Normalized || x.Offset != y.Offset) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// An immutable buffer, from the pool if there is one. No flags: the
+// buffers of a mesh are never touched by the CPU again.
+static GLuint CreateBuffer(ResourcePool* pool, BufferHandle& handle, const std::string& name, size_t bytes,
+                           const void* data) {
+    if (pool) {
+        handle = pool->CreateBuffer(name, bytes, data, 0, MemoryCategory::Geometry);
+        return pool->Get(handle);
+    }
+    GLuint buffer;
+    GLCall(glCreateBuffers(1, &buffer));
+    GLCall(glNamedBufferStorage(buffer, bytes, data, 0));
+    return buffer;
+}
+
+// Vertex pulling reads the vertex buffer as 32 bit words, so its size is
+// rounded up to 4 bytes. Only then is the data copied, the mapping may end
+// right after it.
+static GLuint CreateVertexBuffer(ResourcePool* pool, BufferHandle& handle, const std::string& name,
+                                 const void* data, size_t bytes) {
+    if (bytes % 4 == 0) {
+        return CreateBuffer(pool, handle, name, bytes, data);
+    }
+    std::vector<unsigned char> padded((bytes + 3) / 4 * 4, 0);
+    std::memcpy(padded.data(), data, bytes);
+    return CreateBuffer(pool, handle, name, padded.size(), padded.data());
+}
+
+bool CreateMesh(const MeshFile& file, Mesh& mesh, ResourcePool* pool, const std::string& name) {
+    if (file.VertexBytes == 0 || file.IndexBytes == 0) {
+        return false;
+    }
+
+    mesh.Pool = pool;
+    mesh.Handles = {};
+    mesh.MemoryId = 0;
+    mesh.VertexBuffer = CreateVertexBuffer(pool, mesh.Handles.VertexBuffer, name + " vertices", file.Vertices,
+                                           file.VertexBytes);
+    mesh.IndexBuffer = CreateBuffer(pool, mesh.Handles.IndexBuffer, name + " indices", file.IndexBytes, file.Indices);
+
+    PullFormat format = MakePullFormat(file.Layout);
+    mesh.FormatBuffer = CreateBuffer(pool, mesh.Handles.FormatBuffer, name + " format", sizeof(format), &format);
+
+    if (pool) {
+        mesh.Handles.VertexArray = pool->CreateVertexArray(name);
+        mesh.VertexArray = pool->Get(mesh.Handles.VertexArray);
+    }
+    else {
+        GLCall(glCreateVertexArrays(1, &mesh.VertexArray));
+        mesh.MemoryId = TrackGpuMemory(MemoryCategory::Geometry, name,
+                                       (file.VertexBytes + 3) / 4 * 4 + file.IndexBytes + sizeof(format));
+    }
+    SetVertexFormat(mesh.VertexArray, file.Layout);
+    GLCall(glVertexArrayVertexBuffer(mesh.VertexArray, 0, mesh.VertexBuffer, 0, file.Layout.Stride));
+    GLCall(glVertexArrayElementBuffer(mesh.VertexArray, mesh.IndexBuffer));
+
+    mesh.IndexType = file.IndexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    mesh.BoundsMin = file.BoundsMin;
+    mesh.BoundsMax = file.BoundsMax;
+    mesh.LodCount = file.LodCount;
+    std::copy(file.Lods, file.Lods + file.LodCount, mesh.Lods);
+    return true;
+}
+
+bool LoadMesh(const std::string& filepath, Mesh& mesh, ResourcePool* pool) {
+    MeshFile file;
+    if (!LoadMeshFile(filepath, file) || !CreateMesh(file, mesh, pool, filepath)) {
+        std::cerr << "Failed to load mesh " << filepath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void DeleteMesh(Mesh& mesh) {
+    if (mesh.Pool) {
+        mesh.Pool->Destroy(mesh.Handles.VertexArray);
+        mesh.Pool->Destroy(mesh.Handles.FormatBuffer);
+        mesh.Pool->Destroy(mesh.Handles.IndexBuffer);
+        mesh.Pool->Destroy(mesh.Handles.VertexBuffer);
+    }
+    else {
+        GLCall(glDeleteVertexArrays(1, &mesh.VertexArray));
+        GLCall(glDeleteBuffers(1, &mesh.FormatBuffer));
+        GLCall(glDeleteBuffers(1, &mesh.IndexBuffer));
+        GLCall(glDeleteBuffers(1, &mesh.VertexBuffer));
+        ReleaseGpuMemory(mesh.MemoryId);
+    }
+    mesh = {};
+}
+
+void DrawMesh(const Mesh& mesh, uint32_t lod) {
+    const MeshLod& level = mesh.Lods[std::min(lod, mesh.LodCount - 1)];
+    size_t indexSize = mesh.IndexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    GLCall(glBindVertexArray(mesh.VertexArray));
+    GLCall(glDrawElements(GL_TRIANGLES, level.IndexCount, mesh.IndexType,
+                          (const void*)(level.IndexOffset * indexSize)));
+}
+
+void DrawPulledMesh(const Mesh& mesh, uint32_t lod, uint32_t instanceCount) {
+    const MeshLod& level = mesh.Lods[std::min(lod, mesh.LodCount - 1)];
+    size_t indexSize = mesh.IndexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PULL_VERTEX_BINDING, mesh.VertexBuffer));
+    GLCall(glBindBufferBase(GL_UNIFORM_BUFFER, PULL_FORMAT_BINDING, mesh.FormatBuffer));
+
+    // Only for its index buffer: the shader has no inputs, so the attributes
+    // of the vertex array are never read.
+    GLCall(glBindVertexArray(mesh.VertexArray));
+    GLCall(glDrawElementsInstanced(GL_TRIANGLES, level.IndexCount, mesh.IndexType,
+                                   (const void*)(level.IndexOffset * indexSize), instanceCount));
+}
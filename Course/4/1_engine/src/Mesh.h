@@ -0,0 +1,74 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+
+#include "Math.h"
+#include "MeshFile.h"
+#include "ResourcePool.h"
+
+/*
+    A mesh on the GPU: one vertex buffer, one index buffer and the vertex
+    array that describes them. The layout comes from the file header, so the
+    same code draws any vertex format. Every level of detail is a range of
+    the same index buffer.
+
+    The same buffers can also be drawn with vertex pulling (VertexPulling.h),
+    for which the mesh keeps its format in a small uniform buffer.
+
+    Made through a ResourcePool (ResourcePool.h), the objects get names and
+    handles, and DeleteMesh hands them back to the pool, which deletes them
+    once the GPU is done with them. The plain GLuints stay in the mesh
+    either way, so drawing doesn't go through the pool.
+*/
+
+// What the pool knows the objects of a mesh by.
+struct MeshHandles {
+    VertexArrayHandle VertexArray;
+    BufferHandle VertexBuffer;
+    BufferHandle IndexBuffer;
+    BufferHandle FormatBuffer;
+};
+
+struct Mesh {
+    GLuint VertexArray;
+    GLuint VertexBuffer;
+    GLuint IndexBuffer;
+    // PullFormat, for DrawPulledMesh
+    GLuint FormatBuffer;
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, for glDrawElements
+    GLenum IndexType;
+    Vec3 BoundsMin;
+    Vec3 BoundsMax;
+    uint32_t LodCount;
+    MeshLod Lods[MeshFile::MaxLods];
+    // nullptr if the mesh owns its objects itself.
+    ResourcePool* Pool;
+    MeshHandles Handles;
+    // Without a pool: all three buffers, booked as one (GpuMemory.h).
+    uint32_t MemoryId;
+};
+
+// The blobs go from the mapping straight into immutable buffers
+// (glNamedBufferStorage); the driver makes the only copy.
+// With a pool, the objects are named after name.
+bool CreateMesh(const MeshFile& file, Mesh& mesh, ResourcePool* pool = nullptr, const std::string& name = "mesh");
+
+// LoadMeshFile + CreateMesh. The file is unmapped again right after.
+bool LoadMesh(const std::string& filepath, Mesh& mesh, ResourcePool* pool = nullptr);
+
+void DeleteMesh(Mesh& mesh);
+
+// Enables the attributes of the layout on the vertex array and reads them
+// all from buffer binding 0. The buffers themselves are up to the caller.
+void SetVertexFormat(GLuint vertexArray, const MeshLayout& layout);
+
+bool SameLayout(const MeshLayout& a, const MeshLayout& b);
+
+// Draws one level of detail (0 is full detail) with whatever program is bound.
+void DrawMesh(const Mesh& mesh, uint32_t lod = 0);
+
+// Same, for programs with #pull attributes: binds the vertex buffer as a
+// storage buffer and draws instanceCount copies with glDrawElementsInstanced.
+void DrawPulledMesh(const Mesh& mesh, uint32_t lod = 0, uint32_t instanceCount = 1);
@@ -0,0 +1,186 @@
+#include "MeshArena.h"
+
+#include <algorithm>
+
+#include "Mesh.h"
+#include "Renderer.h"
+#include "Timing.h"
+
+// Index ranges are handed out in steps of this many bytes.
+static const uint32_t INDEX_UNIT = 4;
+
+MeshArena::MeshArena(ResourcePool& pool, const std::string& name, const MeshLayout& layout, uint32_t vertexBytes,
+                     uint32_t indexBytes)
+    : m_Pool(pool), m_Name(name), m_Layout(layout), m_VertexSpace(vertexBytes / layout.Stride),
+      m_IndexSpace(indexBytes / INDEX_UNIT) {
+    m_VertexArray = m_Pool.CreateVertexArray(m_Name);
+    m_VertexArrayId = m_Pool.Get(m_VertexArray);
+    SetVertexFormat(m_VertexArrayId, m_Layout);
+    CreateBuffers();
+}
+
+MeshArena::~MeshArena() {
+    m_Pool.Destroy(m_VertexBuffer);
+    m_Pool.Destroy(m_IndexBuffer);
+    m_Pool.Destroy(m_VertexArray);
+}
+
+// Empty buffers of the full size, attached to the vertex array. The old
+// ones (if any) are the caller's to destroy.
+void MeshArena::CreateBuffers() {
+    m_VertexBuffer = m_Pool.CreateBuffer(m_Name + " vertices", (GLsizeiptr)m_VertexSpace.GetSize() * m_Layout.Stride,
+                                         nullptr, GL_DYNAMIC_STORAGE_BIT, MemoryCategory::Geometry);
+    m_IndexBuffer = m_Pool.CreateBuffer(m_Name + " indices", (GLsizeiptr)m_IndexSpace.GetSize() * INDEX_UNIT, nullptr,
+                                        GL_DYNAMIC_STORAGE_BIT, MemoryCategory::Geometry);
+    GLCall(glVertexArrayVertexBuffer(m_VertexArrayId, 0, m_Pool.Get(m_VertexBuffer), 0, m_Layout.Stride));
+    GLCall(glVertexArrayElementBuffer(m_VertexArrayId, m_Pool.Get(m_IndexBuffer)));
+}
+
+uint32_t MeshArena::Add(const MeshFile& file) {
+    if (!SameLayout(file.Layout, m_Layout) || file.VertexCount == 0 || file.IndexBytes == 0) {
+        return NoMesh;
+    }
+
+    Clock::time_point start = Clock::now();
+    RangeAllocator::Allocation vertices = m_VertexSpace.Allocate(file.VertexCount);
+    RangeAllocator::Allocation indices = m_IndexSpace.Allocate((uint32_t)((file.IndexBytes + INDEX_UNIT - 1) / INDEX_UNIT));
+    m_AllocateSeconds += Seconds(start);
+    m_Allocations += 2;
+
+    if (vertices.Node == RangeAllocator::NoSpace || indices.Node == RangeAllocator::NoSpace) {
+        m_VertexSpace.Free(vertices);
+        m_IndexSpace.Free(indices);
+        return NoMesh;
+    }
+
+    GLCall(glNamedBufferSubData(m_Pool.Get(m_VertexBuffer), (GLintptr)vertices.Offset * m_Layout.Stride,
+                                (GLsizeiptr)file.VertexCount * m_Layout.Stride, file.Vertices));
+    GLCall(glNamedBufferSubData(m_Pool.Get(m_IndexBuffer), (GLintptr)indices.Offset * INDEX_UNIT, file.IndexBytes,
+                                file.Indices));
+
+    uint32_t id;
+    if (!m_FreeMeshes.empty()) {
+        id = m_FreeMeshes.back();
+        m_FreeMeshes.pop_back();
+    }
+    else {
+        id = (uint32_t)m_Meshes.size();
+        m_Meshes.emplace_back();
+    }
+
+    ArenaMesh& mesh = m_Meshes[id];
+    mesh.Vertices = vertices;
+    mesh.Indices = indices;
+    mesh.IndexType = file.IndexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    mesh.BoundsMin = file.BoundsMin;
+    mesh.BoundsMax = file.BoundsMax;
+    mesh.LodCount = file.LodCount;
+    std::copy(file.Lods, file.Lods + file.LodCount, mesh.Lods);
+    mesh.Used = true;
+    return id;
+}
+
+void MeshArena::Remove(uint32_t id) {
+    if (id >= m_Meshes.size() || !m_Meshes[id].Used) {
+        return;
+    }
+    // The bytes stay in the buffer until something else is put there, and
+    // a draw the GPU still has queued reads them just fine.
+    m_VertexSpace.Free(m_Meshes[id].Vertices);
+    m_IndexSpace.Free(m_Meshes[id].Indices);
+    m_Meshes[id].Used = false;
+    m_FreeMeshes.push_back(id);
+}
+
+void MeshArena::Bind() const {
+    GLCall(glBindVertexArray(m_VertexArrayId));
+}
+
+void MeshArena::Draw(uint32_t id, uint32_t lod) const {
+    const ArenaMesh& mesh = m_Meshes[id];
+    const MeshLod& level = mesh.Lods[std::min(lod, mesh.LodCount - 1)];
+    size_t indexSize = mesh.IndexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    size_t offset = (size_t)mesh.Indices.Offset * INDEX_UNIT + level.IndexOffset * indexSize;
+    GLCall(glDrawElementsBaseVertex(GL_TRIANGLES, level.IndexCount, mesh.IndexType, (const void*)offset,
+                                    (GLint)mesh.Vertices.Offset));
+}
+
+void MeshArena::Defragment() {
+    BufferHandle oldVertices = m_VertexBuffer;
+    BufferHandle oldIndices = m_IndexBuffer;
+    GLuint oldVertexBuffer = m_Pool.Get(oldVertices);
+    GLuint oldIndexBuffer = m_Pool.Get(oldIndices);
+    CreateBuffers();
+    GLuint vertexBuffer = m_Pool.Get(m_VertexBuffer);
+    GLuint indexBuffer = m_Pool.Get(m_IndexBuffer);
+
+    // In the order they sit in the old buffers. Starting from an empty
+    // space, every allocation goes right behind the one before.
+    std::vector<uint32_t> order;
+    for (uint32_t id = 0; id < m_Meshes.size(); id++) {
+        if (m_Meshes[id].Used) {
+            order.push_back(id);
+        }
+    }
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return m_Meshes[a].Vertices.Offset < m_Meshes[b].Vertices.Offset;
+    });
+
+    RangeAllocator oldVertexSpace = m_VertexSpace;
+    RangeAllocator oldIndexSpace = m_IndexSpace;
+    m_VertexSpace.Reset();
+    m_IndexSpace.Reset();
+    for (uint32_t id : order) {
+        ArenaMesh& mesh = m_Meshes[id];
+        uint32_t vertexCount = oldVertexSpace.GetSize(mesh.Vertices);
+        uint32_t indexUnits = oldIndexSpace.GetSize(mesh.Indices);
+        RangeAllocator::Allocation vertices = m_VertexSpace.Allocate(vertexCount);
+        RangeAllocator::Allocation indices = m_IndexSpace.Allocate(indexUnits);
+        GLCall(glCopyNamedBufferSubData(oldVertexBuffer, vertexBuffer, (GLintptr)mesh.Vertices.Offset * m_Layout.Stride,
+                                        (GLintptr)vertices.Offset * m_Layout.Stride,
+                                        (GLsizeiptr)vertexCount * m_Layout.Stride));
+        GLCall(glCopyNamedBufferSubData(oldIndexBuffer, indexBuffer, (GLintptr)mesh.Indices.Offset * INDEX_UNIT,
+                                        (GLintptr)indices.Offset * INDEX_UNIT, (GLsizeiptr)indexUnits * INDEX_UNIT));
+        mesh.Vertices = vertices;
+        mesh.Indices = indices;
+    }
+
+    m_Pool.Destroy(oldVertices);
+    m_Pool.Destroy(oldIndices);
+    m_Defragmentations++;
+}
+
+MeshArenaStats MeshArena::GetStats() const {
+    MeshArenaStats stats;
+    stats.Meshes = m_Meshes.size() - m_FreeMeshes.size();
+    stats.VertexBytes = (size_t)m_VertexSpace.GetSize() * m_Layout.Stride;
+    stats.VertexBytesUsed = (size_t)(m_VertexSpace.GetSize() - m_VertexSpace.GetFreeSize()) * m_Layout.Stride;
+    stats.VertexLargestFree = (size_t)m_VertexSpace.GetLargestFreeBlock() * m_Layout.Stride;
+    stats.IndexBytes = (size_t)m_IndexSpace.GetSize() * INDEX_UNIT;
+    stats.IndexBytesUsed = (size_t)(m_IndexSpace.GetSize() - m_IndexSpace.GetFreeSize()) * INDEX_UNIT;
+    stats.IndexLargestFree = (size_t)m_IndexSpace.GetLargestFreeBlock() * INDEX_UNIT;
+    stats.AllocateSeconds = m_AllocateSeconds;
+    stats.Allocations = m_Allocations;
+    stats.Defragmentations = m_Defragmentations;
+    return stats;
+}
+
+static double Fragmentation(size_t total, size_t used, size_t largestFree) {
+    size_t free = total - used;
+    return free > 0 ? 1.0 - (double)largestFree / free : 0.0;
+}
+
+void MeshArena::PrintStats(std::ostream& out) const {
+    MeshArenaStats stats = GetStats();
+    out << m_Name << ": " << stats.Meshes << " meshes\n";
+    out << "  vertices: " << stats.VertexBytesUsed / 1024 << " of " << stats.VertexBytes / 1024
+        << " KB used, fragmentation " << Fragmentation(stats.VertexBytes, stats.VertexBytesUsed, stats.VertexLargestFree)
+        << "\n";
+    out << "  indices:  " << stats.IndexBytesUsed / 1024 << " of " << stats.IndexBytes / 1024
+        << " KB used, fragmentation " << Fragmentation(stats.IndexBytes, stats.IndexBytesUsed, stats.IndexLargestFree)
+        << "\n";
+    if (stats.Allocations > 0) {
+        out << "  " << stats.AllocateSeconds * 1e9 / stats.Allocations << " ns per allocation, "
+            << stats.Defragmentations << " defragmentations\n";
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Math.h"
+#include "MeshFile.h"
+#include "RangeAllocator.h"
+#include "ResourcePool.h"
+
+/*
+        MESH ARENA
+    CreateMesh makes three buffers and a vertex array for every mesh. For a
+    handful of big meshes that's fine. For tens of thousands of small ones it
+    is tens of thousands of driver allocations, and a glBindVertexArray
+    before every single draw.
+
+    An arena is one big vertex buffer and one big index buffer that many
+    meshes share, carved up by a RangeAllocator (RangeAllocator.h):
+    - vertex ranges are counted in whole vertices, so a mesh starts at a
+      vertex index, and glDrawElementsBaseVertex adds that to every index.
+      The indices in the file stay exactly as they are.
+    - index ranges are counted in 4 byte steps, so 16 and 32 bit indices can
+      share the buffer; every draw says which type it reads.
+    There is one vertex array for the whole arena: Bind() once, then every
+    Draw() is just an offset into the buffers. Since the vertex format lives
+    in the vertex array, all meshes of an arena have the same layout.
+
+    Adding and removing meshes leaves holes. Defragment() copies the meshes
+    that are still there into new buffers, one after another, with
+    glCopyNamedBufferSubData (all on the GPU, nothing comes back to the
+    CPU), and gives the old buffers back to the ResourcePool, which deletes
+    them once the GPU is done with them. Mesh ids stay the same.
+*/
+
+// Where one mesh lives in the arena.
+struct ArenaMesh {
+    RangeAllocator::Allocation Vertices;
+    RangeAllocator::Allocation Indices;
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GLenum IndexType;
+    Vec3 BoundsMin;
+    Vec3 BoundsMax;
+    uint32_t LodCount;
+    MeshLod Lods[MeshFile::MaxLods];
+    bool Used;
+};
+
+struct MeshArenaStats {
+    size_t Meshes = 0;
+    size_t VertexBytes = 0;
+    size_t VertexBytesUsed = 0;
+    size_t VertexLargestFree = 0;
+    size_t IndexBytes = 0;
+    size_t IndexBytesUsed = 0;
+    size_t IndexLargestFree = 0;
+    // Time spent in RangeAllocator::Allocate, over Allocations calls.
+    double AllocateSeconds = 0.0;
+    size_t Allocations = 0;
+    size_t Defragmentations = 0;
+};
+
+class MeshArena {
+public:
+    static const uint32_t NoMesh = 0xffffffff;
+
+    // All meshes added must have this layout.
+    MeshArena(ResourcePool& pool, const std::string& name, const MeshLayout& layout, uint32_t vertexBytes,
+              uint32_t indexBytes);
+    ~MeshArena();
+
+    MeshArena(const MeshArena&) = delete;
+    MeshArena& operator=(const MeshArena&) = delete;
+
+    // Copies the vertices and indices of the file in. NoMesh if the layout
+    // differs or the arena has no hole big enough (Defragment() may help).
+    uint32_t Add(const MeshFile& file);
+    void Remove(uint32_t mesh);
+
+    const ArenaMesh& GetMesh(uint32_t mesh) const { return m_Meshes[mesh]; }
+
+    // Binds the vertex array of the arena, for any number of Draw() calls.
+    void Bind() const;
+    // One level of detail of a mesh, with whatever program is bound.
+    void Draw(uint32_t mesh, uint32_t lod = 0) const;
+
+    // Packs all meshes to the start of new buffers.
+    void Defragment();
+
+    MeshArenaStats GetStats() const;
+
+    // Fragmentation is 1 - (largest hole / all free space): 0 when the free
+    // space is in one piece, close to 1 when it is in many small holes.
+    void PrintStats(std::ostream& out) const;
+
+private:
+    void CreateBuffers();
+
+    ResourcePool& m_Pool;
+    std::string m_Name;
+    MeshLayout m_Layout;
+    RangeAllocator m_VertexSpace;
+    RangeAllocator m_IndexSpace;
+    BufferHandle m_VertexBuffer;
+    BufferHandle m_IndexBuffer;
+    VertexArrayHandle m_VertexArray;
+    GLuint m_VertexArrayId = 0;
+    std::vector<ArenaMesh> m_Meshes;
+    std::vector<uint32_t> m_FreeMeshes;
+    double m_AllocateSeconds = 0.0;
+    size_t m_Allocations = 0;
+    size_t m_Defragmentations = 0;
+};
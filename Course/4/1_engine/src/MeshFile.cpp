@@ -0,0 +1,245 @@
+#include "MeshFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "Assets.h"
+
+static const uint32_t MESH_VERSION = 2;
+static const size_t BLOB_ALIGNMENT = 16;
+// Every GL driver has at least this many vertex attribute locations.
+static const uint32_t MAX_LOCATIONS = 16;
+
+struct MeshHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t VertexCount;
+    uint32_t IndexCount;
+    uint32_t IndexSize;
+    float BoundsMin[3];
+    float BoundsMax[3];
+    uint32_t LodCount;
+    uint64_t VertexOffset;
+    uint64_t IndexOffset;
+    MeshLayout Layout;
+    MeshLod Lods[MeshFile::MaxLods];
+};
+
+static_assert(sizeof(VertexAttribute) == 8, "VertexAttribute must match the file layout");
+static_assert(sizeof(MeshLod) == 16, "MeshLod must match the file layout");
+static_assert(sizeof(MeshHeader) == 64 + sizeof(MeshLayout) + 16 * MeshFile::MaxLods,
+              "MeshHeader must match the file layout");
+
+static size_t AttributeTypeSize(AttributeType type) {
+    switch (type) {
+        case AttributeType::Float: return 4;
+        case AttributeType::UnsignedByte: return 1;
+        case AttributeType::Short: return 2;
+        case AttributeType::HalfFloat: return 2;
+    }
+    return 0;
+}
+
+// The largest of count indices. memcpy, since nothing but the file says
+// the blob is aligned.
+template <typename T>
+static uint32_t MaxIndex(const unsigned char* indices, size_t count) {
+    T largest = 0;
+    for (size_t i = 0; i < count; i++) {
+        T index;
+        std::memcpy(&index, indices + i * sizeof(T), sizeof(T));
+        largest = std::max(largest, index);
+    }
+    return largest;
+}
+
+bool ParseMeshFile(const unsigned char* data, size_t size, MeshFile& mesh) {
+    if (size < sizeof(MeshHeader)) {
+        return false;
+    }
+
+    MeshHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.Magic, "GLMS", 4) != 0 || header.Version != MESH_VERSION ||
+        (header.IndexSize != 2 && header.IndexSize != 4) ||
+        header.Layout.AttributeCount > (uint32_t)MeshLayout::MaxAttributes ||
+        header.LodCount == 0 || header.LodCount > (uint32_t)MeshFile::MaxLods) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.LodCount; i++) {
+        if ((uint64_t)header.Lods[i].IndexOffset + header.Lods[i].IndexCount > header.IndexCount) {
+            return false;
+        }
+    }
+
+    // Every attribute must be something GL (and the vertex pulling shader,
+    // which reads at most a vec4) understands, and fit inside of a vertex.
+    // AttributeTypeSize is 0 for a type that isn't in the enum.
+    for (uint32_t i = 0; i < header.Layout.AttributeCount; i++) {
+        const VertexAttribute& attribute = header.Layout.Attributes[i];
+        size_t typeSize = AttributeTypeSize(attribute.Type);
+        if (typeSize == 0 || attribute.Components < 1 || attribute.Components > 4 ||
+            attribute.Location >= MAX_LOCATIONS ||
+            attribute.Offset + attribute.Components * typeSize > header.Layout.Stride) {
+            return false;
+        }
+    }
+
+    size_t vertexBytes = (size_t)header.VertexCount * header.Layout.Stride;
+    size_t indexBytes = (size_t)header.IndexCount * header.IndexSize;
+    if (header.VertexOffset + vertexBytes > size || header.IndexOffset + indexBytes > size) {
+        return false;
+    }
+
+    // Every LOD range is in the index blob, so checking the whole blob once
+    // checks them all. An index past the vertices would make the CPU
+    // (CopyIndices, the occluder) and the GPU read outside of them.
+    if (header.IndexCount > 0) {
+        const unsigned char* indices = data + header.IndexOffset;
+        uint32_t largest = header.IndexSize == 2 ? MaxIndex<uint16_t>(indices, header.IndexCount)
+                                                 : MaxIndex<uint32_t>(indices, header.IndexCount);
+        if (largest >= header.VertexCount) {
+            return false;
+        }
+    }
+
+    mesh.Layout = header.Layout;
+    mesh.VertexCount = header.VertexCount;
+    mesh.IndexCount = header.IndexCount;
+    mesh.IndexSize = header.IndexSize;
+    mesh.BoundsMin = {header.BoundsMin[0], header.BoundsMin[1], header.BoundsMin[2]};
+    mesh.BoundsMax = {header.BoundsMax[0], header.BoundsMax[1], header.BoundsMax[2]};
+    mesh.LodCount = header.LodCount;
+    std::memcpy(mesh.Lods, header.Lods, sizeof(mesh.Lods));
+    mesh.Vertices = data + header.VertexOffset;
+    mesh.VertexBytes = vertexBytes;
+    mesh.Indices = data + header.IndexOffset;
+    mesh.IndexBytes = indexBytes;
+    return true;
+}
+
+bool LoadMeshFile(const std::string& filepath, MeshFile& mesh) {
+    const unsigned char* data;
+    size_t size;
+    if (MapAsset(filepath, data, size)) {
+        return ParseMeshFile(data, size, mesh);
+    }
+
+    if (!mesh.File.Open(filepath)) {
+        return false;
+    }
+    return ParseMeshFile(mesh.File.GetData(), mesh.File.GetSize(), mesh);
+}
+
+bool SaveMeshFile(const std::string& filepath, const MeshLayout& layout, const void* vertices,
+                  uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+                  const MeshLod* lods, uint32_t lodCount) {
+    if (lodCount > (uint32_t)MeshFile::MaxLods) {
+        return false;
+    }
+
+    MeshHeader header = {};
+    std::memcpy(header.Magic, "GLMS", 4);
+    header.Version = MESH_VERSION;
+    header.VertexCount = vertexCount;
+    header.IndexCount = indexCount;
+    header.IndexSize = vertexCount <= 65536 ? 2 : 4;
+    header.Layout = layout;
+    if (lodCount > 0) {
+        header.LodCount = lodCount;
+        std::memcpy(header.Lods, lods, lodCount * sizeof(MeshLod));
+    }
+    else {
+        header.LodCount = 1;
+        header.Lods[0] = {0, indexCount, 0.0f, 0};
+    }
+
+    // The bounds come from the position, which is the attribute at location 0
+    // (three floats, like everywhere else in the engine).
+    for (int c = 0; c < 3; c++) {
+        header.BoundsMin[c] = vertexCount ? 1e30f : 0.0f;
+        header.BoundsMax[c] = vertexCount ? -1e30f : 0.0f;
+    }
+    for (uint32_t i = 0; i < layout.AttributeCount; i++) {
+        const VertexAttribute& attribute = layout.Attributes[i];
+        if (attribute.Location != 0 || attribute.Type != AttributeType::Float || attribute.Components < 3) {
+            continue;
+        }
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            float position[3];
+            std::memcpy(position, (const unsigned char*)vertices + (size_t)v * layout.Stride + attribute.Offset,
+                        sizeof(position));
+            for (int c = 0; c < 3; c++) {
+                header.BoundsMin[c] = std::min(header.BoundsMin[c], position[c]);
+                header.BoundsMax[c] = std::max(header.BoundsMax[c], position[c]);
+            }
+        }
+    }
+
+    size_t vertexBytes = (size_t)vertexCount * layout.Stride;
+    header.VertexOffset = (sizeof(MeshHeader) + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+    header.IndexOffset = (header.VertexOffset + vertexBytes + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+
+    static const char padding[BLOB_ALIGNMENT] = {};
+    std::ofstream output(filepath, std::ios::binary);
+    output.write((const char*)&header, sizeof(header));
+    output.write(padding, header.VertexOffset - sizeof(header));
+    output.write((const char*)vertices, vertexBytes);
+    output.write(padding, header.IndexOffset - header.VertexOffset - vertexBytes);
+
+    if (header.IndexSize == 2) {
+        std::vector<uint16_t> shortIndices(indices, indices + indexCount);
+        output.write((const char*)shortIndices.data(), shortIndices.size() * sizeof(uint16_t));
+    }
+    else {
+        output.write((const char*)indices, (size_t)indexCount * sizeof(uint32_t));
+    }
+
+    return (bool)output;
+}
+
+void CopyPositions(const MeshFile& mesh, std::vector<float>& positions) {
+    positions.assign((size_t)mesh.VertexCount * 3, 0.0f);
+    for (uint32_t i = 0; i < mesh.Layout.AttributeCount; i++) {
+        const VertexAttribute& attribute = mesh.Layout.Attributes[i];
+        if (attribute.Location != 0 || attribute.Type != AttributeType::Float || attribute.Components < 3) {
+            continue;
+        }
+        for (uint32_t v = 0; v < mesh.VertexCount; v++) {
+            std::memcpy(&positions[(size_t)v * 3], mesh.Vertices + (size_t)v * mesh.Layout.Stride + attribute.Offset,
+                        3 * sizeof(float));
+        }
+    }
+}
+
+void CopyIndices(const MeshFile& mesh, std::vector<unsigned int>& indices, uint32_t lod) {
+    const MeshLod& level = mesh.Lods[std::min(lod, mesh.LodCount - 1)];
+    indices.resize(level.IndexCount);
+    for (uint32_t i = 0; i < level.IndexCount; i++) {
+        size_t index = (size_t)level.IndexOffset + i;
+        if (mesh.IndexSize == 2) {
+            uint16_t shortIndex;
+            std::memcpy(&shortIndex, mesh.Indices + index * 2, 2);
+            indices[i] = shortIndex;
+        }
+        else {
+            std::memcpy(&indices[i], mesh.Indices + index * 4, 4);
+        }
+    }
+}
+
+uint32_t SelectLod(const MeshLod* lods, uint32_t lodCount, float worldScale, float distance,
+                   float pixelsPerUnit, float maxPixels) {
+    // Inside (or right at) the object every error is huge, take full detail.
+    if (distance <= 0.0f) {
+        return 0;
+    }
+    for (uint32_t i = lodCount; i-- > 1;) {
+        if (lods[i].Error * worldScale / distance * pixelsPerUnit <= maxPixels) {
+            return i;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Math.h"
+#include "MappedFile.h"
+
+/*
+        BINARY MESH FILES
+    Up to now our vertices were C arrays in main(). A text format (like OBJ)
+    would have to be parsed on every startup. Here the file holds the vertex
+    and index buffers byte for byte the way glVertexAttribPointer and
+    glDrawElements want them, plus a header that says how to read them:
+
+        header      "GLMS", counts, index size, bounds, vertex layout, LOD table
+        vertices    VertexCount * Stride bytes, 16 byte aligned
+        indices     IndexCount * IndexSize bytes (2 or 4), 16 byte aligned
+
+    All levels of detail (see Simplify.h) share the vertices and sit one after
+    the other in the indices; the LOD table says where each one is.
+
+    Loading is: map the file, check the header, hand the two pointers to
+    OpenGL. There is nothing to parse.
+*/
+
+enum class AttributeType : uint8_t {
+    Float,
+    UnsignedByte,
+    Short,
+    HalfFloat
+};
+
+struct VertexAttribute {
+    uint8_t Location;
+    uint8_t Components;
+    AttributeType Type;
+    uint8_t Normalized;
+    uint32_t Offset;
+};
+
+struct MeshLayout {
+    static const int MaxAttributes = 8;
+
+    uint32_t Stride;
+    uint32_t AttributeCount;
+    VertexAttribute Attributes[MaxAttributes];
+};
+
+// One level of detail: a range of the index buffer, and how far (in mesh
+// units) its surface is from the full detail one.
+struct MeshLod {
+    uint32_t IndexOffset;
+    uint32_t IndexCount;
+    float Error;
+    uint32_t Reserved;
+};
+
+struct MeshFile {
+    static const int MaxLods = 8;
+
+    MeshLayout Layout;
+    uint32_t VertexCount;
+    uint32_t IndexCount;
+    // 2 (GL_UNSIGNED_SHORT) or 4 (GL_UNSIGNED_INT)
+    uint32_t IndexSize;
+    Vec3 BoundsMin;
+    Vec3 BoundsMax;
+    uint32_t LodCount;
+    MeshLod Lods[MaxLods];
+
+    // Point into the mapping (or into the archive), valid while the MeshFile lives.
+    const unsigned char* Vertices;
+    size_t VertexBytes;
+    const unsigned char* Indices;
+    size_t IndexBytes;
+
+    MappedFile File;
+};
+
+// Maps the file (from the archive if it is there, see Assets.h) and checks the header.
+bool LoadMeshFile(const std::string& filepath, MeshFile& mesh);
+
+// Same, for data that is already in memory and outlives the MeshFile.
+bool ParseMeshFile(const unsigned char* data, size_t size, MeshFile& mesh);
+
+// Writes a mesh file. Indices are stored as 16 bit when every one of them fits.
+// Without lods, all of the indices are one level.
+bool SaveMeshFile(const std::string& filepath, const MeshLayout& layout, const void* vertices,
+                  uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+                  const MeshLod* lods = nullptr, uint32_t lodCount = 0);
+
+/*
+    Picks the simplest level whose error, projected on the screen, stays
+    under maxPixels. An error of e at distance d covers about
+    e / d * pixelsPerUnit pixels, where pixelsPerUnit is
+    viewportHeight / (2 * tan(fovY / 2)). worldScale is the largest scale of
+    the model matrix (errors are in mesh units).
+*/
+uint32_t SelectLod(const MeshLod* lods, uint32_t lodCount, float worldScale, float distance,
+                   float pixelsPerUnit, float maxPixels);
+
+// CPU copies of the positions (location 0) and the indices of one level, for
+// things like the occlusion buffer that work on the geometry without the GPU.
+void CopyPositions(const MeshFile& mesh, std::vector<float>& positions);
+void CopyIndices(const MeshFile& mesh, std::vector<unsigned int>& indices, uint32_t lod = 0);
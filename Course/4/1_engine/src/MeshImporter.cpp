@@ -0,0 +1,959 @@
+#include "MeshImporter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <thread>
+
+#include "MappedFile.h"
+
+static unsigned int ResolveThreadCount(unsigned int threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    return std::max(1u, threadCount);
+}
+
+// Calls body(0) ... body(count - 1) on up to threadCount threads, the calling
+// thread included. Every thread takes the next index until none are left.
+static void ParallelFor(size_t count, unsigned int threadCount, const std::function<void(size_t)>& body) {
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            body(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < threadCount && t < count; t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+// More chunks than threads, so a thread that got easy chunks simply takes more of them.
+static size_t ChunkCount(size_t bytes, unsigned int threadCount) {
+    const size_t minChunkBytes = 256 * 1024;
+    return std::max<size_t>(1, std::min<size_t>(threadCount * 8, bytes / minChunkBytes));
+}
+
+// Cuts [begin, end) into count pieces that all start at the beginning of a line.
+static std::vector<const char*> SplitLines(const char* begin, const char* end, size_t count) {
+    std::vector<const char*> bounds(1, begin);
+    for (size_t i = 1; i < count; i++) {
+        const char* split = std::max(begin + (end - begin) / count * i, bounds.back());
+        const char* lineEnd = (const char*)std::memchr(split, '\n', end - split);
+        bounds.push_back(lineEnd ? lineEnd + 1 : end);
+    }
+    bounds.push_back(end);
+    return bounds;
+}
+
+static const char* SkipSpaces(const char* s, const char* end) {
+    while (s < end && (*s == ' ' || *s == '\t' || *s == '\r')) {
+        s++;
+    }
+    return s;
+}
+
+static const char* NextLine(const char* s, const char* end) {
+    const char* lineEnd = (const char*)std::memchr(s, '\n', end - s);
+    return lineEnd ? lineEnd + 1 : end;
+}
+
+// Returns the start of the line `lines` lines after begin. The line breaks
+// are counted in parallel first, so only one chunk is searched serially.
+static const char* SkipLines(const char* begin, const char* end, size_t lines, unsigned int threadCount) {
+    if (lines == 0) {
+        return begin;
+    }
+
+    size_t chunkCount = ChunkCount(end - begin, threadCount);
+    std::vector<size_t> counts(chunkCount);
+    ParallelFor(chunkCount, threadCount, [&](size_t i) {
+        counts[i] = std::count(begin + (end - begin) * i / chunkCount, begin + (end - begin) * (i + 1) / chunkCount, '\n');
+    });
+
+    for (size_t i = 0; i < chunkCount; i++) {
+        if (lines > counts[i]) {
+            lines -= counts[i];
+            continue;
+        }
+        const char* s = begin + (end - begin) * i / chunkCount;
+        for (;;) {
+            s = (const char*)std::memchr(s, '\n', end - s) + 1;
+            if (--lines == 0) {
+                return s;
+            }
+        }
+    }
+    return end;
+}
+
+// std::from_chars skips neither spaces nor a leading '+'.
+template <typename T>
+static bool ParseNumber(const char*& s, const char* end, T& value) {
+    s = SkipSpaces(s, end);
+    if (s < end && *s == '+') {
+        s++;
+    }
+    std::from_chars_result result = std::from_chars(s, end, value);
+    if (result.ec != std::errc()) {
+        return false;
+    }
+    s = result.ptr;
+    return true;
+}
+
+static void SetLayout(MeshLayout& layout, bool hasTexCoords, bool hasNormals) {
+    layout = {};
+    layout.Attributes[layout.AttributeCount++] = {0, 3, AttributeType::Float, 0, 0};
+    layout.Stride = 3 * sizeof(float);
+    if (hasTexCoords) {
+        layout.Attributes[layout.AttributeCount++] = {1, 2, AttributeType::Float, 0, layout.Stride};
+        layout.Stride += 2 * sizeof(float);
+    }
+    if (hasNormals) {
+        layout.Attributes[layout.AttributeCount++] = {2, 3, AttributeType::Float, 0, layout.Stride};
+        layout.Stride += 3 * sizeof(float);
+    }
+}
+
+// Writes one vertex in the SetLayout order. texCoord and normal are null
+// when the layout doesn't have them.
+static void StoreVertex(unsigned char* out, const float* position, const float* texCoord, const float* normal) {
+    std::memcpy(out, position, 3 * sizeof(float));
+    out += 3 * sizeof(float);
+    if (texCoord) {
+        std::memcpy(out, texCoord, 2 * sizeof(float));
+        out += 2 * sizeof(float);
+    }
+    if (normal) {
+        std::memcpy(out, normal, 3 * sizeof(float));
+    }
+}
+
+// Joins the per-chunk results in order, copying them in parallel.
+template <typename T>
+static void Concatenate(std::vector<std::vector<T>>& parts, std::vector<T>& result, unsigned int threadCount) {
+    std::vector<size_t> offsets(parts.size() + 1, 0);
+    for (size_t i = 0; i < parts.size(); i++) {
+        offsets[i + 1] = offsets[i] + parts[i].size();
+    }
+    result.resize(offsets.back());
+    ParallelFor(parts.size(), threadCount, [&](size_t i) {
+        std::copy(parts[i].begin(), parts[i].end(), result.begin() + offsets[i]);
+        std::vector<T>().swap(parts[i]);
+    });
+}
+
+bool ImportMesh(const std::string& filepath, ImportedMesh& mesh, unsigned int threadCount) {
+    size_t dot = filepath.rfind('.');
+    std::string extension = dot == std::string::npos ? "" : filepath.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == ".ply") {
+        return ImportPly(filepath, mesh, threadCount);
+    }
+    return ImportObj(filepath, mesh, threadCount);
+}
+
+/*
+        OBJ
+    Faces can refer to vertices with negative indices, counting back from the
+    last vertex read so far. A chunk in the middle of the file can't know that
+    count on its own, so every chunk is read twice: the first pass only counts
+    the v/vt/vn lines, and after adding those up every chunk knows exactly
+    where its own lists start. The second pass then writes the numbers right
+    into their final place in the merged lists.
+*/
+
+// One corner of a face: 0 based indices into the v, vt and vn lists (-1 if missing).
+struct ObjCorner {
+    int Position;
+    int TexCoord;
+    int Normal;
+
+    bool operator==(const ObjCorner& other) const {
+        return Position == other.Position && TexCoord == other.TexCoord && Normal == other.Normal;
+    }
+};
+
+// Open addressing table from a corner to its vertex index. It is sized for
+// the worst case up front, so it never has to grow.
+class CornerTable {
+public:
+    explicit CornerTable(size_t maxEntries) {
+        size_t capacity = 16;
+        while (capacity < maxEntries * 2) {
+            capacity *= 2;
+        }
+        m_Keys.resize(capacity);
+        m_Values.assign(capacity, Empty);
+        m_Mask = capacity - 1;
+    }
+
+    // Returns the index the corner already has, or gives it this one.
+    uint32_t Insert(const ObjCorner& corner, uint32_t index) {
+        uint64_t hash = (uint64_t)(uint32_t)corner.Position * 0x9E3779B97F4A7C15ull ^
+                        (uint64_t)(uint32_t)corner.TexCoord * 0xC2B2AE3D27D4EB4Full ^
+                        (uint64_t)(uint32_t)corner.Normal * 0x165667B19E3779F9ull;
+        size_t slot = (size_t)(hash ^ (hash >> 32)) & m_Mask;
+        while (m_Values[slot] != Empty) {
+            if (m_Keys[slot] == corner) {
+                return m_Values[slot];
+            }
+            slot = (slot + 1) & m_Mask;
+        }
+        m_Keys[slot] = corner;
+        m_Values[slot] = index;
+        return index;
+    }
+
+private:
+    static constexpr uint32_t Empty = 0xffffffffu;
+
+    std::vector<ObjCorner> m_Keys;
+    std::vector<uint32_t> m_Values;
+    size_t m_Mask;
+};
+
+struct ObjChunk {
+    const char* Begin;
+    const char* End;
+
+    // How many v/vt/vn lines the chunk has, and where they go in the merged lists.
+    size_t Positions = 0, TexCoords = 0, Normals = 0;
+    size_t PositionBase = 0, TexCoordBase = 0, NormalBase = 0;
+
+    // Three per triangle.
+    std::vector<ObjCorner> Corners;
+
+    // The distinct corners in the order this chunk met them, every corner as an
+    // index into those, and the final vertex index of each of them.
+    std::vector<ObjCorner> Unique;
+    std::vector<uint32_t> LocalIndices;
+    std::vector<uint32_t> Remap;
+    size_t IndexBase = 0;
+};
+
+enum class ObjLine {
+    Other,
+    Position,
+    TexCoord,
+    Normal,
+    Face
+};
+
+// Moves s past the keyword.
+static ObjLine ClassifyObjLine(const char*& s, const char* end) {
+    s = SkipSpaces(s, end);
+    if (end - s < 2) {
+        return ObjLine::Other;
+    }
+
+    bool space1 = s[1] == ' ' || s[1] == '\t';
+    bool space2 = end - s > 2 && (s[2] == ' ' || s[2] == '\t');
+    if (s[0] == 'v' && space1) {
+        s += 2;
+        return ObjLine::Position;
+    }
+    if (s[0] == 'v' && s[1] == 't' && space2) {
+        s += 3;
+        return ObjLine::TexCoord;
+    }
+    if (s[0] == 'v' && s[1] == 'n' && space2) {
+        s += 3;
+        return ObjLine::Normal;
+    }
+    if (s[0] == 'f' && space1) {
+        s += 2;
+        return ObjLine::Face;
+    }
+    return ObjLine::Other;
+}
+
+// OBJ indices start at 1, negative ones count back from the last one read (seen).
+static int ResolveIndex(long index, size_t seen, size_t total) {
+    if (index > 0) {
+        return index <= (long)total ? (int)index - 1 : -1;
+    }
+    if (index < 0) {
+        return -index <= (long)seen ? (int)((long)seen + index) : -1;
+    }
+    return -1;
+}
+
+static void CountObjChunk(ObjChunk& chunk) {
+    const char* s = chunk.Begin;
+    while (s < chunk.End) {
+        switch (ClassifyObjLine(s, chunk.End)) {
+            case ObjLine::Position: chunk.Positions++; break;
+            case ObjLine::TexCoord: chunk.TexCoords++; break;
+            case ObjLine::Normal: chunk.Normals++; break;
+            default: break;
+        }
+        s = NextLine(s, chunk.End);
+    }
+}
+
+struct ObjLists {
+    float* Positions;
+    float* TexCoords;
+    float* Normals;
+    size_t PositionCount, TexCoordCount, NormalCount;
+};
+
+static void ParseFloats(const char*& s, const char* end, float* out, int count) {
+    for (int i = 0; i < count; i++) {
+        if (!ParseNumber(s, end, out[i])) {
+            out[i] = 0.0f;
+        }
+    }
+}
+
+// Parses "p", "p/t", "p//n" or "p/t/n".
+static bool ParseCorner(const char*& s, const char* end, size_t seenP, size_t seenT, size_t seenN,
+                        const ObjLists& lists, ObjCorner& corner) {
+    long index;
+    if (!ParseNumber(s, end, index)) {
+        return false;
+    }
+    corner.Position = ResolveIndex(index, seenP, lists.PositionCount);
+    corner.TexCoord = -1;
+    corner.Normal = -1;
+    if (s < end && *s == '/') {
+        s++;
+        if (s < end && *s != '/' && ParseNumber(s, end, index)) {
+            corner.TexCoord = ResolveIndex(index, seenT, lists.TexCoordCount);
+        }
+        if (s < end && *s == '/') {
+            s++;
+            if (ParseNumber(s, end, index)) {
+                corner.Normal = ResolveIndex(index, seenN, lists.NormalCount);
+            }
+        }
+    }
+    return corner.Position >= 0;
+}
+
+static void ParseObjChunk(ObjChunk& chunk, const ObjLists& lists) {
+    size_t p = chunk.PositionBase, t = chunk.TexCoordBase, n = chunk.NormalBase;
+    const char* s = chunk.Begin;
+    while (s < chunk.End) {
+        switch (ClassifyObjLine(s, chunk.End)) {
+            case ObjLine::Position:
+                ParseFloats(s, chunk.End, lists.Positions + p++ * 3, 3);
+                break;
+            case ObjLine::TexCoord:
+                ParseFloats(s, chunk.End, lists.TexCoords + t++ * 2, 2);
+                break;
+            case ObjLine::Normal:
+                ParseFloats(s, chunk.End, lists.Normals + n++ * 3, 3);
+                break;
+            case ObjLine::Face: {
+                ObjCorner first = {}, previous = {}, corner;
+                int count = 0;
+                while (ParseCorner(s, chunk.End, p, t, n, lists, corner)) {
+                    // Fan triangulation, fine for the convex polygons exporters write.
+                    if (count >= 2) {
+                        chunk.Corners.push_back(first);
+                        chunk.Corners.push_back(previous);
+                        chunk.Corners.push_back(corner);
+                    }
+                    if (count == 0) {
+                        first = corner;
+                    }
+                    previous = corner;
+                    count++;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        s = NextLine(s, chunk.End);
+    }
+}
+
+bool ImportObj(const std::string& filepath, ImportedMesh& mesh, unsigned int threadCount) {
+    threadCount = ResolveThreadCount(threadCount);
+    MappedFile file;
+    if (!file.Open(filepath)) {
+        return false;
+    }
+    const char* begin = (const char*)file.GetData();
+    const char* end = begin + file.GetSize();
+
+    std::vector<const char*> bounds = SplitLines(begin, end, ChunkCount(file.GetSize(), threadCount));
+    std::vector<ObjChunk> chunks(bounds.size() - 1);
+    for (size_t i = 0; i < chunks.size(); i++) {
+        chunks[i].Begin = bounds[i];
+        chunks[i].End = bounds[i + 1];
+    }
+
+    // Pass 1: count, then hand every chunk its place in the lists.
+    ParallelFor(chunks.size(), threadCount, [&](size_t i) { CountObjChunk(chunks[i]); });
+
+    ObjLists lists = {};
+    for (ObjChunk& chunk : chunks) {
+        chunk.PositionBase = lists.PositionCount;
+        chunk.TexCoordBase = lists.TexCoordCount;
+        chunk.NormalBase = lists.NormalCount;
+        lists.PositionCount += chunk.Positions;
+        lists.TexCoordCount += chunk.TexCoords;
+        lists.NormalCount += chunk.Normals;
+    }
+
+    // Pass 2: parse.
+    std::vector<float> positions(lists.PositionCount * 3);
+    std::vector<float> texCoords(lists.TexCoordCount * 2);
+    std::vector<float> normals(lists.NormalCount * 3);
+    lists.Positions = positions.data();
+    lists.TexCoords = texCoords.data();
+    lists.Normals = normals.data();
+    ParallelFor(chunks.size(), threadCount, [&](size_t i) { ParseObjChunk(chunks[i], lists); });
+
+    // Removing duplicate vertices happens inside every chunk first, in parallel...
+    ParallelFor(chunks.size(), threadCount, [&](size_t i) {
+        ObjChunk& chunk = chunks[i];
+        CornerTable table(chunk.Corners.size());
+        chunk.LocalIndices.reserve(chunk.Corners.size());
+        for (const ObjCorner& corner : chunk.Corners) {
+            uint32_t index = table.Insert(corner, (uint32_t)chunk.Unique.size());
+            if (index == chunk.Unique.size()) {
+                chunk.Unique.push_back(corner);
+            }
+            chunk.LocalIndices.push_back(index);
+        }
+        std::vector<ObjCorner>().swap(chunk.Corners);
+    });
+
+    // ...and then across chunks, in file order. Only the distinct corners of
+    // every chunk go through here, a fraction of all of them.
+    size_t uniqueCount = 0, indexCount = 0;
+    for (ObjChunk& chunk : chunks) {
+        uniqueCount += chunk.Unique.size();
+        chunk.IndexBase = indexCount;
+        indexCount += chunk.LocalIndices.size();
+    }
+
+    std::vector<ObjCorner> vertices;
+    vertices.reserve(uniqueCount);
+    CornerTable table(uniqueCount);
+    for (ObjChunk& chunk : chunks) {
+        chunk.Remap.resize(chunk.Unique.size());
+        for (size_t i = 0; i < chunk.Unique.size(); i++) {
+            uint32_t index = table.Insert(chunk.Unique[i], (uint32_t)vertices.size());
+            if (index == vertices.size()) {
+                vertices.push_back(chunk.Unique[i]);
+            }
+            chunk.Remap[i] = index;
+        }
+    }
+
+    bool hasTexCoords = lists.TexCoordCount > 0;
+    bool hasNormals = lists.NormalCount > 0;
+    SetLayout(mesh.Layout, hasTexCoords, hasNormals);
+    mesh.VertexCount = (uint32_t)vertices.size();
+    mesh.Vertices.resize(vertices.size() * mesh.Layout.Stride);
+    mesh.Indices.resize(indexCount);
+
+    ParallelFor(chunks.size(), threadCount, [&](size_t i) {
+        const ObjChunk& chunk = chunks[i];
+        for (size_t c = 0; c < chunk.LocalIndices.size(); c++) {
+            mesh.Indices[chunk.IndexBase + c] = chunk.Remap[chunk.LocalIndices[c]];
+        }
+    });
+
+    static const float zero[3] = {};
+    size_t rangeCount = chunks.size();
+    ParallelFor(rangeCount, threadCount, [&](size_t r) {
+        for (size_t v = vertices.size() * r / rangeCount; v < vertices.size() * (r + 1) / rangeCount; v++) {
+            const ObjCorner& corner = vertices[v];
+            const float* texCoord = corner.TexCoord >= 0 ? &texCoords[corner.TexCoord * 2] : zero;
+            const float* normal = corner.Normal >= 0 ? &normals[corner.Normal * 3] : zero;
+            StoreVertex(&mesh.Vertices[v * mesh.Layout.Stride], &positions[corner.Position * 3],
+                        hasTexCoords ? texCoord : nullptr, hasNormals ? normal : nullptr);
+        }
+    });
+
+    return true;
+}
+
+/*
+        PLY
+    A text header describes "elements" (vertex, face, ...) and their
+    properties, then the elements follow in order, as text lines or as binary
+    records. The vertices are already indexed, so there's nothing to merge
+    besides joining the chunks.
+*/
+
+enum class PlyType {
+    Invalid,
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Float32,
+    Float64
+};
+
+enum class PlyFormat {
+    Ascii,
+    BinaryLittleEndian,
+    BinaryBigEndian
+};
+
+struct PlyProperty {
+    std::string Name;
+    PlyType Type;
+    bool IsList;
+    PlyType CountType;
+};
+
+struct PlyElement {
+    std::string Name;
+    size_t Count;
+    std::vector<PlyProperty> Properties;
+};
+
+static PlyType ParsePlyType(const std::string& name) {
+    if (name == "char" || name == "int8") return PlyType::Int8;
+    if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+    if (name == "short" || name == "int16") return PlyType::Int16;
+    if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+    if (name == "int" || name == "int32") return PlyType::Int32;
+    if (name == "uint" || name == "uint32") return PlyType::UInt32;
+    if (name == "float" || name == "float32") return PlyType::Float32;
+    if (name == "double" || name == "float64") return PlyType::Float64;
+    return PlyType::Invalid;
+}
+
+static size_t PlyTypeSize(PlyType type) {
+    switch (type) {
+        case PlyType::Int8: case PlyType::UInt8: return 1;
+        case PlyType::Int16: case PlyType::UInt16: return 2;
+        case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+        case PlyType::Float64: return 8;
+        default: return 0;
+    }
+}
+
+// Reads one binary value, swapping the bytes first if the file's byte order isn't ours.
+static double ReadPlyValue(const unsigned char* data, PlyType type, bool swap) {
+    unsigned char bytes[8];
+    size_t size = PlyTypeSize(type);
+    for (size_t i = 0; i < size; i++) {
+        bytes[i] = swap ? data[size - 1 - i] : data[i];
+    }
+
+    switch (type) {
+        case PlyType::Int8: { int8_t v; std::memcpy(&v, bytes, 1); return v; }
+        case PlyType::UInt8: { uint8_t v; std::memcpy(&v, bytes, 1); return v; }
+        case PlyType::Int16: { int16_t v; std::memcpy(&v, bytes, 2); return v; }
+        case PlyType::UInt16: { uint16_t v; std::memcpy(&v, bytes, 2); return v; }
+        case PlyType::Int32: { int32_t v; std::memcpy(&v, bytes, 4); return v; }
+        case PlyType::UInt32: { uint32_t v; std::memcpy(&v, bytes, 4); return v; }
+        case PlyType::Float32: { float v; std::memcpy(&v, bytes, 4); return v; }
+        case PlyType::Float64: { double v; std::memcpy(&v, bytes, 8); return v; }
+        default: return 0.0;
+    }
+}
+
+static bool ParsePlyHeader(const char* begin, const char* end, PlyFormat& format,
+                           std::vector<PlyElement>& elements, const char*& body) {
+    const char* s = begin;
+    bool first = true;
+    while (s < end) {
+        const char* next = NextLine(s, end);
+        std::istringstream words(std::string(s, next));
+        s = next;
+
+        std::string keyword;
+        words >> keyword;
+        if (first) {
+            if (keyword != "ply") {
+                return false;
+            }
+            first = false;
+        }
+        else if (keyword == "format") {
+            std::string name;
+            words >> name;
+            if (name == "ascii") {
+                format = PlyFormat::Ascii;
+            }
+            else if (name == "binary_little_endian") {
+                format = PlyFormat::BinaryLittleEndian;
+            }
+            else if (name == "binary_big_endian") {
+                format = PlyFormat::BinaryBigEndian;
+            }
+            else {
+                return false;
+            }
+        }
+        else if (keyword == "element") {
+            PlyElement element;
+            words >> element.Name >> element.Count;
+            elements.push_back(element);
+        }
+        else if (keyword == "property") {
+            if (elements.empty()) {
+                return false;
+            }
+            PlyProperty property;
+            std::string type;
+            words >> type;
+            property.IsList = type == "list";
+            property.CountType = PlyType::Invalid;
+            if (property.IsList) {
+                std::string countType;
+                words >> countType >> type;
+                property.CountType = ParsePlyType(countType);
+                if (property.CountType == PlyType::Invalid) {
+                    return false;
+                }
+            }
+            property.Type = ParsePlyType(type);
+            words >> property.Name;
+            if (property.Type == PlyType::Invalid) {
+                return false;
+            }
+            elements.back().Properties.push_back(property);
+        }
+        else if (keyword == "end_header") {
+            body = s;
+            return true;
+        }
+        // Anything else (comment, obj_info) is skipped.
+    }
+    return false;
+}
+
+// Which vertex properties fill which floats of our vertex: x y z, u v, nx ny nz.
+struct PlyVertexMap {
+    int Properties[8];
+    bool HasTexCoords;
+    bool HasNormals;
+};
+
+static int FindPlyProperty(const PlyElement& element, const char* name, const char* otherName = nullptr,
+                           const char* thirdName = nullptr) {
+    for (size_t i = 0; i < element.Properties.size(); i++) {
+        const std::string& property = element.Properties[i].Name;
+        if (property == name || (otherName && property == otherName) || (thirdName && property == thirdName)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static bool MapPlyVertex(const PlyElement& element, PlyVertexMap& map) {
+    for (const PlyProperty& property : element.Properties) {
+        if (property.IsList) {
+            return false;
+        }
+    }
+
+    int* p = map.Properties;
+    p[0] = FindPlyProperty(element, "x");
+    p[1] = FindPlyProperty(element, "y");
+    p[2] = FindPlyProperty(element, "z");
+    p[3] = FindPlyProperty(element, "u", "s", "texture_u");
+    p[4] = FindPlyProperty(element, "v", "t", "texture_v");
+    p[5] = FindPlyProperty(element, "nx");
+    p[6] = FindPlyProperty(element, "ny");
+    p[7] = FindPlyProperty(element, "nz");
+    map.HasTexCoords = p[3] >= 0 && p[4] >= 0;
+    map.HasNormals = p[5] >= 0 && p[6] >= 0 && p[7] >= 0;
+    return p[0] >= 0 && p[1] >= 0 && p[2] >= 0;
+}
+
+static void StorePlyVertex(unsigned char* out, const PlyVertexMap& map, const float* values) {
+    float vertex[8];
+    for (int i = 0; i < 8; i++) {
+        vertex[i] = map.Properties[i] >= 0 ? values[map.Properties[i]] : 0.0f;
+    }
+    StoreVertex(out, vertex, map.HasTexCoords ? vertex + 3 : nullptr, map.HasNormals ? vertex + 5 : nullptr);
+}
+
+static bool IsPlyIndexList(const PlyProperty& property) {
+    return property.IsList && (property.Name == "vertex_indices" || property.Name == "vertex_index");
+}
+
+// Appends the fan triangles of one face. Returns false on an index out of range.
+static bool AddFace(const std::vector<uint32_t>& face, uint32_t vertexCount, std::vector<uint32_t>& indices) {
+    for (uint32_t index : face) {
+        if (index >= vertexCount) {
+            return false;
+        }
+    }
+    for (size_t i = 2; i < face.size(); i++) {
+        indices.push_back(face[0]);
+        indices.push_back(face[i - 1]);
+        indices.push_back(face[i]);
+    }
+    return true;
+}
+
+// Size of one binary record, or 0 if it runs past the end of the file.
+static size_t PlyRecordSize(const PlyElement& element, const unsigned char* data, const unsigned char* end, bool swap) {
+    size_t size = 0;
+    for (const PlyProperty& property : element.Properties) {
+        if (property.IsList) {
+            size_t countSize = PlyTypeSize(property.CountType);
+            if (data + size + countSize > end) {
+                return 0;
+            }
+            size_t count = (size_t)ReadPlyValue(data + size, property.CountType, swap);
+            size += countSize + count * PlyTypeSize(property.Type);
+        }
+        else {
+            size += PlyTypeSize(property.Type);
+        }
+    }
+    return data + size <= end ? size : 0;
+}
+
+static bool ReadAsciiPlyVertices(const char* begin, const char* end, const PlyElement& element,
+                                 ImportedMesh& mesh, unsigned int threadCount) {
+    PlyVertexMap map;
+    if (!MapPlyVertex(element, map)) {
+        return false;
+    }
+    SetLayout(mesh.Layout, map.HasTexCoords, map.HasNormals);
+
+    std::vector<const char*> bounds = SplitLines(begin, end, ChunkCount(end - begin, threadCount));
+    std::vector<std::vector<unsigned char>> parts(bounds.size() - 1);
+    ParallelFor(parts.size(), threadCount, [&](size_t i) {
+        std::vector<float> values(element.Properties.size());
+        const char* s = bounds[i];
+        while (s < bounds[i + 1]) {
+            const char* lineEnd = NextLine(s, bounds[i + 1]);
+            if (SkipSpaces(s, lineEnd) < lineEnd && *SkipSpaces(s, lineEnd) != '\n') {
+                for (float& value : values) {
+                    if (!ParseNumber(s, lineEnd, value)) {
+                        value = 0.0f;
+                    }
+                }
+                parts[i].resize(parts[i].size() + mesh.Layout.Stride);
+                StorePlyVertex(&parts[i][parts[i].size() - mesh.Layout.Stride], map, values.data());
+            }
+            s = lineEnd;
+        }
+    });
+
+    Concatenate(parts, mesh.Vertices, threadCount);
+    mesh.VertexCount = (uint32_t)(mesh.Vertices.size() / mesh.Layout.Stride);
+    return mesh.VertexCount == element.Count;
+}
+
+static bool ReadAsciiPlyFaces(const char* begin, const char* end, const PlyElement& element,
+                              ImportedMesh& mesh, unsigned int threadCount) {
+    std::vector<const char*> bounds = SplitLines(begin, end, ChunkCount(end - begin, threadCount));
+    std::vector<std::vector<uint32_t>> parts(bounds.size() - 1);
+    std::atomic<bool> failed(false);
+    ParallelFor(parts.size(), threadCount, [&](size_t i) {
+        std::vector<uint32_t> face;
+        const char* s = bounds[i];
+        while (s < bounds[i + 1] && !failed) {
+            const char* lineEnd = NextLine(s, bounds[i + 1]);
+            for (const PlyProperty& property : element.Properties) {
+                size_t count = 1;
+                if (property.IsList && !ParseNumber(s, lineEnd, count)) {
+                    break;
+                }
+                face.clear();
+                for (size_t c = 0; c < count; c++) {
+                    double value;
+                    if (!ParseNumber(s, lineEnd, value)) {
+                        break;
+                    }
+                    face.push_back((uint32_t)value);
+                }
+                if (IsPlyIndexList(property) && !AddFace(face, mesh.VertexCount, parts[i])) {
+                    failed = true;
+                }
+            }
+            s = lineEnd;
+        }
+    });
+
+    Concatenate(parts, mesh.Indices, threadCount);
+    return !failed;
+}
+
+static bool ReadBinaryPlyVertices(const unsigned char* begin, const PlyElement& element, bool swap,
+                                  ImportedMesh& mesh, unsigned int threadCount) {
+    PlyVertexMap map;
+    if (!MapPlyVertex(element, map)) {
+        return false;
+    }
+    SetLayout(mesh.Layout, map.HasTexCoords, map.HasNormals);
+
+    // No lists, so every record has the same size and any range can be read on its own.
+    std::vector<size_t> offsets;
+    size_t recordSize = 0;
+    for (const PlyProperty& property : element.Properties) {
+        offsets.push_back(recordSize);
+        recordSize += PlyTypeSize(property.Type);
+    }
+
+    mesh.VertexCount = (uint32_t)element.Count;
+    mesh.Vertices.resize(element.Count * mesh.Layout.Stride);
+    size_t rangeCount = ChunkCount(element.Count * recordSize, threadCount);
+    ParallelFor(rangeCount, threadCount, [&](size_t r) {
+        std::vector<float> values(element.Properties.size());
+        for (size_t v = element.Count * r / rangeCount; v < element.Count * (r + 1) / rangeCount; v++) {
+            const unsigned char* record = begin + v * recordSize;
+            for (size_t p = 0; p < values.size(); p++) {
+                values[p] = (float)ReadPlyValue(record + offsets[p], element.Properties[p].Type, swap);
+            }
+            StorePlyVertex(&mesh.Vertices[v * mesh.Layout.Stride], map, values.data());
+        }
+    });
+    return true;
+}
+
+/*
+    Face records have lists, so their size varies and we can't jump into the
+    middle. One quick serial walk (reading only the list sizes) finds where
+    every chunk starts, then the chunks are decoded in parallel.
+*/
+static bool ReadBinaryPlyFaces(const unsigned char* begin, const unsigned char* end, const PlyElement& element,
+                               bool swap, ImportedMesh& mesh, unsigned int threadCount, const unsigned char*& elementEnd) {
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(ChunkCount(end - begin, threadCount), element.Count));
+    size_t facesPerChunk = (element.Count + chunkCount - 1) / chunkCount;
+    std::vector<const unsigned char*> chunkStarts;
+    const unsigned char* s = begin;
+    for (size_t f = 0; f < element.Count; f++) {
+        if (f % facesPerChunk == 0) {
+            chunkStarts.push_back(s);
+        }
+        size_t size = PlyRecordSize(element, s, end, swap);
+        if (size == 0) {
+            return false;
+        }
+        s += size;
+    }
+    elementEnd = s;
+
+    std::vector<std::vector<uint32_t>> parts(chunkStarts.size());
+    std::atomic<bool> failed(false);
+    ParallelFor(parts.size(), threadCount, [&](size_t i) {
+        std::vector<uint32_t> face;
+        const unsigned char* record = chunkStarts[i];
+        size_t faceEnd = std::min(element.Count, (i + 1) * facesPerChunk);
+        for (size_t f = i * facesPerChunk; f < faceEnd && !failed; f++) {
+            for (const PlyProperty& property : element.Properties) {
+                size_t count = 1;
+                if (property.IsList) {
+                    count = (size_t)ReadPlyValue(record, property.CountType, swap);
+                    record += PlyTypeSize(property.CountType);
+                }
+                size_t itemSize = PlyTypeSize(property.Type);
+                if (IsPlyIndexList(property)) {
+                    face.clear();
+                    for (size_t c = 0; c < count; c++) {
+                        face.push_back((uint32_t)ReadPlyValue(record + c * itemSize, property.Type, swap));
+                    }
+                    if (!AddFace(face, mesh.VertexCount, parts[i])) {
+                        failed = true;
+                    }
+                }
+                record += count * itemSize;
+            }
+        }
+    });
+
+    Concatenate(parts, mesh.Indices, threadCount);
+    return !failed;
+}
+
+bool ImportPly(const std::string& filepath, ImportedMesh& mesh, unsigned int threadCount) {
+    threadCount = ResolveThreadCount(threadCount);
+    MappedFile file;
+    if (!file.Open(filepath)) {
+        return false;
+    }
+    const char* begin = (const char*)file.GetData();
+    const char* end = begin + file.GetSize();
+
+    PlyFormat format = PlyFormat::Ascii;
+    std::vector<PlyElement> elements;
+    const char* body;
+    if (!ParsePlyHeader(begin, end, format, elements, body)) {
+        return false;
+    }
+
+    const uint16_t one = 1;
+    bool littleEndian = *(const unsigned char*)&one == 1;
+    bool swap = format == (littleEndian ? PlyFormat::BinaryBigEndian : PlyFormat::BinaryLittleEndian);
+
+    mesh.Vertices.clear();
+    mesh.Indices.clear();
+    mesh.VertexCount = 0;
+    bool hasVertices = false;
+
+    const char* s = body;
+    for (const PlyElement& element : elements) {
+        if (element.Name == "face" && !hasVertices) {
+            return false;
+        }
+
+        if (format == PlyFormat::Ascii) {
+            const char* elementEnd = SkipLines(s, end, element.Count, threadCount);
+            if (element.Name == "vertex") {
+                if (!ReadAsciiPlyVertices(s, elementEnd, element, mesh, threadCount)) {
+                    return false;
+                }
+                hasVertices = true;
+            }
+            else if (element.Name == "face" && !ReadAsciiPlyFaces(s, elementEnd, element, mesh, threadCount)) {
+                return false;
+            }
+            s = elementEnd;
+        }
+        else {
+            const unsigned char* data = (const unsigned char*)s;
+            const unsigned char* dataEnd = (const unsigned char*)end;
+            const unsigned char* elementEnd = data;
+            if (element.Name == "vertex") {
+                size_t recordSize = PlyRecordSize(element, data, dataEnd, swap);
+                if (recordSize == 0 || element.Count * recordSize > (size_t)(dataEnd - data) ||
+                    !ReadBinaryPlyVertices(data, element, swap, mesh, threadCount)) {
+                    return false;
+                }
+                elementEnd = data + element.Count * recordSize;
+                hasVertices = true;
+            }
+            else if (element.Name == "face") {
+                if (!ReadBinaryPlyFaces(data, dataEnd, element, swap, mesh, threadCount, elementEnd)) {
+                    return false;
+                }
+            }
+            else {
+                for (size_t i = 0; i < element.Count; i++) {
+                    size_t size = PlyRecordSize(element, elementEnd, dataEnd, swap);
+                    if (size == 0) {
+                        return false;
+                    }
+                    elementEnd += size;
+                }
+            }
+            s = (const char*)elementEnd;
+        }
+    }
+
+    return hasVertices;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MeshFile.h"
+
+/*
+    Reads OBJ and PLY files, for the mesh converter. This is exactly the kind
+    of parsing we don't want to do at startup, so it only runs offline. But
+    scans with millions of triangles are hundreds of megabytes of text, and
+    reading them line by line with getline (like ParseShaders does) takes
+    minutes. So:
+
+    1. The file is mapped and cut into chunks that start right after a line
+       break, one line never spans two chunks.
+    2. Every chunk is parsed on its own thread. Numbers are read with
+       std::from_chars: no locale, no copying, no allocation per number.
+    3. The per-chunk results are merged in file order, so the output is
+       exactly the same no matter how many threads were used.
+
+    OBJ: v, vt, vn and f (polygons become a fan of triangles), the rest is
+    skipped. Every distinct position/texcoord/normal combination becomes one
+    vertex.
+    PLY: ascii and binary (either byte order). The "vertex" element gives
+    x/y/z, nx/ny/nz and u/v (or s/t), the "face" element gives vertex_indices.
+
+    The vertices are:
+        location 0  position, 3 floats
+        location 1  texcoord, 2 floats (only if the file has any)
+        location 2  normal, 3 floats (only if the file has any)
+*/
+
+struct ImportedMesh {
+    MeshLayout Layout;
+    std::vector<unsigned char> Vertices;
+    uint32_t VertexCount;
+    std::vector<uint32_t> Indices;
+};
+
+// Picks the format from the extension. threadCount 0 means one per core.
+bool ImportMesh(const std::string& filepath, ImportedMesh& mesh, unsigned int threadCount = 0);
+
+bool ImportObj(const std::string& filepath, ImportedMesh& mesh, unsigned int threadCount = 0);
+
+bool ImportPly(const std::string& filepath, ImportedMesh& mesh, unsigned int threadCount = 0);
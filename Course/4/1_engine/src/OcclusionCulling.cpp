@@ -0,0 +1,335 @@
+#include "OcclusionCulling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+    : m_Width(width), m_Height(height), m_Stride((width + 3) & ~3),
+      m_Depth((size_t)m_Stride * height, 1.0f) {
+    // Every level halves the size (rounding up) until we reach a single texel.
+    int w = width;
+    int h = height;
+    while (w > 1 || h > 1) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        Level level;
+        level.Width = w;
+        level.Height = h;
+        level.MinDepth.assign((size_t)w * h, 1.0f);
+        level.MaxDepth.assign((size_t)w * h, 1.0f);
+        m_Levels.push_back(std::move(level));
+    }
+}
+
+void OcclusionBuffer::Clear() {
+    std::fill(m_Depth.begin(), m_Depth.end(), 1.0f);
+}
+
+// Clips a polygon against the near plane (z + w >= 0 in clip space). A triangle
+// that pokes through the near plane turns into a quad at most.
+static int ClipNear(const Vec4* in, int count, Vec4* out) {
+    int outCount = 0;
+    for (int i = 0; i < count; i++) {
+        const Vec4& a = in[i];
+        const Vec4& b = in[(i + 1) % count];
+        float da = a.z + a.w;
+        float db = b.z + b.w;
+
+        if (da >= 0.0f) {
+            out[outCount++] = a;
+        }
+        if ((da >= 0.0f) != (db >= 0.0f)) {
+            float t = da / (da - db);
+            out[outCount++] = {
+                a.x + (b.x - a.x) * t,
+                a.y + (b.y - a.y) * t,
+                a.z + (b.z - a.z) * t,
+                a.w + (b.w - a.w) * t
+            };
+        }
+    }
+    return outCount;
+}
+
+size_t OcclusionBuffer::RasterizeOccluder(const Mat4& mvp, const float* positions, size_t vertexCount,
+                                          const unsigned int* indices, size_t indexCount) {
+    // Transform every vertex once, triangles usually share them.
+    std::vector<Vec4> clip(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        clip[i] = Transform(mvp, {positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]});
+    }
+
+    size_t rasterized = 0;
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        Vec4 triangle[3] = {clip[indices[i]], clip[indices[i + 1]], clip[indices[i + 2]]};
+
+        // Trivial reject: all three vertices outside of the same clip plane.
+        bool outside = false;
+        for (int axis = 0; axis < 3 && !outside; axis++) {
+            bool allBelow = true;
+            bool allAbove = true;
+            for (const Vec4& v : triangle) {
+                float c = axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+                allBelow = allBelow && c < -v.w;
+                allAbove = allAbove && c > v.w;
+            }
+            outside = allBelow || allAbove;
+        }
+        if (outside) {
+            continue;
+        }
+
+        Vec4 polygon[4];
+        int count = ClipNear(triangle, 3, polygon);
+        if (count < 3) {
+            continue;
+        }
+
+        // Perspective divide and viewport transform. Pixel (x, y) covers
+        // [x, x + 1) x [y, y + 1), so its center is at (x + 0.5, y + 0.5).
+        ScreenVertex screen[4];
+        for (int v = 0; v < count; v++) {
+            float invW = 1.0f / polygon[v].w;
+            screen[v].x = (polygon[v].x * invW * 0.5f + 0.5f) * m_Width;
+            screen[v].y = (polygon[v].y * invW * 0.5f + 0.5f) * m_Height;
+            screen[v].z = polygon[v].z * invW * 0.5f + 0.5f;
+        }
+
+        // A clipped quad is drawn as a fan of two triangles.
+        for (int v = 1; v + 1 < count; v++) {
+            RasterizeTriangle(screen[0], screen[v], screen[v + 1]);
+        }
+        rasterized++;
+    }
+
+    return rasterized;
+}
+
+void OcclusionBuffer::RasterizeTriangle(const ScreenVertex& v0, const ScreenVertex& a, const ScreenVertex& b) {
+    // Occluders are usually closed meshes seen from both sides, so we don't
+    // cull back faces; we just flip the winding to be counter-clockwise.
+    float area = (a.x - v0.x) * (b.y - v0.y) - (a.y - v0.y) * (b.x - v0.x);
+    if (area == 0.0f) {
+        return;
+    }
+    const ScreenVertex& v1 = area > 0.0f ? a : b;
+    const ScreenVertex& v2 = area > 0.0f ? b : a;
+    area = std::fabs(area);
+
+    // Bounding box of the triangle, clamped to the buffer.
+    int minX = std::max(0, (int)std::floor(std::min({v0.x, v1.x, v2.x})));
+    int maxX = std::min(m_Width - 1, (int)std::ceil(std::max({v0.x, v1.x, v2.x})));
+    int minY = std::max(0, (int)std::floor(std::min({v0.y, v1.y, v2.y})));
+    int maxY = std::min(m_Height - 1, (int)std::ceil(std::max({v0.y, v1.y, v2.y})));
+    if (minX > maxX || minY > maxY) {
+        return;
+    }
+
+    /*
+        Edge functions. For an edge going from p to q, E(x, y) = A * x + B * y + C
+        is positive on the inside of a counter-clockwise triangle. They are linear
+        in x, so stepping one pixel to the right just adds A. Depth is linear in
+        screen space too (after the perspective divide), so it gets the same
+        treatment: z(x, y) = zA * x + zB * y + zC.
+    */
+    const ScreenVertex* p[3] = {&v1, &v2, &v0};
+    const ScreenVertex* q[3] = {&v2, &v0, &v1};
+    float A[3], B[3], C[3];
+    for (int e = 0; e < 3; e++) {
+        A[e] = p[e]->y - q[e]->y;
+        B[e] = q[e]->x - p[e]->x;
+        C[e] = p[e]->x * q[e]->y - p[e]->y * q[e]->x;
+    }
+
+    // The barycentric weight of vertex i is E_i / area, where edge i is the one
+    // opposite of vertex i.
+    float invArea = 1.0f / area;
+    float zA = (A[0] * v0.z + A[1] * v1.z + A[2] * v2.z) * invArea;
+    float zB = (B[0] * v0.z + B[1] * v1.z + B[2] * v2.z) * invArea;
+    float zC = (C[0] * v0.z + C[1] * v1.z + C[2] * v2.z) * invArea;
+
+    // The SIMD loop works on groups of 4 pixels, starting on a 4 aligned column.
+    minX &= ~3;
+
+    for (int y = minY; y <= maxY; y++) {
+        float py = y + 0.5f;
+        float row[3] = {B[0] * py + C[0], B[1] * py + C[1], B[2] * py + C[2]};
+        float rowZ = zB * py + zC;
+        float* depth = &m_Depth[(size_t)y * m_Stride];
+
+#ifdef __SSE2__
+        const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 zero = _mm_setzero_ps();
+        for (int x = minX; x <= maxX; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[0]), px), _mm_set1_ps(row[0]));
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[1]), px), _mm_set1_ps(row[1]));
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[2]), px), _mm_set1_ps(row[2]));
+            __m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero),
+                            _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+            if (_mm_movemask_ps(inside) == 0) {
+                continue;
+            }
+
+            // Keep the nearest depth, but only where the pixel is inside.
+            __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zA), px), _mm_set1_ps(rowZ));
+            __m128 old = _mm_loadu_ps(depth + x);
+            __m128 nearest = _mm_min_ps(old, z);
+            _mm_storeu_ps(depth + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+        }
+#else
+        for (int x = minX; x <= maxX; x++) {
+            float px = x + 0.5f;
+            if (A[0] * px + row[0] >= 0.0f && A[1] * px + row[1] >= 0.0f && A[2] * px + row[2] >= 0.0f) {
+                float z = zA * px + rowZ;
+                depth[x] = std::min(depth[x], z);
+            }
+        }
+#endif
+    }
+}
+
+void OcclusionBuffer::BuildHierarchy() {
+    // The first level reads straight from the depth buffer, where min == max.
+    int sourceWidth = m_Width;
+    int sourceHeight = m_Height;
+    int sourceStride = m_Stride;
+    const float* sourceMin = m_Depth.data();
+    const float* sourceMax = m_Depth.data();
+
+    for (Level& level : m_Levels) {
+        for (int y = 0; y < level.Height; y++) {
+            int y0 = y * 2;
+            int y1 = std::min(y0 + 1, sourceHeight - 1);
+            for (int x = 0; x < level.Width; x++) {
+                int x0 = x * 2;
+                int x1 = std::min(x0 + 1, sourceWidth - 1);
+
+                // On odd sizes the last texel just reads its own row/column twice.
+                float mn = std::min(std::min(sourceMin[y0 * sourceStride + x0], sourceMin[y0 * sourceStride + x1]),
+                                    std::min(sourceMin[y1 * sourceStride + x0], sourceMin[y1 * sourceStride + x1]));
+                float mx = std::max(std::max(sourceMax[y0 * sourceStride + x0], sourceMax[y0 * sourceStride + x1]),
+                                    std::max(sourceMax[y1 * sourceStride + x0], sourceMax[y1 * sourceStride + x1]));
+                level.MinDepth[y * level.Width + x] = mn;
+                level.MaxDepth[y * level.Width + x] = mx;
+            }
+        }
+
+        sourceWidth = level.Width;
+        sourceHeight = level.Height;
+        sourceStride = level.Width;
+        sourceMin = level.MinDepth.data();
+        sourceMax = level.MaxDepth.data();
+    }
+}
+
+OcclusionResult OcclusionBuffer::Test(const Mat4& mvp, const Vec3& boundsMin, const Vec3& boundsMax) const {
+    float minX = 1e30f, minY = 1e30f, minZ = 1e30f;
+    float maxX = -1e30f, maxY = -1e30f;
+    int outside[6] = {0, 0, 0, 0, 0, 0};
+
+    for (int corner = 0; corner < 8; corner++) {
+        Vec3 p = {
+            (corner & 1) ? boundsMax.x : boundsMin.x,
+            (corner & 2) ? boundsMax.y : boundsMin.y,
+            (corner & 4) ? boundsMax.z : boundsMin.z
+        };
+        Vec4 c = Transform(mvp, p);
+
+        outside[0] += c.x < -c.w;
+        outside[1] += c.x > c.w;
+        outside[2] += c.y < -c.w;
+        outside[3] += c.y > c.w;
+        outside[4] += c.z < -c.w;
+        outside[5] += c.z > c.w;
+
+        if (c.z < -c.w) {
+            // The box crosses the near plane, so the camera is (almost) inside
+            // of it. We can't project it reliably, and it is most likely visible.
+            continue;
+        }
+
+        float invW = 1.0f / c.w;
+        minX = std::min(minX, (c.x * invW * 0.5f + 0.5f) * m_Width);
+        maxX = std::max(maxX, (c.x * invW * 0.5f + 0.5f) * m_Width);
+        minY = std::min(minY, (c.y * invW * 0.5f + 0.5f) * m_Height);
+        maxY = std::max(maxY, (c.y * invW * 0.5f + 0.5f) * m_Height);
+        minZ = std::min(minZ, c.z * invW * 0.5f + 0.5f);
+    }
+
+    for (int plane = 0; plane < 6; plane++) {
+        if (outside[plane] == 8) {
+            return OcclusionResult::OutsideFrustum;
+        }
+    }
+    if (outside[4] > 0) {
+        return OcclusionResult::Visible;
+    }
+
+    // Pixels that the box touches, clamped to the buffer.
+    int x0 = std::max(0, (int)std::floor(minX));
+    int x1 = std::min(m_Width - 1, (int)std::floor(maxX));
+    int y0 = std::max(0, (int)std::floor(minY));
+    int y1 = std::min(m_Height - 1, (int)std::floor(maxY));
+    if (x0 > x1 || y0 > y1) {
+        return OcclusionResult::OutsideFrustum;
+    }
+
+    // Start from the level where the box covers at most 2x2 texels.
+    int levelIndex = 0;
+    while (levelIndex < (int)m_Levels.size() &&
+           (((x1 >> levelIndex) - (x0 >> levelIndex)) > 1 || ((y1 >> levelIndex) - (y0 >> levelIndex)) > 1)) {
+        levelIndex++;
+    }
+
+    /*
+        At a coarse level a texel usually covers much more than the box does, so
+        its max depth may come from a hole next to the box. If the coarse test
+        can't decide, we go down a couple of levels and look again. The min depth
+        tells us when going down is pointless: if the box is in front of even the
+        NEAREST occluder in the region, it is visible no matter where it is.
+    */
+    for (;;) {
+        int tx0 = x0 >> levelIndex, tx1 = x1 >> levelIndex;
+        int ty0 = y0 >> levelIndex, ty1 = y1 >> levelIndex;
+
+        bool occluded = true;
+        bool inFrontOfAll = true;
+        for (int ty = ty0; ty <= ty1; ty++) {
+            for (int tx = tx0; tx <= tx1; tx++) {
+                float mn, mx;
+                if (levelIndex == 0) {
+                    mn = mx = m_Depth[ty * m_Stride + tx];
+                }
+                else {
+                    const Level& level = m_Levels[levelIndex - 1];
+                    mn = level.MinDepth[ty * level.Width + tx];
+                    mx = level.MaxDepth[ty * level.Width + tx];
+                }
+                occluded = occluded && minZ > mx;
+                inFrontOfAll = inFrontOfAll && minZ <= mn;
+            }
+        }
+
+        if (occluded) {
+            return OcclusionResult::Occluded;
+        }
+        if (inFrontOfAll || levelIndex == 0) {
+            return OcclusionResult::Visible;
+        }
+
+        // Don't refine into more than 8x8 texels, it's not worth it.
+        int finer = std::max(0, levelIndex - 2);
+        if (((x1 >> finer) - (x0 >> finer)) >= 8 || ((y1 >> finer) - (y0 >> finer)) >= 8) {
+            finer = levelIndex - 1;
+            if (((x1 >> finer) - (x0 >> finer)) >= 8 || ((y1 >> finer) - (y0 >> finer)) >= 8) {
+                return OcclusionResult::Visible;
+            }
+        }
+        levelIndex = finer;
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Math.h"
+
+#include <cstddef>
+#include <vector>
+
+/*
+        SOFTWARE OCCLUSION CULLING
+    Frustum culling throws away everything outside of the camera, but everything
+    hidden BEHIND a big wall still gets drawn. The idea here is to do a tiny
+    bit of rendering on the CPU before we render on the GPU:
+
+    1. Rasterize a few big, simple occluder meshes (walls, terrain, buildings)
+       into a small depth buffer (something like 256x128). Only depth, no color.
+    2. Build a hierarchy (a mip chain) from that depth buffer. Every texel of
+       level N stores the MIN and the MAX depth of the 2x2 texels below it.
+    3. Before a draw call, project the bounding box of the object, pick the level
+       where the box covers only a couple of texels and compare: if the nearest
+       point of the box is farther than the farthest occluder depth in all of
+       those texels, nothing of the object can be seen, so we skip the draw.
+
+    Depth follows the OpenGL convention mapped to [0, 1]: 0 is the near plane,
+    1 is the far plane, and the buffer is cleared to 1.
+
+    Everything here is plain C++ (no OpenGL), so it runs headless and gives
+    exactly the same answer every time for the same input.
+*/
+
+enum class OcclusionResult {
+    Visible,
+    Occluded,
+    OutsideFrustum
+};
+
+class OcclusionBuffer {
+public:
+    OcclusionBuffer(int width, int height);
+
+    // Resets every pixel to the far plane.
+    void Clear();
+
+    // positions are tightly packed xyz floats, indices describe GL_TRIANGLES.
+    // Returns the number of triangles that actually touched the buffer.
+    size_t RasterizeOccluder(const Mat4& mvp, const float* positions, size_t vertexCount,
+                             const unsigned int* indices, size_t indexCount);
+
+    // Must be called after the occluders are rasterized and before Test().
+    void BuildHierarchy();
+
+    // Tests an axis aligned bounding box given in object space. Const and
+    // free of side effects, so many threads may test against the same buffer.
+    OcclusionResult Test(const Mat4& mvp, const Vec3& boundsMin, const Vec3& boundsMax) const;
+
+    int GetWidth() const { return m_Width; }
+    int GetHeight() const { return m_Height; }
+    int GetLevelCount() const { return (int)m_Levels.size(); }
+
+    // Depth of pixel (x, y) of the full resolution buffer, y = 0 is the bottom row.
+    float GetDepth(int x, int y) const { return m_Depth[y * m_Stride + x]; }
+
+private:
+    struct Level {
+        int Width;
+        int Height;
+        std::vector<float> MinDepth;
+        std::vector<float> MaxDepth;
+    };
+
+    struct ScreenVertex {
+        float x, y, z;
+    };
+
+    void RasterizeTriangle(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2);
+
+    int m_Width;
+    int m_Height;
+    // Rows are padded to a multiple of 4 pixels so the SIMD loop never has to
+    // deal with a partial group at the end of a row.
+    int m_Stride;
+    std::vector<float> m_Depth;
+    // m_Levels[0] is the 2x2 reduction of m_Depth, m_Levels[1] of that, etc.
+    std::vector<Level> m_Levels;
+};
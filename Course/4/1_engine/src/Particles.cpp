@@ -0,0 +1,174 @@
+#include "Particles.h"
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#include "GpuMemory.h"
+#include "Renderer.h"
+#include "Shader.h"
+
+// The Particle struct of the shaders: two vec4.
+static const size_t PARTICLE_SIZE = 32;
+static const uint32_t GROUP_SIZE = 64;
+
+// Offsets into the State block of ParticleUpdate.shader.
+static const GLintptr DISPATCH_OFFSET = 2 * sizeof(uint32_t);
+static const GLintptr DRAW_OFFSET = 6 * sizeof(uint32_t);
+static const size_t STATE_SIZE = 10 * sizeof(uint32_t);
+
+// The Parameters block of ParticleUpdate.shader, in std140 layout.
+struct ParticleParameters {
+    Vec3 EmitterPosition;
+    float Spread;
+    Vec3 EmitterVelocity;
+    float DeltaTime;
+    Vec3 Gravity;
+    uint32_t Source;
+    float Lifetime[2];
+    uint32_t EmitCount;
+    uint32_t Seed;
+    uint32_t Capacity;
+    uint32_t Padding[3];
+};
+
+static_assert(sizeof(ParticleParameters) == 80, "ParticleParameters must match the std140 layout");
+
+ParticleSystem::ParticleSystem(uint32_t capacity) : m_Capacity(capacity) {
+    // Every pass sees the same blocks, so every pass is checked against the
+    // structs we upload and the offsets we read.
+    bool valid = true;
+    for (int pass = 0; pass < PASS_COUNT; pass++) {
+        ProgramReflection reflection;
+        m_Programs[pass] = LoadProgram("res/shaders/ParticleUpdate.shader", reflection, {{"PASS", 0, (GLuint)pass}});
+        valid = valid && m_Programs[pass] != 0;
+        valid = valid && ValidateUniformBlock(reflection, "Parameters", sizeof(ParticleParameters),
+                                              {{"u_EmitterPosition", offsetof(ParticleParameters, EmitterPosition)},
+                                               {"u_Spread", offsetof(ParticleParameters, Spread)},
+                                               {"u_EmitterVelocity", offsetof(ParticleParameters, EmitterVelocity)},
+                                               {"u_DeltaTime", offsetof(ParticleParameters, DeltaTime)},
+                                               {"u_Gravity", offsetof(ParticleParameters, Gravity)},
+                                               {"u_Source", offsetof(ParticleParameters, Source)},
+                                               {"u_Lifetime", offsetof(ParticleParameters, Lifetime)},
+                                               {"u_EmitCount", offsetof(ParticleParameters, EmitCount)},
+                                               {"u_Seed", offsetof(ParticleParameters, Seed)},
+                                               {"u_Capacity", offsetof(ParticleParameters, Capacity)}});
+        valid = valid && ValidateStorageBlock(reflection, "State");
+        valid = valid && ValidateStorageBlock(reflection, "Source", "source", PARTICLE_SIZE);
+    }
+
+    ProgramReflection reflection;
+    m_DrawProgram = LoadProgram("res/shaders/Particles.shader", reflection);
+    valid = valid && m_DrawProgram != 0;
+    valid = valid && ValidateUniform(reflection, "u_ViewProjection", GL_FLOAT_MAT4, &m_ViewProjectionLocation);
+    valid = valid && ValidateUniform(reflection, "u_PointSize", GL_FLOAT, &m_PointSizeLocation);
+
+    // No flags: only the GPU ever reads or writes the particles.
+    GLCall(glCreateBuffers(2, m_Particles));
+    for (GLuint buffer : m_Particles) {
+        GLCall(glNamedBufferStorage(buffer, (GLsizeiptr)capacity * PARTICLE_SIZE, nullptr, 0));
+    }
+
+    uint32_t state[STATE_SIZE / sizeof(uint32_t)] = {};
+    GLCall(glCreateBuffers(1, &m_State));
+    GLCall(glNamedBufferStorage(m_State, STATE_SIZE, state, 0));
+    GLCall(glCreateBuffers(1, &m_Parameters));
+    GLCall(glNamedBufferStorage(m_Parameters, sizeof(ParticleParameters), nullptr, GL_DYNAMIC_STORAGE_BIT));
+    GLCall(glCreateVertexArrays(1, &m_VertexArray));
+    m_MemoryId = TrackGpuMemory(MemoryCategory::ShaderData, "particles",
+                                2 * (size_t)capacity * PARTICLE_SIZE + STATE_SIZE + sizeof(ParticleParameters));
+
+    m_Valid = valid;
+    if (!m_Valid) {
+        std::cerr << "Can't build the particle shaders" << std::endl;
+    }
+}
+
+ParticleSystem::~ParticleSystem() {
+    for (GLuint program : m_Programs) {
+        GLCall(glDeleteProgram(program));
+    }
+    GLCall(glDeleteProgram(m_DrawProgram));
+    GLCall(glDeleteBuffers(2, m_Particles));
+    GLCall(glDeleteBuffers(1, &m_State));
+    GLCall(glDeleteBuffers(1, &m_Parameters));
+    GLCall(glDeleteVertexArrays(1, &m_VertexArray));
+    ReleaseGpuMemory(m_MemoryId);
+}
+
+void ParticleSystem::Update(float deltaTime, const ParticleEmitter& emitter, uint32_t emitCount) {
+    if (!m_Valid) {
+        return;
+    }
+
+    ParticleParameters parameters = {};
+    parameters.EmitterPosition = emitter.Position;
+    parameters.Spread = emitter.Spread;
+    parameters.EmitterVelocity = emitter.Velocity;
+    parameters.DeltaTime = deltaTime;
+    parameters.Gravity = m_Gravity;
+    parameters.Source = m_Source;
+    parameters.Lifetime[0] = emitter.MinLifetime;
+    parameters.Lifetime[1] = emitter.MaxLifetime;
+    parameters.EmitCount = emitCount;
+    parameters.Seed = m_Frame++;
+    parameters.Capacity = m_Capacity;
+    GLCall(glNamedBufferSubData(m_Parameters, 0, sizeof(parameters), &parameters));
+
+    GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_Particles[m_Source]));
+    GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_Particles[1 - m_Source]));
+    GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_State));
+    GLCall(glBindBufferBase(GL_UNIFORM_BUFFER, 1, m_Parameters));
+    GLCall(glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_State));
+
+    // Every pass reads what the one before wrote, hence a barrier between
+    // each of them. The indirect dispatches also read their arguments from
+    // a buffer a shader wrote, which is what GL_COMMAND_BARRIER_BIT is for.
+    if (emitCount > 0) {
+        GLCall(glUseProgram(m_Programs[EMIT]));
+        GLCall(glDispatchCompute((emitCount + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1));
+        GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+    }
+
+    GLCall(glUseProgram(m_Programs[PREPARE]));
+    GLCall(glDispatchCompute(1, 1, 1));
+    GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT));
+
+    GLCall(glUseProgram(m_Programs[SIMULATE]));
+    GLCall(glDispatchComputeIndirect(DISPATCH_OFFSET));
+    GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+
+    GLCall(glUseProgram(m_Programs[COMPACT]));
+    GLCall(glDispatchComputeIndirect(DISPATCH_OFFSET));
+    GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+
+    GLCall(glUseProgram(m_Programs[FINISH]));
+    GLCall(glDispatchCompute(1, 1, 1));
+
+    // Draw() reads the command from m_State and the particles from the buffer.
+    GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT));
+    m_Source = 1 - m_Source;
+}
+
+void ParticleSystem::Draw(const Mat4& viewProjection, float pointSize) {
+    if (!m_Valid) {
+        return;
+    }
+
+    GLCall(glUseProgram(m_DrawProgram));
+    GLCall(glUniformMatrix4fv(m_ViewProjectionLocation, 1, GL_FALSE, viewProjection.Data));
+    GLCall(glUniform1f(m_PointSizeLocation, pointSize));
+    GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_Particles[m_Source]));
+    GLCall(glBindVertexArray(m_VertexArray));
+    GLCall(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_State));
+
+    GLCall(glEnable(GL_PROGRAM_POINT_SIZE));
+    GLCall(glDrawArraysIndirect(GL_POINTS, (const void*)DRAW_OFFSET));
+    GLCall(glDisable(GL_PROGRAM_POINT_SIZE));
+}
+
+uint32_t ParticleSystem::ReadCount() const {
+    uint32_t count = 0;
+    GLCall(glGetNamedBufferSubData(m_State, m_Source * sizeof(uint32_t), sizeof(count), &count));
+    return count;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+#include "Math.h"
+
+/*
+        GPU PARTICLES
+    Animating things on the CPU means doing the math there and uploading the
+    result every frame. For a few values that's fine; for a million particles
+    the upload alone eats the frame.
+
+    Here the particles never leave the GPU. They live in two shader storage
+    buffers, and every frame is a handful of compute passes
+    (res/shaders/ParticleUpdate.shader):
+
+    1. EMIT       appends the new particles to the source buffer.
+    2. PREPARE    one thread: turns the particle count into the size of the
+                  next dispatches (one group per 64 particles).
+    3. SIMULATE   moves every particle and ages it (glDispatchComputeIndirect).
+    4. COMPACT    copies the ones still alive to the other buffer, so the
+                  dead ones disappear without leaving holes.
+    5. FINISH     one thread: writes the draw command for the survivors.
+
+    Drawing is glDrawArraysIndirect with that command, one point per
+    particle, read by gl_VertexID. So the number of particles goes from
+    compute to draw without the CPU ever seeing it: no glGetBufferSubData,
+    no stall. The buffers then swap roles for the next frame.
+*/
+
+struct ParticleEmitter {
+    Vec3 Position;
+    // Where the particles go, and how fast.
+    Vec3 Velocity;
+    // Largest random speed added to Velocity on every axis.
+    float Spread;
+    // Every particle lives a random number of seconds in this range.
+    float MinLifetime;
+    float MaxLifetime;
+};
+
+class ParticleSystem {
+public:
+    explicit ParticleSystem(uint32_t capacity);
+    ~ParticleSystem();
+
+    ParticleSystem(const ParticleSystem&) = delete;
+    ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+    // False if the shaders failed to build.
+    bool IsValid() const { return m_Valid; }
+
+    // Emits emitCount particles (as many as fit) and advances all of them by
+    // deltaTime seconds. Only queues GPU work, never waits for it.
+    void Update(float deltaTime, const ParticleEmitter& emitter, uint32_t emitCount);
+
+    // Draws the particles as points. Leaves the particle buffer bound to
+    // storage buffer binding 0.
+    void Draw(const Mat4& viewProjection, float pointSize);
+
+    uint32_t GetCapacity() const { return m_Capacity; }
+
+    // Acceleration on every particle, units per second squared.
+    void SetGravity(const Vec3& gravity) { m_Gravity = gravity; }
+
+    // Reads the number of living particles back from the GPU. This waits for
+    // all queued work, so it's for tests and statistics, not for every frame.
+    uint32_t ReadCount() const;
+
+private:
+    // The PASS numbers of ParticleUpdate.shader.
+    enum Pass { EMIT, PREPARE, SIMULATE, COMPACT, FINISH, PASS_COUNT };
+
+    uint32_t m_Capacity;
+    bool m_Valid = false;
+    Vec3 m_Gravity = {0.0f, -9.81f, 0.0f};
+    GLuint m_Programs[PASS_COUNT] = {};
+    GLuint m_DrawProgram = 0;
+    GLint m_ViewProjectionLocation = -1;
+    GLint m_PointSizeLocation = -1;
+
+    // The particles, twice; m_Source is the one that holds the current ones.
+    GLuint m_Particles[2] = {};
+    uint32_t m_Source = 0;
+    // Counts, dispatch and draw arguments (the State block of the shader).
+    GLuint m_State = 0;
+    // Everything Update() gets from the CPU, in one uniform buffer.
+    GLuint m_Parameters = 0;
+    // The core profile can't draw without one, even if it is empty.
+    GLuint m_VertexArray = 0;
+    uint32_t m_Frame = 0;
+    // All the buffers, booked as one (GpuMemory.h).
+    uint32_t m_MemoryId = 0;
+};
@@ -0,0 +1,383 @@
+#include "ProgramReflection.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static const char REFLECTION_MAGIC[4] = {'G', 'L', 'R', 'F'};
+static const uint32_t REFLECTION_VERSION = 1;
+
+static std::string ResourceName(GLuint program, GLenum interface, GLuint index, GLint length) {
+    std::string name(length > 0 ? length : 1, '\0');
+    glGetProgramResourceName(program, interface, index, (GLsizei)name.size(), nullptr, &name[0]);
+    name.resize(std::strlen(name.c_str()));
+    return name;
+}
+
+static std::vector<ShaderVariable> ReflectVariables(GLuint program, GLenum interface) {
+    // Not every interface has every property, the missing ones stay -1.
+    std::vector<GLenum> properties = {GL_NAME_LENGTH, GL_TYPE, GL_ARRAY_SIZE};
+    if (interface != GL_BUFFER_VARIABLE) {
+        properties.push_back(GL_LOCATION);
+    }
+    if (interface != GL_PROGRAM_INPUT) {
+        properties.push_back(GL_BLOCK_INDEX);
+        properties.push_back(GL_OFFSET);
+        properties.push_back(interface == GL_BUFFER_VARIABLE ? GL_TOP_LEVEL_ARRAY_STRIDE : GL_ARRAY_STRIDE);
+    }
+
+    GLint count = 0;
+    glGetProgramInterfaceiv(program, interface, GL_ACTIVE_RESOURCES, &count);
+
+    std::vector<ShaderVariable> variables;
+    for (GLint i = 0; i < count; i++) {
+        GLint values[7] = {0, 0, 0, -1, -1, -1, -1};
+        glGetProgramResourceiv(program, interface, i, (GLsizei)properties.size(), properties.data(),
+                               (GLsizei)properties.size(), nullptr, values);
+
+        ShaderVariable variable;
+        variable.Type = (GLenum)values[1];
+        variable.ArraySize = values[2];
+        size_t next = 3;
+        variable.Location = interface != GL_BUFFER_VARIABLE ? values[next++] : -1;
+        variable.BlockIndex = interface != GL_PROGRAM_INPUT ? values[next++] : -1;
+        variable.Offset = interface != GL_PROGRAM_INPUT ? values[next++] : -1;
+        variable.ArrayStride = interface != GL_PROGRAM_INPUT ? values[next++] : -1;
+        variable.Name = ResourceName(program, interface, i, values[0]);
+
+        if (variable.Name.compare(0, 3, "gl_") != 0) {
+            variables.push_back(variable);
+        }
+    }
+    return variables;
+}
+
+static std::vector<ShaderBlock> ReflectBlocks(GLuint program, GLenum interface) {
+    const GLenum properties[] = {GL_NAME_LENGTH, GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE};
+
+    GLint count = 0;
+    glGetProgramInterfaceiv(program, interface, GL_ACTIVE_RESOURCES, &count);
+
+    std::vector<ShaderBlock> blocks;
+    for (GLint i = 0; i < count; i++) {
+        GLint values[3] = {};
+        glGetProgramResourceiv(program, interface, i, 3, properties, 3, nullptr, values);
+        blocks.push_back({ResourceName(program, interface, i, values[0]), values[1], values[2]});
+    }
+    return blocks;
+}
+
+ProgramReflection ReflectProgram(GLuint program, const std::string& name) {
+    ProgramReflection reflection;
+    reflection.Name = name;
+    reflection.Inputs = ReflectVariables(program, GL_PROGRAM_INPUT);
+    reflection.Uniforms = ReflectVariables(program, GL_UNIFORM);
+    reflection.BufferVariables = ReflectVariables(program, GL_BUFFER_VARIABLE);
+    reflection.UniformBlocks = ReflectBlocks(program, GL_UNIFORM_BLOCK);
+    reflection.StorageBlocks = ReflectBlocks(program, GL_SHADER_STORAGE_BLOCK);
+    return reflection;
+}
+
+/*
+    Serialized form: "GLRF", version, the name, then the five tables, every
+    one a count followed by its entries. Strings are a length and the
+    characters, numbers are 32 bit, in the byte order of the machine (the
+    cache is for this machine only anyway).
+*/
+
+static void WriteInt(std::vector<unsigned char>& data, int32_t value) {
+    unsigned char bytes[4];
+    std::memcpy(bytes, &value, 4);
+    data.insert(data.end(), bytes, bytes + 4);
+}
+
+static void WriteString(std::vector<unsigned char>& data, const std::string& value) {
+    WriteInt(data, (int32_t)value.size());
+    data.insert(data.end(), value.begin(), value.end());
+}
+
+struct ReflectionReader {
+    const unsigned char* Data;
+    size_t Size;
+    size_t Position;
+
+    bool ReadInt(int32_t& value) {
+        if (Size - Position < 4) {
+            return false;
+        }
+        std::memcpy(&value, Data + Position, 4);
+        Position += 4;
+        return true;
+    }
+
+    bool ReadString(std::string& value) {
+        int32_t length;
+        if (!ReadInt(length) || length < 0 || Size - Position < (size_t)length) {
+            return false;
+        }
+        value.assign((const char*)Data + Position, length);
+        Position += length;
+        return true;
+    }
+};
+
+static void WriteVariables(std::vector<unsigned char>& data, const std::vector<ShaderVariable>& variables) {
+    WriteInt(data, (int32_t)variables.size());
+    for (const ShaderVariable& variable : variables) {
+        WriteString(data, variable.Name);
+        WriteInt(data, (int32_t)variable.Type);
+        WriteInt(data, variable.Location);
+        WriteInt(data, variable.ArraySize);
+        WriteInt(data, variable.BlockIndex);
+        WriteInt(data, variable.Offset);
+        WriteInt(data, variable.ArrayStride);
+    }
+}
+
+static bool ReadVariables(ReflectionReader& reader, std::vector<ShaderVariable>& variables) {
+    int32_t count;
+    if (!reader.ReadInt(count) || count < 0 || (size_t)count > reader.Size / 4) {
+        return false;
+    }
+    variables.resize(count);
+    for (ShaderVariable& variable : variables) {
+        int32_t type;
+        if (!reader.ReadString(variable.Name) || !reader.ReadInt(type) || !reader.ReadInt(variable.Location) ||
+            !reader.ReadInt(variable.ArraySize) || !reader.ReadInt(variable.BlockIndex) ||
+            !reader.ReadInt(variable.Offset) || !reader.ReadInt(variable.ArrayStride)) {
+            return false;
+        }
+        variable.Type = (GLenum)type;
+    }
+    return true;
+}
+
+static void WriteBlocks(std::vector<unsigned char>& data, const std::vector<ShaderBlock>& blocks) {
+    WriteInt(data, (int32_t)blocks.size());
+    for (const ShaderBlock& block : blocks) {
+        WriteString(data, block.Name);
+        WriteInt(data, block.Binding);
+        WriteInt(data, block.DataSize);
+    }
+}
+
+static bool ReadBlocks(ReflectionReader& reader, std::vector<ShaderBlock>& blocks) {
+    int32_t count;
+    if (!reader.ReadInt(count) || count < 0 || (size_t)count > reader.Size / 4) {
+        return false;
+    }
+    blocks.resize(count);
+    for (ShaderBlock& block : blocks) {
+        if (!reader.ReadString(block.Name) || !reader.ReadInt(block.Binding) || !reader.ReadInt(block.DataSize)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SerializeReflection(const ProgramReflection& reflection, std::vector<unsigned char>& data) {
+    data.insert(data.end(), REFLECTION_MAGIC, REFLECTION_MAGIC + 4);
+    WriteInt(data, REFLECTION_VERSION);
+    WriteString(data, reflection.Name);
+    WriteVariables(data, reflection.Inputs);
+    WriteVariables(data, reflection.Uniforms);
+    WriteVariables(data, reflection.BufferVariables);
+    WriteBlocks(data, reflection.UniformBlocks);
+    WriteBlocks(data, reflection.StorageBlocks);
+}
+
+bool DeserializeReflection(const unsigned char* data, size_t size, ProgramReflection& reflection) {
+    ReflectionReader reader = {data, size, 4};
+    int32_t version;
+    return size >= 4 && std::memcmp(data, REFLECTION_MAGIC, 4) == 0 &&
+           reader.ReadInt(version) && version == (int32_t)REFLECTION_VERSION &&
+           reader.ReadString(reflection.Name) &&
+           ReadVariables(reader, reflection.Inputs) &&
+           ReadVariables(reader, reflection.Uniforms) &&
+           ReadVariables(reader, reflection.BufferVariables) &&
+           ReadBlocks(reader, reflection.UniformBlocks) &&
+           ReadBlocks(reader, reflection.StorageBlocks) &&
+           reader.Position == size;
+}
+
+static std::string TypeName(GLenum type) {
+    switch (type) {
+        case GL_FLOAT: return "float";
+        case GL_FLOAT_VEC2: return "vec2";
+        case GL_FLOAT_VEC3: return "vec3";
+        case GL_FLOAT_VEC4: return "vec4";
+        case GL_INT: return "int";
+        case GL_INT_VEC2: return "ivec2";
+        case GL_INT_VEC3: return "ivec3";
+        case GL_INT_VEC4: return "ivec4";
+        case GL_UNSIGNED_INT: return "uint";
+        case GL_UNSIGNED_INT_VEC2: return "uvec2";
+        case GL_UNSIGNED_INT_VEC3: return "uvec3";
+        case GL_UNSIGNED_INT_VEC4: return "uvec4";
+        case GL_BOOL: return "bool";
+        case GL_FLOAT_MAT3: return "mat3";
+        case GL_FLOAT_MAT4: return "mat4";
+        case GL_SAMPLER_2D: return "sampler2D";
+        case GL_SAMPLER_CUBE: return "samplerCube";
+    }
+    char hex[16];
+    std::snprintf(hex, sizeof(hex), "0x%04X", type);
+    return hex;
+}
+
+void PrintReflection(const ProgramReflection& reflection, std::ostream& out) {
+    out << reflection.Name << "\n";
+    for (const ShaderVariable& input : reflection.Inputs) {
+        out << "  in      " << TypeName(input.Type) << " " << input.Name << " (location " << input.Location << ")\n";
+    }
+    for (const ShaderVariable& uniform : reflection.Uniforms) {
+        out << "  uniform " << TypeName(uniform.Type) << " " << uniform.Name;
+        if (uniform.BlockIndex >= 0) {
+            out << " (block " << reflection.UniformBlocks[uniform.BlockIndex].Name << ", offset " << uniform.Offset << ")\n";
+        }
+        else {
+            out << " (location " << uniform.Location << ")\n";
+        }
+    }
+    for (const ShaderVariable& variable : reflection.BufferVariables) {
+        out << "  buffer  " << TypeName(variable.Type) << " " << variable.Name << " (block "
+            << reflection.StorageBlocks[variable.BlockIndex].Name << ", offset " << variable.Offset
+            << ", stride " << variable.ArrayStride << ")\n";
+    }
+    for (const ShaderBlock& block : reflection.UniformBlocks) {
+        out << "  uniform block " << block.Name << " (binding " << block.Binding << ", " << block.DataSize << " bytes)\n";
+    }
+    for (const ShaderBlock& block : reflection.StorageBlocks) {
+        out << "  storage block " << block.Name << " (binding " << block.Binding << ", " << block.DataSize << " bytes)\n";
+    }
+}
+
+static bool IsIntegerType(GLenum type) {
+    switch (type) {
+        case GL_INT: case GL_INT_VEC2: case GL_INT_VEC3: case GL_INT_VEC4:
+        case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+            return true;
+    }
+    return false;
+}
+
+bool ValidateVertexLayout(const ProgramReflection& reflection, const MeshLayout& layout) {
+    bool valid = true;
+    for (const ShaderVariable& input : reflection.Inputs) {
+        const VertexAttribute* found = nullptr;
+        for (uint32_t i = 0; i < layout.AttributeCount; i++) {
+            if (layout.Attributes[i].Location == input.Location) {
+                found = &layout.Attributes[i];
+            }
+        }
+        if (!found) {
+            std::cerr << reflection.Name << ": input " << input.Name << " reads location " << input.Location
+                      << ", the mesh has no attribute there" << std::endl;
+            valid = false;
+        }
+        else if (IsIntegerType(input.Type)) {
+            std::cerr << reflection.Name << ": input " << input.Name << " is " << TypeName(input.Type)
+                      << ", but vertex attributes are converted to float" << std::endl;
+            valid = false;
+        }
+    }
+    return valid;
+}
+
+// Arrays are reported as "name[0]".
+static bool SameName(const std::string& reported, const std::string& name) {
+    return reported == name || reported == name + "[0]";
+}
+
+bool ValidateUniform(const ProgramReflection& reflection, const std::string& name, GLenum type, GLint* location) {
+    for (const ShaderVariable& uniform : reflection.Uniforms) {
+        if (uniform.BlockIndex < 0 && SameName(uniform.Name, name)) {
+            if (uniform.Type != type) {
+                std::cerr << reflection.Name << ": uniform " << name << " is " << TypeName(uniform.Type)
+                          << ", the code sets a " << TypeName(type) << std::endl;
+                return false;
+            }
+            if (location) {
+                *location = uniform.Location;
+            }
+            return true;
+        }
+    }
+    std::cerr << reflection.Name << ": no uniform " << name << " (misspelled, or optimized away)" << std::endl;
+    return false;
+}
+
+static const ShaderBlock* FindBlock(const std::vector<ShaderBlock>& blocks, const std::string& name, GLint* index) {
+    for (size_t i = 0; i < blocks.size(); i++) {
+        if (blocks[i].Name == name) {
+            *index = (GLint)i;
+            return &blocks[i];
+        }
+    }
+    return nullptr;
+}
+
+bool ValidateUniformBlock(const ProgramReflection& reflection, const std::string& name, size_t size,
+                          std::initializer_list<std::pair<const char*, size_t>> members) {
+    GLint index;
+    const ShaderBlock* block = FindBlock(reflection.UniformBlocks, name, &index);
+    if (!block) {
+        std::cerr << reflection.Name << ": no uniform block " << name << std::endl;
+        return false;
+    }
+
+    bool valid = true;
+    if (size < (size_t)block->DataSize) {
+        std::cerr << reflection.Name << ": uniform block " << name << " is " << block->DataSize
+                  << " bytes, the C++ struct only " << size << std::endl;
+        valid = false;
+    }
+
+    for (const std::pair<const char*, size_t>& member : members) {
+        const ShaderVariable* found = nullptr;
+        for (const ShaderVariable& uniform : reflection.Uniforms) {
+            if (uniform.BlockIndex == index && SameName(uniform.Name, member.first)) {
+                found = &uniform;
+            }
+        }
+        if (!found) {
+            std::cerr << reflection.Name << ": uniform block " << name << " has no member " << member.first << std::endl;
+            valid = false;
+        }
+        else if ((size_t)found->Offset != member.second) {
+            std::cerr << reflection.Name << ": " << member.first << " is at offset " << found->Offset
+                      << " of " << name << ", in the C++ struct at " << member.second << std::endl;
+            valid = false;
+        }
+    }
+    return valid;
+}
+
+bool ValidateStorageBlock(const ProgramReflection& reflection, const std::string& name,
+                          const std::string& array, size_t stride) {
+    GLint index;
+    if (!FindBlock(reflection.StorageBlocks, name, &index)) {
+        std::cerr << reflection.Name << ": no storage block " << name << std::endl;
+        return false;
+    }
+    if (array.empty()) {
+        return true;
+    }
+
+    // Members of an array of structs are reported one by one ("instances[0].MVP"),
+    // all with the stride of the array.
+    const std::string prefix = array + "[0]";
+    for (const ShaderVariable& variable : reflection.BufferVariables) {
+        if (variable.BlockIndex == index && variable.Name.compare(0, prefix.size(), prefix) == 0) {
+            if ((size_t)variable.ArrayStride != stride) {
+                std::cerr << reflection.Name << ": elements of " << array << " are " << variable.ArrayStride
+                          << " bytes apart, the C++ struct is " << stride << std::endl;
+                return false;
+            }
+            return true;
+        }
+    }
+    std::cerr << reflection.Name << ": storage block " << name << " has no array " << array << std::endl;
+    return false;
+}
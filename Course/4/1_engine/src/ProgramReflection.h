@@ -0,0 +1,101 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <initializer_list>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MeshFile.h"
+
+/*
+        PROGRAM REFLECTION
+    After linking, OpenGL knows the whole interface of a program: which
+    inputs it reads from which location, which uniforms it has and of what
+    type, which blocks sit at which binding and how big they are. We ask for
+    all of it once (glGetProgramInterfaceiv and glGetProgramResource*) and
+    keep the answers in a small table.
+
+    The table is then checked against the C++ side right when the program is
+    loaded:
+    - the vertex layout of the meshes it draws (MeshLayout),
+    - the uniforms we are going to set, and their types,
+    - the structs we upload into blocks: size and offset of every member,
+      and the stride of storage buffer arrays.
+    A mistake becomes a message that names the program and the variable,
+    instead of a location of -1 or a black screen.
+
+    The table is saved next to the program binary in the program cache (see
+    BuildProgram in Shader.h), so a warm start doesn't query it again.
+*/
+
+struct ShaderVariable {
+    std::string Name;
+    // GL_FLOAT_VEC3, GL_SAMPLER_2D, ...
+    GLenum Type;
+    // -1 for members of blocks.
+    GLint Location;
+    GLint ArraySize;
+    // Index into UniformBlocks or StorageBlocks, -1 outside of blocks.
+    GLint BlockIndex;
+    // Byte offset inside of the block, -1 outside of blocks.
+    GLint Offset;
+    // Uniforms: between array elements. Buffer variables: between elements
+    // of the outermost array (GL_TOP_LEVEL_ARRAY_STRIDE).
+    GLint ArrayStride;
+};
+
+struct ShaderBlock {
+    std::string Name;
+    GLint Binding;
+    // The smallest buffer that holds the block (without the elements of an
+    // unsized array at the end).
+    GLint DataSize;
+};
+
+struct ProgramReflection {
+    // Only for messages, usually the path of the .shader file.
+    std::string Name;
+    std::vector<ShaderVariable> Inputs;
+    std::vector<ShaderVariable> Uniforms;
+    std::vector<ShaderVariable> BufferVariables;
+    std::vector<ShaderBlock> UniformBlocks;
+    std::vector<ShaderBlock> StorageBlocks;
+};
+
+// The program must be linked. Built-in inputs (gl_VertexID...) are left out.
+ProgramReflection ReflectProgram(GLuint program, const std::string& name);
+
+// A flat binary form of the table, for the program cache.
+void SerializeReflection(const ProgramReflection& reflection, std::vector<unsigned char>& data);
+bool DeserializeReflection(const unsigned char* data, size_t size, ProgramReflection& reflection);
+
+// Prints the table, one line per entry.
+void PrintReflection(const ProgramReflection& reflection, std::ostream& out);
+
+/*
+    The checks. Every one prints what's wrong (to std::cerr) and returns
+    false, so a loader can call all of them and stop at the end.
+*/
+
+// Every input of the vertex shader must have an attribute with its location
+// in the layout. Integer inputs can't be fed by our (float) attributes.
+bool ValidateVertexLayout(const ProgramReflection& reflection, const MeshLayout& layout);
+
+// The uniform must exist (outside of a block) and have the given type.
+// location (optional) gets its location, for glUniform*.
+bool ValidateUniform(const ProgramReflection& reflection, const std::string& name, GLenum type,
+                     GLint* location = nullptr);
+
+// The uniform block must exist and size must cover it, for a C++ struct
+// that is uploaded as a whole. members are (GLSL name, offsetof in the struct).
+bool ValidateUniformBlock(const ProgramReflection& reflection, const std::string& name, size_t size,
+                          std::initializer_list<std::pair<const char*, size_t>> members = {});
+
+// The storage block must exist, and if array is given, its elements must be
+// stride bytes apart (sizeof the C++ struct of one element).
+bool ValidateStorageBlock(const ProgramReflection& reflection, const std::string& name,
+                          const std::string& array = "", size_t stride = 0);
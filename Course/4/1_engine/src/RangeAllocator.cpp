@@ -0,0 +1,209 @@
+#include "RangeAllocator.h"
+
+RangeAllocator::RangeAllocator(uint32_t size) : m_Size(size) {
+    Reset();
+}
+
+// Sizes below 8 get a bin each. Above that, the highest bit picks a row of 8
+// bins and the 3 bits after it the bin in the row, so every bin covers 1/8
+// of its power of two.
+uint32_t RangeAllocator::BinOf(uint32_t size) {
+    if (size < (1u << SecondLevelBits)) {
+        return size;
+    }
+    uint32_t highest = 31 - __builtin_clz(size);
+    uint32_t row = highest - SecondLevelBits + 1;
+    uint32_t column = (size >> (highest - SecondLevelBits)) & ((1u << SecondLevelBits) - 1);
+    return (row << SecondLevelBits) | column;
+}
+
+// The first non-empty bin whose blocks are all at least size big: the bin
+// of size rounded up to the next bin boundary, or any bin after it.
+uint32_t RangeAllocator::FindBin(uint32_t size) const {
+    if (size >= (1u << SecondLevelBits)) {
+        uint32_t highest = 31 - __builtin_clz(size);
+        size += (1u << (highest - SecondLevelBits)) - 1;
+    }
+    uint32_t bin = BinOf(size);
+    uint32_t row = bin >> SecondLevelBits;
+    if (row >= 32) {
+        return NoSpace;
+    }
+
+    uint32_t columns = m_SecondLevel[row] & (0xffu << (bin & ((1u << SecondLevelBits) - 1)));
+    if (columns == 0) {
+        uint32_t rows = row + 1 < 32 ? m_FirstLevel & (0xffffffffu << (row + 1)) : 0;
+        if (rows == 0) {
+            return NoSpace;
+        }
+        row = __builtin_ctz(rows);
+        columns = m_SecondLevel[row];
+    }
+    return (row << SecondLevelBits) | __builtin_ctz(columns);
+}
+
+uint32_t RangeAllocator::NewNode() {
+    if (m_UnusedNodes != NoSpace) {
+        uint32_t node = m_UnusedNodes;
+        m_UnusedNodes = m_Nodes[node].NextFree;
+        return node;
+    }
+    m_Nodes.emplace_back();
+    return (uint32_t)m_Nodes.size() - 1;
+}
+
+void RangeAllocator::InsertFree(uint32_t node) {
+    uint32_t bin = BinOf(m_Nodes[node].Size);
+    m_Nodes[node].Used = false;
+    m_Nodes[node].PreviousFree = NoSpace;
+    m_Nodes[node].NextFree = m_Bins[bin];
+    if (m_Bins[bin] != NoSpace) {
+        m_Nodes[m_Bins[bin]].PreviousFree = node;
+    }
+    m_Bins[bin] = node;
+    m_SecondLevel[bin >> SecondLevelBits] |= 1u << (bin & ((1u << SecondLevelBits) - 1));
+    m_FirstLevel |= 1u << (bin >> SecondLevelBits);
+    m_FreeSize += m_Nodes[node].Size;
+}
+
+void RangeAllocator::RemoveFree(uint32_t node) {
+    Node& n = m_Nodes[node];
+    uint32_t bin = BinOf(n.Size);
+    if (n.PreviousFree != NoSpace) {
+        m_Nodes[n.PreviousFree].NextFree = n.NextFree;
+    }
+    else {
+        m_Bins[bin] = n.NextFree;
+    }
+    if (n.NextFree != NoSpace) {
+        m_Nodes[n.NextFree].PreviousFree = n.PreviousFree;
+    }
+
+    if (m_Bins[bin] == NoSpace) {
+        uint32_t row = bin >> SecondLevelBits;
+        m_SecondLevel[row] &= ~(1u << (bin & ((1u << SecondLevelBits) - 1)));
+        if (m_SecondLevel[row] == 0) {
+            m_FirstLevel &= ~(1u << row);
+        }
+    }
+    m_FreeSize -= n.Size;
+}
+
+RangeAllocator::Allocation RangeAllocator::Allocate(uint32_t size) {
+    Allocation allocation;
+    if (size == 0) {
+        size = 1;
+    }
+    uint32_t node = NoSpace;
+    uint32_t bin = FindBin(size);
+    if (bin != NoSpace) {
+        node = m_Bins[bin];
+    }
+    else {
+        // Nearly full: the bin size falls into may still hold a block that's
+        // big enough, it's just not guaranteed. Worth a look before failing.
+        for (uint32_t candidate = m_Bins[BinOf(size)]; candidate != NoSpace;
+             candidate = m_Nodes[candidate].NextFree) {
+            if (m_Nodes[candidate].Size >= size) {
+                node = candidate;
+                break;
+            }
+        }
+        if (node == NoSpace) {
+            return allocation;
+        }
+    }
+
+    RemoveFree(node);
+    m_Nodes[node].Used = true;
+
+    // The rest becomes a free block right behind the allocation.
+    if (m_Nodes[node].Size > size) {
+        uint32_t rest = NewNode();
+        Node& n = m_Nodes[node];
+        m_Nodes[rest] = {n.Offset + size, n.Size - size, node, n.NextBlock, NoSpace, NoSpace, false};
+        if (n.NextBlock != NoSpace) {
+            m_Nodes[n.NextBlock].PreviousBlock = rest;
+        }
+        n.NextBlock = rest;
+        n.Size = size;
+        InsertFree(rest);
+    }
+
+    m_AllocationCount++;
+    allocation.Offset = m_Nodes[node].Offset;
+    allocation.Node = node;
+    return allocation;
+}
+
+void RangeAllocator::Free(Allocation allocation) {
+    uint32_t node = allocation.Node;
+    if (node == NoSpace || node >= m_Nodes.size() || !m_Nodes[node].Used) {
+        return;
+    }
+    m_AllocationCount--;
+
+    // Swallow a free block before and after; their nodes go back to the
+    // list of unused ones.
+    uint32_t previous = m_Nodes[node].PreviousBlock;
+    if (previous != NoSpace && !m_Nodes[previous].Used) {
+        RemoveFree(previous);
+        m_Nodes[node].Offset = m_Nodes[previous].Offset;
+        m_Nodes[node].Size += m_Nodes[previous].Size;
+        m_Nodes[node].PreviousBlock = m_Nodes[previous].PreviousBlock;
+        if (m_Nodes[node].PreviousBlock != NoSpace) {
+            m_Nodes[m_Nodes[node].PreviousBlock].NextBlock = node;
+        }
+        m_Nodes[previous].NextFree = m_UnusedNodes;
+        m_UnusedNodes = previous;
+    }
+
+    uint32_t next = m_Nodes[node].NextBlock;
+    if (next != NoSpace && !m_Nodes[next].Used) {
+        RemoveFree(next);
+        m_Nodes[node].Size += m_Nodes[next].Size;
+        m_Nodes[node].NextBlock = m_Nodes[next].NextBlock;
+        if (m_Nodes[node].NextBlock != NoSpace) {
+            m_Nodes[m_Nodes[node].NextBlock].PreviousBlock = node;
+        }
+        m_Nodes[next].NextFree = m_UnusedNodes;
+        m_UnusedNodes = next;
+    }
+
+    InsertFree(node);
+}
+
+void RangeAllocator::Reset() {
+    m_Nodes.clear();
+    m_UnusedNodes = NoSpace;
+    m_FreeSize = 0;
+    m_AllocationCount = 0;
+    m_FirstLevel = 0;
+    for (uint32_t& bin : m_Bins) {
+        bin = NoSpace;
+    }
+    for (uint8_t& row : m_SecondLevel) {
+        row = 0;
+    }
+
+    if (m_Size > 0) {
+        m_Nodes.push_back({0, m_Size, NoSpace, NoSpace, NoSpace, NoSpace, false});
+        InsertFree(0);
+    }
+}
+
+uint32_t RangeAllocator::GetLargestFreeBlock() const {
+    if (m_FirstLevel == 0) {
+        return 0;
+    }
+    // Only the highest bin can hold it, but its blocks differ in size.
+    uint32_t row = 31 - __builtin_clz(m_FirstLevel);
+    uint32_t bin = (row << SecondLevelBits) | (31 - __builtin_clz((uint32_t)m_SecondLevel[row]));
+    uint32_t largest = 0;
+    for (uint32_t node = m_Bins[bin]; node != NoSpace; node = m_Nodes[node].NextFree) {
+        if (m_Nodes[node].Size > largest) {
+            largest = m_Nodes[node].Size;
+        }
+    }
+    return largest;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+        TLSF RANGE ALLOCATOR
+    Hands out ranges of some bigger space, like malloc does for memory. It
+    never touches that space itself, it only does the bookkeeping: here the
+    space is a big GPU buffer (MeshArena.h), and the allocator only says at
+    which offset a mesh goes.
+
+    It's a TWO LEVEL SEGREGATED FIT allocator (TLSF). Free blocks are sorted
+    into bins by size: the first level is the power of two (the highest set
+    bit), the second level splits every power of two into 8 steps. A bitmap
+    says which bins have a block. Finding a block that's big enough is then
+    two "find first set bit" instructions instead of a walk over a free list,
+    so Allocate() and Free() take the same (tiny) time however full or
+    fragmented the space is.
+
+    - Allocate() takes the first block of the smallest bin whose blocks are
+      all big enough, and splits off what it doesn't need. Only if there is
+      no such bin does it search the bin the size itself falls into.
+    - Free() merges the block with free neighbours right away, so two free
+      blocks never sit next to each other.
+
+    Sizes and offsets are in whatever units the caller likes (bytes,
+    vertices...), up to 2^31 of them.
+*/
+
+class RangeAllocator {
+public:
+    static const uint32_t NoSpace = 0xffffffff;
+
+    struct Allocation {
+        uint32_t Offset = NoSpace;
+        // For Free(). NoSpace if the allocation failed.
+        uint32_t Node = NoSpace;
+    };
+
+    explicit RangeAllocator(uint32_t size);
+
+    // Node is NoSpace if there is no free block of that size.
+    Allocation Allocate(uint32_t size);
+    void Free(Allocation allocation);
+
+    // Makes the whole space one free block again.
+    void Reset();
+
+    uint32_t GetSize() const { return m_Size; }
+    uint32_t GetSize(Allocation allocation) const { return m_Nodes[allocation.Node].Size; }
+    uint32_t GetFreeSize() const { return m_FreeSize; }
+    uint32_t GetLargestFreeBlock() const;
+    size_t GetAllocationCount() const { return m_AllocationCount; }
+
+private:
+    static const int SecondLevelBits = 3;
+    static const int BinCount = 32 << SecondLevelBits;
+
+    struct Node {
+        uint32_t Offset;
+        uint32_t Size;
+        // Neighbours in the space, NoSpace at either end.
+        uint32_t PreviousBlock;
+        uint32_t NextBlock;
+        // Neighbours in the bin (free blocks) or in the list of unused nodes.
+        uint32_t PreviousFree;
+        uint32_t NextFree;
+        bool Used;
+    };
+
+    static uint32_t BinOf(uint32_t size);
+    uint32_t FindBin(uint32_t size) const;
+    uint32_t NewNode();
+    void InsertFree(uint32_t node);
+    void RemoveFree(uint32_t node);
+
+    uint32_t m_Size;
+    uint32_t m_FreeSize = 0;
+    size_t m_AllocationCount = 0;
+    std::vector<Node> m_Nodes;
+    uint32_t m_UnusedNodes = NoSpace;
+    // First free block of every bin.
+    uint32_t m_Bins[BinCount];
+    // Bit i of m_FirstLevel: m_SecondLevel[i] is not 0. Bit j of
+    // m_SecondLevel[i]: bin (i << SecondLevelBits) + j has a block.
+    uint32_t m_FirstLevel = 0;
+    uint8_t m_SecondLevel[32];
+};
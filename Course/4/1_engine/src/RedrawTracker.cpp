@@ -0,0 +1,78 @@
+#include "RedrawTracker.h"
+
+#include <algorithm>
+
+const char* GetRedrawReasonName(RedrawReason reason) {
+    switch (reason) {
+        case RedrawReason::Window: return "window";
+        case RedrawReason::Input: return "input";
+        case RedrawReason::Animation: return "animation";
+        case RedrawReason::Content: return "content";
+    }
+    return "?";
+}
+
+static uint32_t Bit(RedrawReason reason) {
+    return 1u << (uint32_t)reason;
+}
+
+RedrawTracker::RedrawTracker(double maxWaitSeconds)
+    : m_MaxWait(std::max(maxWaitSeconds, 0.0)), m_Dirty(Bit(RedrawReason::Window)) {}
+
+void RedrawTracker::Invalidate(RedrawReason reason) {
+    m_Dirty |= Bit(reason);
+}
+
+bool RedrawTracker::BeginFrame(double now) {
+    // The time since the last frame goes to what that frame was.
+    std::clock_t cpu = std::clock();
+    if (m_Started) {
+        double wall = now - m_LastTime;
+        double cpuSeconds = (double)(cpu - m_LastCpu) / CLOCKS_PER_SEC;
+        if (m_LastDrawn) {
+            m_Stats.BusySeconds += wall;
+            m_Stats.BusyCpuSeconds += cpuSeconds;
+        }
+        else {
+            m_Stats.IdleSeconds += wall;
+            m_Stats.IdleCpuSeconds += cpuSeconds;
+        }
+    }
+    m_Started = true;
+    m_LastTime = now;
+    m_LastCpu = cpu;
+
+    uint32_t reasons = m_Dirty;
+    if (m_Animating) {
+        reasons |= Bit(RedrawReason::Animation);
+    }
+    m_Dirty = 0;
+
+    m_Stats.Frames++;
+    m_LastDrawn = reasons != 0;
+    if (!m_LastDrawn) {
+        m_Stats.Skipped++;
+        return false;
+    }
+    m_Stats.Drawn++;
+    for (size_t i = 0; i < RedrawStats::ReasonCount; i++) {
+        if (reasons & (1u << i)) {
+            m_Stats.Reasons[i]++;
+        }
+    }
+    return true;
+}
+
+double RedrawTracker::GetWaitTimeout() const {
+    return m_Dirty != 0 || m_Animating ? 0.0 : m_MaxWait;
+}
+
+void RedrawTracker::PrintReport(std::ostream& out) const {
+    out << "redraw frames " << m_Stats.Frames << " drawn " << m_Stats.Drawn << " skipped " << m_Stats.Skipped
+        << " skipped_percent " << m_Stats.GetSkippedPercent() << " idle_s " << m_Stats.IdleSeconds
+        << " idle_cpu_percent " << m_Stats.GetIdleCpuPercent() << " busy_s " << m_Stats.BusySeconds
+        << " busy_cpu_percent " << m_Stats.GetBusyCpuPercent() << "\n";
+    for (size_t i = 0; i < RedrawStats::ReasonCount; i++) {
+        out << "redraw_reason " << GetRedrawReasonName((RedrawReason)i) << " frames " << m_Stats.Reasons[i] << "\n";
+    }
+}
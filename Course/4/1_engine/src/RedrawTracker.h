@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <ostream>
+
+/*
+        DRAWING ON DEMAND
+    A loop that polls for events and swaps as fast as it may draws the same
+    picture over and over when nothing moves: the CPU culls, the GPU shades
+    and the screen shows nothing new. On a display that is always on that is
+    power (and fan noise) for nothing.
+
+    On demand, the loop asks a different question each time around: would
+    this frame look any different from the last one? Only when something
+    changed:
+    - WINDOW:    resized, uncovered (the refresh callback), focus
+    - INPUT:     a key or the mouse
+    - ANIMATION: something is moving, then every frame is different
+    - CONTENT:   something arrived or changed outside of the loop, like a
+                 texture that finished loading or a new render scale
+    If none of these happened, the frame is skipped entirely, no clear, no
+    draw and no swap, and the loop goes back to sleep in
+    glfwWaitEventsTimeout until the next event.
+
+    The tracker counts the frames it skipped and measures the process's CPU
+    time while it sleeps (std::clock, all threads together), which is what
+    the idle scene really costs.
+*/
+
+enum class RedrawReason : uint8_t { Window, Input, Animation, Content };
+
+const char* GetRedrawReasonName(RedrawReason reason);
+
+struct RedrawStats {
+    static const size_t ReasonCount = 4;
+
+    // Times the loop came around, and how many of those it drew.
+    size_t Frames = 0;
+    size_t Drawn = 0;
+    size_t Skipped = 0;
+    // Drawn frames per reason; a frame can have several.
+    size_t Reasons[ReasonCount] = {};
+    // Wall clock and CPU time after skipped frames (the sleeping) and after
+    // drawn ones.
+    double IdleSeconds = 0.0;
+    double IdleCpuSeconds = 0.0;
+    double BusySeconds = 0.0;
+    double BusyCpuSeconds = 0.0;
+
+    double GetSkippedPercent() const { return Frames > 0 ? 100.0 * Skipped / Frames : 0.0; }
+    // Of one core.
+    double GetIdleCpuPercent() const { return IdleSeconds > 0.0 ? 100.0 * IdleCpuSeconds / IdleSeconds : 0.0; }
+    double GetBusyCpuPercent() const { return BusySeconds > 0.0 ? 100.0 * BusyCpuSeconds / BusySeconds : 0.0; }
+};
+
+class RedrawTracker {
+public:
+    // maxWaitSeconds: the longest the loop sleeps, so it still notices
+    // what doesn't send an event.
+    explicit RedrawTracker(double maxWaitSeconds = 1.0);
+
+    // Something changed; the next frame is drawn. The first frame always is.
+    void Invalidate(RedrawReason reason);
+    // While animating, every frame is drawn.
+    void SetAnimating(bool animating) { m_Animating = animating; }
+    bool IsAnimating() const { return m_Animating; }
+
+    // At the top of every frame. True if it must be drawn; either way the
+    // reasons are used up.
+    bool BeginFrame(double now);
+    // For glfwWaitEventsTimeout: 0 when the next frame is to be drawn anyway.
+    double GetWaitTimeout() const;
+
+    const RedrawStats& GetStats() const { return m_Stats; }
+    // "redraw ..." and one "redraw_reason ..." line per reason.
+    void PrintReport(std::ostream& out) const;
+
+private:
+    double m_MaxWait;
+    uint32_t m_Dirty;
+    bool m_Animating = false;
+
+    // Where the previous BeginFrame() was, and whether it drew.
+    bool m_Started = false;
+    bool m_LastDrawn = false;
+    double m_LastTime = 0.0;
+    std::clock_t m_LastCpu = 0;
+
+    RedrawStats m_Stats;
+};
@@ -0,0 +1,451 @@
+#include "RenderGraph.h"
+
+#include "Renderer.h"
+
+#include <algorithm>
+#include <iostream>
+
+// How many frames a GL texture (and its framebuffers) stays around without
+// being used, so a pass that comes and goes doesn't allocate every time.
+static const uint64_t KEEP_FRAMES = 8;
+
+static bool IsDepthFormat(GLenum format) {
+    switch (format) {
+        case GL_DEPTH_COMPONENT16:
+        case GL_DEPTH_COMPONENT24:
+        case GL_DEPTH_COMPONENT32:
+        case GL_DEPTH_COMPONENT32F:
+        case GL_DEPTH24_STENCIL8:
+        case GL_DEPTH32F_STENCIL8:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool HasStencil(GLenum format) {
+    return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+static size_t BytesPerPixel(GLenum format) {
+    switch (format) {
+        case GL_R8: return 1;
+        case GL_RG8:
+        case GL_R16F:
+        case GL_DEPTH_COMPONENT16: return 2;
+        case GL_RGBA16F:
+        case GL_RG32F:
+        case GL_DEPTH32F_STENCIL8: return 8;
+        case GL_RGBA32F: return 16;
+        // RGBA8, RGB10_A2, R11F_G11F_B10F, RG16F, R32F, the 24 and 32 bit depths...
+        default: return 4;
+    }
+}
+
+static size_t TargetBytes(const RenderTargetDesc& desc) {
+    return (size_t)desc.Width * desc.Height * BytesPerPixel(desc.Format);
+}
+
+static bool SameDesc(const RenderTargetDesc& a, const RenderTargetDesc& b) {
+    return a.Width == b.Width && a.Height == b.Height && a.Format == b.Format;
+}
+
+void RenderPassBuilder::Read(RenderTarget target) {
+    if (target.Index < m_Graph.m_Targets.size()) {
+        m_Graph.m_Passes[m_Pass].Reads.push_back(target.Index);
+    }
+}
+
+void RenderPassBuilder::Write(RenderTarget target, LoadOp load, const float* clearColor) {
+    if (target.Index >= m_Graph.m_Targets.size()) {
+        return;
+    }
+    RenderGraph::PassWrite write = {target.Index, load, {0.0f, 0.0f, 0.0f, 0.0f}};
+    if (clearColor) {
+        std::copy(clearColor, clearColor + 4, write.ClearColor);
+    }
+    m_Graph.m_Passes[m_Pass].Writes.push_back(write);
+}
+
+void RenderPassBuilder::SideEffect() {
+    m_Graph.m_Passes[m_Pass].SideEffect = true;
+}
+
+GLuint RenderPassContext::GetTexture(RenderTarget target) const {
+    const RenderGraph::Target& t = m_Graph.m_Targets[target.Index];
+    return t.Kind == RenderGraph::TargetKind::Backbuffer ? 0 : t.Texture;
+}
+
+const RenderTargetDesc& RenderPassContext::GetDesc(RenderTarget target) const {
+    return m_Graph.m_Targets[target.Index].Desc;
+}
+
+RenderGraph::RenderGraph(ResourcePool& resources) : m_Resources(resources) {}
+
+RenderGraph::~RenderGraph() {
+    for (auto& framebuffer : m_Framebuffers) {
+        GLCall(glDeleteFramebuffers(1, &framebuffer.second));
+    }
+    for (PhysicalTexture& texture : m_Textures) {
+        m_Resources.Destroy(texture.Handle);
+    }
+}
+
+void RenderGraph::Begin() {
+    m_Passes.clear();
+    m_Targets.clear();
+}
+
+RenderTarget RenderGraph::Create(const std::string& name, const RenderTargetDesc& desc) {
+    m_Targets.push_back({name, desc, TargetKind::Transient, 0, -1, -1, 0, GL_NONE});
+    return {(uint32_t)m_Targets.size() - 1};
+}
+
+RenderTarget RenderGraph::Import(const std::string& name, GLuint texture, const RenderTargetDesc& desc) {
+    m_Targets.push_back({name, desc, TargetKind::Imported, texture, -1, -1, 0, GL_NONE});
+    return {(uint32_t)m_Targets.size() - 1};
+}
+
+RenderTarget RenderGraph::ImportBackbuffer(GLuint framebuffer, GLsizei width, GLsizei height) {
+    m_Targets.push_back(
+        {"backbuffer", {width, height, GL_RGBA8}, TargetKind::Backbuffer, framebuffer, -1, -1, 0, GL_NONE});
+    return {(uint32_t)m_Targets.size() - 1};
+}
+
+void RenderGraph::AddPass(const std::string& name, const std::function<void(RenderPassBuilder&)>& setup,
+                          std::function<void(const RenderPassContext&)> execute) {
+    m_Passes.emplace_back();
+    m_Passes.back().Name = name;
+    m_Passes.back().Execute = std::move(execute);
+    RenderPassBuilder builder(*this, (uint32_t)m_Passes.size() - 1);
+    setup(builder);
+}
+
+void RenderGraph::Cull() {
+    // Backwards: a transient is needed if a later kept pass reads it before
+    // anything overwrites all of it.
+    std::vector<bool> needed(m_Targets.size(), false);
+    for (size_t p = m_Passes.size(); p-- > 0;) {
+        Pass& pass = m_Passes[p];
+        bool keep = pass.SideEffect;
+        for (const PassWrite& write : pass.Writes) {
+            keep = keep || m_Targets[write.Target].Kind != TargetKind::Transient || needed[write.Target];
+        }
+        pass.Culled = !keep;
+        if (!keep) {
+            continue;
+        }
+        for (const PassWrite& write : pass.Writes) {
+            if (write.Load != LoadOp::Load) {
+                needed[write.Target] = false;
+            }
+        }
+        for (uint32_t read : pass.Reads) {
+            needed[read] = true;
+        }
+    }
+
+    for (size_t p = 0; p < m_Passes.size(); p++) {
+        if (m_Passes[p].Culled) {
+            continue;
+        }
+        auto use = [&](uint32_t index) {
+            Target& target = m_Targets[index];
+            if (target.FirstUse < 0) {
+                target.FirstUse = (int)p;
+            }
+            target.LastUse = (int)p;
+        };
+        for (uint32_t read : m_Passes[p].Reads) {
+            use(read);
+        }
+        for (const PassWrite& write : m_Passes[p].Writes) {
+            use(write.Target);
+        }
+    }
+}
+
+void RenderGraph::AssignTextures() {
+    for (PhysicalTexture& texture : m_Textures) {
+        texture.BusyUntil = -1;
+    }
+
+    // In order of first use, every transient takes a texture of its size and
+    // format whose last user came before, or a new one.
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < m_Targets.size(); i++) {
+        if (m_Targets[i].Kind == TargetKind::Transient && m_Targets[i].FirstUse >= 0) {
+            order.push_back(i);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t a, uint32_t b) { return m_Targets[a].FirstUse < m_Targets[b].FirstUse; });
+
+    for (uint32_t index : order) {
+        Target& target = m_Targets[index];
+        int physical = -1;
+        for (size_t i = 0; i < m_Textures.size() && physical < 0; i++) {
+            if (m_Textures[i].BusyUntil < target.FirstUse && SameDesc(m_Textures[i].Desc, target.Desc)) {
+                physical = (int)i;
+            }
+        }
+        if (physical < 0) {
+            PhysicalTexture texture;
+            texture.Desc = target.Desc;
+            texture.Bytes = TargetBytes(target.Desc);
+            texture.Handle = m_Resources.CreateTexture(target.Name, GL_TEXTURE_2D, (GLsizeiptr)texture.Bytes,
+                                                       MemoryCategory::RenderTargets);
+            texture.Id = m_Resources.Get(texture.Handle);
+            GLCall(glTextureStorage2D(texture.Id, 1, target.Desc.Format, target.Desc.Width, target.Desc.Height));
+            GLenum filter = IsDepthFormat(target.Desc.Format) ? GL_NEAREST : GL_LINEAR;
+            GLCall(glTextureParameteri(texture.Id, GL_TEXTURE_MIN_FILTER, filter));
+            GLCall(glTextureParameteri(texture.Id, GL_TEXTURE_MAG_FILTER, filter));
+            GLCall(glTextureParameteri(texture.Id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+            GLCall(glTextureParameteri(texture.Id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+            m_Textures.push_back(texture);
+            m_Stats.TexturesCreated++;
+            physical = (int)m_Textures.size() - 1;
+        }
+        m_Textures[physical].BusyUntil = target.LastUse;
+        m_Textures[physical].LastFrame = m_Frame;
+        target.Texture = m_Textures[physical].Id;
+    }
+}
+
+GLuint RenderGraph::GetFramebuffer(const Pass& pass, std::vector<GLenum>& attachments) {
+    std::vector<GLuint> key;
+    for (const PassWrite& write : pass.Writes) {
+        const Target& target = m_Targets[write.Target];
+        if (target.Kind == TargetKind::Backbuffer) {
+            if (pass.Writes.size() > 1) {
+                std::cerr << "Render pass \"" << pass.Name << "\" can't attach anything next to the backbuffer"
+                          << std::endl;
+            }
+            attachments.assign(1, target.Texture == 0 ? GL_COLOR : GL_COLOR_ATTACHMENT0);
+            return target.Texture;
+        }
+        key.push_back(target.Texture);
+    }
+
+    GLenum color = GL_COLOR_ATTACHMENT0;
+    std::vector<GLenum> drawBuffers;
+    for (const PassWrite& write : pass.Writes) {
+        GLenum format = m_Targets[write.Target].Desc.Format;
+        if (!IsDepthFormat(format)) {
+            drawBuffers.push_back(color);
+            attachments.push_back(color++);
+        }
+        else {
+            attachments.push_back(HasStencil(format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT);
+        }
+    }
+
+    auto found = m_Framebuffers.find(key);
+    if (found != m_Framebuffers.end()) {
+        GLuint framebuffer = found->second;
+        // Imported textures may have been deleted and their ids reused, so
+        // they are attached again every time.
+        for (size_t i = 0; i < pass.Writes.size(); i++) {
+            const Target& target = m_Targets[pass.Writes[i].Target];
+            if (target.Kind == TargetKind::Imported) {
+                GLCall(glNamedFramebufferTexture(framebuffer, attachments[i], target.Texture, 0));
+            }
+        }
+        return framebuffer;
+    }
+
+    GLuint framebuffer;
+    GLCall(glCreateFramebuffers(1, &framebuffer));
+    for (size_t i = 0; i < pass.Writes.size(); i++) {
+        GLCall(glNamedFramebufferTexture(framebuffer, attachments[i], m_Targets[pass.Writes[i].Target].Texture, 0));
+    }
+    if (drawBuffers.empty()) {
+        GLCall(glNamedFramebufferDrawBuffer(framebuffer, GL_NONE));
+    }
+    else {
+        GLCall(glNamedFramebufferDrawBuffers(framebuffer, (GLsizei)drawBuffers.size(), drawBuffers.data()));
+    }
+    GLenum status = glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Render pass \"" << pass.Name << "\": framebuffer incomplete (" << status << ")" << std::endl;
+    }
+    m_Framebuffers[key] = framebuffer;
+    m_Stats.FramebuffersCreated++;
+    return framebuffer;
+}
+
+void RenderGraph::RunPass(uint32_t index) {
+    Pass& pass = m_Passes[index];
+    GLuint framebuffer = 0;
+    std::vector<GLenum> attachments;
+    if (!pass.Writes.empty()) {
+        framebuffer = GetFramebuffer(pass, attachments);
+        const RenderTargetDesc& desc = m_Targets[pass.Writes[0].Target].Desc;
+        GLCall(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+        GLCall(glViewport(0, 0, desc.Width, desc.Height));
+    }
+
+    // Clears one by one, invalidations in one call.
+    std::vector<GLenum> invalidate;
+    GLint colorIndex = 0;
+    for (size_t i = 0; i < pass.Writes.size() && i < attachments.size(); i++) {
+        const PassWrite& write = pass.Writes[i];
+        Target& target = m_Targets[write.Target];
+        bool depth = IsDepthFormat(target.Desc.Format);
+        LoadOp load = write.Load;
+        if (load == LoadOp::Load && target.Kind == TargetKind::Transient && target.FirstUse == (int)index) {
+            load = LoadOp::DontCare;
+        }
+
+        if (load == LoadOp::Clear) {
+            if (HasStencil(target.Desc.Format)) {
+                GLCall(glClearNamedFramebufferfi(framebuffer, GL_DEPTH_STENCIL, 0, 1.0f, 0));
+            }
+            else if (depth) {
+                const float one = 1.0f;
+                GLCall(glClearNamedFramebufferfv(framebuffer, GL_DEPTH, 0, &one));
+            }
+            else {
+                GLCall(glClearNamedFramebufferfv(framebuffer, GL_COLOR, colorIndex, write.ClearColor));
+            }
+            m_Stats.Clears++;
+        }
+        else if (load == LoadOp::DontCare) {
+            invalidate.push_back(attachments[i]);
+        }
+        if (!depth) {
+            colorIndex++;
+        }
+        target.Framebuffer = framebuffer;
+        target.Attachment = attachments[i];
+    }
+    if (!invalidate.empty()) {
+        GLCall(glInvalidateNamedFramebufferData(framebuffer, (GLsizei)invalidate.size(), invalidate.data()));
+        m_Stats.Invalidations += invalidate.size();
+    }
+
+    pass.Execute(RenderPassContext(*this, framebuffer));
+
+    // Transients this was the last pass of: whatever is in them now is never
+    // looked at again.
+    std::map<GLuint, std::vector<GLenum>> ended;
+    auto end = [&](uint32_t t) {
+        const Target& target = m_Targets[t];
+        if (target.Kind == TargetKind::Transient && target.LastUse == (int)index && target.Framebuffer != 0) {
+            std::vector<GLenum>& list = ended[target.Framebuffer];
+            if (std::find(list.begin(), list.end(), target.Attachment) == list.end()) {
+                list.push_back(target.Attachment);
+            }
+        }
+    };
+    for (uint32_t read : pass.Reads) {
+        end(read);
+    }
+    for (const PassWrite& write : pass.Writes) {
+        end(write.Target);
+    }
+    for (auto& list : ended) {
+        GLCall(glInvalidateNamedFramebufferData(list.first, (GLsizei)list.second.size(), list.second.data()));
+        m_Stats.Invalidations += list.second.size();
+    }
+}
+
+void RenderGraph::ReleaseUnused() {
+    for (size_t i = 0; i < m_Textures.size();) {
+        PhysicalTexture& texture = m_Textures[i];
+        if (texture.LastFrame + KEEP_FRAMES >= m_Frame) {
+            i++;
+            continue;
+        }
+        // Its id may be handed out again, so no framebuffer may keep it.
+        for (auto it = m_Framebuffers.begin(); it != m_Framebuffers.end();) {
+            if (std::find(it->first.begin(), it->first.end(), texture.Id) != it->first.end()) {
+                GLCall(glDeleteFramebuffers(1, &it->second));
+                it = m_Framebuffers.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+        m_Resources.Destroy(texture.Handle);
+        m_Textures[i] = m_Textures.back();
+        m_Textures.pop_back();
+    }
+}
+
+void RenderGraph::Execute() {
+    m_Stats.Passes = m_Passes.size();
+    m_Stats.CulledPasses = 0;
+    m_Stats.Transients = 0;
+    m_Stats.TransientBytes = 0;
+    m_Stats.AliasedBytes = 0;
+    m_Stats.Clears = 0;
+    m_Stats.Invalidations = 0;
+
+    Cull();
+    AssignTextures();
+
+    for (const Target& target : m_Targets) {
+        if (target.Kind == TargetKind::Transient && target.FirstUse >= 0) {
+            m_Stats.Transients++;
+            m_Stats.TransientBytes += TargetBytes(target.Desc);
+        }
+    }
+    for (const PhysicalTexture& texture : m_Textures) {
+        if (texture.LastFrame == m_Frame) {
+            m_Stats.AliasedBytes += texture.Bytes;
+        }
+    }
+    m_Stats.PeakTransientBytes = std::max(m_Stats.PeakTransientBytes, m_Stats.TransientBytes);
+    m_Stats.PeakAliasedBytes = std::max(m_Stats.PeakAliasedBytes, m_Stats.AliasedBytes);
+
+    for (uint32_t p = 0; p < m_Passes.size(); p++) {
+        if (m_Passes[p].Culled) {
+            m_Stats.CulledPasses++;
+        }
+        else {
+            RunPass(p);
+        }
+    }
+
+    for (const Target& target : m_Targets) {
+        if (target.Kind == TargetKind::Backbuffer) {
+            GLCall(glBindFramebuffer(GL_FRAMEBUFFER, target.Texture));
+            GLCall(glViewport(0, 0, target.Desc.Width, target.Desc.Height));
+        }
+    }
+
+    m_Frame++;
+    ReleaseUnused();
+}
+
+void RenderGraph::Print(std::ostream& out) const {
+    auto names = [&](const std::vector<uint32_t>& targets) {
+        std::string list;
+        for (uint32_t t : targets) {
+            list += (list.empty() ? "" : ", ") + m_Targets[t].Name;
+        }
+        return list.empty() ? std::string("-") : list;
+    };
+    for (const Pass& pass : m_Passes) {
+        std::vector<uint32_t> writes;
+        for (const PassWrite& write : pass.Writes) {
+            writes.push_back(write.Target);
+        }
+        out << "render_pass \"" << pass.Name << "\" " << (pass.Culled ? "culled" : "kept") << " reads "
+            << names(pass.Reads) << " writes " << names(writes) << "\n";
+    }
+    for (const Target& target : m_Targets) {
+        if (target.Kind != TargetKind::Transient) {
+            continue;
+        }
+        out << "render_target \"" << target.Name << "\" " << target.Desc.Width << "x" << target.Desc.Height
+            << " format 0x" << std::hex << target.Desc.Format << std::dec;
+        if (target.FirstUse >= 0) {
+            out << " passes " << target.FirstUse << "-" << target.LastUse << " texture " << target.Texture << "\n";
+        }
+        else {
+            out << " unused\n";
+        }
+    }
+}
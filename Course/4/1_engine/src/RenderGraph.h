@@ -0,0 +1,237 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ResourcePool.h"
+
+/*
+        THE RENDER GRAPH
+    So far every draw went straight to the window. Shadow maps, post
+    processing and the like all need render targets of their own, and doing
+    those by hand means an FBO per effect, a texture per FBO alive all the
+    time, and clears "just in case".
+
+    Instead, every frame the renderer DECLARES its passes: a name, which
+    textures the pass reads and writes, and a function that does the
+    drawing. Only after all of them are declared does the graph run them, in
+    the order they were added. Knowing the whole frame up front lets it:
+
+    - CULL passes nobody needs. Walking the passes backwards from what ends
+      up on screen (or in an imported texture), a pass survives only if
+      something later reads what it writes. A debug view nobody looks at
+      costs nothing.
+    - ALIAS the TRANSIENT textures, the ones that only live inside the frame.
+      A texture is needed from the first pass that touches it to the last
+      one; two textures whose lifetimes don't overlap can be the same
+      memory. OpenGL doesn't let us put two textures on the same memory, so
+      textures of the same size and format share one GL texture instead,
+      which is what it comes down to in most frames. The GL textures are kept
+      from frame to frame and only go once they were not needed for a while.
+    - INVALIDATE what nobody will look at again (glInvalidateFramebuffer):
+      a depth buffer after its last pass, a texture after its last reader,
+      and a texture before a pass that draws all of it anyway. On a tiled
+      GPU (phones) that saves writing the tile out to memory or reading it
+      back in; elsewhere it costs nothing. A pass only CLEARS when it asks
+      for it.
+
+    Textures written by a pass are attached to its framebuffer, depth
+    formats as the depth attachment, the rest as color attachments in the
+    order they were written. The FBOs are made by the graph and kept as long
+    as their textures.
+
+    A frame goes:
+        graph.Begin();
+        RenderTarget color = graph.Create("scene color", {w, h, GL_RGBA8});
+        graph.AddPass("scene", [&](RenderPassBuilder& pass) { pass.Write(color, LoadOp::Clear); },
+                      [&](const RenderPassContext& context) { ...draw... });
+        ...
+        graph.Execute();
+*/
+
+// Index of a texture in this frame's graph. Only valid until the next Begin().
+struct RenderTarget {
+    uint32_t Index = UINT32_MAX;
+
+    bool IsNull() const { return Index == UINT32_MAX; }
+};
+
+struct RenderTargetDesc {
+    GLsizei Width = 0;
+    GLsizei Height = 0;
+    // A sized internal format: GL_RGBA8, GL_RGBA16F, GL_DEPTH_COMPONENT24...
+    GLenum Format = GL_RGBA8;
+};
+
+// What happens to a written texture before the pass draws.
+enum class LoadOp : uint8_t {
+    // Keep what the earlier passes drew.
+    Load,
+    // Clear it (depth to 1, color to the pass's clear color).
+    Clear,
+    // The pass draws every pixel: the old content is invalidated.
+    DontCare
+};
+
+class RenderPassBuilder {
+public:
+    // Sampled (or read in any other way but as an attachment) by the pass.
+    void Read(RenderTarget target);
+    // Attached to the pass's framebuffer. For a transient texture written
+    // for the first time, Load means DontCare: there's nothing to keep.
+    void Write(RenderTarget target, LoadOp load = LoadOp::Load, const float* clearColor = nullptr);
+    // Never culled, even if nothing reads what it writes (timer queries,
+    // readbacks...).
+    void SideEffect();
+
+private:
+    friend class RenderGraph;
+    RenderPassBuilder(class RenderGraph& graph, uint32_t pass) : m_Graph(graph), m_Pass(pass) {}
+
+    RenderGraph& m_Graph;
+    uint32_t m_Pass;
+};
+
+class RenderPassContext {
+public:
+    // The GL texture behind a target; 0 for the backbuffer.
+    GLuint GetTexture(RenderTarget target) const;
+    const RenderTargetDesc& GetDesc(RenderTarget target) const;
+    // The pass's framebuffer, already bound, with the viewport set.
+    GLuint GetFramebuffer() const { return m_Framebuffer; }
+
+private:
+    friend class RenderGraph;
+    RenderPassContext(const RenderGraph& graph, GLuint framebuffer) : m_Graph(graph), m_Framebuffer(framebuffer) {}
+
+    const RenderGraph& m_Graph;
+    GLuint m_Framebuffer;
+};
+
+struct RenderGraphStats {
+    // Of the last frame.
+    size_t Passes = 0;
+    size_t CulledPasses = 0;
+    size_t Transients = 0;
+    // Transient bytes if every texture had its own memory, and what the
+    // shared GL textures take.
+    size_t TransientBytes = 0;
+    size_t AliasedBytes = 0;
+    size_t Clears = 0;
+    size_t Invalidations = 0;
+    // The largest of those two over all frames.
+    size_t PeakTransientBytes = 0;
+    size_t PeakAliasedBytes = 0;
+    // GL textures and framebuffers made over all frames.
+    size_t TexturesCreated = 0;
+    size_t FramebuffersCreated = 0;
+};
+
+class RenderGraph {
+public:
+    // The textures come out of (and go back to) the pool, booked as render
+    // targets in the GPU memory accounting.
+    explicit RenderGraph(ResourcePool& resources);
+    ~RenderGraph();
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    // Forgets the last frame's passes and targets.
+    void Begin();
+
+    // A texture that only lives in this frame.
+    RenderTarget Create(const std::string& name, const RenderTargetDesc& desc);
+    // A texture made elsewhere that lives on after the frame: never culled,
+    // aliased or invalidated, and a pass that writes it is always kept.
+    RenderTarget Import(const std::string& name, GLuint texture, const RenderTargetDesc& desc);
+    // The framebuffer the frame ends up in: 0 for the window. Only color,
+    // and nothing else can be attached next to it.
+    RenderTarget ImportBackbuffer(GLuint framebuffer, GLsizei width, GLsizei height);
+
+    // setup declares the reads and writes right away, execute runs in
+    // Execute() unless the pass is culled.
+    void AddPass(const std::string& name, const std::function<void(RenderPassBuilder&)>& setup,
+                 std::function<void(const RenderPassContext&)> execute);
+
+    // Culls, assigns the GL textures and runs the passes. Leaves the
+    // backbuffer bound.
+    void Execute();
+
+    const RenderGraphStats& GetStats() const { return m_Stats; }
+
+    // One line per pass of the last frame: kept or culled, what it read and
+    // wrote, and which GL texture each target got.
+    void Print(std::ostream& out) const;
+
+private:
+    friend class RenderPassBuilder;
+    friend class RenderPassContext;
+
+    enum class TargetKind : uint8_t { Transient, Imported, Backbuffer };
+
+    struct Target {
+        std::string Name;
+        RenderTargetDesc Desc;
+        TargetKind Kind;
+        // The GL texture (for transients, once assigned), or the framebuffer
+        // of the backbuffer.
+        GLuint Texture;
+        // Kept passes, -1 if none touches it.
+        int FirstUse;
+        int LastUse;
+        // The framebuffer it was last attached to, and where, for the
+        // invalidation after its last use.
+        GLuint Framebuffer;
+        GLenum Attachment;
+    };
+
+    struct PassWrite {
+        uint32_t Target;
+        LoadOp Load;
+        float ClearColor[4];
+    };
+
+    struct Pass {
+        std::string Name;
+        std::vector<uint32_t> Reads;
+        std::vector<PassWrite> Writes;
+        bool SideEffect = false;
+        bool Culled = false;
+        std::function<void(const RenderPassContext&)> Execute;
+    };
+
+    // A GL texture shared by the transients of one size and format.
+    struct PhysicalTexture {
+        RenderTargetDesc Desc;
+        TextureHandle Handle;
+        GLuint Id;
+        size_t Bytes;
+        // Which pass frees it in this frame (-1: free), and the last frame
+        // it was used in.
+        int BusyUntil;
+        uint64_t LastFrame;
+    };
+
+    void Cull();
+    void AssignTextures();
+    void RunPass(uint32_t index);
+    GLuint GetFramebuffer(const Pass& pass, std::vector<GLenum>& attachments);
+    void ReleaseUnused();
+
+    ResourcePool& m_Resources;
+    std::vector<Pass> m_Passes;
+    std::vector<Target> m_Targets;
+    std::vector<PhysicalTexture> m_Textures;
+    // Keyed by the attached textures, in attachment order.
+    std::map<std::vector<GLuint>, GLuint> m_Framebuffers;
+    uint64_t m_Frame = 0;
+    RenderGraphStats m_Stats;
+};
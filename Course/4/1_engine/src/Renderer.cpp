@@ -0,0 +1,24 @@
+#include "Renderer.h"
+#include "GLReport.h"
+
+#include <string>
+
+void ClearError() {
+    // At this point we don't care about error codes, we are just clearing it.
+    while (glGetError() != GL_NO_ERROR);
+}
+
+bool LogCall(const char* func, const char* file, int line) {
+    while(GLenum error = glGetError()) {
+        // Deduplicated and written by the reporter's thread (GLReport.h).
+        // A new error is never rate limited, and it is waited for: the
+        // ASSERT around us stops right after.
+        if (ReportGLMessage(GLMessageSource::Error, error, file, line,
+                            std::string("OpenGL error (") + GetGLErrorName(error) + "): In function " + func)) {
+            FlushGLReports();
+        }
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <signal.h>
+
+#ifdef GL_PROFILE
+#include "GLProfiler.h"
+#endif
+
+/*
+    The error handling from 3/1_error_handling, pulled out of main.cpp so every
+    file of the engine can wrap its OpenGL calls the same way. LogCall hands
+    the errors to GLReport.h, which writes each one once.
+*/
+
+#define ASSERT(x) if (!(x)) raise(SIGTRAP);
+
+#ifdef GL_PROFILE
+// Also counts and times the call itself (not the error checks around it) for
+// the profiler, see GLProfiler.h.
+#define GLCall(x) do {\
+    static const uint32_t glCallSite = RegisterGLCallSite(#x, __FILE__, __LINE__); \
+    ClearError(); \
+    { GLCallTimer glCallTimer(glCallSite); x; } \
+    ASSERT(LogCall(#x, __FILE__, __LINE__)) \
+    } while(0)
+#else
+#define GLCall(x) do {\
+    ClearError(); \
+    x; \
+    ASSERT(LogCall(#x, __FILE__, __LINE__)) \
+    } while(0)
+#endif
+
+void ClearError();
+
+bool LogCall(const char* func, const char* file, int line);
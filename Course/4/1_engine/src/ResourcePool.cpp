@@ -0,0 +1,226 @@
+#include "ResourcePool.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "Renderer.h"
+#include "Shader.h"
+
+static const char* KindName(ResourceKind kind) {
+    switch (kind) {
+        case ResourceKind::Buffer: return "buffer";
+        case ResourceKind::VertexArray: return "vertex array";
+        case ResourceKind::Program: return "program";
+        case ResourceKind::Texture: return "texture";
+        case ResourceKind::Count: break;
+    }
+    return "?";
+}
+
+// The identifier glObjectLabel wants for every kind.
+static GLenum LabelIdentifier(ResourceKind kind) {
+    switch (kind) {
+        case ResourceKind::Buffer: return GL_BUFFER;
+        case ResourceKind::VertexArray: return GL_VERTEX_ARRAY;
+        case ResourceKind::Program: return GL_PROGRAM;
+        case ResourceKind::Texture: return GL_TEXTURE;
+        case ResourceKind::Count: break;
+    }
+    return GL_NONE;
+}
+
+ResourcePool::~ResourcePool() {
+    if (m_Stats.Live[(int)ResourceKind::Buffer] + m_Stats.Live[(int)ResourceKind::VertexArray] +
+        m_Stats.Live[(int)ResourceKind::Program] + m_Stats.Live[(int)ResourceKind::Texture] > 0) {
+        std::cerr << "Leaked GL resources:" << std::endl;
+        PrintLive(std::cerr);
+    }
+
+    for (int kind = 0; kind < (int)ResourceKind::Count; kind++) {
+        for (size_t i = 0; i < m_Pools[kind].Slots.size(); i++) {
+            if (m_Pools[kind].Slots[i].Id != 0) {
+                m_Destroyed[kind].push_back(m_Pools[kind].Slots[i].Id);
+                ReleaseGpuMemory(m_Pools[kind].Infos[i].MemoryId);
+            }
+        }
+    }
+
+    // Nothing may be drawn any more, so there is no point in checking the
+    // fences one by one.
+    GLCall(glFinish());
+    for (PendingFrame& frame : m_Pending) {
+        GLCall(glDeleteSync(frame.Fence));
+        DeleteObjects(frame.Objects);
+    }
+    DeleteObjects(m_Destroyed);
+}
+
+BufferHandle ResourcePool::CreateBuffer(const std::string& name, GLsizeiptr size, const void* data,
+                                        GLbitfield flags, MemoryCategory category) {
+    GLuint buffer;
+    GLCall(glCreateBuffers(1, &buffer));
+    GLCall(glNamedBufferStorage(buffer, size, data, flags));
+    BufferHandle handle;
+    handle.Index = Allocate(ResourceKind::Buffer, buffer, name, size, flags, category);
+    handle.Generation = m_Pools[(int)ResourceKind::Buffer].Slots[handle.Index].Generation;
+    return handle;
+}
+
+VertexArrayHandle ResourcePool::CreateVertexArray(const std::string& name) {
+    GLuint vertexArray;
+    GLCall(glCreateVertexArrays(1, &vertexArray));
+    VertexArrayHandle handle;
+    handle.Index = Allocate(ResourceKind::VertexArray, vertexArray, name, 0, 0, MemoryCategory::Other);
+    handle.Generation = m_Pools[(int)ResourceKind::VertexArray].Slots[handle.Index].Generation;
+    return handle;
+}
+
+TextureHandle ResourcePool::CreateTexture(const std::string& name, GLenum target, GLsizeiptr size,
+                                          MemoryCategory category) {
+    GLuint texture;
+    GLCall(glCreateTextures(target, 1, &texture));
+    TextureHandle handle;
+    handle.Index = Allocate(ResourceKind::Texture, texture, name, size, target, category);
+    handle.Generation = m_Pools[(int)ResourceKind::Texture].Slots[handle.Index].Generation;
+    return handle;
+}
+
+ProgramHandle ResourcePool::AddProgram(const std::string& name, GLuint program) {
+    ProgramHandle handle;
+    if (program != 0) {
+        // Not for SPIR-V programs, see IsSpirvProgram.
+        GLint binarySize = 0;
+        if (!IsSpirvProgram(program)) {
+            GLCall(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize));
+        }
+        handle.Index = Allocate(ResourceKind::Program, program, name, binarySize, 0, MemoryCategory::Programs);
+        handle.Generation = m_Pools[(int)ResourceKind::Program].Slots[handle.Index].Generation;
+    }
+    return handle;
+}
+
+uint32_t ResourcePool::Allocate(ResourceKind kind, GLuint id, const std::string& name, GLsizeiptr size,
+                                GLenum usage, MemoryCategory category) {
+    Pool& pool = m_Pools[(int)kind];
+    uint32_t index;
+    if (!pool.FreeSlots.empty()) {
+        index = pool.FreeSlots.back();
+        pool.FreeSlots.pop_back();
+        pool.Slots[index].Id = id;
+    }
+    else {
+        index = (uint32_t)pool.Slots.size();
+        pool.Slots.push_back({id, 1});
+        pool.Infos.emplace_back();
+    }
+    pool.Infos[index] = {name, size, usage, category, 0};
+    m_Stats.Live[(int)kind]++;
+
+    // Shows up in debuggers (RenderDoc...) and in debug output messages.
+    GLCall(glObjectLabel(LabelIdentifier(kind), id, (GLsizei)name.size(), name.c_str()));
+
+    // Last: a budget callback may destroy other objects of this pool in
+    // there. Vertex arrays only hold state, there's nothing to book.
+    if (size > 0) {
+        uint32_t memory = TrackGpuMemory(category, name, (size_t)size);
+        pool.Infos[index].MemoryId = memory;
+    }
+    return index;
+}
+
+void ResourcePool::Release(ResourceKind kind, uint32_t index, uint32_t generation) {
+    Pool& pool = m_Pools[(int)kind];
+    if (generation == 0 || index >= pool.Slots.size() || pool.Slots[index].Generation != generation) {
+        return;
+    }
+
+    m_Destroyed[(int)kind].push_back(pool.Slots[index].Id);
+    ReleaseGpuMemory(pool.Infos[index].MemoryId);
+    m_Stats.Pending++;
+    m_Stats.Live[(int)kind]--;
+
+    // The slot can be handed out again right away, the old handles are
+    // already stale. 0 is skipped when the generation wraps around.
+    Slot& slot = pool.Slots[index];
+    slot.Id = 0;
+    slot.Generation = slot.Generation + 1 != 0 ? slot.Generation + 1 : 1;
+    pool.Infos[index] = {};
+    pool.FreeSlots.push_back(index);
+}
+
+void ResourcePool::EndFrame() {
+    // Fences signal in order, so we can stop at the first one that hasn't.
+    while (!m_Pending.empty()) {
+        GLenum status = glClientWaitSync(m_Pending.front().Fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        GLCall(glDeleteSync(m_Pending.front().Fence));
+        DeleteObjects(m_Pending.front().Objects);
+        m_Pending.pop_front();
+    }
+
+    bool destroyedAny = false;
+    for (const std::vector<GLuint>& objects : m_Destroyed) {
+        destroyedAny = destroyedAny || !objects.empty();
+    }
+    if (destroyedAny) {
+        PendingFrame frame;
+        GLCall(frame.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+        for (int kind = 0; kind < (int)ResourceKind::Count; kind++) {
+            frame.Objects[kind].swap(m_Destroyed[kind]);
+        }
+        m_Pending.push_back(std::move(frame));
+    }
+}
+
+void ResourcePool::DeleteObjects(std::vector<GLuint> (&objects)[(int)ResourceKind::Count]) {
+    for (int kind = 0; kind < (int)ResourceKind::Count; kind++) {
+        std::vector<GLuint>& ids = objects[kind];
+        if (ids.empty()) {
+            continue;
+        }
+
+        switch ((ResourceKind)kind) {
+            case ResourceKind::Buffer:
+                GLCall(glDeleteBuffers((GLsizei)ids.size(), ids.data()));
+                break;
+            case ResourceKind::VertexArray:
+                GLCall(glDeleteVertexArrays((GLsizei)ids.size(), ids.data()));
+                break;
+            case ResourceKind::Texture:
+                GLCall(glDeleteTextures((GLsizei)ids.size(), ids.data()));
+                break;
+            case ResourceKind::Program:
+                // The only one without a batched version.
+                for (GLuint id : ids) {
+                    GLCall(glDeleteProgram(id));
+                }
+                break;
+            case ResourceKind::Count:
+                break;
+        }
+
+        m_Stats.DeleteCalls++;
+        m_Stats.Deleted += ids.size();
+        m_Stats.Pending -= std::min(m_Stats.Pending, ids.size());
+        ids.clear();
+    }
+}
+
+void ResourcePool::PrintLive(std::ostream& out) const {
+    for (int kind = 0; kind < (int)ResourceKind::Count; kind++) {
+        const Pool& pool = m_Pools[kind];
+        for (size_t i = 0; i < pool.Slots.size(); i++) {
+            if (pool.Slots[i].Id == 0) {
+                continue;
+            }
+            out << "  " << KindName((ResourceKind)kind) << " " << pool.Slots[i].Id << " \"" << pool.Infos[i].Name
+                << "\"";
+            if (pool.Infos[i].Size > 0) {
+                out << ", " << pool.Infos[i].Size << " bytes";
+            }
+            out << "\n";
+        }
+    }
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "GpuMemory.h"
+
+/*
+        RESOURCE HANDLES
+    A GLuint says nothing about what it is or whether it's still alive. Delete
+    a buffer and the driver will happily hand the same number out again for
+    the next one, so an old copy of the id now points at something else.
+
+    The pool hands out HANDLES instead: an index into a table plus a
+    GENERATION. Every slot of the table counts up its generation when its
+    object is destroyed, so an old handle no longer matches and Get() returns
+    0 instead of somebody else's object. Looking a handle up is one array
+    access and one compare.
+
+    The table itself is split in two: what Get() needs (the GL id and the
+    generation, 8 bytes per slot) sits densely in one array, the rest (name,
+    size, usage) in another that only reports and debugging touch. Freed slots
+    are reused, so both stay as long as the most objects ever alive at once.
+
+    Destroy() doesn't call glDelete* right away. The object may still be used
+    by a frame the GPU hasn't drawn yet, and the driver would have to keep it
+    alive behind our back anyway. Instead it goes onto this frame's list;
+    EndFrame() puts a fence (glFenceSync) behind the frame, and once that
+    fence signals, the whole list is deleted with one glDelete* call per kind.
+
+    Whatever is still alive when the pool is destroyed is a leak: it is
+    listed with its name and size, and then deleted.
+
+    The bytes of every buffer, texture and program are also booked in the
+    GPU memory accounting (GpuMemory.h) under their name, from Create*()
+    until Destroy().
+*/
+
+enum class ResourceKind : uint8_t { Buffer, VertexArray, Program, Texture, Count };
+
+// One type per kind, so a buffer handle can't end up where a texture is
+// expected.
+template <ResourceKind Kind>
+struct ResourceHandle {
+    uint32_t Index = 0;
+    // Live generations start at 1, so a default handle is always null.
+    uint32_t Generation = 0;
+
+    bool IsNull() const { return Generation == 0; }
+};
+
+using BufferHandle = ResourceHandle<ResourceKind::Buffer>;
+using VertexArrayHandle = ResourceHandle<ResourceKind::VertexArray>;
+using ProgramHandle = ResourceHandle<ResourceKind::Program>;
+using TextureHandle = ResourceHandle<ResourceKind::Texture>;
+
+struct ResourceInfo {
+    std::string Name;
+    // Bytes, where known (buffers always, textures if the caller said so).
+    GLsizeiptr Size = 0;
+    // Buffers: the glNamedBufferStorage flags. Textures: the target.
+    GLenum Usage = 0;
+    MemoryCategory Category = MemoryCategory::Other;
+    // From TrackGpuMemory.
+    uint32_t MemoryId = 0;
+};
+
+struct ResourceStats {
+    size_t Live[(int)ResourceKind::Count] = {};
+    // Destroyed, but waiting for their frame's fence.
+    size_t Pending = 0;
+    // How many glDelete* calls those deletions took.
+    size_t DeleteCalls = 0;
+    size_t Deleted = 0;
+};
+
+class ResourcePool {
+public:
+    ResourcePool() = default;
+    // Waits for the GPU, deletes everything pending and reports (and
+    // deletes) what was never destroyed. Needs the context to still exist.
+    ~ResourcePool();
+
+    ResourcePool(const ResourcePool&) = delete;
+    ResourcePool& operator=(const ResourcePool&) = delete;
+
+    // An immutable buffer (glNamedBufferStorage); data may be nullptr.
+    BufferHandle CreateBuffer(const std::string& name, GLsizeiptr size, const void* data, GLbitfield flags,
+                              MemoryCategory category = MemoryCategory::ShaderData);
+    VertexArrayHandle CreateVertexArray(const std::string& name);
+    // Without storage; size is what the storage will take, for the books.
+    TextureHandle CreateTexture(const std::string& name, GLenum target, GLsizeiptr size = 0,
+                                MemoryCategory category = MemoryCategory::Textures);
+    // Takes over a program made elsewhere (LoadProgram...). 0 gives a null
+    // handle. Its binary size is booked as its memory (nothing for SPIR-V
+    // programs).
+    ProgramHandle AddProgram(const std::string& name, GLuint program);
+
+    // The GL id, or 0 if the handle is null or its object was destroyed.
+    template <ResourceKind Kind>
+    GLuint Get(ResourceHandle<Kind> handle) const {
+        const std::vector<Slot>& slots = m_Pools[(int)Kind].Slots;
+        if (handle.Index >= slots.size() || slots[handle.Index].Generation != handle.Generation) {
+            return 0;
+        }
+        return slots[handle.Index].Id;
+    }
+
+    // nullptr under the same conditions Get() returns 0.
+    template <ResourceKind Kind>
+    const ResourceInfo* GetInfo(ResourceHandle<Kind> handle) const {
+        return Get(handle) ? &m_Pools[(int)Kind].Infos[handle.Index] : nullptr;
+    }
+
+    // Queues the object for deletion and resets the handle. Destroying a
+    // null or stale handle does nothing.
+    template <ResourceKind Kind>
+    void Destroy(ResourceHandle<Kind>& handle) {
+        Release(Kind, handle.Index, handle.Generation);
+        handle = {};
+    }
+
+    // Once per frame, after the last draw: fences this frame's deletions and
+    // deletes those of earlier frames the GPU has finished. Never waits.
+    void EndFrame();
+
+    const ResourceStats& GetStats() const { return m_Stats; }
+
+    // One line per live object.
+    void PrintLive(std::ostream& out) const;
+
+private:
+    // The hot part: everything Get() reads.
+    struct Slot {
+        GLuint Id;
+        uint32_t Generation;
+    };
+
+    struct Pool {
+        std::vector<Slot> Slots;
+        std::vector<ResourceInfo> Infos;
+        std::vector<uint32_t> FreeSlots;
+    };
+
+    // The deletions of one frame, per kind.
+    struct PendingFrame {
+        GLsync Fence;
+        std::vector<GLuint> Objects[(int)ResourceKind::Count];
+    };
+
+    uint32_t Allocate(ResourceKind kind, GLuint id, const std::string& name, GLsizeiptr size, GLenum usage,
+                      MemoryCategory category);
+    void Release(ResourceKind kind, uint32_t index, uint32_t generation);
+    void DeleteObjects(std::vector<GLuint> (&objects)[(int)ResourceKind::Count]);
+
+    Pool m_Pools[(int)ResourceKind::Count];
+    std::vector<GLuint> m_Destroyed[(int)ResourceKind::Count];
+    std::deque<PendingFrame> m_Pending;
+    ResourceStats m_Stats;
+};
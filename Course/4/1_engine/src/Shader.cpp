@@ -0,0 +1,423 @@
+#include "Shader.h"
+#include "Assets.h"
+#include "GLReport.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+// Compiler and linker logs go through GLReport.h like the GL errors: a
+// shader that fails every frame is written out once. The log itself is the
+// message id, so two different failures at one site are two messages.
+static void ReportShaderLog(const char* file, int line, const std::string& what, const char* log) {
+    uint32_t id = (uint32_t)std::hash<std::string>()(log);
+    ReportGLMessage(GLMessageSource::Shader, id, file, line, what + "\n" + log);
+}
+
+GLuint CompileShader(GLenum type, const std::string& source) {
+    GLuint id = glCreateShader(type);
+    const char* src = source.c_str();
+
+    glShaderSource(id, 1, &src, nullptr);
+
+    glCompileShader(id);
+
+    int result;
+    glGetShaderiv(id, GL_COMPILE_STATUS, &result);
+    if(result == GL_FALSE) {
+        int length;
+        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
+        char* message = (char*)alloca(length * sizeof(char));
+
+        glGetShaderInfoLog(id, length, &length, message);
+        ReportShaderLog(__FILE__, __LINE__, std::string("Failed to compile ") +
+                        (type == GL_VERTEX_SHADER ? "vertex" : type == GL_COMPUTE_SHADER ? "compute" : "fragment") +
+                        " shader!", message);
+        glDeleteShader(id);
+        return 0;
+    }
+
+    return id;
+}
+
+// Reports the info log if the program didn't link.
+static bool CheckLinkStatus(GLuint program) {
+    int result;
+    glGetProgramiv(program, GL_LINK_STATUS, &result);
+    if (result == GL_FALSE) {
+        int length;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::string message(length > 0 ? length : 1, '\0');
+        glGetProgramInfoLog(program, (GLsizei)message.size(), nullptr, &message[0]);
+        ReportShaderLog(__FILE__, __LINE__, "Failed to link program!", message.c_str());
+        return false;
+    }
+    return true;
+}
+
+GLuint CreateShader(const std::string& vertexSource, const std::string& fragmentSource) {
+    GLuint program = glCreateProgram();
+
+    GLuint vs = CompileShader(GL_VERTEX_SHADER, vertexSource);
+    GLuint fs = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
+    glValidateProgram(program);
+
+    glDetachShader(program, vs);
+    glDetachShader(program, fs);
+
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    if (!CheckLinkStatus(program)) {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+GLuint CreateComputeShader(const std::string& computeSource) {
+    GLuint program = glCreateProgram();
+
+    GLuint cs = CompileShader(GL_COMPUTE_SHADER, computeSource);
+
+    glAttachShader(program, cs);
+    glLinkProgram(program);
+
+    glDetachShader(program, cs);
+    glDeleteShader(cs);
+
+    if (!CheckLinkStatus(program)) {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+static std::string s_ProgramCacheDirectory = "cache/programs";
+
+// What IsSpirvProgram answers. Programs deleted since may linger here, so
+// every new program drops its id. Programs are also made on the loader
+// thread (BackgroundLoader.h), hence the mutex.
+static std::unordered_set<GLuint> s_SpirvPrograms;
+static std::mutex s_SpirvProgramsMutex;
+
+static void SetSpirvProgram(GLuint program, bool spirv) {
+    std::lock_guard<std::mutex> lock(s_SpirvProgramsMutex);
+    if (spirv) {
+        s_SpirvPrograms.insert(program);
+    }
+    else {
+        s_SpirvPrograms.erase(program);
+    }
+}
+
+void SetProgramCacheDirectory(const std::string& directory) {
+    s_ProgramCacheDirectory = directory;
+}
+
+// A cache file: this header, the program binary, then the reflection.
+struct ProgramCacheHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint64_t Hash;
+    uint32_t BinaryFormat;
+    uint32_t BinarySize;
+    uint32_t ReflectionSize;
+    uint32_t Reserved;
+};
+
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+// A binary only works with the driver that made it, so the driver is part of the key.
+static uint64_t HashProgram(const ShaderProgramSource& source) {
+    uint64_t hash = HashShaderSource(source);
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        const char* value = (const char*)glGetString(name);
+        hash = HashText(hash, value ? value : "");
+    }
+    return hash;
+}
+
+static std::string CachePath(uint64_t hash) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)hash);
+    return s_ProgramCacheDirectory + name;
+}
+
+static GLuint LoadCachedProgram(uint64_t hash, ProgramReflection& reflection) {
+    std::ifstream file(CachePath(hash), std::ios::binary | std::ios::ate);
+    if (!file) {
+        return 0;
+    }
+    std::vector<unsigned char> data((size_t)file.tellg());
+    file.seekg(0);
+    file.read((char*)data.data(), data.size());
+
+    ProgramCacheHeader header;
+    if (!file || data.size() < sizeof(header)) {
+        return 0;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.Magic, "GLPC", 4) != 0 || header.Version != PROGRAM_CACHE_VERSION ||
+        header.Hash != hash || sizeof(header) + (size_t)header.BinarySize + header.ReflectionSize != data.size()) {
+        return 0;
+    }
+
+    const unsigned char* binary = data.data() + sizeof(header);
+    if (!DeserializeReflection(binary + header.BinarySize, header.ReflectionSize, reflection)) {
+        return 0;
+    }
+
+    // Fails (quietly) when the driver changed in a way it can't load.
+    GLuint program = glCreateProgram();
+    SetSpirvProgram(program, false);
+    glProgramBinary(program, header.BinaryFormat, binary, header.BinarySize);
+    int linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked == GL_FALSE) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+static void SaveCachedProgram(uint64_t hash, GLuint program, const ProgramReflection& reflection) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<unsigned char> binary(length);
+    GLenum format;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    std::vector<unsigned char> serialized;
+    SerializeReflection(reflection, serialized);
+
+    ProgramCacheHeader header = {{'G', 'L', 'P', 'C'}, PROGRAM_CACHE_VERSION, hash, format,
+                                 (uint32_t)length, (uint32_t)serialized.size(), 0};
+    std::error_code error;
+    std::filesystem::create_directories(s_ProgramCacheDirectory, error);
+    std::ofstream file(CachePath(hash), std::ios::binary);
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)binary.data(), length);
+    file.write((const char*)serialized.data(), serialized.size());
+}
+
+// Links the compiled shaders (0 means that one failed) and deletes them.
+// The binary can only be read back if we ask for it before linking, so this
+// is CreateShader spelled out.
+static GLuint LinkShaders(const std::vector<GLuint>& shaders, bool retrievable, const std::string& name) {
+    GLuint program = glCreateProgram();
+    SetSpirvProgram(program, false);
+    bool compiled = true;
+    for (GLuint shader : shaders) {
+        compiled = compiled && shader != 0;
+        if (shader) {
+            glAttachShader(program, shader);
+        }
+    }
+    if (retrievable) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    if (compiled) {
+        glLinkProgram(program);
+    }
+    for (GLuint shader : shaders) {
+        if (shader) {
+            glDetachShader(program, shader);
+            glDeleteShader(shader);
+        }
+    }
+
+    if (!compiled || !CheckLinkStatus(program)) {
+        ReportGLMessage(GLMessageSource::Shader, 0, name.c_str(), 0, "Failed to build " + name);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+GLuint BuildProgram(const ShaderProgramSource& source, const std::string& name, ProgramReflection& reflection,
+                    bool* fromCache) {
+    bool useCache = !s_ProgramCacheDirectory.empty();
+    uint64_t hash = useCache ? HashProgram(source) : 0;
+    if (fromCache) {
+        *fromCache = false;
+    }
+
+    if (useCache) {
+        if (GLuint program = LoadCachedProgram(hash, reflection)) {
+            reflection.Name = name;
+            if (fromCache) {
+                *fromCache = true;
+            }
+            return program;
+        }
+    }
+
+    std::vector<GLuint> shaders;
+    if (!source.ComputeSource.empty()) {
+        shaders.push_back(CompileShader(GL_COMPUTE_SHADER, source.ComputeSource));
+    }
+    else {
+        shaders.push_back(CompileShader(GL_VERTEX_SHADER, source.VertexSource));
+        shaders.push_back(CompileShader(GL_FRAGMENT_SHADER, source.FragmentSource));
+    }
+
+    GLuint program = LinkShaders(shaders, useCache, name);
+    if (!program) {
+        return 0;
+    }
+
+    reflection = ReflectProgram(program, name);
+    if (useCache) {
+        SaveCachedProgram(hash, program, reflection);
+    }
+    return program;
+}
+
+static bool s_SpirvEnabled = true;
+
+void SetSpirvEnabled(bool enabled) {
+    s_SpirvEnabled = enabled;
+}
+
+// "res/shaders/Basic.shader" -> "res/shaders/Basic.vert.spv", or with no
+// stage "res/shaders/Basic.spv.hash", the hash spirvc writes with them.
+static std::string SpirvPath(const std::string& filepath, const char* stage) {
+    size_t extension = filepath.rfind(".shader");
+    if (!stage) {
+        return filepath.substr(0, extension) + ".spv.hash";
+    }
+    return filepath.substr(0, extension) + "." + stage + ".spv";
+}
+
+// Whether spirvc made the modules out of the .shader file as it is now.
+static bool IsSpirvCurrent(const std::string& filepath) {
+    std::string text;
+    unsigned long long hash = 0;
+    if (!ReadAsset(SpirvPath(filepath, nullptr), text) || std::sscanf(text.c_str(), "%llx", &hash) != 1) {
+        return false;
+    }
+    return hash == HashShaderSource(ParseShaders(filepath));
+}
+
+bool LoadSpirvModules(const std::string& filepath, std::vector<SpirvModule>& modules) {
+    modules.clear();
+    SpirvModule module;
+    if (LoadSpirvModule(SpirvPath(filepath, "comp"), GL_COMPUTE_SHADER, module)) {
+        modules.push_back(std::move(module));
+    }
+    else {
+        for (GLenum stage : {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER}) {
+            if (!LoadSpirvModule(SpirvPath(filepath, stage == GL_VERTEX_SHADER ? "vert" : "frag"), stage, module)) {
+                modules.clear();
+                return false;
+            }
+            modules.push_back(std::move(module));
+        }
+    }
+    if (!IsSpirvCurrent(filepath)) {
+        std::cerr << "The SPIR-V of " << filepath << " is out of date (make spirv), using the GLSL" << std::endl;
+        modules.clear();
+        return false;
+    }
+    return true;
+}
+
+// The SPIR-V counterpart of CompileShader.
+static GLuint SpecializeShader(const SpirvModule& module, const std::vector<ShaderConstant>& constants) {
+    // The module must have every constant it is given, so each one only
+    // gets the ones it declares.
+    std::vector<GLuint> ids, values;
+    for (const ShaderConstant& constant : constants) {
+        if (HasSpecializationConstant(module, constant.Id)) {
+            ids.push_back(constant.Id);
+            values.push_back(constant.Value);
+        }
+    }
+
+    GLuint id = glCreateShader(module.Stage);
+    glShaderBinary(1, &id, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, module.Words.data(),
+                   (GLsizei)(module.Words.size() * sizeof(uint32_t)));
+    glSpecializeShaderARB(id, "main", (GLuint)ids.size(), ids.data(), values.data());
+
+    int result;
+    glGetShaderiv(id, GL_COMPILE_STATUS, &result);
+    if (result == GL_FALSE) {
+        int length;
+        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
+        std::string message(length > 0 ? length : 1, '\0');
+        glGetShaderInfoLog(id, (GLsizei)message.size(), nullptr, &message[0]);
+        ReportShaderLog(__FILE__, __LINE__, "Failed to specialize SPIR-V shader!", message.c_str());
+        glDeleteShader(id);
+        return 0;
+    }
+    return id;
+}
+
+GLuint BuildSpirvProgram(const std::vector<SpirvModule>& modules, const std::vector<ShaderConstant>& constants,
+                         const std::string& name, ProgramReflection& reflection) {
+    std::vector<GLuint> shaders;
+    for (const SpirvModule& module : modules) {
+        shaders.push_back(SpecializeShader(module, constants));
+    }
+    GLuint program = LinkShaders(shaders, false, name);
+    if (!program) {
+        return 0;
+    }
+
+    // The driver may have dropped the names, the modules still have them.
+    if (!ReflectSpirv(modules, name, reflection)) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    SetSpirvProgram(program, true);
+    return program;
+}
+
+bool IsSpirvProgram(GLuint program) {
+    std::lock_guard<std::mutex> lock(s_SpirvProgramsMutex);
+    return s_SpirvPrograms.count(program) != 0;
+}
+
+GLuint LoadProgram(const std::string& filepath, ProgramReflection& reflection,
+                   const std::vector<ShaderConstant>& constants) {
+    std::string name = filepath;
+    for (const ShaderConstant& constant : constants) {
+        name += " (" + constant.Name + " " + std::to_string(constant.Value) + ")";
+    }
+
+    std::vector<SpirvModule> modules;
+    if (s_SpirvEnabled && GLEW_ARB_gl_spirv && LoadSpirvModules(filepath, modules)) {
+        if (GLuint program = BuildSpirvProgram(modules, constants, name, reflection)) {
+            return program;
+        }
+        std::cerr << "Falling back to the GLSL of " << name << std::endl;
+    }
+
+    ShaderProgramSource source = ParseShaders(filepath);
+    for (const ShaderConstant& constant : constants) {
+        std::string define = constant.Name + " " + std::to_string(constant.Value) + "u";
+        for (std::string* part : {&source.VertexSource, &source.FragmentSource, &source.ComputeSource}) {
+            if (!part->empty()) {
+                *part = AddDefine(*part, define);
+            }
+        }
+    }
+    return BuildProgram(source, name, reflection);
+}
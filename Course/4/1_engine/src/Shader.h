@@ -0,0 +1,78 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+
+#include "ProgramReflection.h"
+#include "ShaderSource.h"
+#include "Spirv.h"
+
+// Returns 0 (and prints the info log) if the shader fails to compile.
+GLuint CompileShader(GLenum type, const std::string& source);
+
+// Both return 0 (and print the info log) if the program fails to link.
+GLuint CreateShader(const std::string& vertexSource, const std::string& fragmentSource);
+
+// A program with nothing but a compute shader, for glDispatchCompute.
+GLuint CreateComputeShader(const std::string& computeSource);
+
+/*
+    CreateShader (or CreateComputeShader, when there is a compute part) plus
+    reflection (ProgramReflection.h), through the PROGRAM CACHE: the linked
+    program is saved with glGetProgramBinary, together with its reflection,
+    in a file named after a hash of the sources and the driver. The next
+    start finds the file and skips compiling, linking and all the reflection
+    queries. A cache file the driver doesn't accept any more (new driver
+    version) is simply rebuilt.
+
+    name is for messages. fromCache (optional) says whether the cache was used.
+    Returns 0 if the program doesn't build.
+*/
+GLuint BuildProgram(const ShaderProgramSource& source, const std::string& name, ProgramReflection& reflection,
+                    bool* fromCache = nullptr);
+
+// A specialization constant, "layout (constant_id = Id) const uint Name" in
+// the shader. The GLSL has no such thing, so there it becomes
+// "#define Name Valueu" and the shader declares the constant only
+// #ifdef GL_SPIRV (which the SPIR-V compiler defines).
+struct ShaderConstant {
+    std::string Name;
+    GLuint Id;
+    GLuint Value;
+};
+
+/*
+    The SPIR-V modules of the file if there are any and the driver takes
+    them (BuildSpirvProgram), otherwise ParseShaders + BuildProgram with the
+    constants as #defines. A module that fails falls back to the GLSL too,
+    so the .spv files only ever make loading faster.
+*/
+GLuint LoadProgram(const std::string& filepath, ProgramReflection& reflection,
+                   const std::vector<ShaderConstant>& constants = {});
+
+// "make spirv" (tools/spirvc.cpp) compiles res/shaders/Basic.shader into
+// Basic.vert.spv and Basic.frag.spv next to it, a compute shader into
+// X.comp.spv, and Basic.spv.hash with HashShaderSource of the file. False
+// unless every stage is there and the hash is the one of the .shader file
+// now: a module made from an older version is never used.
+bool LoadSpirvModules(const std::string& filepath, std::vector<SpirvModule>& modules);
+
+// BuildProgram for SPIR-V: glShaderBinary + glSpecializeShader with the
+// constants, then linking and the reflection read from the modules
+// (Spirv.h). Needs GL_ARB_gl_spirv. The program cache isn't used, see
+// IsSpirvProgram; the compiler's front end is skipped anyway.
+GLuint BuildSpirvProgram(const std::vector<SpirvModule>& modules, const std::vector<ShaderConstant>& constants,
+                         const std::string& name, ProgramReflection& reflection);
+
+// Off: LoadProgram ignores the .spv files. On by default.
+void SetSpirvEnabled(bool enabled);
+
+// Whether the program came out of BuildSpirvProgram. Some drivers (Mesa 22)
+// crash when asked for the binary of a SPIR-V program with blocks, so
+// neither the program cache nor ResourcePool asks for one.
+bool IsSpirvProgram(GLuint program);
+
+// Where BuildProgram keeps its files, "cache/programs" by default. An empty
+// string turns the cache off.
+void SetProgramCacheDirectory(const std::string& directory);
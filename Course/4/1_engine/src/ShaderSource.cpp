@@ -0,0 +1,107 @@
+#include "ShaderSource.h"
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "Assets.h"
+#include "VertexPulling.h"
+
+ShaderProgramSource ParseShaders(const std::string& filepath) {
+    // The file may come from the packed archive or from disk, see Assets.h.
+    std::string text;
+    if (!ReadAsset(filepath, text)) {
+        std::cerr << "Can't read " << filepath << std::endl;
+    }
+
+    std::istringstream input(text);
+    std::string line;
+    std::stringstream ss[3];
+
+    enum class ShaderType {
+        NONE = -1,
+        VERTEX = 0,
+        FRAGMENT = 1,
+        COMPUTE = 2
+    };
+
+    ShaderType type = ShaderType::NONE;
+
+    // The #pull lines of the vertex shader, and where the code for them goes.
+    std::vector<PulledAttribute> pulled;
+    size_t pullPosition = 0;
+
+    // We iterate through every line in the file.  
+    while (getline(input, line)) {
+        // If we found a shader, we set the mode to the type of the shader we found.
+        if (line.find("#shader") != std::string::npos) {
+            if (line.find("vertex") != std::string::npos) {
+                type = ShaderType::VERTEX;
+            }
+            else if (line.find("fragment") != std::string::npos) {
+                type = ShaderType::FRAGMENT;
+            }
+            else if (line.find("compute") != std::string::npos) {
+                type = ShaderType::COMPUTE;
+            }
+            else {
+                std::cerr << "Unrecognised shader type.\n";
+            }
+        }
+        // Pulled attributes (see VertexPulling.h) are collected and replaced by
+        // generated code at the end.
+        else if (type == ShaderType::VERTEX && line.find("#pull") != std::string::npos) {
+            PulledAttribute attribute;
+            if (!ParsePullLine(line, attribute)) {
+                std::cerr << "Malformed " << line << " in " << filepath << "\n";
+                continue;
+            }
+            if (pulled.empty()) {
+                pullPosition = ss[0].str().size();
+            }
+            pulled.push_back(attribute);
+        }
+        // Otherwise, we just append the line to the appropriate shader string stream.
+        // Don't forget the \n here, otherwise shaders won't compile!
+        else if (type != ShaderType::NONE) {
+            ss[(int)type] << line << '\n'; 
+        }
+    }
+
+    std::string vertexSource = ss[0].str();
+    if (!pulled.empty()) {
+        vertexSource.insert(pullPosition, GeneratePullingCode(pulled));
+    }
+
+    return {vertexSource, ss[1].str(), ss[2].str()};
+}
+
+std::string AddDefine(const std::string& source, const std::string& name) {
+    // #version has to stay the first thing in the shader.
+    size_t position = 0;
+    size_t version = source.find("#version");
+    if (version != std::string::npos) {
+        size_t end = source.find('\n', version);
+        position = end == std::string::npos ? source.size() : end + 1;
+    }
+    std::string result = source;
+    result.insert(position, "#define " + name + "\n");
+    return result;
+}
+
+uint64_t HashText(uint64_t hash, const char* text) {
+    for (; *text; text++) {
+        hash = (hash ^ (unsigned char)*text) * 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t HashShaderSource(const ShaderProgramSource& source) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = HashText(hash, source.VertexSource.c_str());
+    hash = HashText(hash, "#shader fragment");
+    hash = HashText(hash, source.FragmentSource.c_str());
+    hash = HashText(hash, "#shader compute");
+    hash = HashText(hash, source.ComputeSource.c_str());
+    return hash;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*
+    The text side of Shader.h: splitting .shader files and adding #defines.
+    No OpenGL in here, so the offline tools (tools/spirvc.cpp) split .shader
+    files exactly like the engine does, without linking GL.
+*/
+
+// We will return this struct when parsing shaders.
+struct ShaderProgramSource {
+    std::string VertexSource;
+    std::string FragmentSource;
+    std::string ComputeSource;
+};
+
+// Splits a .shader file into its "#shader vertex", "#shader fragment" and
+// "#shader compute" parts.
+// "#pull" lines in the vertex part become vertex pulling code, see VertexPulling.h.
+ShaderProgramSource ParseShaders(const std::string& filepath);
+
+// FNV-1a, 64 bit. Give it the last hash to go on with another text.
+uint64_t HashText(uint64_t hash, const char* text);
+
+// The hash of the three parts, after ParseShaders. "make spirv" writes it
+// next to the .spv files, so the engine can tell when they were made from
+// an older version of the .shader file.
+uint64_t HashShaderSource(const ShaderProgramSource& source);
+
+// Adds "#define name" right after the #version line. That way one file can
+// hold several variants of a shader behind #ifdef.
+std::string AddDefine(const std::string& source, const std::string& name);
@@ -0,0 +1,470 @@
+#include "Simplify.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// How much a difference in texcoords/normals costs, compared to moving the
+// surface. Positions are scaled to a unit box first, so a normal that turns
+// by about 6 degrees costs as much as moving by 1% of the mesh size.
+static const double ATTRIBUTE_WEIGHT = 0.01;
+
+// Planes standing on open edges count this much more than the triangles.
+static const double BOUNDARY_WEIGHT = 10.0;
+
+// Symmetric 4x4 matrix of a weighted sum of planes ax + by + cz + d = 0.
+struct Quadric {
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+    double Weight;
+};
+
+static void AddPlane(Quadric& q, double a, double b, double c, double d, double weight) {
+    q.a2 += a * a * weight; q.ab += a * b * weight; q.ac += a * c * weight; q.ad += a * d * weight;
+    q.b2 += b * b * weight; q.bc += b * c * weight; q.bd += b * d * weight;
+    q.c2 += c * c * weight; q.cd += c * d * weight;
+    q.d2 += d * d * weight;
+    q.Weight += weight;
+}
+
+static void AddQuadric(Quadric& q, const Quadric& other) {
+    q.a2 += other.a2; q.ab += other.ab; q.ac += other.ac; q.ad += other.ad;
+    q.b2 += other.b2; q.bc += other.bc; q.bd += other.bd;
+    q.c2 += other.c2; q.cd += other.cd;
+    q.d2 += other.d2;
+    q.Weight += other.Weight;
+}
+
+// The average squared distance of p to the planes.
+static double QuadricError(const Quadric& q, const Vec3& p) {
+    double x = p.x, y = p.y, z = p.z;
+    double sum = q.a2 * x * x + 2 * q.ab * x * y + 2 * q.ac * x * z + 2 * q.ad * x +
+                 q.b2 * y * y + 2 * q.bc * y * z + 2 * q.bd * y +
+                 q.c2 * z * z + 2 * q.cd * z + q.d2;
+    return q.Weight > 0.0 ? std::max(0.0, sum / q.Weight) : 0.0;
+}
+
+enum class VertexKind : uint8_t {
+    Manifold,   // free to move onto any neighbor
+    Border,     // on an open edge, only moves along it
+    Locked      // seam, non-manifold edge or no position; never moves
+};
+
+// Everything about the input that doesn't change between passes.
+struct SimplifyInput {
+    uint32_t VertexCount;
+    std::vector<Vec3> Positions;        // scaled into a unit box
+    std::vector<float> Attributes;      // AttributeCount floats per vertex
+    uint32_t AttributeCount;
+    // The first vertex with the same position.
+    std::vector<uint32_t> Remap;
+    float Extent;
+};
+
+static void ReadInput(const unsigned char* vertices, uint32_t vertexCount, const MeshLayout& layout,
+                      SimplifyInput& input) {
+    input.VertexCount = vertexCount;
+    input.Positions.assign(vertexCount, {0.0f, 0.0f, 0.0f});
+    input.AttributeCount = 0;
+
+    // Every other float attribute (texcoords, normals) counts as an attribute.
+    std::vector<const VertexAttribute*> attributes;
+    const VertexAttribute* position = nullptr;
+    for (uint32_t i = 0; i < layout.AttributeCount; i++) {
+        const VertexAttribute& attribute = layout.Attributes[i];
+        if (attribute.Type != AttributeType::Float) {
+            continue;
+        }
+        if (attribute.Location == 0 && attribute.Components >= 3) {
+            position = &attribute;
+        }
+        else {
+            attributes.push_back(&attribute);
+            input.AttributeCount += attribute.Components;
+        }
+    }
+
+    input.Attributes.assign((size_t)vertexCount * input.AttributeCount, 0.0f);
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        const unsigned char* vertex = vertices + (size_t)v * layout.Stride;
+        if (position) {
+            std::memcpy(&input.Positions[v], vertex + position->Offset, sizeof(Vec3));
+        }
+        float* out = &input.Attributes[(size_t)v * input.AttributeCount];
+        for (const VertexAttribute* attribute : attributes) {
+            std::memcpy(out, vertex + attribute->Offset, attribute->Components * sizeof(float));
+            out += attribute->Components;
+        }
+    }
+
+    // Scale into a unit box, so the weights mean the same for every mesh.
+    Vec3 min = {FLT_MAX, FLT_MAX, FLT_MAX}, max = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (const Vec3& p : input.Positions) {
+        min = {std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z)};
+        max = {std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z)};
+    }
+    input.Extent = vertexCount ? std::max({max.x - min.x, max.y - min.y, max.z - min.z}) : 0.0f;
+    float scale = input.Extent > 0.0f ? 1.0f / input.Extent : 1.0f;
+    for (Vec3& p : input.Positions) {
+        p = (p - min) * scale;
+    }
+
+    // Vertices with the same position, found by sorting.
+    std::vector<uint32_t> order(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        order[v] = v;
+    }
+    auto less = [&](uint32_t a, uint32_t b) {
+        const Vec3& p = input.Positions[a];
+        const Vec3& q = input.Positions[b];
+        return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z != q.z ? p.z < q.z : a < b;
+    };
+    std::sort(order.begin(), order.end(), less);
+
+    input.Remap.resize(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; i++) {
+        uint32_t v = order[i];
+        const Vec3& p = input.Positions[v];
+        bool same = false;
+        if (i > 0) {
+            const Vec3& q = input.Positions[order[i - 1]];
+            same = p.x == q.x && p.y == q.y && p.z == q.z;
+        }
+        input.Remap[v] = same ? input.Remap[order[i - 1]] : v;
+    }
+}
+
+static Vec3 TriangleNormal(const Vec3& a, const Vec3& b, const Vec3& c) {
+    return Cross(b - a, c - a);
+}
+
+static uint64_t EdgeKey(uint32_t a, uint32_t b) {
+    return (uint64_t)a << 32 | b;
+}
+
+struct Collapse {
+    uint32_t From;
+    uint32_t To;
+    double Cost;
+    double Distance;
+    bool BorderEdge;
+};
+
+std::vector<uint32_t> SimplifyMesh(const unsigned char* vertices, uint32_t vertexCount, const MeshLayout& layout,
+                                   const uint32_t* indices, size_t indexCount, size_t targetIndexCount,
+                                   float maxError, float* error) {
+    SimplifyInput input;
+    ReadInput(vertices, vertexCount, layout, input);
+    const std::vector<Vec3>& positions = input.Positions;
+    const std::vector<uint32_t>& remap = input.Remap;
+
+    // Duplicated vertices (same position AND attributes) would look like a
+    // seam. Point every index at the first of them.
+    std::vector<uint32_t> canonical(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        canonical[v] = v;
+        uint32_t first = remap[v];
+        if (first != v &&
+            std::memcmp(&input.Attributes[(size_t)v * input.AttributeCount],
+                        &input.Attributes[(size_t)first * input.AttributeCount],
+                        input.AttributeCount * sizeof(float)) == 0) {
+            canonical[v] = first;
+        }
+    }
+    // How many different vertices the triangles use at every position, and
+    // (when that's one) which vertex it is.
+    std::vector<uint32_t> wedges(vertexCount, 0), wedgeVertex(vertexCount);
+    std::vector<bool> used(vertexCount, false);
+    std::vector<uint32_t> result(indexCount);
+    for (size_t i = 0; i < indexCount; i++) {
+        result[i] = canonical[indices[i]];
+        if (!used[result[i]]) {
+            used[result[i]] = true;
+            wedges[remap[result[i]]]++;
+            wedgeVertex[remap[result[i]]] = result[i];
+        }
+    }
+
+    // The error quadric of every position: the planes of its triangles,
+    // weighted by area, plus a plane standing on every open edge.
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+    {
+        std::unordered_map<uint64_t, uint32_t> edges;
+        for (size_t t = 0; t + 2 < result.size(); t += 3) {
+            for (int e = 0; e < 3; e++) {
+                edges[EdgeKey(remap[result[t + e]], remap[result[t + (e + 1) % 3]])]++;
+            }
+        }
+        for (size_t t = 0; t + 2 < result.size(); t += 3) {
+            const Vec3& p0 = positions[result[t]];
+            const Vec3& p1 = positions[result[t + 1]];
+            const Vec3& p2 = positions[result[t + 2]];
+            Vec3 normal = TriangleNormal(p0, p1, p2);
+            float area = std::sqrt(Dot(normal, normal)) * 0.5f;
+            if (area <= 0.0f) {
+                continue;
+            }
+            normal = Normalize(normal);
+            for (int c = 0; c < 3; c++) {
+                AddPlane(quadrics[remap[result[t + c]]], normal.x, normal.y, normal.z, -Dot(normal, p0), area);
+            }
+
+            for (int e = 0; e < 3; e++) {
+                uint32_t a = remap[result[t + e]], b = remap[result[t + (e + 1) % 3]];
+                if (edges.count(EdgeKey(b, a))) {
+                    continue;
+                }
+                const Vec3& pa = positions[a];
+                Vec3 edge = positions[b] - pa;
+                Vec3 side = Normalize(Cross(edge, normal));
+                double weight = Dot(edge, edge) * BOUNDARY_WEIGHT;
+                AddPlane(quadrics[a], side.x, side.y, side.z, -Dot(side, pa), weight);
+                AddPlane(quadrics[b], side.x, side.y, side.z, -Dot(side, pa), weight);
+            }
+        }
+    }
+
+    const double maxDistance = input.Extent > 0.0f ? maxError / input.Extent : maxError;
+    double worstDistance = 0.0;
+    targetIndexCount = targetIndexCount / 3 * 3;
+
+    /*
+        Collapsing happens in passes. Every pass finds the best collapse of
+        every edge, sorts them by cost and applies as many of the cheapest as
+        it can, as long as no two of them touch the same triangles. That's
+        much simpler than keeping a priority queue up to date, and gives
+        almost the same result.
+    */
+    std::vector<VertexKind> kinds(vertexCount);
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1), adjacency;
+    std::vector<uint32_t> collapseTo(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<Collapse> candidates;
+    std::vector<uint32_t> neighbors, otherNeighbors;
+
+    while (result.size() > targetIndexCount) {
+        // Which triangles use every position.
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index : result) {
+            adjacencyOffsets[remap[index] + 1]++;
+        }
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        adjacency.resize(result.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++) {
+                adjacency[fill[remap[result[i]]]++] = (uint32_t)(i / 3);
+            }
+        }
+
+        // Open and non-manifold edges, between positions.
+        std::unordered_map<uint64_t, uint32_t> edges;
+        edges.reserve(result.size());
+        for (size_t t = 0; t < result.size(); t += 3) {
+            for (int e = 0; e < 3; e++) {
+                edges[EdgeKey(remap[result[t + e]], remap[result[t + (e + 1) % 3]])]++;
+            }
+        }
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            kinds[v] = wedges[v] > 1 ? VertexKind::Locked : VertexKind::Manifold;
+        }
+        for (const auto& edge : edges) {
+            uint32_t a = (uint32_t)(edge.first >> 32), b = (uint32_t)edge.first;
+            if (edge.second > 1) {
+                kinds[a] = kinds[b] = VertexKind::Locked;
+            }
+            else if (!edges.count(EdgeKey(b, a))) {
+                for (uint32_t v : {a, b}) {
+                    if (kinds[v] != VertexKind::Locked) {
+                        kinds[v] = VertexKind::Border;
+                    }
+                }
+            }
+        }
+
+        auto isBorderEdge = [&](uint32_t a, uint32_t b) {
+            return !edges.count(EdgeKey(a, b)) || !edges.count(EdgeKey(b, a));
+        };
+
+        auto canCollapse = [&](uint32_t from, uint32_t to) {
+            if (kinds[from] == VertexKind::Locked || wedges[to] > 1) {
+                return false;
+            }
+            if (kinds[from] == VertexKind::Border) {
+                return kinds[to] != VertexKind::Manifold && isBorderEdge(from, to);
+            }
+            return true;
+        };
+
+        auto evaluate = [&](uint32_t from, uint32_t to, Collapse& collapse) {
+            Quadric q = quadrics[from];
+            AddQuadric(q, quadrics[to]);
+            collapse.From = from;
+            collapse.To = to;
+            collapse.Distance = QuadricError(q, positions[to]);
+            double attributeError = 0.0;
+            const float* a = &input.Attributes[(size_t)wedgeVertex[from] * input.AttributeCount];
+            const float* b = &input.Attributes[(size_t)wedgeVertex[to] * input.AttributeCount];
+            for (uint32_t i = 0; i < input.AttributeCount; i++) {
+                attributeError += (double)(a[i] - b[i]) * (a[i] - b[i]);
+            }
+            collapse.Cost = collapse.Distance + attributeError * ATTRIBUTE_WEIGHT;
+            collapse.BorderEdge = isBorderEdge(from, to);
+        };
+
+        // The cheaper direction of every edge. Inner edges show up in two
+        // triangles, take them once.
+        candidates.clear();
+        for (size_t t = 0; t < result.size(); t += 3) {
+            for (int e = 0; e < 3; e++) {
+                uint32_t a = remap[result[t + e]], b = remap[result[t + (e + 1) % 3]];
+                if (a > b && edges.count(EdgeKey(b, a))) {
+                    continue;
+                }
+                Collapse best, other;
+                bool forward = canCollapse(a, b), backward = canCollapse(b, a);
+                if (forward) {
+                    evaluate(a, b, best);
+                }
+                if (backward) {
+                    evaluate(b, a, other);
+                    if (!forward || other.Cost < best.Cost) {
+                        best = other;
+                    }
+                }
+                if (forward || backward) {
+                    candidates.push_back(best);
+                }
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; });
+
+        std::fill(collapseTo.begin(), collapseTo.end(), UINT32_MAX);
+        std::fill(touched.begin(), touched.end(), false);
+        size_t removedTriangles = 0, neededTriangles = (result.size() - targetIndexCount) / 3;
+        for (const Collapse& collapse : candidates) {
+            if (removedTriangles >= neededTriangles || collapse.Distance > maxDistance * maxDistance) {
+                break;
+            }
+            uint32_t from = collapse.From, to = collapse.To;
+            if (touched[from] || touched[to]) {
+                continue;
+            }
+
+            // Link condition: the two ends may only share the neighbors of the
+            // triangles on the edge, or the collapse pinches the surface.
+            auto gatherNeighbors = [&](uint32_t v, std::vector<uint32_t>& out) {
+                out.clear();
+                for (uint32_t i = adjacencyOffsets[v]; i < adjacencyOffsets[v + 1]; i++) {
+                    for (int c = 0; c < 3; c++) {
+                        uint32_t n = remap[result[adjacency[i] * 3 + c]];
+                        if (n != v) {
+                            out.push_back(n);
+                        }
+                    }
+                }
+                std::sort(out.begin(), out.end());
+                out.erase(std::unique(out.begin(), out.end()), out.end());
+            };
+            gatherNeighbors(from, neighbors);
+            gatherNeighbors(to, otherNeighbors);
+            size_t shared = 0;
+            for (uint32_t n : neighbors) {
+                shared += std::binary_search(otherNeighbors.begin(), otherNeighbors.end(), n);
+            }
+            if (shared != (collapse.BorderEdge ? 1u : 2u)) {
+                continue;
+            }
+
+            // No triangle around from may flip over (or get squashed flat).
+            bool flips = false;
+            for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1] && !flips; i++) {
+                const uint32_t* triangle = &result[adjacency[i] * 3];
+                Vec3 before[3], after[3];
+                bool hasTo = false;
+                for (int c = 0; c < 3; c++) {
+                    uint32_t v = remap[triangle[c]];
+                    hasTo = hasTo || v == to;
+                    before[c] = positions[v];
+                    after[c] = v == from ? positions[to] : positions[v];
+                }
+                if (hasTo) {
+                    continue;
+                }
+                Vec3 n0 = TriangleNormal(before[0], before[1], before[2]);
+                Vec3 n1 = TriangleNormal(after[0], after[1], after[2]);
+                flips = Dot(n0, n1) < 0.25f * std::sqrt(Dot(n0, n0) * Dot(n1, n1));
+            }
+            if (flips) {
+                continue;
+            }
+
+            collapseTo[from] = to;
+            AddQuadric(quadrics[to], quadrics[from]);
+            touched[from] = touched[to] = true;
+            for (uint32_t n : neighbors) {
+                touched[n] = true;
+            }
+            removedTriangles += collapse.BorderEdge ? 1 : 2;
+            worstDistance = std::max(worstDistance, collapse.Distance);
+        }
+
+        if (removedTriangles == 0) {
+            break;
+        }
+
+        // Move the collapsed vertices and drop the triangles that became lines.
+        size_t write = 0;
+        for (size_t t = 0; t < result.size(); t += 3) {
+            uint32_t triangle[3];
+            for (int c = 0; c < 3; c++) {
+                uint32_t v = result[t + c];
+                triangle[c] = collapseTo[remap[v]] != UINT32_MAX ? wedgeVertex[collapseTo[remap[v]]] : v;
+            }
+            if (remap[triangle[0]] == remap[triangle[1]] || remap[triangle[1]] == remap[triangle[2]] ||
+                remap[triangle[0]] == remap[triangle[2]]) {
+                continue;
+            }
+            std::memcpy(&result[write], triangle, sizeof(triangle));
+            write += 3;
+        }
+        result.resize(write);
+    }
+
+    if (error) {
+        *error = (float)std::sqrt(worstDistance) * input.Extent;
+    }
+    return result;
+}
+
+std::vector<MeshLod> BuildLodChain(const unsigned char* vertices, uint32_t vertexCount, const MeshLayout& layout,
+                                   std::vector<uint32_t>& indices, uint32_t maxLevels) {
+    // Below this, another level isn't worth a draw call's worth of bookkeeping.
+    const size_t minTriangles = 32;
+
+    std::vector<MeshLod> lods;
+    lods.push_back({0, (uint32_t)indices.size(), 0.0f, 0});
+
+    // Every level is made from the one before (faster, and the levels nest).
+    // Its error is relative to that level, so the errors add up; that's a bit
+    // pessimistic, which is the safe side.
+    std::vector<uint32_t> current(indices);
+    float error = 0.0f;
+    while (lods.size() < maxLevels && current.size() / 3 >= minTriangles * 2) {
+        float levelError = 0.0f;
+        std::vector<uint32_t> simplified = SimplifyMesh(vertices, vertexCount, layout, current.data(), current.size(),
+                                                        current.size() / 2, FLT_MAX, &levelError);
+        if (simplified.empty() || simplified.size() > current.size() * 9 / 10) {
+            break;
+        }
+        error += levelError;
+        lods.push_back({(uint32_t)indices.size(), (uint32_t)simplified.size(), error, 0});
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+        current.swap(simplified);
+    }
+    return lods;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshFile.h"
+
+/*
+        MESH SIMPLIFICATION
+    A mesh far away covers a few pixels, but we still send every one of its
+    triangles. So at import time we make simpler versions of it (levels of
+    detail) and at runtime we draw the simplest one that still looks the same.
+
+    Simplifying works by collapsing edges: vertex A moves onto its neighbor B,
+    and the two triangles that shared the edge disappear. Which edge goes
+    first is decided by quadric error metrics (Garland & Heckbert 1997):
+    every vertex keeps the sum of the planes of the triangles around it, and
+    the squared distance of a point to all of those planes tells how far the
+    surface would move. Cheapest collapses first.
+
+    - A only ever moves onto B, no vertex is moved or created. So all levels
+      use the SAME vertex buffer, and a level is just a different list of
+      indices.
+    - Attribute aware: the difference in texcoords and normals between A and
+      B is added to the cost, so collapses that would smear them wait longer.
+      Vertices on a texture seam (same position, different attributes) stay.
+    - Boundary preserving: vertices on an open edge of the mesh only slide
+      along that edge, and an extra plane standing on the edge keeps them
+      from cutting into the outline.
+*/
+
+// Returns the indices of the simplified mesh, at most targetIndexCount of them
+// if that is possible without going over maxError. The vertices are unchanged.
+// error (optional) gets the largest distance the surface moved, in mesh units.
+std::vector<uint32_t> SimplifyMesh(const unsigned char* vertices, uint32_t vertexCount, const MeshLayout& layout,
+                                   const uint32_t* indices, size_t indexCount, size_t targetIndexCount,
+                                   float maxError, float* error = nullptr);
+
+// Appends up to maxLevels - 1 simpler versions of the mesh in indices (which
+// holds level 0 on input), every one about half of the one before. Returns
+// where every level is in indices, level 0 first.
+std::vector<MeshLod> BuildLodChain(const unsigned char* vertices, uint32_t vertexCount, const MeshLayout& layout,
+                                   std::vector<uint32_t>& indices, uint32_t maxLevels = MeshFile::MaxLods);
@@ -0,0 +1,404 @@
+#include "Spirv.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <utility>
+
+#include "Assets.h"
+
+static const uint32_t SPIRV_MAGIC = 0x07230203;
+static const size_t SPIRV_HEADER_WORDS = 5;
+
+// The few numbers of the SPIR-V specification we need.
+enum Opcode : uint32_t {
+    OP_NAME = 5,
+    OP_MEMBER_NAME = 6,
+    OP_TYPE_BOOL = 20,
+    OP_TYPE_INT = 21,
+    OP_TYPE_FLOAT = 22,
+    OP_TYPE_VECTOR = 23,
+    OP_TYPE_MATRIX = 24,
+    OP_TYPE_IMAGE = 25,
+    OP_TYPE_SAMPLED_IMAGE = 27,
+    OP_TYPE_ARRAY = 28,
+    OP_TYPE_RUNTIME_ARRAY = 29,
+    OP_TYPE_STRUCT = 30,
+    OP_TYPE_POINTER = 32,
+    OP_CONSTANT = 43,
+    OP_VARIABLE = 59,
+    OP_DECORATE = 71,
+    OP_MEMBER_DECORATE = 72,
+};
+
+enum StorageClass : uint32_t {
+    STORAGE_UNIFORM_CONSTANT = 0,
+    STORAGE_INPUT = 1,
+    STORAGE_UNIFORM = 2,
+    STORAGE_STORAGE_BUFFER = 12,
+};
+
+enum Decoration : uint32_t {
+    DECORATION_SPEC_ID = 1,
+    DECORATION_BLOCK = 2,
+    DECORATION_BUFFER_BLOCK = 3,
+    DECORATION_ARRAY_STRIDE = 6,
+    DECORATION_MATRIX_STRIDE = 7,
+    DECORATION_BUILT_IN = 11,
+    DECORATION_LOCATION = 30,
+    DECORATION_BINDING = 33,
+    DECORATION_OFFSET = 35,
+};
+
+enum ImageDimension : uint32_t { DIM_1D = 0, DIM_2D = 1, DIM_3D = 2, DIM_CUBE = 3 };
+
+// What the decorations of one id (or one struct member) say. -1 if missing.
+struct SpirvDecorations {
+    GLint Location = -1;
+    GLint Binding = -1;
+    GLint Offset = -1;
+    GLint ArrayStride = -1;
+    GLint MatrixStride = -1;
+    bool Block = false;
+    bool BufferBlock = false;
+    bool BuiltIn = false;
+};
+
+struct SpirvVariable {
+    uint32_t Id;
+    uint32_t PointerType;
+    uint32_t Storage;
+};
+
+// Everything about one module that reflection needs, by id.
+struct SpirvInfo {
+    std::map<uint32_t, std::string> Names;
+    std::map<std::pair<uint32_t, uint32_t>, std::string> MemberNames;
+    std::map<uint32_t, SpirvDecorations> Decorations;
+    std::map<std::pair<uint32_t, uint32_t>, SpirvDecorations> MemberDecorations;
+    // The opcode followed by the operands after the result id.
+    std::map<uint32_t, std::vector<uint32_t>> Types;
+    std::map<uint32_t, uint32_t> Constants;
+    std::vector<SpirvVariable> Variables;
+};
+
+bool LoadSpirvModule(const std::string& filepath, GLenum stage, SpirvModule& module) {
+    std::vector<unsigned char> data;
+    if (!ReadAsset(filepath, data)) {
+        return false;
+    }
+    uint32_t magic = 0;
+    if (data.size() >= 4) {
+        std::memcpy(&magic, data.data(), 4);
+    }
+    if (data.size() % 4 != 0 || data.size() < SPIRV_HEADER_WORDS * 4 || magic != SPIRV_MAGIC) {
+        std::cerr << filepath << " is not a SPIR-V module" << std::endl;
+        return false;
+    }
+    module.Stage = stage;
+    module.Words.resize(data.size() / 4);
+    std::memcpy(module.Words.data(), data.data(), data.size());
+    return true;
+}
+
+bool HasSpecializationConstant(const SpirvModule& module, uint32_t id) {
+    const std::vector<uint32_t>& words = module.Words;
+    size_t position = SPIRV_HEADER_WORDS;
+    while (position < words.size()) {
+        uint32_t opcode = words[position] & 0xFFFF;
+        size_t count = words[position] >> 16;
+        if (count == 0 || position + count > words.size()) {
+            return false;
+        }
+        if (opcode == OP_DECORATE && count >= 4 && words[position + 2] == DECORATION_SPEC_ID &&
+            words[position + 3] == id) {
+            return true;
+        }
+        position += count;
+    }
+    return false;
+}
+
+// Literal strings are packed into words, 4 characters each, ending with a 0.
+static std::string ReadString(const uint32_t* words, size_t count) {
+    std::string text;
+    for (size_t i = 0; i < count; i++) {
+        for (int byte = 0; byte < 4; byte++) {
+            char c = (char)((words[i] >> (byte * 8)) & 0xFF);
+            if (c == '\0') {
+                return text;
+            }
+            text += c;
+        }
+    }
+    return text;
+}
+
+static void ApplyDecoration(SpirvDecorations& decorations, uint32_t decoration, uint32_t value) {
+    switch (decoration) {
+        case DECORATION_BLOCK: decorations.Block = true; break;
+        case DECORATION_BUFFER_BLOCK: decorations.BufferBlock = true; break;
+        case DECORATION_ARRAY_STRIDE: decorations.ArrayStride = (GLint)value; break;
+        case DECORATION_MATRIX_STRIDE: decorations.MatrixStride = (GLint)value; break;
+        case DECORATION_BUILT_IN: decorations.BuiltIn = true; break;
+        case DECORATION_LOCATION: decorations.Location = (GLint)value; break;
+        case DECORATION_BINDING: decorations.Binding = (GLint)value; break;
+        case DECORATION_OFFSET: decorations.Offset = (GLint)value; break;
+    }
+}
+
+static bool ParseModule(const SpirvModule& module, SpirvInfo& info) {
+    const std::vector<uint32_t>& words = module.Words;
+    size_t position = SPIRV_HEADER_WORDS;
+    while (position < words.size()) {
+        uint32_t opcode = words[position] & 0xFFFF;
+        size_t count = words[position] >> 16;
+        if (count == 0 || position + count > words.size()) {
+            return false;
+        }
+        const uint32_t* operands = &words[position + 1];
+        size_t operandCount = count - 1;
+        if (opcode == OP_NAME && operandCount >= 1) {
+            info.Names[operands[0]] = ReadString(operands + 1, operandCount - 1);
+        }
+        else if (opcode == OP_MEMBER_NAME && operandCount >= 2) {
+            info.MemberNames[{operands[0], operands[1]}] = ReadString(operands + 2, operandCount - 2);
+        }
+        else if (opcode == OP_DECORATE && operandCount >= 2) {
+            ApplyDecoration(info.Decorations[operands[0]], operands[1], operandCount > 2 ? operands[2] : 0);
+        }
+        else if (opcode == OP_MEMBER_DECORATE && operandCount >= 3) {
+            ApplyDecoration(info.MemberDecorations[{operands[0], operands[1]}], operands[2],
+                            operandCount > 3 ? operands[3] : 0);
+        }
+        else if (opcode >= OP_TYPE_BOOL && opcode <= OP_TYPE_POINTER && operandCount >= 1) {
+            std::vector<uint32_t>& type = info.Types[operands[0]];
+            type.assign(1, opcode);
+            type.insert(type.end(), operands + 1, operands + operandCount);
+        }
+        else if (opcode == OP_CONSTANT && operandCount >= 3) {
+            info.Constants[operands[1]] = operands[2];
+        }
+        else if (opcode == OP_VARIABLE && operandCount >= 3) {
+            info.Variables.push_back({operands[1], operands[0], operands[2]});
+        }
+        position += count;
+    }
+    return true;
+}
+
+static const std::vector<uint32_t>& GetType(const SpirvInfo& info, uint32_t id) {
+    static const std::vector<uint32_t> none = {0};
+    auto found = info.Types.find(id);
+    return found != info.Types.end() ? found->second : none;
+}
+
+static SpirvDecorations GetDecorations(const SpirvInfo& info, uint32_t id) {
+    auto found = info.Decorations.find(id);
+    return found != info.Decorations.end() ? found->second : SpirvDecorations();
+}
+
+static SpirvDecorations GetMemberDecorations(const SpirvInfo& info, uint32_t type, uint32_t member) {
+    auto found = info.MemberDecorations.find({type, member});
+    return found != info.MemberDecorations.end() ? found->second : SpirvDecorations();
+}
+
+// Strips one level of array. arraySize is 0 for a runtime array ("[]").
+static uint32_t ElementType(const SpirvInfo& info, uint32_t type, GLint& arraySize, GLint& arrayStride) {
+    const std::vector<uint32_t>& t = GetType(info, type);
+    arraySize = 1;
+    arrayStride = 0;
+    if ((t[0] != OP_TYPE_ARRAY && t[0] != OP_TYPE_RUNTIME_ARRAY) || t.size() < 2) {
+        return type;
+    }
+    if (t[0] == OP_TYPE_ARRAY && t.size() >= 3) {
+        auto length = info.Constants.find(t[2]);
+        arraySize = length != info.Constants.end() ? (GLint)length->second : 1;
+    }
+    else {
+        arraySize = 0;
+    }
+    arrayStride = std::max(GetDecorations(info, type).ArrayStride, 0);
+    return t[1];
+}
+
+static GLenum GLType(const SpirvInfo& info, uint32_t type) {
+    const std::vector<uint32_t>& t = GetType(info, type);
+    switch (t[0]) {
+        case OP_TYPE_BOOL: return GL_BOOL;
+        case OP_TYPE_INT: return t.size() >= 3 && t[2] ? GL_INT : GL_UNSIGNED_INT;
+        case OP_TYPE_FLOAT: return GL_FLOAT;
+        case OP_TYPE_VECTOR: {
+            static const GLenum vectors[4][3] = {{GL_FLOAT_VEC2, GL_FLOAT_VEC3, GL_FLOAT_VEC4},
+                                                 {GL_INT_VEC2, GL_INT_VEC3, GL_INT_VEC4},
+                                                 {GL_UNSIGNED_INT_VEC2, GL_UNSIGNED_INT_VEC3, GL_UNSIGNED_INT_VEC4},
+                                                 {GL_BOOL_VEC2, GL_BOOL_VEC3, GL_BOOL_VEC4}};
+            static const GLenum scalars[4] = {GL_FLOAT, GL_INT, GL_UNSIGNED_INT, GL_BOOL};
+            uint32_t n = t.size() >= 3 ? t[2] : 0;
+            GLenum scalar = GLType(info, t[1]);
+            for (int i = 0; i < 4; i++) {
+                if (scalars[i] == scalar && n >= 2 && n <= 4) {
+                    return vectors[i][n - 2];
+                }
+            }
+            return 0;
+        }
+        case OP_TYPE_MATRIX: {
+            // Columns of the column type, rows of its components.
+            static const GLenum matrices[3][3] = {{GL_FLOAT_MAT2, GL_FLOAT_MAT2x3, GL_FLOAT_MAT2x4},
+                                                  {GL_FLOAT_MAT3x2, GL_FLOAT_MAT3, GL_FLOAT_MAT3x4},
+                                                  {GL_FLOAT_MAT4x2, GL_FLOAT_MAT4x3, GL_FLOAT_MAT4}};
+            const std::vector<uint32_t>& column = GetType(info, t[1]);
+            uint32_t columns = t.size() >= 3 ? t[2] : 0;
+            uint32_t rows = column[0] == OP_TYPE_VECTOR && column.size() >= 3 ? column[2] : 0;
+            if (columns < 2 || columns > 4 || rows < 2 || rows > 4) {
+                return 0;
+            }
+            return matrices[columns - 2][rows - 2];
+        }
+        case OP_TYPE_SAMPLED_IMAGE: {
+            const std::vector<uint32_t>& image = GetType(info, t[1]);
+            if (image[0] != OP_TYPE_IMAGE || image.size() < 3) {
+                return 0;
+            }
+            switch (image[2]) {
+                case DIM_1D: return GL_SAMPLER_1D;
+                case DIM_2D: return GL_SAMPLER_2D;
+                case DIM_3D: return GL_SAMPLER_3D;
+                case DIM_CUBE: return GL_SAMPLER_CUBE;
+            }
+            return 0;
+        }
+    }
+    return 0;
+}
+
+// Bytes the type takes in a block. Runtime arrays count as 0.
+static GLint TypeSize(const SpirvInfo& info, uint32_t type, GLint matrixStride) {
+    const std::vector<uint32_t>& t = GetType(info, type);
+    switch (t[0]) {
+        case OP_TYPE_BOOL: return 4;
+        case OP_TYPE_INT:
+        case OP_TYPE_FLOAT: return t.size() >= 2 ? (GLint)t[1] / 8 : 4;
+        case OP_TYPE_VECTOR: return t.size() >= 3 ? (GLint)t[2] * TypeSize(info, t[1], -1) : 0;
+        case OP_TYPE_MATRIX: {
+            GLint columns = t.size() >= 3 ? (GLint)t[2] : 0;
+            return columns * (matrixStride > 0 ? matrixStride : TypeSize(info, t[1], -1));
+        }
+        case OP_TYPE_ARRAY: {
+            GLint size, stride;
+            uint32_t element = ElementType(info, type, size, stride);
+            return size * (stride > 0 ? stride : TypeSize(info, element, matrixStride));
+        }
+        case OP_TYPE_STRUCT: {
+            GLint end = 0;
+            for (uint32_t member = 0; member + 1 < t.size(); member++) {
+                SpirvDecorations decorations = GetMemberDecorations(info, type, member);
+                end = std::max(end, std::max(decorations.Offset, 0) +
+                                        TypeSize(info, t[member + 1], decorations.MatrixStride));
+            }
+            return end;
+        }
+    }
+    return 0;
+}
+
+static bool HasVariable(const std::vector<ShaderVariable>& variables, const std::string& name) {
+    return std::any_of(variables.begin(), variables.end(),
+                       [&](const ShaderVariable& variable) { return variable.Name == name; });
+}
+
+static bool HasBlock(const std::vector<ShaderBlock>& blocks, const std::string& name) {
+    return std::any_of(blocks.begin(), blocks.end(), [&](const ShaderBlock& block) { return block.Name == name; });
+}
+
+// A uniform or storage block: the block itself plus one variable per member.
+static void ReflectBlock(const SpirvInfo& info, const SpirvVariable& variable, uint32_t structType, bool storage,
+                         ProgramReflection& reflection) {
+    std::vector<ShaderBlock>& blocks = storage ? reflection.StorageBlocks : reflection.UniformBlocks;
+    std::vector<ShaderVariable>& members = storage ? reflection.BufferVariables : reflection.Uniforms;
+
+    auto name = info.Names.find(structType);
+    std::string blockName = name != info.Names.end() ? name->second : "";
+    if (HasBlock(blocks, blockName)) {
+        return;
+    }
+    GLint blockIndex = (GLint)blocks.size();
+    blocks.push_back({blockName, GetDecorations(info, variable.Id).Binding, TypeSize(info, structType, -1)});
+
+    // Members of a block with an instance name are "Block.member", like GL reports them.
+    auto instance = info.Names.find(variable.Id);
+    std::string prefix = instance != info.Names.end() && !instance->second.empty() ? blockName + "." : "";
+
+    const std::vector<uint32_t>& t = GetType(info, structType);
+    for (uint32_t member = 0; member + 1 < t.size(); member++) {
+        auto memberName = info.MemberNames.find({structType, member});
+        ShaderVariable entry;
+        GLint arraySize, arrayStride;
+        uint32_t element = ElementType(info, t[member + 1], arraySize, arrayStride);
+        bool array = element != t[member + 1];
+        entry.Name = prefix + (memberName != info.MemberNames.end() ? memberName->second : "") + (array ? "[0]" : "");
+        entry.Type = GLType(info, element);
+        entry.Location = -1;
+        entry.ArraySize = arraySize;
+        entry.BlockIndex = blockIndex;
+        entry.Offset = GetMemberDecorations(info, structType, member).Offset;
+        entry.ArrayStride = arrayStride;
+        members.push_back(entry);
+    }
+}
+
+static void ReflectModule(const SpirvInfo& info, bool firstStage, ProgramReflection& reflection) {
+    for (const SpirvVariable& variable : info.Variables) {
+        const std::vector<uint32_t>& pointer = GetType(info, variable.PointerType);
+        if (pointer[0] != OP_TYPE_POINTER || pointer.size() < 3) {
+            continue;
+        }
+        GLint arraySize, arrayStride;
+        uint32_t type = ElementType(info, pointer[2], arraySize, arrayStride);
+        bool array = type != pointer[2];
+        SpirvDecorations decorations = GetDecorations(info, variable.Id);
+        SpirvDecorations typeDecorations = GetDecorations(info, type);
+        auto found = info.Names.find(variable.Id);
+        std::string name = found != info.Names.end() ? found->second : "";
+
+        if (variable.Storage == STORAGE_INPUT) {
+            // Built-ins (gl_VertexID...) are left out, like ReflectProgram does.
+            if (!firstStage || decorations.BuiltIn || GetMemberDecorations(info, type, 0).BuiltIn ||
+                name.compare(0, 3, "gl_") == 0) {
+                continue;
+            }
+            reflection.Inputs.push_back({name, GLType(info, type), decorations.Location, arraySize, -1, -1, -1});
+        }
+        else if (variable.Storage == STORAGE_UNIFORM_CONSTANT) {
+            if (array) {
+                name += "[0]";
+            }
+            if (!HasVariable(reflection.Uniforms, name)) {
+                reflection.Uniforms.push_back({name, GLType(info, type), decorations.Location, arraySize, -1, -1, -1});
+            }
+        }
+        else if (variable.Storage == STORAGE_UNIFORM && typeDecorations.Block) {
+            ReflectBlock(info, variable, type, false, reflection);
+        }
+        else if ((variable.Storage == STORAGE_UNIFORM && typeDecorations.BufferBlock) ||
+                 (variable.Storage == STORAGE_STORAGE_BUFFER && typeDecorations.Block)) {
+            ReflectBlock(info, variable, type, true, reflection);
+        }
+    }
+}
+
+bool ReflectSpirv(const std::vector<SpirvModule>& modules, const std::string& name, ProgramReflection& reflection) {
+    reflection = ProgramReflection();
+    reflection.Name = name;
+    for (size_t i = 0; i < modules.size(); i++) {
+        SpirvInfo info;
+        if (!ParseModule(modules[i], info)) {
+            std::cerr << name << ": broken SPIR-V module" << std::endl;
+            return false;
+        }
+        ReflectModule(info, i == 0, reflection);
+    }
+    return true;
+}
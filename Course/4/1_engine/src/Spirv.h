@@ -0,0 +1,51 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ProgramReflection.h"
+
+/*
+        SPIR-V MODULES
+    GLSL text has to be preprocessed, parsed and type checked by the driver
+    every time a program is built. SPIR-V is the same shader after all of
+    that: a list of 32 bit words that an offline compiler (glslangValidator,
+    see tools/spirvc.cpp) made out of the GLSL. With GL_ARB_gl_spirv the
+    driver takes it with glShaderBinary, and glSpecializeShader then sets the
+    SPECIALIZATION CONSTANTS ("layout (constant_id = 0) const uint PASS") and
+    picks the entry point. A constant set there is a constant to the
+    optimizer, so the branches it decides are gone, just like with #define.
+
+    One catch: the driver doesn't have to keep any names. Mesa doesn't, so
+    glGetUniformLocation and the program interface queries of
+    ProgramReflection.h come back empty. The module itself still has them
+    (OpName, for the checks and for debuggers), next to the locations,
+    bindings and offsets the compiler decorated the variables with, so we
+    read the reflection out of the modules instead of asking the driver.
+
+    The reflection is the same table ReflectProgram fills, with two
+    differences: buffer variables are the members of the block (an array
+    member is "name[0]", with its stride), not every leaf of every struct,
+    and DataSize is the end of the last member, without the padding at the
+    end of a std140 block.
+*/
+
+struct SpirvModule {
+    // GL_VERTEX_SHADER, GL_FRAGMENT_SHADER or GL_COMPUTE_SHADER.
+    GLenum Stage;
+    std::vector<uint32_t> Words;
+};
+
+// Reads a .spv file (through ReadAsset) and checks the header. Quiet if the
+// file isn't there.
+bool LoadSpirvModule(const std::string& filepath, GLenum stage, SpirvModule& module);
+
+// Whether the module has a specialization constant with this constant_id.
+bool HasSpecializationConstant(const SpirvModule& module, uint32_t id);
+
+// The reflection of a program made of these modules. Inputs come from the
+// first stage; uniforms and blocks of all stages are merged by name.
+bool ReflectSpirv(const std::vector<SpirvModule>& modules, const std::string& name, ProgramReflection& reflection);
@@ -0,0 +1,220 @@
+#include "TextureContainer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+// The OpenGL enums KTX files use. We don't include GL here, so this file also
+// builds in tools and headless benchmarks.
+static const unsigned int KTX_COMPRESSED_RGB_S3TC_DXT1 = 0x83F0;
+static const unsigned int KTX_COMPRESSED_RGBA_S3TC_DXT1 = 0x83F1;
+static const unsigned int KTX_COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+static const unsigned int KTX_COMPRESSED_RGB8_ETC2 = 0x9274;
+
+static const unsigned int DDS_FLAGS = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+static const unsigned int DDS_CAPS = 0x1000 | 0x400000 | 0x8;
+static const unsigned int DDS_PIXELFORMAT_FOURCC = 0x4;
+static const unsigned int DXGI_FORMAT_BC1_UNORM = 71;
+static const unsigned int DXGI_FORMAT_BC1_UNORM_SRGB = 72;
+static const unsigned int DXGI_FORMAT_BC3_UNORM = 77;
+static const unsigned int DXGI_FORMAT_BC3_UNORM_SRGB = 78;
+
+static unsigned int ReadU32(const unsigned char* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int)data[3] << 24);
+}
+
+static unsigned int FourCC(const char* code) {
+    return ReadU32((const unsigned char*)code);
+}
+
+// A full mip chain ends at 1x1. A file may claim more levels than that,
+// but glTextureStorage2D would refuse them, so the rest is ignored.
+static int ClampLevelCount(int levelCount, int width, int height) {
+    int levels = 1;
+    while ((std::max(width, height) >> levels) > 0) {
+        levels++;
+    }
+    return std::min(levelCount, levels);
+}
+
+// Fills in the levels of a tightly packed mip chain that starts at data.
+static bool AddPackedLevels(TextureContainer& container, int levelCount, const unsigned char* data, size_t size) {
+    int width = container.Width;
+    int height = container.Height;
+    size_t offset = 0;
+
+    for (int i = 0; i < levelCount; i++) {
+        size_t levelSize = GetCompressedSize(container.Format, width, height);
+        if (offset + levelSize > size) {
+            return false;
+        }
+        container.Levels.push_back({width, height, data + offset, levelSize});
+        offset += levelSize;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+
+    return true;
+}
+
+static bool ParseDDS(const unsigned char* data, size_t size, TextureContainer& container) {
+    // "DDS " + a 124 byte header.
+    if (size < 128 || ReadU32(data + 4) != 124) {
+        return false;
+    }
+    const unsigned char* header = data + 4;
+
+    container.Height = (int)ReadU32(header + 8);
+    container.Width = (int)ReadU32(header + 12);
+    int levelCount = std::max(1, (int)ReadU32(header + 24));
+    unsigned int pixelFormatFlags = ReadU32(header + 76);
+    unsigned int fourCC = ReadU32(header + 80);
+    size_t dataOffset = 128;
+
+    if (!(pixelFormatFlags & DDS_PIXELFORMAT_FOURCC)) {
+        return false;
+    }
+
+    if (fourCC == FourCC("DXT1")) {
+        container.Format = BlockFormat::BC1;
+    }
+    else if (fourCC == FourCC("DXT5")) {
+        container.Format = BlockFormat::BC3;
+    }
+    else if (fourCC == FourCC("DX10") && size >= 148) {
+        // The DX10 extension header stores a DXGI format right after the normal header.
+        unsigned int dxgiFormat = ReadU32(data + 128);
+        dataOffset = 148;
+        if (dxgiFormat == DXGI_FORMAT_BC1_UNORM || dxgiFormat == DXGI_FORMAT_BC1_UNORM_SRGB) {
+            container.Format = BlockFormat::BC1;
+        }
+        else if (dxgiFormat == DXGI_FORMAT_BC3_UNORM || dxgiFormat == DXGI_FORMAT_BC3_UNORM_SRGB) {
+            container.Format = BlockFormat::BC3;
+        }
+        else {
+            return false;
+        }
+    }
+    else {
+        return false;
+    }
+
+    if (container.Width <= 0 || container.Height <= 0) {
+        return false;
+    }
+    levelCount = ClampLevelCount(levelCount, container.Width, container.Height);
+    return AddPackedLevels(container, levelCount, data + dataOffset, size - dataOffset);
+}
+
+static bool ParseKTX(const unsigned char* data, size_t size, TextureContainer& container) {
+    static const unsigned char identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+    // We only read little endian files, which is what every tool writes.
+    if (size < 64 || std::memcmp(data, identifier, 12) != 0 || ReadU32(data + 12) != 0x04030201) {
+        return false;
+    }
+
+    unsigned int glType = ReadU32(data + 16);
+    unsigned int glInternalFormat = ReadU32(data + 28);
+    container.Width = (int)ReadU32(data + 36);
+    container.Height = (int)ReadU32(data + 40);
+    unsigned int depth = ReadU32(data + 44);
+    unsigned int arrayElements = ReadU32(data + 48);
+    unsigned int faces = ReadU32(data + 52);
+    int levelCount = std::max(1, (int)ReadU32(data + 56));
+    unsigned int keyValueBytes = ReadU32(data + 60);
+
+    // Compressed 2D textures only: no cube maps, arrays or 3D textures.
+    if (glType != 0 || depth > 1 || arrayElements > 1 || faces != 1) {
+        return false;
+    }
+
+    switch (glInternalFormat) {
+        case KTX_COMPRESSED_RGB_S3TC_DXT1: container.Format = BlockFormat::BC1; break;
+        case KTX_COMPRESSED_RGBA_S3TC_DXT1: container.Format = BlockFormat::BC1_RGBA; break;
+        case KTX_COMPRESSED_RGBA_S3TC_DXT5: container.Format = BlockFormat::BC3; break;
+        case KTX_COMPRESSED_RGB8_ETC2: container.Format = BlockFormat::ETC2_RGB8; break;
+        default: return false;
+    }
+    if (container.Width <= 0 || container.Height <= 0) {
+        return false;
+    }
+    levelCount = ClampLevelCount(levelCount, container.Width, container.Height);
+
+    // Every level is prefixed with its size and padded to 4 bytes.
+    size_t offset = 64 + (size_t)keyValueBytes;
+    int width = container.Width;
+    int height = container.Height;
+    for (int i = 0; i < levelCount; i++) {
+        if (offset + 4 > size) {
+            return false;
+        }
+        size_t levelSize = ReadU32(data + offset);
+        offset += 4;
+        if (levelSize != GetCompressedSize(container.Format, width, height) || offset + levelSize > size) {
+            return false;
+        }
+        container.Levels.push_back({width, height, data + offset, levelSize});
+        offset += (levelSize + 3) & ~(size_t)3;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+
+    return true;
+}
+
+bool ParseTextureContainer(const unsigned char* data, size_t size, TextureContainer& container) {
+    container.Levels.clear();
+
+    if (size >= 4 && std::memcmp(data, "DDS ", 4) == 0) {
+        return ParseDDS(data, size, container);
+    }
+    return ParseKTX(data, size, container);
+}
+
+bool LoadTextureContainer(const std::string& filepath, TextureContainer& container) {
+    if (!container.File.Open(filepath)) {
+        return false;
+    }
+    return ParseTextureContainer(container.File.GetData(), container.File.GetSize(), container);
+}
+
+static void WriteU32(std::ofstream& output, unsigned int value) {
+    unsigned char bytes[4] = {(unsigned char)value, (unsigned char)(value >> 8),
+                              (unsigned char)(value >> 16), (unsigned char)(value >> 24)};
+    output.write((const char*)bytes, 4);
+}
+
+bool SaveDDS(const std::string& filepath, BlockFormat format, int width, int height,
+             const std::vector<std::vector<unsigned char>>& levels) {
+    if (format != BlockFormat::BC1 && format != BlockFormat::BC3) {
+        return false;
+    }
+
+    std::ofstream output(filepath, std::ios::binary);
+    output.write("DDS ", 4);
+    WriteU32(output, 124);
+    WriteU32(output, DDS_FLAGS);
+    WriteU32(output, (unsigned int)height);
+    WriteU32(output, (unsigned int)width);
+    WriteU32(output, levels.empty() ? 0 : (unsigned int)levels[0].size());
+    WriteU32(output, 0);                                // depth
+    WriteU32(output, (unsigned int)levels.size());
+    for (int i = 0; i < 11; i++) {
+        WriteU32(output, 0);                            // reserved
+    }
+    WriteU32(output, 32);                               // pixel format size
+    WriteU32(output, DDS_PIXELFORMAT_FOURCC);
+    WriteU32(output, FourCC(format == BlockFormat::BC1 ? "DXT1" : "DXT5"));
+    for (int i = 0; i < 5; i++) {
+        WriteU32(output, 0);                            // bit count and masks
+    }
+    WriteU32(output, DDS_CAPS);
+    for (int i = 0; i < 4; i++) {
+        WriteU32(output, 0);                            // caps 2-4, reserved
+    }
+
+    for (const std::vector<unsigned char>& level : levels) {
+        output.write((const char*)level.data(), level.size());
+    }
+    return (bool)output;
+}
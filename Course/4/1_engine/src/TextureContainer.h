@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "BlockCompression.h"
+#include "MappedFile.h"
+
+/*
+    Container files for block compressed textures with a prebuilt mip chain.
+    We understand two of them:
+    - DDS with a DXT1/DXT5 FourCC or a DX10 header (BC1, BC3)
+    - KTX 1.1, which stores the OpenGL internal format directly (BC1, BC3, ETC2 RGB8)
+
+    The file is memory mapped and the levels point straight into the mapping.
+    Nothing is copied: those pointers go to glCompressedTextureSubImage2D as they are.
+*/
+
+struct TextureLevel {
+    int Width;
+    int Height;
+    const unsigned char* Data;
+    size_t Size;
+};
+
+struct TextureContainer {
+    BlockFormat Format;
+    int Width;
+    int Height;
+    // Level 0 is the full size image, every next one is half the size.
+    std::vector<TextureLevel> Levels;
+    // Keeps the pages mapped for as long as Levels is used.
+    MappedFile File;
+};
+
+// Maps the file and parses its header. Returns false on unknown or broken files.
+bool LoadTextureContainer(const std::string& filepath, TextureContainer& container);
+
+// Same, for a file that is already in memory (the data must outlive the container).
+bool ParseTextureContainer(const unsigned char* data, size_t size, TextureContainer& container);
+
+// Writes a DDS file; levels[i] holds the blocks of mip level i.
+bool SaveDDS(const std::string& filepath, BlockFormat format, int width, int height,
+             const std::vector<std::vector<unsigned char>>& levels);
@@ -0,0 +1,273 @@
+#include "TextureUploader.h"
+
+#include <algorithm>
+
+#include "Assets.h"
+#include "GpuMemory.h"
+#include "Image.h"
+#include "Renderer.h"
+
+TextureUploader::TextureUploader(ThreadPool& pool, size_t stagingBytes, size_t bytesPerFrame)
+    : m_Pool(pool), m_BytesPerFrame(bytesPerFrame) {
+    if (!GLEW_ARB_buffer_storage || stagingBytes == 0) {
+        return;
+    }
+
+    // PERSISTENT: the buffer stays mapped while the GPU uses it.
+    // COHERENT: our writes become visible to the GPU without glFlushMappedBufferRange.
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLCall(glCreateBuffers(1, &m_StagingBuffer));
+    GLCall(glNamedBufferStorage(m_StagingBuffer, stagingBytes, nullptr, flags));
+    m_StagingMemory = (unsigned char*)glMapNamedBufferRange(m_StagingBuffer, 0, stagingBytes, flags);
+    if (!m_StagingMemory) {
+        GLCall(glDeleteBuffers(1, &m_StagingBuffer));
+        m_StagingBuffer = 0;
+        return;
+    }
+    m_StagingSize = stagingBytes;
+    m_StagingMemoryId = TrackGpuMemory(MemoryCategory::Staging, "texture staging", stagingBytes);
+}
+
+TextureUploader::~TextureUploader() {
+    // Jobs that are still queued will see m_Stopping and give up, but they
+    // hold a pointer to us, so we must wait until every one of them returned.
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+        m_StagingFreed.notify_all();
+        m_JobsDone.wait(lock, [this] { return m_RunningJobs == 0; });
+    }
+
+    for (const InFlightUpload& upload : m_InFlight) {
+        GLCall(glDeleteSync(upload.Fence));
+    }
+
+    if (m_StagingBuffer) {
+        GLCall(glUnmapNamedBuffer(m_StagingBuffer));
+        GLCall(glDeleteBuffers(1, &m_StagingBuffer));
+        ReleaseGpuMemory(m_StagingMemoryId);
+    }
+
+    for (size_t i = 0; i < m_Textures.size(); i++) {
+        if (m_Textures[i]) {
+            GLCall(glDeleteTextures(1, &m_Textures[i]));
+            ReleaseGpuMemory(m_TextureMemory[i]);
+        }
+    }
+}
+
+unsigned int TextureUploader::Load(const std::string& filepath) {
+    unsigned int id = (unsigned int)m_Textures.size();
+    m_Textures.push_back(0);
+    m_TextureMemory.push_back(0);
+
+    if (m_Outstanding == 0) {
+        m_FirstLoad = Clock::now();
+    }
+    m_Outstanding++;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_RunningJobs++;
+    }
+    m_Pool.Submit([this, id, filepath] { DecodeJob(id, filepath); });
+
+    return id;
+}
+
+bool TextureUploader::IsIdle() const {
+    return m_Outstanding == 0;
+}
+
+void TextureUploader::DecodeJob(unsigned int id, const std::string& filepath) {
+    ReadyImage image = {id, 0, 0, false, 0, 0, {}, filepath};
+
+    bool stopping;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        stopping = m_Stopping;
+    }
+
+    std::vector<unsigned char> file;
+    ImageInfo info;
+    if (!stopping && ReadAsset(filepath, file) && ReadImageInfo(file.data(), file.size(), info)) {
+        size_t size = (size_t)info.Width * info.Height * 4;
+
+        if (m_StagingMemory && AllocateStaging(size, image.Offset)) {
+            if (DecodeImage(file.data(), file.size(), m_StagingMemory + image.Offset)) {
+                image.InStaging = true;
+            }
+            else {
+                ReleaseStaging(image.Offset);
+            }
+        }
+        else {
+            image.Pixels.resize(size);
+            if (!DecodeImage(file.data(), file.size(), image.Pixels.data())) {
+                image.Pixels.clear();
+            }
+        }
+
+        if (image.InStaging || !image.Pixels.empty()) {
+            image.Width = info.Width;
+            image.Height = info.Height;
+            image.Size = size;
+        }
+    }
+
+    // A Width of 0 tells the render thread that this one failed.
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Ready.push_back(std::move(image));
+    m_RunningJobs--;
+    m_JobsDone.notify_all();
+}
+
+void TextureUploader::Update() {
+    Clock::time_point start = Clock::now();
+
+    // 1. Give back the staging memory of every upload the GPU has finished.
+    //    Fences signal in order, so we can stop at the first one that hasn't.
+    while (!m_InFlight.empty()) {
+        GLenum status = glClientWaitSync(m_InFlight.front().Fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        GLCall(glDeleteSync(m_InFlight.front().Fence));
+        ReleaseStaging(m_InFlight.front().Offset);
+        m_InFlight.pop_front();
+    }
+
+    // 2. Create textures from decoded images until the budget is used up. The
+    //    first image of the frame always goes, otherwise an image bigger than
+    //    the budget would never be uploaded.
+    size_t uploaded = 0;
+    bool finishedAny = false;
+    for (;;) {
+        ReadyImage image;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_Ready.empty() || (uploaded > 0 && uploaded + m_Ready.front().Size > m_BytesPerFrame)) {
+                break;
+            }
+            image = std::move(m_Ready.front());
+            m_Ready.pop_front();
+        }
+
+        m_Outstanding--;
+        finishedAny = true;
+        if (image.Width == 0) {
+            m_Stats.TexturesFailed++;
+            continue;
+        }
+
+        int levels = 1;
+        while ((std::max(image.Width, image.Height) >> levels) > 0) {
+            levels++;
+        }
+
+        GLuint texture;
+        GLCall(glCreateTextures(GL_TEXTURE_2D, 1, &texture));
+        GLCall(glTextureStorage2D(texture, levels, GL_RGBA8, image.Width, image.Height));
+        GLCall(glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+        GLCall(glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+
+        if (image.InStaging) {
+            // With a buffer bound to GL_PIXEL_UNPACK_BUFFER, the last argument is
+            // an offset into that buffer and not a pointer.
+            GLCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_StagingBuffer));
+            GLCall(glTextureSubImage2D(texture, 0, 0, 0, image.Width, image.Height, GL_RGBA, GL_UNSIGNED_BYTE,
+                                       (const void*)image.Offset));
+            GLCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+            m_InFlight.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), image.Offset});
+        }
+        else {
+            GLCall(glTextureSubImage2D(texture, 0, 0, 0, image.Width, image.Height, GL_RGBA, GL_UNSIGNED_BYTE,
+                                       image.Pixels.data()));
+        }
+        GLCall(glGenerateTextureMipmap(texture));
+
+        m_Textures[image.Id] = texture;
+        // The whole mip chain adds a third.
+        m_TextureMemory[image.Id] = TrackGpuMemory(MemoryCategory::Textures, image.Filepath, image.Size * 4 / 3);
+        m_Stats.TexturesLoaded++;
+        m_Stats.BytesUploaded += image.Size;
+        uploaded += image.Size;
+    }
+
+    Clock::time_point end = Clock::now();
+    if (finishedAny && m_Outstanding == 0) {
+        m_Stats.BusySeconds += Seconds(m_FirstLoad, end);
+    }
+    m_Stats.UpdateSeconds += Seconds(start, end);
+    m_Stats.WorstFrameSeconds = std::max(m_Stats.WorstFrameSeconds, Seconds(start, end));
+    m_Stats.Frames++;
+}
+
+void TextureUploader::PrintStats(std::ostream& out) const {
+    double megabytes = m_Stats.BytesUploaded / (1024.0 * 1024.0);
+    out << "textures: " << m_Stats.TexturesLoaded << " loaded, " << m_Stats.TexturesFailed << " failed, "
+        << megabytes << " MB\n"
+        << "upload throughput: " << (m_Stats.BusySeconds > 0.0 ? megabytes / m_Stats.BusySeconds : 0.0)
+        << " MB/s\n"
+        << "render thread cost: " << m_Stats.UpdateSeconds * 1000.0 << " ms over " << m_Stats.Frames
+        << " frames, worst frame " << m_Stats.WorstFrameSeconds * 1000.0 << " ms\n";
+}
+
+bool TextureUploader::AllocateStaging(size_t size, size_t& offset) {
+    if (size > m_StagingSize) {
+        return false;
+    }
+
+    // Wait for the render thread to retire older uploads if the ring is full.
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_StagingFreed.wait(lock, [&] { return m_Stopping || TryAllocateStaging(size, offset); });
+    return !m_Stopping;
+}
+
+bool TextureUploader::TryAllocateStaging(size_t size, size_t& offset) {
+    if (m_Spans.empty()) {
+        m_Head = m_Tail = 0;
+    }
+
+    // Free space is [tail, end) + [0, head) when the used part doesn't wrap,
+    // and [tail, head) when it does.
+    if (m_Spans.empty() || m_Tail > m_Head) {
+        if (m_StagingSize - m_Tail >= size) {
+            offset = m_Tail;
+        }
+        else if (m_Head >= size) {
+            offset = 0;
+        }
+        else {
+            return false;
+        }
+    }
+    else if (m_Tail < m_Head && m_Head - m_Tail >= size) {
+        offset = m_Tail;
+    }
+    else {
+        return false;
+    }
+
+    m_Tail = offset + size;
+    m_Spans.push_back({offset, size, false});
+    return true;
+}
+
+void TextureUploader::ReleaseStaging(size_t offset) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (StagingSpan& span : m_Spans) {
+            if (span.Offset == offset && !span.Released) {
+                span.Released = true;
+                break;
+            }
+        }
+        while (!m_Spans.empty() && m_Spans.front().Released) {
+            m_Spans.pop_front();
+        }
+        m_Head = m_Spans.empty() ? m_Tail : m_Spans.front().Offset;
+    }
+    m_StagingFreed.notify_all();
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "Timing.h"
+
+/*
+        ASYNCHRONOUS TEXTURE UPLOADS
+    The simple way to load a texture is: read the file, decode it, call
+    glTexImage2D. Done on the render thread, that freezes the frame for as long
+    as decoding takes, and glTexImage2D from client memory has to copy all of
+    the pixels before it returns.
+
+    Here the work is split up:
+    1. Load() only reserves a slot and queues a job on the thread pool.
+    2. A worker reads and decodes the file, writing the pixels straight into a
+       PIXEL UNPACK BUFFER (PBO) that is persistently mapped (glBufferStorage
+       with GL_MAP_PERSISTENT_BIT), so there is no extra copy.
+    3. Once per frame, Update() on the render thread creates the textures whose
+       pixels are ready, by calling glTextureSubImage2D with an OFFSET into the
+       bound PBO instead of a pointer. The driver copies from GPU visible memory
+       on its own time. We stop as soon as this frame's byte budget is used up.
+    4. Behind every upload goes a fence (glFenceSync). When the fence signals,
+       the GPU is done reading that part of the staging buffer and we can hand
+       it out again.
+
+    Images that don't fit into the staging buffer (or drivers without
+    ARB_buffer_storage) fall back to decoding into ordinary memory.
+*/
+
+struct TextureUploadStats {
+    size_t TexturesLoaded = 0;
+    size_t TexturesFailed = 0;
+    size_t BytesUploaded = 0;
+    // From the first Load() until the last texture finished uploading.
+    double BusySeconds = 0.0;
+    // Time spent inside Update(), i.e. what the render thread paid.
+    double UpdateSeconds = 0.0;
+    double WorstFrameSeconds = 0.0;
+    size_t Frames = 0;
+};
+
+class TextureUploader {
+public:
+    // stagingBytes is the size of the persistently mapped PBO, bytesPerFrame
+    // how much we are willing to upload in a single Update().
+    TextureUploader(ThreadPool& pool, size_t stagingBytes, size_t bytesPerFrame);
+    ~TextureUploader();
+
+    TextureUploader(const TextureUploader&) = delete;
+    TextureUploader& operator=(const TextureUploader&) = delete;
+
+    // Render thread. Returns an id for GetTexture(), never blocks.
+    unsigned int Load(const std::string& filepath);
+
+    // Render thread, once per frame.
+    void Update();
+
+    // 0 while the texture is still loading (or if loading failed).
+    GLuint GetTexture(unsigned int id) const { return m_Textures[id]; }
+
+    // True once every texture asked for so far is either uploaded or failed.
+    bool IsIdle() const;
+
+    const TextureUploadStats& GetStats() const { return m_Stats; }
+    void PrintStats(std::ostream& out) const;
+
+private:
+    // A decoded image waiting for the render thread.
+    struct ReadyImage {
+        unsigned int Id;
+        int Width;
+        int Height;
+        bool InStaging;
+        size_t Offset;
+        size_t Size;
+        std::vector<unsigned char> Pixels;  // only used when not in staging
+        std::string Filepath;
+    };
+
+    struct InFlightUpload {
+        GLsync Fence;
+        size_t Offset;
+    };
+
+    struct StagingSpan {
+        size_t Offset;
+        size_t Size;
+        bool Released;
+    };
+
+    void DecodeJob(unsigned int id, const std::string& filepath);
+
+    // Thread safe ring allocator over the staging buffer. Spans are handed out
+    // in ring order and given back in any order, but the space only becomes
+    // free again once everything older than it was given back too.
+    bool AllocateStaging(size_t size, size_t& offset);
+    bool TryAllocateStaging(size_t size, size_t& offset);
+    void ReleaseStaging(size_t offset);
+
+    ThreadPool& m_Pool;
+    size_t m_BytesPerFrame;
+
+    GLuint m_StagingBuffer = 0;
+    unsigned char* m_StagingMemory = nullptr;
+    size_t m_StagingSize = 0;
+    uint32_t m_StagingMemoryId = 0;
+
+    // Render thread only.
+    std::vector<GLuint> m_Textures;
+    // Ids from TrackGpuMemory, one per texture.
+    std::vector<uint32_t> m_TextureMemory;
+    std::deque<InFlightUpload> m_InFlight;
+    TextureUploadStats m_Stats;
+    Clock::time_point m_FirstLoad;
+    size_t m_Outstanding = 0;
+
+    // Shared between the workers and the render thread.
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_StagingFreed;
+    std::condition_variable m_JobsDone;
+    std::deque<ReadyImage> m_Ready;
+    std::deque<StagingSpan> m_Spans;
+    size_t m_Head = 0;
+    size_t m_Tail = 0;
+    size_t m_RunningJobs = 0;
+    bool m_Stopping = false;
+};
@@ -0,0 +1,48 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    if (threadCount == 0) {
+        unsigned int cores = std::thread::hardware_concurrency();
+        threadCount = cores > 1 ? cores - 1 : 1;
+    }
+
+    for (unsigned int i = 0; i < threadCount; i++) {
+        m_Threads.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_Condition.notify_all();
+
+    for (std::thread& thread : m_Threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Tasks.push_back(std::move(task));
+    }
+    m_Condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Condition.wait(lock, [this] { return m_Stopping || !m_Tasks.empty(); });
+            if (m_Tasks.empty()) {
+                return;
+            }
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop_front();
+        }
+        task();
+    }
+}
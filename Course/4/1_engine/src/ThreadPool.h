@@ -0,0 +1,36 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    A fixed number of worker threads that take tasks from one shared queue.
+    Tasks must NOT touch OpenGL: the context belongs to the main thread.
+*/
+class ThreadPool {
+public:
+    // 0 means one thread per core, minus the main thread.
+    explicit ThreadPool(unsigned int threadCount = 0);
+    // Finishes the tasks that are already queued, then joins the threads.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> task);
+
+    unsigned int GetThreadCount() const { return (unsigned int)m_Threads.size(); }
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> m_Threads;
+    std::deque<std::function<void()>> m_Tasks;
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    bool m_Stopping = false;
+};
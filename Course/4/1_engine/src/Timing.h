@@ -0,0 +1,27 @@
+#pragma once
+
+#include <chrono>
+
+/*
+    Wall clock time for the stats and the benchmarks. steady_clock never
+    jumps (system_clock may, when somebody sets the time), so the difference
+    of two of its time points is always a duration.
+*/
+using Clock = std::chrono::steady_clock;
+
+// From start to end, by default to now.
+inline double Seconds(Clock::time_point start, Clock::time_point end = Clock::now()) {
+    return std::chrono::duration<double>(end - start).count();
+}
+
+inline double Milliseconds(Clock::time_point start, Clock::time_point end = Clock::now()) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+inline double Microseconds(Clock::time_point start, Clock::time_point end = Clock::now()) {
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+inline double Nanoseconds(Clock::time_point start, Clock::time_point end = Clock::now()) {
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
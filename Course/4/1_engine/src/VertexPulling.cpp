@@ -0,0 +1,116 @@
+#include "VertexPulling.h"
+
+#include <cstdio>
+#include <sstream>
+
+PullFormat MakePullFormat(const MeshLayout& layout) {
+    PullFormat format = {};
+    format.Stride = layout.Stride;
+    for (uint32_t i = 0; i < layout.AttributeCount; i++) {
+        const VertexAttribute& attribute = layout.Attributes[i];
+        if (attribute.Location < PULL_MAX_LOCATIONS) {
+            uint32_t* entry = format.Attributes[attribute.Location];
+            entry[0] = attribute.Offset;
+            entry[1] = (uint32_t)attribute.Type;
+            entry[2] = attribute.Normalized;
+            entry[3] = attribute.Components;
+        }
+    }
+    return format;
+}
+
+bool ParsePullLine(const std::string& line, PulledAttribute& attribute) {
+    unsigned int location;
+    char type[16], name[64];
+    if (std::sscanf(line.c_str(), " #pull ( location = %u ) %15s %63[A-Za-z0-9_]", &location, type, name) != 3 ||
+        location >= PULL_MAX_LOCATIONS) {
+        return false;
+    }
+
+    std::string typeName = type;
+    if (typeName == "float") {
+        attribute.Components = 1;
+    }
+    else if (typeName == "vec2" || typeName == "vec3" || typeName == "vec4") {
+        attribute.Components = typeName[3] - '0';
+    }
+    else {
+        return false;
+    }
+    attribute.Location = location;
+    attribute.Name = name;
+    return true;
+}
+
+// The values of AttributeType are spelled out in the shader, keep them in sync.
+static_assert((int)AttributeType::Float == 0 && (int)AttributeType::UnsignedByte == 1 &&
+              (int)AttributeType::Short == 2 && (int)AttributeType::HalfFloat == 3,
+              "pull_Component depends on the values of AttributeType");
+
+static const char* PULLING_FUNCTIONS = R"(
+// One component of an attribute. Everything is read as 32 bit words, the
+// smaller types are cut out of them.
+float pull_Component(uint byteOffset, uint type, bool normalized) {
+    uint word = pull_Vertices[byteOffset >> 2];
+    uint shift = (byteOffset & 3u) * 8u;
+    if (type == 1u) {
+        float value = float((word >> shift) & 0xFFu);
+        return normalized ? value / 255.0 : value;
+    }
+    if (type == 2u) {
+        float value = float(int(word << (16u - shift)) >> 16);
+        return normalized ? max(value / 32767.0, -1.0) : value;
+    }
+    if (type == 3u) {
+        return unpackHalf2x16(word >> shift).x;
+    }
+    return uintBitsToFloat(word);
+}
+
+vec4 pull_Attribute(uint vertex, uint location) {
+    uvec4 format = pull_Attributes[location];
+    uint size = format.y == 0u ? 4u : (format.y == 1u ? 1u : 2u);
+    uint base = vertex * pull_Stride + format.x;
+    vec4 value = vec4(0.0, 0.0, 0.0, 1.0);
+    if (format.y == 0u) {
+        // Floats (the usual case) are whole words.
+        for (uint i = 0u; i < format.w; i++) {
+            value[i] = uintBitsToFloat(pull_Vertices[(base >> 2) + i]);
+        }
+        return value;
+    }
+    for (uint i = 0u; i < format.w; i++) {
+        value[i] = pull_Component(base + i * size, format.y, format.z != 0u);
+    }
+    return value;
+}
+)";
+
+std::string GeneratePullingCode(const std::vector<PulledAttribute>& attributes) {
+    static const char* types[] = {"", "float", "vec2", "vec3", "vec4"};
+    static const char* swizzles[] = {"", ".x", ".xy", ".xyz", ""};
+
+    std::ostringstream code;
+    code << "// Generated from the #pull lines, see VertexPulling.h.\n"
+         << "layout (std430, binding = " << PULL_VERTEX_BINDING << ") readonly buffer PulledVertices {\n"
+         << "    uint pull_Vertices[];\n"
+         << "};\n"
+         << "layout (std140, binding = " << PULL_FORMAT_BINDING << ") uniform PulledFormat {\n"
+         << "    uint pull_Stride;\n"
+         << "    uvec4 pull_Attributes[" << PULL_MAX_LOCATIONS << "];\n"
+         << "};\n\n";
+
+    for (const PulledAttribute& attribute : attributes) {
+        code << types[attribute.Components] << " " << attribute.Name << ";\n";
+    }
+
+    code << PULLING_FUNCTIONS << "\n"
+         << "void PullVertex() {\n"
+         << "    uint vertex = uint(gl_VertexID);\n";
+    for (const PulledAttribute& attribute : attributes) {
+        code << "    " << attribute.Name << " = pull_Attribute(vertex, " << attribute.Location << "u)"
+             << swizzles[attribute.Components] << ";\n";
+    }
+    code << "}\n";
+    return code.str();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MeshFile.h"
+
+/*
+        PROGRAMMABLE VERTEX PULLING
+    With glVertexAttribPointer (or a vertex array) the format of the vertices
+    is C++ state: every new format means new setup code, and two meshes with
+    different formats can never be drawn by the same draw call.
+
+    Instead, the vertex shader can read the vertices itself. The vertex
+    buffer is bound as a shader storage buffer, and in an indexed draw
+    gl_VertexID is the index that was read from the index buffer, so:
+
+        attribute = vertices[gl_VertexID * stride + offset of the attribute]
+
+    The indices stay in the index buffer on purpose. Reading them from a
+    storage buffer too (glDrawArrays, then indices[gl_VertexID]) works, but
+    then the GPU can't tell that two corners are the same vertex and runs
+    the vertex shader for every corner instead of about once per vertex.
+    On llvmpipe that made the dense spheres of pulling_bench up to twice as
+    slow as the vertex array.
+
+    The format (stride, offset and type of every attribute) comes from a
+    small uniform buffer that every mesh carries, so the same shader draws
+    any mesh, and gl_InstanceID is free to pick per object data.
+
+    A shader asks for pulled attributes in its vertex part with
+
+        #pull (location = 0) vec3 position
+
+    which is the same as "layout (location = 0) in vec3 position;" with
+    "layout" and "in" replaced. ParseShaders turns those lines into global
+    variables plus a PullVertex() function that fills them, and main() has to
+    call PullVertex() before it uses them. Locations the mesh does not have
+    read as (0, 0, 0, 1), just like disabled vertex attributes. Floats have
+    to be 4 byte aligned in the vertex, which is how meshconv writes them.
+*/
+
+// Binding points of the generated code. Shaders can use the other storage
+// buffer bindings for their own data.
+const uint32_t PULL_VERTEX_BINDING = 0;   // shader storage buffer
+const uint32_t PULL_FORMAT_BINDING = 0;   // uniform buffer
+
+// Vertex attribute locations 0..15 can be pulled (the minimum of GL_MAX_VERTEX_ATTRIBS).
+const uint32_t PULL_MAX_LOCATIONS = 16;
+
+// The uniform buffer of a mesh, in std140 layout.
+struct PullFormat {
+    uint32_t Stride;
+    uint32_t Padding[3];
+    // Per location: byte offset, AttributeType, normalized, components (0 if missing).
+    uint32_t Attributes[PULL_MAX_LOCATIONS][4];
+};
+
+PullFormat MakePullFormat(const MeshLayout& layout);
+
+struct PulledAttribute {
+    uint32_t Location;
+    uint32_t Components;
+    std::string Name;
+};
+
+// Parses one "#pull (location = N) vecM name" line. Returns false if it is malformed.
+bool ParsePullLine(const std::string& line, PulledAttribute& attribute);
+
+// The GLSL that replaces the #pull lines: buffer declarations, one global
+// per attribute and PullVertex().
+std::string GeneratePullingCode(const std::vector<PulledAttribute>& attributes);
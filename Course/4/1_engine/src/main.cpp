@@ -0,0 +1,730 @@
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Assets.h"
+#include "BackgroundLoader.h"
+#include "DynamicResolution.h"
+#include "FrameCapture.h"
+#include "FramePacing.h"
+#include "GpuMemory.h"
+#include "GLProfiler.h"
+#include "GLReport.h"
+#include "GpuTimer.h"
+#include "ImmediateMode.h"
+#include "JobSystem.h"
+#include "Math.h"
+#include "MeshArena.h"
+#include "Mesh.h"
+#include "OcclusionCulling.h"
+#include "Particles.h"
+#include "RedrawTracker.h"
+#include "RenderGraph.h"
+#include "Renderer.h"
+#include "ResourcePool.h"
+#include "Shader.h"
+#include "TextureUploader.h"
+#include "ThreadPool.h"
+#include "VertexPulling.h"
+
+/*
+        THE ENGINE
+    Up until now every lesson was a single main.cpp that we kept copying and
+    growing. From here on the code is split into files that we reuse:
+    - Renderer.h/.cpp   - GLCall, ASSERT and the error logging from 3/1
+    - Shader.h/.cpp     - ParseShaders, CompileShader and CreateShader from 2/3
+    - Math.h            - vectors and matrices, so we can have a camera
+    - everything else is one subsystem per file
+
+    The scene is a field of spheres with a wall in front of the camera. Before
+    we draw a sphere, we ask the CPU occlusion buffer (OcclusionCulling.h)
+    whether it can be seen at all. Spheres hidden behind the wall never reach
+    the GPU, and the ones far away are drawn with fewer triangles (a level of
+    detail picked by how big its error would be on screen, see Simplify.h).
+
+    The wall's texture is loaded in the background (TextureUploader.h). Until
+    it arrives, the wall is drawn in a flat color and the frame rate never dips.
+
+    The occlusion tests and the choice of level of detail run on every core
+    through the job system (JobSystem.h); only the draws stay on the main
+    thread.
+
+    The spheres are drawn with vertex pulling (VertexPulling.h): the visible
+    ones are sorted by level of detail, and every level is one instanced draw
+    instead of one draw per sphere. "./engine --attributes" draws them the
+    classic way, one glDrawElementsBaseVertex each out of a shared mesh arena
+    (MeshArena.h), for comparison.
+
+    In front of the wall is a fountain of particles that lives entirely on the
+    GPU: compute shaders emit, move and remove them, and the draw call gets its
+    count from the GPU as well (Particles.h).
+
+    Shaders go through the program cache (BuildProgram in Shader.h) and are
+    checked against the meshes and structs that feed them as soon as they are
+    loaded (ProgramReflection.h). After "make spirv" they are loaded as
+    precompiled SPIR-V instead, where the driver supports it (Spirv.h) and
+    the .shader file hasn't changed since.
+
+    The frame is a render graph (RenderGraph.h): the scene is drawn into a
+    color and a depth texture that only live for the frame, and a second
+    pass presents the color on the window. The window itself has no depth
+    buffer any more.
+
+    The scene textures don't have to be as big as the window: a timer query
+    measures what the GPU spends on every frame, and when that goes over
+    the budget the scene is drawn smaller and stretched by the present pass
+    (DynamicResolution.h). The budget and the limits of the scale come from
+    ENGINE_GPU_BUDGET_MS, ENGINE_MIN_SCALE and ENGINE_MAX_SCALE; every change
+    of the scale is logged.
+
+    How the frames are paced is up to ENGINE_FRAME_PACING (FramePacing.h):
+    "vsync" (the default), "adaptive" (vsync that lets late frames tear),
+    "uncapped", or a number of frames per second for the limiter. The
+    frame times and their jitter are printed at exit.
+
+    P pauses the camera and the particles. With ENGINE_ON_DEMAND=1 the loop
+    then stops drawing altogether: it sleeps in glfwWaitEventsTimeout and
+    only draws a frame when something would look different, a window event,
+    a key, the wall's texture coming in (RedrawTracker.h). How many frames
+    were skipped and what the process cost while idle is printed at exit.
+
+    B shows the bounds of every sphere, green when it was drawn and red when
+    it was culled. They are drawn the way the first lessons drew their
+    triangle, Begin, Vertex, End, through the batched immediate mode of
+    ImmediateMode.h: a thousand boxes, one draw call.
+
+    Built with "make GL_PROFILE=1", every GLCall is counted and timed per
+    call site (GLProfiler.h), and the GL calls that cost the most CPU are
+    printed every second and at exit.
+
+    GL errors, the driver's debug messages and the shader logs are written
+    by a thread of their own, each message once and then once a second with
+    how often it came again; a summary is printed at exit (GLReport.h).
+    ENGINE_GL_DEBUG=1 asks for a debug context, where drivers say the most.
+
+    ENGINE_CAPTURE=<target> records every frame drawn, without waiting for
+    the GPU (FrameCapture.h): frames/frame_%05d.png, capture.y4m, or a
+    command to pipe the frames into, "|ffmpeg -y -i - capture.mp4".
+    ENGINE_CAPTURE_FPS is the frame rate written into a Y4M stream.
+
+    The programs are built on a loader thread, in a hidden window's context
+    shared with this one, while the meshes load (BackgroundLoader.h).
+
+    Every buffer, texture and program is booked in the GPU memory accounting
+    (GpuMemory.h). Press M for a report (and the render graph's passes);
+    with GPU_MEMORY_REPORT=<file> set, the report (with the peaks) is also
+    written at exit.
+
+    Assets come from res.pak when it exists ("make assets"), see Assets.h.
+    The meshes are no longer arrays in here but .mesh files in res/meshes,
+    made from the OBJ files in models by "make meshes" (see MeshFile.h).
+*/
+
+// GL call sites in each profile report (GLProfiler.h).
+static const size_t GL_PROFILE_TOP = 10;
+
+struct Object {
+    Mat4 Model;
+    float Color[4];
+};
+
+// One entry of the Instances buffer in Pulled.shader (std430).
+struct Instance {
+    Mat4 MVP;
+    float Color[4];
+};
+
+// What the culling jobs found out about one sphere.
+struct CullResult {
+    Mat4 MVP;
+    uint32_t Lod;
+    bool Visible;
+};
+
+// The 12 edges of a box, in the style of glBegin(GL_LINES).
+static void DrawBox(ImmediateRenderer& imm, const Mat4& model, const Vec3& min, const Vec3& max) {
+    Vec3 corners[8];
+    for (int i = 0; i < 8; i++) {
+        Vec4 corner = Transform(model, {i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z});
+        corners[i] = {corner.x, corner.y, corner.z};
+    }
+    imm.Begin(GL_LINES);
+    for (int i = 0; i < 8; i++) {
+        for (int axis = 1; axis < 8; axis <<= 1) {
+            if (!(i & axis)) {
+                imm.Vertex3f(corners[i].x, corners[i].y, corners[i].z);
+                imm.Vertex3f(corners[i | axis].x, corners[i | axis].y, corners[i | axis].z);
+            }
+        }
+    }
+    imm.End();
+}
+
+// Window and input callbacks, on demand: the next frame is drawn.
+static void Invalidate(GLFWwindow* window, RedrawReason reason) {
+    if (RedrawTracker* redraw = (RedrawTracker*)glfwGetWindowUserPointer(window)) {
+        redraw->Invalidate(reason);
+    }
+}
+
+// Everything that owns GL objects lives in here, so it is all destroyed while
+// the context still exists (before glfwTerminate).
+static void RunScene(GLFWwindow* window, bool vertexPulling, const DynamicResolutionSettings& resolutionSettings,
+                     FramePacer& pacer, bool onDemand, const FrameCaptureSettings& captureSettings,
+                     const SharedContext& loaderContext) {
+    GLCall(glEnable(GL_DEPTH_TEST));
+
+    // Owns the meshes, programs and buffers below. Declared first, so it goes
+    // last and can report whatever the scene forgot to destroy.
+    ResourcePool resources;
+
+    // Compiling and linking happens on the loader thread while the meshes
+    // load; the programs are taken (and checked) below.
+    BackgroundLoader loader(loaderContext);
+    uint32_t basicProgram = loader.LoadProgram("res/shaders/Basic.shader");
+    uint32_t texturedProgram = loader.LoadProgram("res/shaders/Textured.shader");
+    uint32_t pulledProgram = loader.LoadProgram("res/shaders/Pulled.shader");
+    uint32_t presentProgram = loader.LoadProgram("res/shaders/Present.shader");
+
+    // The same file feeds the GPU buffers and the CPU copy for the occluder.
+    MeshFile cubeFile;
+    if (!LoadMeshFile("res/meshes/cube.mesh", cubeFile)) {
+        std::cerr << "Can't load res/meshes/cube.mesh (run \"make meshes\")" << std::endl;
+        return;
+    }
+    std::vector<float> cubePositions;
+    std::vector<unsigned int> cubeIndices;
+    CopyPositions(cubeFile, cubePositions);
+    CopyIndices(cubeFile, cubeIndices);
+
+    MeshFile sphereFile;
+    Mesh sphere;
+    if (!LoadMeshFile("res/meshes/sphere.mesh", sphereFile) || !CreateMesh(sphereFile, sphere, &resources, "sphere")) {
+        std::cerr << "Can't load res/meshes/sphere.mesh (run \"make meshes\")" << std::endl;
+        return;
+    }
+
+    // Drawn with vertex attributes, both meshes come out of one arena
+    // (MeshArena.h): the vertex array is bound once per frame, and every
+    // draw after that is only an offset into the shared buffers.
+    MeshArena arena(resources, "scene", cubeFile.Layout, 1024 * 1024, 1024 * 1024);
+    uint32_t cubeMesh = arena.Add(cubeFile);
+    uint32_t sphereMesh = arena.Add(sphereFile);
+    if (cubeMesh == MeshArena::NoMesh || sphereMesh == MeshArena::NoMesh) {
+        std::cerr << "The cube and the sphere need the same vertex layout" << std::endl;
+        DeleteMesh(sphere);
+        return;
+    }
+
+    // Every program is checked against what this file feeds it: the mesh
+    // layouts, the uniforms (which also gives us their locations) and the
+    // structs that go into its buffers. See ProgramReflection.h.
+    ProgramReflection reflection;
+    auto takeProgram = [&](uint32_t id) {
+        loader.WaitFor(id);
+        reflection = loader.GetReflection(id);
+        return loader.Take(id);
+    };
+    GLint mvpLocation, colorLocation;
+    GLuint shader = takeProgram(basicProgram);
+    bool valid = shader != 0;
+    valid = valid && ValidateVertexLayout(reflection, cubeFile.Layout);
+    valid = valid && ValidateVertexLayout(reflection, sphereFile.Layout);
+    valid = valid && ValidateUniform(reflection, "u_MVP", GL_FLOAT_MAT4, &mvpLocation);
+    valid = valid && ValidateUniform(reflection, "u_Color", GL_FLOAT_VEC4, &colorLocation);
+
+    GLint texturedMvpLocation, texturedColorLocation, textureLocation;
+    GLuint texturedShader = takeProgram(texturedProgram);
+    valid = valid && texturedShader != 0;
+    valid = valid && ValidateVertexLayout(reflection, cubeFile.Layout);
+    valid = valid && ValidateUniform(reflection, "u_MVP", GL_FLOAT_MAT4, &texturedMvpLocation);
+    valid = valid && ValidateUniform(reflection, "u_Color", GL_FLOAT_VEC4, &texturedColorLocation);
+    valid = valid && ValidateUniform(reflection, "u_Texture", GL_SAMPLER_2D, &textureLocation);
+
+    GLint firstInstanceLocation;
+    GLuint pulledShader = takeProgram(pulledProgram);
+    valid = valid && pulledShader != 0;
+    valid = valid && ValidateUniformBlock(reflection, "PulledFormat", sizeof(PullFormat));
+    valid = valid && ValidateStorageBlock(reflection, "Instances", "instances", sizeof(Instance));
+    valid = valid && ValidateUniform(reflection, "u_FirstInstance", GL_UNSIGNED_INT, &firstInstanceLocation);
+
+    // Draws the scene's color onto the window, see the render graph below.
+    GLint sceneTextureLocation;
+    GLuint presentShader = takeProgram(presentProgram);
+    valid = valid && presentShader != 0;
+    valid = valid && ValidateUniform(reflection, "u_Scene", GL_SAMPLER_2D, &sceneTextureLocation);
+
+    ProgramHandle programs[] = {resources.AddProgram("Basic", shader), resources.AddProgram("Textured", texturedShader),
+                                resources.AddProgram("Pulled", pulledShader),
+                                resources.AddProgram("Present", presentShader)};
+    // The present pass's triangle comes from gl_VertexID, but a draw call
+    // still needs a vertex array.
+    VertexArrayHandle emptyVertexArray = resources.CreateVertexArray("fullscreen triangle");
+    auto destroyAll = [&]() {
+        for (ProgramHandle& program : programs) {
+            resources.Destroy(program);
+        }
+        resources.Destroy(emptyVertexArray);
+        DeleteMesh(sphere);
+    };
+    if (!valid) {
+        destroyAll();
+        return;
+    }
+    GLCall(glUseProgram(shader));
+
+    // Decoding happens on the pool, the render thread uploads at most 4 MB per frame.
+    // Decoding mostly waits for the disk, so it stays out of the job system.
+    ThreadPool pool;
+    JobSystem jobs;
+    TextureUploader textures(pool, 16 * 1024 * 1024, 4 * 1024 * 1024);
+    unsigned int wallTexture = textures.Load("res/textures/bricks.tga");
+
+    // The wall is both drawn and used as the occluder.
+    Object wall = {Translate({-8.0f, 0.0f, 0.0f}) * Scale({16.0f, 6.0f, 0.5f}), {0.6f, 0.6f, 0.6f, 1.0f}};
+
+    std::vector<Object> spheres;
+    for (int z = 0; z < 32; z++) {
+        for (int x = 0; x < 32; x++) {
+            Object object;
+            object.Model = Translate({-20.0f + x * 1.25f, 0.0f, 8.0f - z * 1.5f}) * Scale({0.8f, 0.8f, 0.8f});
+            object.Color[0] = x / 32.0f;
+            object.Color[1] = 0.0f;
+            object.Color[2] = z / 32.0f;
+            object.Color[3] = 1.0f;
+            spheres.push_back(object);
+        }
+    }
+
+    const float fovY = 60.0f * 3.14159265f / 180.0f;
+    Mat4 projection = Perspective(fovY, 640.0f / 480.0f, 0.1f, 200.0f);
+
+    // How many pixels one unit covers at distance 1 (per pixel of the
+    // scene's height, which changes with its scale), and how many pixels of
+    // error we accept before switching to a more detailed level.
+    const float pixelsPerUnitPerHeight = 1.0f / (2.0f * std::tan(fovY / 2.0f));
+    const float maxLodPixels = 1.0f;
+    Vec3 sphereCenter = (sphere.BoundsMin + sphere.BoundsMax) * 0.5f;
+    OcclusionBuffer occlusion(256, 128);
+
+    // The visible spheres of every level of detail, rewritten every frame.
+    std::vector<Instance> batches[MeshFile::MaxLods];
+    std::vector<Instance> instances;
+    std::vector<CullResult> culled(spheres.size());
+    BufferHandle instanceHandle =
+        resources.CreateBuffer("instances", spheres.size() * sizeof(Instance), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    GLuint instanceBuffer = resources.Get(instanceHandle);
+
+    // 20000 particles per second, living 1 to 3 seconds each.
+    ParticleSystem particles(1 << 16);
+    ParticleEmitter fountain = {{0.0f, 0.0f, 4.0f}, {0.0f, 6.0f, 0.0f}, 1.5f, 1.0f, 3.0f};
+    const float particlesPerSecond = 20000.0f;
+    float particlesToEmit = 0.0f;
+    double lastFrame = glfwGetTime();
+    // Only runs while the animation isn't paused.
+    double animationTime = 0.0;
+
+    // Declared after the pool, so its textures go back before the pool goes.
+    RenderGraph graph(resources);
+    GpuTimer frameTimer;
+    DynamicResolution resolution(resolutionSettings);
+    FrameCapture capture(captureSettings);
+
+    RedrawTracker redraw;
+    redraw.SetAnimating(true);
+    bool wallTextured = false;
+    if (onDemand) {
+        glfwSetWindowUserPointer(window, &redraw);
+        glfwSetFramebufferSizeCallback(window, [](GLFWwindow* w, int, int) { Invalidate(w, RedrawReason::Window); });
+        glfwSetWindowRefreshCallback(window, [](GLFWwindow* w) { Invalidate(w, RedrawReason::Window); });
+        glfwSetWindowFocusCallback(window, [](GLFWwindow* w, int) { Invalidate(w, RedrawReason::Window); });
+        glfwSetKeyCallback(window, [](GLFWwindow* w, int, int, int, int) { Invalidate(w, RedrawReason::Input); });
+        glfwSetCursorPosCallback(window, [](GLFWwindow* w, double, double) { Invalidate(w, RedrawReason::Input); });
+    }
+
+    ImmediateRenderer imm;
+    bool showBounds = false;
+
+    bool memoryKeyDown = false, pauseKeyDown = false, boundsKeyDown = false;
+
+    double lastReport = glfwGetTime();
+    size_t framesSinceReport = 0, drawnSinceReport = 0, culledSinceReport = 0, trianglesSinceReport = 0;
+
+    while (!glfwWindowShouldClose(window)) {
+        // On demand, sleep until an event, unless the next frame is to be
+        // drawn anyway. While textures are loading, Update() below has to
+        // keep coming around.
+        if (onDemand) {
+            double timeout = redraw.GetWaitTimeout();
+            glfwWaitEventsTimeout(textures.IsIdle() ? timeout : std::min(timeout, 0.005));
+        }
+        else {
+            glfwPollEvents();
+        }
+
+        // Once per press, not once per frame the key is held.
+        bool memoryKey = glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS;
+        if (memoryKey && !memoryKeyDown) {
+            QueryDriverMemory();
+            PrintGpuMemoryReport(std::cout);
+            graph.Print(std::cout);
+            if (onDemand) {
+                redraw.PrintReport(std::cout);
+            }
+        }
+        memoryKeyDown = memoryKey;
+        bool pauseKey = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+        if (pauseKey && !pauseKeyDown) {
+            redraw.SetAnimating(!redraw.IsAnimating());
+        }
+        pauseKeyDown = pauseKey;
+        bool boundsKey = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+        if (boundsKey && !boundsKeyDown) {
+            showBounds = !showBounds;
+        }
+        boundsKeyDown = boundsKey;
+
+        // Whole particles only, the rest waits for the next frame. Paused,
+        // nothing moves, but the clock still has to be followed.
+        double now = glfwGetTime();
+        float deltaTime = redraw.IsAnimating() ? (float)(now - lastFrame) : 0.0f;
+        lastFrame = now;
+        animationTime += deltaTime;
+        particlesToEmit += particlesPerSecond * deltaTime;
+        uint32_t emitCount = (uint32_t)particlesToEmit;
+        particlesToEmit -= emitCount;
+
+        // Uploads go on whether the frame is drawn or not; the wall looks
+        // different once its texture is in.
+        textures.Update();
+        if (!wallTextured && textures.GetTexture(wallTexture)) {
+            wallTextured = true;
+            redraw.Invalidate(RedrawReason::Content);
+        }
+
+        // Nothing would change on screen: no culling, no clear, no draw and
+        // no swap. The time asleep isn't a frame interval either.
+        if (onDemand && !redraw.BeginFrame(now)) {
+            pacer.Restart();
+            continue;
+        }
+
+        // Slowly swing the camera left and right so spheres pop in and out behind the wall.
+        float t = (float)animationTime;
+        Vec3 eye = {std::sin(t * 0.3f) * 12.0f, 1.7f, 16.0f};
+        Mat4 view = LookAt(eye, {0.0f, 1.5f, 0.0f}, {0.0f, 1.0f, 0.0f});
+        Mat4 viewProjection = projection * view;
+
+        // Occlusion pass, all on the CPU.
+        occlusion.Clear();
+        occlusion.RasterizeOccluder(viewProjection * wall.Model, cubePositions.data(), cubePositions.size() / 3,
+                                    cubeIndices.data(), cubeIndices.size());
+        occlusion.BuildHierarchy();
+
+        // The GPU time of a frame or two ago decides this frame's scale.
+        double gpuMilliseconds;
+        if (frameTimer.Poll(gpuMilliseconds) && resolution.Update(gpuMilliseconds)) {
+            redraw.Invalidate(RedrawReason::Content);
+            std::cout << "render scale " << resolution.GetScale() << " (GPU frame " << resolution.GetAverageMs()
+                      << " ms, budget " << resolutionSettings.BudgetMs << " ms)" << std::endl;
+        }
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        // Minimized, the window is 0 by 0.
+        width = std::max(width, 1);
+        height = std::max(height, 1);
+        int sceneWidth, sceneHeight;
+        resolution.GetRenderSize(width, height, sceneWidth, sceneHeight);
+        const float pixelsPerUnit = sceneHeight * pixelsPerUnitPerHeight;
+
+        particles.Update(deltaTime, fountain, emitCount);
+
+        // Testing a sphere and picking its level of detail only reads, so the
+        // spheres are split over all cores. The draws stay on this thread,
+        // in the same order as before.
+        jobs.ParallelFor(spheres.size(), 64, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const Object& object = spheres[i];
+                CullResult& result = culled[i];
+                result.MVP = viewProjection * object.Model;
+                result.Visible =
+                    occlusion.Test(result.MVP, sphere.BoundsMin, sphere.BoundsMax) == OcclusionResult::Visible;
+                if (result.Visible) {
+                    Vec4 center = Transform(object.Model, sphereCenter);
+                    Vec3 toCamera = Vec3{center.x, center.y, center.z} - eye;
+                    result.Lod = SelectLod(sphere.Lods, sphere.LodCount, MaxScale(object.Model),
+                                           std::sqrt(Dot(toCamera, toCamera)), pixelsPerUnit, maxLodPixels);
+                }
+            }
+        });
+
+        // The scene goes into textures of the scaled size that only live for
+        // this frame; the graph clears them, and throws the depth away once
+        // the scene is drawn.
+        graph.Begin();
+        RenderTarget backbuffer = graph.ImportBackbuffer(0, width, height);
+        RenderTarget sceneColor = graph.Create("scene color", {sceneWidth, sceneHeight, GL_RGBA8});
+        RenderTarget sceneDepth = graph.Create("scene depth", {sceneWidth, sceneHeight, GL_DEPTH_COMPONENT24});
+
+        graph.AddPass(
+            "scene",
+            [&](RenderPassBuilder& pass) {
+                pass.Write(sceneColor, LoadOp::Clear);
+                pass.Write(sceneDepth, LoadOp::Clear);
+            },
+            [&](const RenderPassContext&) {
+                Mat4 wallMvp = viewProjection * wall.Model;
+                arena.Bind();
+                if (GLuint texture = textures.GetTexture(wallTexture)) {
+                    GLCall(glUseProgram(texturedShader));
+                    GLCall(glBindTextureUnit(0, texture));
+                    GLCall(glUniform1i(textureLocation, 0));
+                    GLCall(glUniformMatrix4fv(texturedMvpLocation, 1, GL_FALSE, wallMvp.Data));
+                    GLCall(glUniform4f(texturedColorLocation, 1.0f, 1.0f, 1.0f, 1.0f));
+                    arena.Draw(cubeMesh);
+                    GLCall(glUseProgram(shader));
+                }
+                else {
+                    GLCall(glUniformMatrix4fv(mvpLocation, 1, GL_FALSE, wallMvp.Data));
+                    GLCall(glUniform4fv(colorLocation, 1, wall.Color));
+                    arena.Draw(cubeMesh);
+                }
+
+                for (size_t i = 0; i < spheres.size(); i++) {
+                    const Object& object = spheres[i];
+                    if (!culled[i].Visible) {
+                        culledSinceReport++;
+                        continue;
+                    }
+                    const Mat4& mvp = culled[i].MVP;
+                    uint32_t lod = culled[i].Lod;
+
+                    if (vertexPulling) {
+                        batches[lod].push_back(
+                            {mvp, {object.Color[0], object.Color[1], object.Color[2], object.Color[3]}});
+                    }
+                    else {
+                        GLCall(glUniformMatrix4fv(mvpLocation, 1, GL_FALSE, mvp.Data));
+                        GLCall(glUniform4fv(colorLocation, 1, object.Color));
+                        arena.Draw(sphereMesh, lod);
+                    }
+                    drawnSinceReport++;
+                    trianglesSinceReport += sphere.Lods[lod].IndexCount / 3;
+                }
+
+                if (vertexPulling) {
+                    // All batches go into the buffer in one upload, one after the other.
+                    instances.clear();
+                    for (std::vector<Instance>& batch : batches) {
+                        instances.insert(instances.end(), batch.begin(), batch.end());
+                    }
+                    if (!instances.empty()) {
+                        GLCall(glNamedBufferSubData(instanceBuffer, 0, instances.size() * sizeof(Instance),
+                                                    instances.data()));
+                    }
+
+                    GLCall(glUseProgram(pulledShader));
+                    GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, instanceBuffer));
+                    uint32_t first = 0;
+                    for (uint32_t lod = 0; lod < MeshFile::MaxLods; lod++) {
+                        if (!batches[lod].empty()) {
+                            GLCall(glUniform1ui(firstInstanceLocation, first));
+                            DrawPulledMesh(sphere, lod, (uint32_t)batches[lod].size());
+                            first += (uint32_t)batches[lod].size();
+                            batches[lod].clear();
+                        }
+                    }
+                    GLCall(glUseProgram(shader));
+                }
+
+                // The point size is in pixels of the scene.
+                particles.Draw(viewProjection, 20.0f * resolution.GetScale());
+
+                if (showBounds) {
+                    for (size_t i = 0; i < spheres.size(); i++) {
+                        if (culled[i].Visible) {
+                            imm.Color3f(0.2f, 1.0f, 0.2f);
+                        }
+                        else {
+                            imm.Color3f(1.0f, 0.2f, 0.2f);
+                        }
+                        DrawBox(imm, spheres[i].Model, sphere.BoundsMin, sphere.BoundsMax);
+                    }
+                    imm.Flush(viewProjection);
+                }
+                GLCall(glUseProgram(shader));
+            });
+
+        graph.AddPass(
+            "present",
+            [&](RenderPassBuilder& pass) {
+                pass.Read(sceneColor);
+                pass.Write(backbuffer, LoadOp::DontCare);
+            },
+            // The bilinear filtering of the scene color is the upscale.
+            [&](const RenderPassContext& context) {
+                GLCall(glDisable(GL_DEPTH_TEST));
+                GLCall(glUseProgram(presentShader));
+                GLCall(glBindTextureUnit(0, context.GetTexture(sceneColor)));
+                GLCall(glUniform1i(sceneTextureLocation, 0));
+                GLCall(glBindVertexArray(resources.Get(emptyVertexArray)));
+                GLCall(glDrawArrays(GL_TRIANGLES, 0, 3));
+                GLCall(glUseProgram(shader));
+                GLCall(glEnable(GL_DEPTH_TEST));
+            });
+
+        frameTimer.Begin();
+        graph.Execute();
+        frameTimer.End();
+
+        // Whatever the jobs left for the GL thread.
+        jobs.RunMainThreadJobs();
+
+        // Queues a copy of the back buffer; written a few frames later.
+        capture.Capture(0, width, height);
+
+        pacer.BeforeSwap();
+        glfwSwapBuffers(window);
+        pacer.AfterSwap();
+        resources.EndFrame();
+        GLProfilerEndFrame();
+
+        framesSinceReport++;
+        if (glfwGetTime() - lastReport >= 1.0) {
+            std::cout << "spheres drawn per frame: " << drawnSinceReport / framesSinceReport
+                      << ", culled: " << culledSinceReport / framesSinceReport
+                      << ", triangles: " << trianglesSinceReport / framesSinceReport
+                      << ", render scale: " << resolution.GetScale() << std::endl;
+            PrintGLProfile(std::cout, GL_PROFILE_TOP, true);
+            lastReport = glfwGetTime();
+            framesSinceReport = drawnSinceReport = culledSinceReport = trianglesSinceReport = 0;
+        }
+    }
+
+    textures.PrintStats(std::cout);
+    const RenderGraphStats& graphStats = graph.GetStats();
+    std::cout << "render graph: " << graphStats.Passes << " passes, " << graphStats.CulledPasses
+              << " culled, peak transient memory " << graphStats.PeakTransientBytes / 1024 << " KB ("
+              << graphStats.PeakAliasedBytes / 1024 << " KB aliased)" << std::endl;
+    if (onDemand) {
+        redraw.PrintReport(std::cout);
+        glfwSetWindowUserPointer(window, nullptr);
+    }
+    PrintGLProfile(std::cout, GL_PROFILE_TOP, false);
+    capture.Finish();
+    capture.PrintReport(std::cout);
+    loader.PrintReport(std::cout);
+
+    resources.Destroy(instanceHandle);
+    destroyAll();
+}
+
+int main(int argc, char* argv[]) {
+    bool vertexPulling = !(argc > 1 && std::string(argv[1]) == "--attributes");
+
+    GLFWwindow* window;
+
+    // Initializing glfw library.
+    if (!glfwInit()) {
+        return -1;
+    }
+
+    // Creating an OpenGL context; the depth buffer is the render graph's.
+    glfwWindowHint(GLFW_DEPTH_BITS, 0);
+    const char* glDebug = std::getenv("ENGINE_GL_DEBUG");
+    if (glDebug && std::string(glDebug) != "0") {
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+    }
+    window = glfwCreateWindow(640, 480, "Engine", nullptr, nullptr);
+    if (!window) {
+        glfwTerminate();
+        return -1;
+    }
+
+    // "Selecting" that context.
+    glfwMakeContextCurrent(window);
+
+    // Vsync unless ENGINE_FRAME_PACING says otherwise; -1 (adaptive) only
+    // where the driver knows it.
+    FramePacingSettings pacingSettings;
+    if (const char* pacing = std::getenv("ENGINE_FRAME_PACING")) {
+        if (!ParsePacingMode(pacing, pacingSettings)) {
+            std::cerr << "Unknown ENGINE_FRAME_PACING \"" << pacing << "\", using vsync" << std::endl;
+        }
+    }
+    bool tearControl = glfwExtensionSupported("WGL_EXT_swap_control_tear") ||
+                       glfwExtensionSupported("GLX_EXT_swap_control_tear");
+    glfwSwapInterval(GetSwapInterval(pacingSettings.Mode, tearControl));
+    if (pacingSettings.Mode == PacingMode::Adaptive && !tearControl) {
+        std::cout << "No swap_control_tear, adaptive vsync is plain vsync" << std::endl;
+    }
+
+    // Initializing glew.
+    GLenum err = glewInit();
+    if (GLEW_OK != err) {
+        std::cerr << glewGetErrorString(err) << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    EnableGLDebugOutput();
+
+    // Without the archive every asset is simply read from res/ as before.
+    if (MountArchive("res.pak")) {
+        std::cout << "Reading assets from res.pak" << std::endl;
+    }
+
+    if (const char* memoryReport = std::getenv("GPU_MEMORY_REPORT")) {
+        SetGpuMemoryReportAtExit(memoryReport);
+    }
+
+    DynamicResolutionSettings resolutionSettings;
+    if (const char* budget = std::getenv("ENGINE_GPU_BUDGET_MS")) {
+        resolutionSettings.BudgetMs = (float)std::atof(budget);
+    }
+    if (const char* minScale = std::getenv("ENGINE_MIN_SCALE")) {
+        resolutionSettings.MinScale = (float)std::atof(minScale);
+    }
+    if (const char* maxScale = std::getenv("ENGINE_MAX_SCALE")) {
+        resolutionSettings.MaxScale = (float)std::atof(maxScale);
+    }
+
+    // Draw only when something changed, see RedrawTracker.h.
+    const char* onDemand = std::getenv("ENGINE_ON_DEMAND");
+    bool drawOnDemand = onDemand && std::string(onDemand) != "0";
+
+    FrameCaptureSettings captureSettings;
+    if (const char* captureTarget = std::getenv("ENGINE_CAPTURE")) {
+        captureSettings = GetCaptureSettings(captureTarget);
+    }
+    if (const char* captureFps = std::getenv("ENGINE_CAPTURE_FPS")) {
+        captureSettings.FramesPerSecond = std::max(std::atoi(captureFps), 1);
+    }
+
+    // The loader thread's context: a hidden window's, sharing this one's
+    // objects. Without it the programs are built here, as before.
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* loaderWindow = glfwCreateWindow(1, 1, "Loader", nullptr, window);
+    SharedContext loaderContext;
+    if (loaderWindow) {
+        loaderContext.MakeCurrent = [loaderWindow]() {
+            glfwMakeContextCurrent(loaderWindow);
+            return true;
+        };
+        loaderContext.Release = []() { glfwMakeContextCurrent(nullptr); };
+    }
+
+    FramePacer pacer(pacingSettings);
+    RunScene(window, vertexPulling, resolutionSettings, pacer, drawOnDemand, captureSettings, loaderContext);
+    pacer.PrintReport(std::cout);
+    StopGLReporting();
+
+    if (loaderWindow) {
+        glfwDestroyWindow(loaderWindow);
+    }
+    glfwTerminate();
+    return 0;
+}
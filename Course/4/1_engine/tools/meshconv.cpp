@@ -0,0 +1,40 @@
+/*
+    Offline mesh converter: OBJ or PLY in, binary mesh (see MeshFile.h) out.
+    The engine then loads the result without parsing anything. The levels of
+    detail (see Simplify.h) are made here too.
+
+    Usage: meshconv input.obj|input.ply output.mesh
+*/
+
+#include "../src/MeshFile.h"
+#include "../src/MeshImporter.h"
+#include "../src/Simplify.h"
+
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " input.obj|input.ply output.mesh" << std::endl;
+        return 1;
+    }
+
+    ImportedMesh mesh;
+    if (!ImportMesh(argv[1], mesh) || mesh.Indices.empty()) {
+        std::cerr << "Can't read " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::vector<MeshLod> lods = BuildLodChain(mesh.Vertices.data(), mesh.VertexCount, mesh.Layout, mesh.Indices);
+
+    if (!SaveMeshFile(argv[2], mesh.Layout, mesh.Vertices.data(), mesh.VertexCount,
+                      mesh.Indices.data(), (uint32_t)mesh.Indices.size(), lods.data(), (uint32_t)lods.size())) {
+        std::cerr << "Can't write " << argv[2] << std::endl;
+        return 1;
+    }
+
+    std::cout << argv[2] << ": " << mesh.VertexCount << " vertices (" << mesh.Layout.Stride << " bytes each)" << std::endl;
+    for (size_t i = 0; i < lods.size(); i++) {
+        std::cout << "  lod " << i << ": " << lods[i].IndexCount / 3 << " triangles, error " << lods[i].Error << std::endl;
+    }
+    return 0;
+}
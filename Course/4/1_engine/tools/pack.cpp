@@ -0,0 +1,53 @@
+/*
+    Packs a directory (recursively) into an archive for Archive/Assets.
+    Paths are stored the way they are given, so packing "res" from the engine
+    directory gives entries like "res/shaders/Basic.shader", exactly the paths
+    the code already uses.
+
+    Usage: pack res res.pak
+*/
+
+#include "../src/Archive.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " directory output.pak" << std::endl;
+        return 1;
+    }
+
+    std::vector<ArchiveInput> files;
+    size_t totalSize = 0;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(argv[1])) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+
+        std::ifstream input(entry.path(), std::ios::binary);
+        ArchiveInput file;
+        file.Path = entry.path().generic_string();
+        file.Data.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        // Block compressed textures barely shrink, and stored textures and meshes
+        // can be used straight from the mapping, so leave them alone.
+        std::string extension = entry.path().extension().string();
+        file.Compress = extension != ".dds" && extension != ".ktx" && extension != ".mesh";
+        totalSize += file.Data.size();
+        files.push_back(std::move(file));
+    }
+
+    if (!WriteArchive(argv[2], files)) {
+        std::cerr << "Can't write " << argv[2] << std::endl;
+        return 1;
+    }
+
+    std::cout << argv[2] << ": " << files.size() << " files, " << totalSize << " bytes packed into "
+              << fs::file_size(argv[2]) << std::endl;
+    return 0;
+}
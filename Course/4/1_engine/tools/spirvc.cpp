@@ -0,0 +1,110 @@
+/*
+    Offline SPIR-V compiler: every .shader file in, one .spv module per stage
+    out, next to it (Basic.shader gives Basic.vert.spv and Basic.frag.spv).
+    The engine loads those instead of the GLSL when the driver has
+    GL_ARB_gl_spirv, see LoadProgram in Shader.h.
+
+    Basic.spv.hash is written last, once every stage compiled: the
+    HashShaderSource of the file. The engine only takes the modules while
+    the .shader file still has that hash, so an edited shader is never run
+    from old SPIR-V; and make only recompiles shaders newer than their hash.
+
+    The file is split with the engine's own ParseShaders (ShaderSource.h,
+    no GL), so "#pull" lines are expanded exactly as at run time. Each stage is written to
+    cache/spirv and compiled by glslangValidator for OpenGL (-G), which also
+    defines GL_SPIRV for the shader.
+
+    Usage: spirvc [--glslang path] file.shader...
+*/
+
+#include "../src/ShaderSource.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+static const char* TEMP_DIRECTORY = "cache/spirv";
+
+// Writes one stage and runs the compiler on it.
+static bool CompileStage(const std::string& glslang, const std::string& filepath, const std::string& source,
+                         const char* stage) {
+    std::filesystem::path path(filepath);
+    std::string stem = path.stem().string();
+    std::string input = std::string(TEMP_DIRECTORY) + "/" + stem + "." + stage;
+    std::string output = (path.parent_path() / (stem + "." + stage + ".spv")).string();
+
+    std::ofstream file(input, std::ios::binary);
+    file << source;
+    file.close();
+    if (!file) {
+        std::cerr << "Can't write " << input << std::endl;
+        return false;
+    }
+
+    // glslangValidator picks the stage from the extension.
+    std::string command = glslang + " -G -o \"" + output + "\" \"" + input + "\"";
+    if (std::system(command.c_str()) != 0) {
+        std::cerr << "Failed to compile the " << stage << " stage of " << filepath << std::endl;
+        std::filesystem::remove(output);
+        return false;
+    }
+    std::cout << output << std::endl;
+    return true;
+}
+
+// Basic.spv.hash, or none if a stage failed.
+static bool WriteHash(const std::string& filepath, const ShaderProgramSource& source, bool compiled) {
+    std::filesystem::path path(filepath);
+    std::string output = (path.parent_path() / (path.stem().string() + ".spv.hash")).string();
+    if (!compiled) {
+        std::filesystem::remove(output);
+        return false;
+    }
+
+    char text[32];
+    std::snprintf(text, sizeof(text), "%016llx\n", (unsigned long long)HashShaderSource(source));
+    std::ofstream file(output, std::ios::binary);
+    file << text;
+    file.close();
+    if (!file) {
+        std::cerr << "Can't write " << output << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::string glslang = "glslangValidator";
+    int first = 1;
+    if (argc > 2 && std::string(argv[1]) == "--glslang") {
+        glslang = argv[2];
+        first = 3;
+    }
+    if (first >= argc) {
+        std::cerr << "Usage: " << argv[0] << " [--glslang path] file.shader..." << std::endl;
+        return 1;
+    }
+
+    std::filesystem::create_directories(TEMP_DIRECTORY);
+    bool ok = true;
+    for (int i = first; i < argc; i++) {
+        ShaderProgramSource source = ParseShaders(argv[i]);
+        bool compiled = true;
+        if (!source.ComputeSource.empty()) {
+            compiled = CompileStage(glslang, argv[i], source.ComputeSource, "comp");
+        }
+        else if (!source.VertexSource.empty() && !source.FragmentSource.empty()) {
+            compiled = CompileStage(glslang, argv[i], source.VertexSource, "vert");
+            compiled = CompileStage(glslang, argv[i], source.FragmentSource, "frag") && compiled;
+        }
+        else {
+            std::cerr << "No stages in " << argv[i] << std::endl;
+            compiled = false;
+        }
+        ok = WriteHash(argv[i], source, compiled) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+/*
+    Offline texture compressor: TGA/PPM in, DDS with BC1 blocks and a full mip
+    chain out. Do this once at build time instead of shipping plain RGBA.
+
+    Usage: texcompress input.tga output.dds
+*/
+
+#include "../src/BlockCompression.h"
+#include "../src/Image.h"
+#include "../src/TextureContainer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " input.tga output.dds" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(argv[1], std::ios::binary);
+    std::vector<unsigned char> file((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    ImageInfo info;
+    if (!input || !ReadImageInfo(file.data(), file.size(), info)) {
+        std::cerr << "Can't read " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::vector<unsigned char> rgba((size_t)info.Width * info.Height * 4);
+    if (!DecodeImage(file.data(), file.size(), rgba.data())) {
+        std::cerr << "Can't decode " << argv[1] << std::endl;
+        return 1;
+    }
+
+    // Compress every level, halving the image until it is 1x1.
+    std::vector<std::vector<unsigned char>> levels;
+    int width = info.Width;
+    int height = info.Height;
+    for (;;) {
+        levels.emplace_back(GetCompressedSize(BlockFormat::BC1, width, height));
+        EncodeBC1(width, height, rgba.data(), levels.back().data());
+        if (width == 1 && height == 1) {
+            break;
+        }
+
+        std::vector<unsigned char> smaller((size_t)std::max(1, width / 2) * std::max(1, height / 2) * 4);
+        DownsampleImage(width, height, rgba.data(), smaller.data());
+        rgba.swap(smaller);
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+
+    if (!SaveDDS(argv[2], BlockFormat::BC1, info.Width, info.Height, levels)) {
+        std::cerr << "Can't write " << argv[2] << std::endl;
+        return 1;
+    }
+
+    size_t compressed = 0;
+    for (const std::vector<unsigned char>& level : levels) {
+        compressed += level.size();
+    }
+    std::cout << argv[2] << ": " << info.Width << "x" << info.Height << ", " << levels.size() << " levels, "
+              << compressed << " bytes (RGBA with mips would be about "
+              << (size_t)info.Width * info.Height * 4 * 4 / 3 << ")" << std::endl;
+    return 0;
+}
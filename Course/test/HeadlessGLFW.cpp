@@ -0,0 +1,398 @@
+/*
+        GLFW WITHOUT A WINDOW
+    The lessons are programs that open a window and draw until it's closed.
+    To check them automatically, they are linked against this file instead
+    of libglfw: the same GLFW functions, but the "window" is an EGL context
+    on Mesa's surfaceless platform with a framebuffer object of the window's
+    size bound in place of the default framebuffer. The lesson's code stays
+    exactly as it is, it can't tell the difference.
+
+    What the test wants is set in the environment:
+    - HEADLESS_FRAMES   after this many glfwSwapBuffers the window "closes"
+                        (10 by default), so the lesson leaves its loop.
+    - HEADLESS_CAPTURE  the last frame is read back and written there, as a
+                        binary PPM (P6), to compare with the golden image.
+    - HEADLESS_METRICS  how long the frames took and how many GL calls they
+                        made, written there as JSON when glfwTerminate is
+                        called.
+
+    Counting GL calls: the functions of OpenGL 1.1 (glClear, glBegin,
+    glVertex2d, glDrawArrays, glDrawElements, glGetError...) are exported by
+    libGL itself, so defining them here takes the lesson's calls, and we
+    pass them on with dlsym(RTLD_NEXT). Everything newer goes through
+    GLEW's function pointers and isn't counted, but every draw call and
+    every clear is.
+
+    Frame times are from one swap to the next, with a glFinish in the swap
+    so the frame's rendering is in them too. The first frame, with the
+    shaders compiled and the buffers uploaded, is left out.
+
+    glfwGetTime is not the real time: it moves 1/60 s per frame, so an
+    animation looks the same after N frames on every machine.
+*/
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct GLFWwindow {
+    int Width;
+    int Height;
+    EGLContext Context;
+    GLuint Framebuffer = 0;
+    GLuint Renderbuffers[2] = {0, 0};
+    bool ShouldClose = false;
+    void* UserPointer = nullptr;
+};
+
+struct Headless {
+    EGLDisplay Display = EGL_NO_DISPLAY;
+    GLFWwindow* Current = nullptr;
+    // glfwWindowHint
+    int Major = 0, Minor = 0, Profile = GLFW_OPENGL_ANY_PROFILE;
+    bool ForwardCompatible = false, Debug = false;
+
+    int FramesToDraw = 10;
+    int Frames = 0;
+    Clock::time_point LastSwap;
+    std::vector<double> FrameMs;
+
+    // GL calls and draw calls: all of them, up to the first swap, and in the
+    // frames after it.
+    uint64_t Calls = 0, DrawCalls = 0;
+    uint64_t SetupCalls = 0, SetupDrawCalls = 0;
+    uint64_t FrameCalls = 0, FrameDrawCalls = 0;
+};
+
+static Headless s_Headless;
+
+static void CountCall(bool draw) {
+    s_Headless.Calls++;
+    s_Headless.DrawCalls += draw;
+}
+
+// The real function, from the library after us.
+#define COUNTED_GL(ret, name, draw, params, args) \
+    extern "C" ret GLAPIENTRY name params { \
+        static auto real = (ret (GLAPIENTRY*) params)dlsym(RTLD_NEXT, #name); \
+        CountCall(draw); \
+        return real args; \
+    }
+
+COUNTED_GL(void, glClear, false, (GLbitfield mask), (mask))
+COUNTED_GL(void, glClearColor, false, (GLfloat r, GLfloat g, GLfloat b, GLfloat a), (r, g, b, a))
+COUNTED_GL(void, glViewport, false, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height))
+COUNTED_GL(void, glEnable, false, (GLenum cap), (cap))
+COUNTED_GL(void, glDisable, false, (GLenum cap), (cap))
+COUNTED_GL(GLenum, glGetError, false, (), ())
+COUNTED_GL(void, glBegin, false, (GLenum mode), (mode))
+// Immediate mode draws at glEnd.
+COUNTED_GL(void, glEnd, true, (), ())
+COUNTED_GL(void, glVertex2d, false, (GLdouble x, GLdouble y), (x, y))
+COUNTED_GL(void, glVertex2f, false, (GLfloat x, GLfloat y), (x, y))
+COUNTED_GL(void, glVertex3f, false, (GLfloat x, GLfloat y, GLfloat z), (x, y, z))
+COUNTED_GL(void, glColor3f, false, (GLfloat r, GLfloat g, GLfloat b), (r, g, b))
+COUNTED_GL(void, glDrawArrays, true, (GLenum mode, GLint first, GLsizei count), (mode, first, count))
+COUNTED_GL(void, glDrawElements, true, (GLenum mode, GLsizei count, GLenum type, const void* indices),
+           (mode, count, type, indices))
+COUNTED_GL(void, glBindTexture, false, (GLenum target, GLuint texture), (target, texture))
+
+// Before glewInit, and not to be counted: straight from EGL.
+template <typename T>
+static T GetGL(const char* name) {
+    return (T)eglGetProcAddress(name);
+}
+
+int glfwInit(void) {
+    if (s_Headless.Display != EGL_NO_DISPLAY) {
+        return GLFW_TRUE;
+    }
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (!getPlatformDisplay) {
+        std::cerr << "headless: EGL has no eglGetPlatformDisplayEXT" << std::endl;
+        return GLFW_FALSE;
+    }
+    s_Headless.Display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (s_Headless.Display == EGL_NO_DISPLAY || !eglInitialize(s_Headless.Display, nullptr, nullptr) ||
+        !eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "headless: can't initialize EGL" << std::endl;
+        s_Headless.Display = EGL_NO_DISPLAY;
+        return GLFW_FALSE;
+    }
+    if (const char* frames = std::getenv("HEADLESS_FRAMES")) {
+        s_Headless.FramesToDraw = std::max(1, std::atoi(frames));
+    }
+    return GLFW_TRUE;
+}
+
+void glfwWindowHint(int hint, int value) {
+    switch (hint) {
+        case GLFW_CONTEXT_VERSION_MAJOR: s_Headless.Major = value; break;
+        case GLFW_CONTEXT_VERSION_MINOR: s_Headless.Minor = value; break;
+        case GLFW_OPENGL_PROFILE: s_Headless.Profile = value; break;
+        case GLFW_OPENGL_FORWARD_COMPAT: s_Headless.ForwardCompatible = value != 0; break;
+        case GLFW_OPENGL_DEBUG_CONTEXT: s_Headless.Debug = value != 0; break;
+        default: break;
+    }
+}
+
+GLFWwindow* glfwCreateWindow(int width, int height, const char*, GLFWmonitor*, GLFWwindow*) {
+    if (s_Headless.Display == EGL_NO_DISPLAY) {
+        return nullptr;
+    }
+    std::vector<EGLint> attributes;
+    if (s_Headless.Major > 0) {
+        attributes.insert(attributes.end(), {EGL_CONTEXT_MAJOR_VERSION, s_Headless.Major,
+                                             EGL_CONTEXT_MINOR_VERSION, s_Headless.Minor});
+    }
+    if (s_Headless.Profile == GLFW_OPENGL_CORE_PROFILE) {
+        attributes.insert(attributes.end(), {EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT});
+    }
+    else {
+        // What glfw gives without hints, and what glBegin needs.
+        attributes.insert(attributes.end(),
+                          {EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT});
+    }
+    if (s_Headless.ForwardCompatible) {
+        attributes.insert(attributes.end(), {EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE, EGL_TRUE});
+    }
+    if (s_Headless.Debug) {
+        attributes.insert(attributes.end(), {EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE});
+    }
+    attributes.push_back(EGL_NONE);
+
+    EGLContext context = eglCreateContext(s_Headless.Display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes.data());
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "headless: can't create the context the window hints ask for" << std::endl;
+        return nullptr;
+    }
+    return new GLFWwindow{width, height, context};
+}
+
+void glfwMakeContextCurrent(GLFWwindow* window) {
+    s_Headless.Current = window;
+    if (!window) {
+        eglMakeCurrent(s_Headless.Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        return;
+    }
+    eglMakeCurrent(s_Headless.Display, EGL_NO_SURFACE, EGL_NO_SURFACE, window->Context);
+    if (window->Framebuffer) {
+        return;
+    }
+
+    // The window's framebuffer: a color and a depth-stencil renderbuffer. The
+    // lessons never bind another one, so it stays bound.
+    auto genRenderbuffers = GetGL<PFNGLGENRENDERBUFFERSPROC>("glGenRenderbuffers");
+    auto bindRenderbuffer = GetGL<PFNGLBINDRENDERBUFFERPROC>("glBindRenderbuffer");
+    auto renderbufferStorage = GetGL<PFNGLRENDERBUFFERSTORAGEPROC>("glRenderbufferStorage");
+    auto genFramebuffers = GetGL<PFNGLGENFRAMEBUFFERSPROC>("glGenFramebuffers");
+    auto bindFramebuffer = GetGL<PFNGLBINDFRAMEBUFFERPROC>("glBindFramebuffer");
+    auto framebufferRenderbuffer = GetGL<PFNGLFRAMEBUFFERRENDERBUFFERPROC>("glFramebufferRenderbuffer");
+    // Not the counted one above.
+    auto viewport = GetGL<void (GLAPIENTRY*)(GLint, GLint, GLsizei, GLsizei)>("glViewport");
+
+    genRenderbuffers(2, window->Renderbuffers);
+    bindRenderbuffer(GL_RENDERBUFFER, window->Renderbuffers[0]);
+    renderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, window->Width, window->Height);
+    bindRenderbuffer(GL_RENDERBUFFER, window->Renderbuffers[1]);
+    renderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, window->Width, window->Height);
+    bindRenderbuffer(GL_RENDERBUFFER, 0);
+    genFramebuffers(1, &window->Framebuffer);
+    bindFramebuffer(GL_FRAMEBUFFER, window->Framebuffer);
+    framebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, window->Renderbuffers[0]);
+    framebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, window->Renderbuffers[1]);
+    // A window's viewport starts out as the window.
+    viewport(0, 0, window->Width, window->Height);
+}
+
+GLFWwindow* glfwGetCurrentContext(void) {
+    return s_Headless.Current;
+}
+
+// Bottom row first in GL, top row first in the file.
+static void WriteCapture(GLFWwindow* window, const char* path) {
+    std::vector<unsigned char> pixels((size_t)window->Width * window->Height * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, window->Width, window->Height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n" << window->Width << " " << window->Height << "\n255\n";
+    size_t row = (size_t)window->Width * 3;
+    for (int y = window->Height - 1; y >= 0; y--) {
+        file.write((const char*)&pixels[y * row], row);
+    }
+    if (!file) {
+        std::cerr << "headless: can't write " << path << std::endl;
+    }
+}
+
+void glfwSwapBuffers(GLFWwindow* window) {
+    glFinish();
+    Clock::time_point now = Clock::now();
+    s_Headless.Frames++;
+    if (s_Headless.Frames == 1) {
+        // The first frame is setup and frame in one, it counts as setup.
+        s_Headless.SetupCalls = s_Headless.Calls;
+        s_Headless.SetupDrawCalls = s_Headless.DrawCalls;
+    }
+    else {
+        s_Headless.FrameMs.push_back(std::chrono::duration<double, std::milli>(now - s_Headless.LastSwap).count());
+    }
+    s_Headless.LastSwap = now;
+
+    if (s_Headless.Frames == s_Headless.FramesToDraw) {
+        s_Headless.FrameCalls = s_Headless.Calls - s_Headless.SetupCalls;
+        s_Headless.FrameDrawCalls = s_Headless.DrawCalls - s_Headless.SetupDrawCalls;
+        if (const char* capture = std::getenv("HEADLESS_CAPTURE")) {
+            WriteCapture(window, capture);
+        }
+        window->ShouldClose = true;
+    }
+}
+
+int glfwWindowShouldClose(GLFWwindow* window) {
+    return window->ShouldClose;
+}
+
+void glfwSetWindowShouldClose(GLFWwindow* window, int value) {
+    window->ShouldClose = value != 0;
+}
+
+static double Percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(p * values.size()))];
+}
+
+static void WriteMetrics(const char* path) {
+    const std::vector<double>& ms = s_Headless.FrameMs;
+    double mean = 0.0;
+    for (double frame : ms) {
+        mean += frame;
+    }
+    mean /= std::max<size_t>(ms.size(), 1);
+    // Per frame, over the frames after the first.
+    double frames = std::max(s_Headless.Frames - 1, 1);
+
+    std::ofstream file(path);
+    file << "{\n"
+         << "    \"frames\": " << s_Headless.Frames << ",\n"
+         << "    \"setup_gl_calls\": " << s_Headless.SetupCalls << ",\n"
+         << "    \"gl_calls_per_frame\": " << s_Headless.FrameCalls / frames << ",\n"
+         << "    \"draw_calls_per_frame\": " << s_Headless.FrameDrawCalls / frames << ",\n"
+         << "    \"frame_ms_mean\": " << mean << ",\n"
+         << "    \"frame_ms_p50\": " << Percentile(ms, 0.5) << ",\n"
+         << "    \"frame_ms_p95\": " << Percentile(ms, 0.95) << ",\n"
+         << "    \"frame_ms_max\": " << Percentile(ms, 1.0) << "\n"
+         << "}\n";
+    if (!file) {
+        std::cerr << "headless: can't write " << path << std::endl;
+    }
+}
+
+void glfwDestroyWindow(GLFWwindow* window) {
+    if (!window) {
+        return;
+    }
+    if (s_Headless.Current == window) {
+        glfwMakeContextCurrent(nullptr);
+    }
+    eglDestroyContext(s_Headless.Display, window->Context);
+    delete window;
+}
+
+void glfwTerminate(void) {
+    if (s_Headless.Display == EGL_NO_DISPLAY) {
+        return;
+    }
+    // Only a lesson that got through its frames has metrics worth writing.
+    const char* metrics = std::getenv("HEADLESS_METRICS");
+    if (metrics && s_Headless.Frames >= s_Headless.FramesToDraw) {
+        WriteMetrics(metrics);
+    }
+    glfwDestroyWindow(s_Headless.Current);
+    eglTerminate(s_Headless.Display);
+    s_Headless.Display = EGL_NO_DISPLAY;
+}
+
+double glfwGetTime(void) {
+    return s_Headless.Frames / 60.0;
+}
+
+int glfwExtensionSupported(const char* name) {
+    auto getStringi = GetGL<PFNGLGETSTRINGIPROC>("glGetStringi");
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        if (std::strcmp((const char*)getStringi(GL_EXTENSIONS, i), name) == 0) {
+            return GLFW_TRUE;
+        }
+    }
+    // No window system, so no WGL_ or GLX_ extensions either.
+    return GLFW_FALSE;
+}
+
+// No window, so no events: nothing to wait for and no keys pressed.
+void glfwSwapInterval(int) {}
+void glfwPollEvents(void) {}
+void glfwWaitEvents(void) {}
+void glfwWaitEventsTimeout(double) {}
+void glfwPostEmptyEvent(void) {}
+
+int glfwGetKey(GLFWwindow*, int) {
+    return GLFW_RELEASE;
+}
+
+void glfwGetFramebufferSize(GLFWwindow* window, int* width, int* height) {
+    if (width) {
+        *width = window->Width;
+    }
+    if (height) {
+        *height = window->Height;
+    }
+}
+
+void* glfwGetWindowUserPointer(GLFWwindow* window) {
+    return window->UserPointer;
+}
+
+void glfwSetWindowUserPointer(GLFWwindow* window, void* pointer) {
+    window->UserPointer = pointer;
+}
+
+// Set, but never called.
+GLFWframebuffersizefun glfwSetFramebufferSizeCallback(GLFWwindow*, GLFWframebuffersizefun) {
+    return nullptr;
+}
+
+GLFWkeyfun glfwSetKeyCallback(GLFWwindow*, GLFWkeyfun) {
+    return nullptr;
+}
+
+GLFWcursorposfun glfwSetCursorPosCallback(GLFWwindow*, GLFWcursorposfun) {
+    return nullptr;
+}
+
+GLFWwindowrefreshfun glfwSetWindowRefreshCallback(GLFWwindow*, GLFWwindowrefreshfun) {
+    return nullptr;
+}
+
+GLFWwindowfocusfun glfwSetWindowFocusCallback(GLFWwindow*, GLFWwindowfocusfun) {
+    return nullptr;
+}
@@ -0,0 +1,243 @@
+/*
+    Checks what a lesson left behind (HeadlessGLFW.cpp) against what it
+    should look like and cost:
+
+    - The captured frame against the golden image. A pixel differs when one
+      of its channels is more than "image_tolerance" off; the test fails if
+      more than "image_max_differing" of the pixels (a fraction) differ.
+      Rasterization is not exactly the same on every driver and version, so
+      some difference is allowed. What failed is shown in <capture>.diff.ppm:
+      the golden image, darkened, with the differing pixels in red.
+    - The metrics against the thresholds: for every "max_<metric>" and
+      "min_<metric>" of the scene, the metric (e.g. frame_ms_p50,
+      draw_calls_per_frame) must be at most, or at least, that.
+
+    thresholds.json has a "default" object and one object per scene; a
+    scene's values replace the defaults. The "bench" object holds the
+    frame times. They depend on the machine and on whatever else it is
+    doing, so only --bench ("make bench") checks them, never "make test".
+    Its limits are about 10x what llvmpipe takes here on one core, so only
+    a real slowdown fails.
+
+    Usage: check [--bench] <scene> <thresholds.json> <metrics.json> [<capture.ppm> <golden.ppm>]
+*/
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Just enough JSON for our two files: objects, numbers and strings.
+struct JsonValue {
+    double Number = 0.0;
+    std::string String;
+    std::map<std::string, JsonValue> Object;
+    bool IsObject = false;
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : m_Text(text) {}
+
+    bool Parse(JsonValue& value) {
+        return ParseValue(value) && (SkipSpace(), m_Position == m_Text.size());
+    }
+
+private:
+    void SkipSpace() {
+        while (m_Position < m_Text.size() && std::isspace((unsigned char)m_Text[m_Position])) {
+            m_Position++;
+        }
+    }
+
+    bool Expect(char c) {
+        SkipSpace();
+        if (m_Position < m_Text.size() && m_Text[m_Position] == c) {
+            m_Position++;
+            return true;
+        }
+        return false;
+    }
+
+    bool ParseString(std::string& out) {
+        if (!Expect('"')) {
+            return false;
+        }
+        while (m_Position < m_Text.size() && m_Text[m_Position] != '"') {
+            if (m_Text[m_Position] == '\\' && m_Position + 1 < m_Text.size()) {
+                m_Position++;
+            }
+            out += m_Text[m_Position++];
+        }
+        return Expect('"');
+    }
+
+    bool ParseValue(JsonValue& value) {
+        SkipSpace();
+        if (m_Position >= m_Text.size()) {
+            return false;
+        }
+        char c = m_Text[m_Position];
+        if (c == '"') {
+            return ParseString(value.String);
+        }
+        if (c == '{') {
+            m_Position++;
+            value.IsObject = true;
+            if (Expect('}')) {
+                return true;
+            }
+            do {
+                std::string key;
+                if (!ParseString(key) || !Expect(':') || !ParseValue(value.Object[key])) {
+                    return false;
+                }
+            } while (Expect(','));
+            return Expect('}');
+        }
+        const char* start = m_Text.c_str() + m_Position;
+        char* end;
+        value.Number = std::strtod(start, &end);
+        m_Position += end - start;
+        return end != start;
+    }
+
+    const std::string& m_Text;
+    size_t m_Position = 0;
+};
+
+static bool ReadJson(const std::string& path, JsonValue& value) {
+    std::ifstream file(path);
+    std::stringstream text;
+    text << file.rdbuf();
+    if (!file || !JsonParser(text.str()).Parse(value) || !value.IsObject) {
+        std::cerr << "Can't read " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+struct Image {
+    int Width = 0;
+    int Height = 0;
+    std::vector<unsigned char> Pixels;
+};
+
+static bool ReadPpm(const std::string& path, Image& image) {
+    std::ifstream file(path, std::ios::binary);
+    std::string magic;
+    int maxValue = 0;
+    file >> magic >> image.Width >> image.Height >> maxValue;
+    file.get();
+    if (!file || magic != "P6" || maxValue != 255) {
+        std::cerr << "Can't read " << path << std::endl;
+        return false;
+    }
+    image.Pixels.resize((size_t)image.Width * image.Height * 3);
+    file.read((char*)image.Pixels.data(), image.Pixels.size());
+    return (bool)file;
+}
+
+static void WritePpm(const std::string& path, const Image& image) {
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n" << image.Width << " " << image.Height << "\n255\n";
+    file.write((const char*)image.Pixels.data(), image.Pixels.size());
+}
+
+static bool CompareImages(const std::string& capturePath, const std::string& goldenPath, double tolerance,
+                          double maxDiffering) {
+    Image capture, golden;
+    if (!ReadPpm(capturePath, capture) || !ReadPpm(goldenPath, golden)) {
+        return false;
+    }
+    if (capture.Width != golden.Width || capture.Height != golden.Height) {
+        std::cout << "image:     " << capture.Width << "x" << capture.Height << ", golden is " << golden.Width << "x"
+                  << golden.Height << "\n";
+        return false;
+    }
+
+    Image diff = golden;
+    size_t differing = 0;
+    int largest = 0;
+    for (size_t pixel = 0; pixel < golden.Pixels.size(); pixel += 3) {
+        int difference = 0;
+        for (size_t c = 0; c < 3; c++) {
+            difference = std::max(difference, std::abs(capture.Pixels[pixel + c] - golden.Pixels[pixel + c]));
+        }
+        largest = std::max(largest, difference);
+        bool differs = difference > tolerance;
+        differing += differs;
+        for (size_t c = 0; c < 3; c++) {
+            diff.Pixels[pixel + c] = differs ? (c == 0 ? 255 : 0) : golden.Pixels[pixel + c] / 4;
+        }
+    }
+    double fraction = (double)differing / ((size_t)golden.Width * golden.Height);
+    bool valid = fraction <= maxDiffering;
+    std::cout << "image:     " << differing << " pixels (" << fraction * 100.0 << "%) differ by more than "
+              << tolerance << ", largest difference " << largest << (valid ? "" : ", TOO MANY") << "\n";
+    if (!valid) {
+        WritePpm(capturePath + ".diff.ppm", diff);
+        std::cout << "           see " << capturePath << ".diff.ppm\n";
+    }
+    return valid;
+}
+
+int main(int argc, char* argv[]) {
+    bool bench = argc > 1 && std::string(argv[1]) == "--bench";
+    if (bench) {
+        argc--;
+        argv++;
+    }
+    if (argc != 4 && argc != 6) {
+        std::cerr << "Usage: check [--bench] <scene> <thresholds.json> <metrics.json> [<capture.ppm> <golden.ppm>]"
+                  << std::endl;
+        return 2;
+    }
+    const std::string scene = argv[1];
+    JsonValue thresholds, metrics;
+    if (!ReadJson(argv[2], thresholds) || !ReadJson(argv[3], metrics)) {
+        return 1;
+    }
+    std::map<std::string, JsonValue> limits = thresholds.Object["default"].Object;
+    for (const auto& limit : thresholds.Object[scene].Object) {
+        limits[limit.first] = limit.second;
+    }
+    if (bench) {
+        for (const auto& limit : thresholds.Object["bench"].Object) {
+            limits[limit.first] = limit.second;
+        }
+    }
+
+    bool valid = true;
+    for (const auto& limit : limits) {
+        const std::string& key = limit.first;
+        bool isMax = key.compare(0, 4, "max_") == 0, isMin = key.compare(0, 4, "min_") == 0;
+        if (!isMax && !isMin) {
+            continue;
+        }
+        std::string name = key.substr(4);
+        auto metric = metrics.Object.find(name);
+        if (metric == metrics.Object.end()) {
+            std::cout << name << ": missing\n";
+            valid = false;
+            continue;
+        }
+        double value = metric->second.Number, bound = limit.second.Number;
+        bool within = isMax ? value <= bound : value >= bound;
+        std::cout << name << ": " << value << (isMax ? " <= " : " >= ") << bound << (within ? "" : "  FAILED")
+                  << "\n";
+        valid = valid && within;
+    }
+
+    if (argc == 6) {
+        valid = CompareImages(argv[4], argv[5], limits["image_tolerance"].Number,
+                              limits["image_max_differing"].Number) && valid;
+    }
+    std::cout << scene << ": " << (valid ? "passed" : "FAILED") << "\n";
+    return valid ? 0 : 1;
+}